@@ -0,0 +1,73 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "bench.h"
+#include <stdio.h>
+#include <time.h>
+
+#ifndef BENCH_REV
+#define BENCH_REV "unknown"
+#endif
+
+int64_t bench_nanos()
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;
+}
+
+const char *bench_rev()
+{
+        return BENCH_REV;
+}
+
+static void bench_print(
+        const char *suite,
+        const char *bench,
+        const size_t size,
+        const size_t iterations,
+        const int64_t nanos,
+        const char *extra)
+{
+        const double per_op = iterations ? 
+                (double)nanos / (double)iterations : 0;
+        const double per_sec = nanos ? 
+                (double)iterations * 1e9 / (double)nanos : 0;
+
+        printf( "{\"suite\":\"%s\",\"bench\":\"%s\",\"size\":%zu,"
+                "\"iterations\":%zu,\"ns\":%lld,\"ns_per_op\":%.2f,"
+                "\"ops_per_sec\":%.2f,%s\"rev\":\"%s\"}\n",
+                suite,
+                bench,
+                size,
+                iterations,
+                (long long)nanos,
+                per_op,
+                per_sec,
+                extra,
+                bench_rev());
+
+        fflush(stdout);
+}
+
+void bench_report(
+        const char *suite,
+        const char *bench,
+        const size_t size,
+        const size_t iterations,
+        const int64_t nanos)
+{
+        bench_print(suite, bench, size, iterations, nanos, "");
+}
+
+void bench_report_bytes(
+        const char *suite,
+        const char *bench,
+        const size_t size,
+        const size_t iterations,
+        const int64_t nanos,
+        const size_t bytes_out)
+{
+        char extra[48];
+        snprintf(extra, sizeof(extra), "\"bytes_out\":%zu,", bytes_out);
+        bench_print(suite, bench, size, iterations, nanos, extra);
+}
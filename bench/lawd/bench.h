@@ -0,0 +1,42 @@
+#ifndef LAWD_BENCH_H
+#define LAWD_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** 
+ * Get a monotonic timestamp in nanoseconds. 
+ */
+int64_t bench_nanos();
+
+/**
+ * Get the revision the benchmarks were built from.
+ */
+const char *bench_rev();
+
+/**
+ * Print a single result as one line of JSON to stdout.
+ * 
+ * {"suite":"table","bench":"insert","size":1024,"iterations":1024,
+ *  "ns":51200,"ns_per_op":50.00,"ops_per_sec":20000000.00,"rev":"ddc3516"}
+ */
+void bench_report(
+        const char *suite,
+        const char *bench,
+        const size_t size,
+        const size_t iterations,
+        const int64_t nanos);
+
+/**
+ * Print a result like bench_report, with the bytes the benchmark produced
+ * (compressed output, for example) as "bytes_out".
+ */
+void bench_report_bytes(
+        const char *suite,
+        const char *bench,
+        const size_t size,
+        const size_t iterations,
+        const int64_t nanos,
+        const size_t bytes_out);
+
+#endif
@@ -0,0 +1,97 @@
+
+#include "lawd/buffer.h"
+#include "lawd/error.h"
+#include "bench.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#define ITERATIONS 100000
+
+static const char *HEAD = 
+        "GET /index.html HTTP/1.1\r\n"
+        "Host: www.example.com\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) "
+                "Gecko/20100101 Firefox/115.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;"
+                "q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.5\r\n"
+        "Accept-Encoding: gzip, deflate, br\r\n"
+        "Connection: keep-alive\r\n"
+        "Upgrade-Insecure-Requests: 1\r\n"
+        "\r\n";
+
+void bench_get_put()
+{
+        uint8_t bytes[0x1000], chunk[64];
+        struct pgc_buf buf;
+        pgc_buf_init(&buf, bytes, sizeof(bytes), 0);
+
+        memset(chunk, 'x', sizeof(chunk));
+
+        const int64_t start = bench_nanos();
+
+        for(int x = 0; x < ITERATIONS; ++x) {
+                SEL_TEST(pgc_buf_put(&buf, chunk, 64) == PGC_ERR_OK);
+                SEL_TEST(pgc_buf_get(&buf, chunk, 64) == PGC_ERR_OK);
+        }
+
+        bench_report("buffer", "put_get_64", 64, ITERATIONS, 
+                bench_nanos() - start);
+}
+
+void bench_scan()
+{
+        const size_t len = strlen(HEAD);
+
+        uint8_t bytes[0x1000];
+        struct pgc_buf buf;
+        pgc_buf_init(&buf, bytes, sizeof(bytes), 0);
+
+        const int64_t start = bench_nanos();
+
+        for(int x = 0; x < ITERATIONS; ++x) {
+                const size_t base = pgc_buf_tell(&buf);
+                SEL_TEST(pgc_buf_put(&buf, HEAD, len) == PGC_ERR_OK);
+                SEL_TEST(pgc_buf_scan(&buf, "\r\n\r\n", 4) == PGC_ERR_OK);
+                SEL_TEST(pgc_buf_tell(&buf) - base == len);
+        }
+
+        bench_report("buffer", "scan_crlf2", len, ITERATIONS, 
+                bench_nanos() - start);
+}
+
+void bench_read()
+{
+        const size_t len = strlen(HEAD);
+
+        uint8_t bytes[0x1000];
+        struct pgc_buf buf;
+        pgc_buf_init(&buf, bytes, sizeof(bytes), 0);
+
+        int fds[2];
+        SEL_TEST(pipe(fds) == 0);
+
+        const int64_t start = bench_nanos();
+
+        for(int x = 0; x < ITERATIONS; ++x) {
+                SEL_TEST(write(fds[1], HEAD, len) == len);
+                SEL_TEST(law_buf_read(&buf, fds[0], len) == len);
+                SEL_TEST(pgc_buf_seek(&buf, pgc_buf_end(&buf)) == PGC_ERR_OK);
+        }
+
+        /* Includes the write syscall which feeds the pipe. */
+        bench_report("buffer", "law_buf_read", len, ITERATIONS, 
+                bench_nanos() - start);
+
+        close(fds[0]);
+        close(fds[1]);
+}
+
+int main(int argc, char **args)
+{
+        bench_get_put();
+        bench_scan();
+        bench_read();
+        return 0;
+}
@@ -0,0 +1,86 @@
+
+#include "lawd/coroutine.h"
+#include "lawd/error.h"
+#include "bench.h"
+
+#define ITERATIONS 1000000
+
+int bench_return(law_cor_t *caller, law_cor_t *callee, void *state)
+{
+        return 0;
+}
+
+void bench_call()
+{
+        law_cor_t *caller = law_cor_create();
+        law_cor_t *callee = law_cor_create();
+        law_smem_t *stack = law_smem_create(0x4000, 0x1000);
+
+        SEL_TEST(caller && callee && stack);
+
+        const int64_t start = bench_nanos();
+
+        for(int x = 0; x < ITERATIONS; ++x) {
+                law_cor_call(caller, callee, stack, bench_return, NULL);
+        }
+
+        bench_report(
+                "coroutine", 
+                "call", 
+                0, 
+                ITERATIONS, 
+                bench_nanos() - start);
+
+        law_smem_destroy(stack);
+        law_cor_destroy(callee);
+        law_cor_destroy(caller);
+}
+
+int bench_yield_loop(law_cor_t *caller, law_cor_t *callee, void *state)
+{
+        for(int x = 0; x < ITERATIONS; ++x) {
+                law_cor_yield(caller, callee, 1);
+        }
+        return 0;
+}
+
+void bench_switch()
+{
+        law_cor_t *caller = law_cor_create();
+        law_cor_t *callee = law_cor_create();
+        law_smem_t *stack = law_smem_create(0x4000, 0x1000);
+
+        SEL_TEST(caller && callee && stack);
+
+        const int64_t start = bench_nanos();
+
+        int signal = law_cor_call(
+                caller, 
+                callee, 
+                stack, 
+                bench_yield_loop, 
+                NULL);
+
+        while(signal == 1) {
+                signal = law_cor_resume(caller, callee, 0);
+        }
+
+        /* Each iteration is one yield plus one resume. */
+        bench_report(
+                "coroutine", 
+                "yield_resume", 
+                0, 
+                ITERATIONS, 
+                bench_nanos() - start);
+
+        law_smem_destroy(stack);
+        law_cor_destroy(callee);
+        law_cor_destroy(caller);
+}
+
+int main(int argc, char **args)
+{
+        bench_call();
+        bench_switch();
+        return 0;
+}
@@ -0,0 +1,85 @@
+
+#include "hdr.h"
+#include <string.h>
+
+#define HDR_SUB_COUNT (1 << BENCH_HDR_SUB_BITS)
+#define HDR_SUB_HALF (1 << (BENCH_HDR_SUB_BITS - 1))
+
+static size_t bench_hdr_index(const int64_t value)
+{
+        const uint64_t v = (uint64_t)value;
+
+        if(v < HDR_SUB_COUNT) return (size_t)v;
+
+        const int msb = 63 - __builtin_clzll(v);
+        const int shift = msb - (BENCH_HDR_SUB_BITS - 1);
+        const size_t index = (size_t)HDR_SUB_COUNT +
+                (size_t)(shift - 1) * HDR_SUB_HALF +
+                (size_t)(v >> shift) - HDR_SUB_HALF;
+
+        return index < BENCH_HDR_BUCKETS ? index : BENCH_HDR_BUCKETS - 1;
+}
+
+static int64_t bench_hdr_value(const size_t index)
+{
+        if(index < HDR_SUB_COUNT) return (int64_t)index;
+
+        const size_t offset = index - HDR_SUB_COUNT;
+        const int shift = (int)(offset / HDR_SUB_HALF) + 1;
+        const uint64_t sub = offset % HDR_SUB_HALF + HDR_SUB_HALF;
+
+        return (int64_t)(((sub + 1) << shift) - 1);
+}
+
+void bench_hdr_init(bench_hdr_t *hdr)
+{
+        memset(hdr, 0, sizeof(bench_hdr_t));
+        hdr->min = INT64_MAX;
+}
+
+void bench_hdr_record(bench_hdr_t *hdr, int64_t value)
+{
+        if(value < 0) value = 0;
+        hdr->counts[bench_hdr_index(value)] += 1;
+        hdr->total += 1;
+        hdr->sum += (double)value;
+        if(value < hdr->min) hdr->min = value;
+        if(value > hdr->max) hdr->max = value;
+}
+
+void bench_hdr_merge(bench_hdr_t *dst, const bench_hdr_t *src)
+{
+        for(size_t x = 0; x < BENCH_HDR_BUCKETS; ++x) {
+                dst->counts[x] += src->counts[x];
+        }
+        dst->total += src->total;
+        dst->sum += src->sum;
+        if(src->min < dst->min) dst->min = src->min;
+        if(src->max > dst->max) dst->max = src->max;
+}
+
+int64_t bench_hdr_percentile(const bench_hdr_t *hdr, const double percentile)
+{
+        if(!hdr->total) return 0;
+
+        uint64_t rank = (uint64_t)(percentile / 100.0 * (double)hdr->total);
+        if(rank < 1) rank = 1;
+        if(rank > hdr->total) rank = hdr->total;
+
+        uint64_t seen = 0;
+
+        for(size_t x = 0; x < BENCH_HDR_BUCKETS; ++x) {
+                seen += hdr->counts[x];
+                if(seen >= rank) {
+                        const int64_t value = bench_hdr_value(x);
+                        return value < hdr->max ? value : hdr->max;
+                }
+        }
+
+        return hdr->max;
+}
+
+double bench_hdr_mean(const bench_hdr_t *hdr)
+{
+        return hdr->total ? hdr->sum / (double)hdr->total : 0;
+}
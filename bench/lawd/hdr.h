@@ -0,0 +1,54 @@
+#ifndef LAWD_BENCH_HDR_H
+#define LAWD_BENCH_HDR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Linear Sub-Buckets per Power of Two (three significant digits) */
+#define BENCH_HDR_SUB_BITS 11
+
+/** Number of Counters (values up to 2^42) */
+#define BENCH_HDR_BUCKETS \
+        ((1 << BENCH_HDR_SUB_BITS) + \
+        (42 - BENCH_HDR_SUB_BITS) * (1 << (BENCH_HDR_SUB_BITS - 1)))
+
+/**
+ * Log-linear (HDR) histogram.  Every recorded value is kept to within
+ * 1/1024 of its magnitude, so high percentiles stay exact enough to compare
+ * across runs without storing individual samples.
+ */
+typedef struct bench_hdr {
+        uint64_t counts[BENCH_HDR_BUCKETS];     /** Bucket Counters */
+        uint64_t total;                         /** Number of Samples */
+        int64_t min;                            /** Smallest Sample */
+        int64_t max;                            /** Largest Sample */
+        double sum;                             /** Sum of Samples */
+} bench_hdr_t;
+
+/**
+ * Reset the histogram.
+ */
+void bench_hdr_init(bench_hdr_t *hdr);
+
+/**
+ * Record a non-negative sample.  Negative samples are recorded as zero.
+ */
+void bench_hdr_record(bench_hdr_t *hdr, int64_t value);
+
+/**
+ * Add every sample of src to dst.
+ */
+void bench_hdr_merge(bench_hdr_t *dst, const bench_hdr_t *src);
+
+/**
+ * Get the value at the percentile (0 to 100).  The result is the highest
+ * value equivalent to the bucket holding the percentile, capped by max.
+ */
+int64_t bench_hdr_percentile(const bench_hdr_t *hdr, const double percentile);
+
+/**
+ * Get the mean of all samples.
+ */
+double bench_hdr_mean(const bench_hdr_t *hdr);
+
+#endif
@@ -0,0 +1,120 @@
+
+#include "lawd/http_gzip.h"
+#include "lawd/error.h"
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+#define ITERATIONS 200
+
+static const int LEVELS[] = { 1, 3, 5, 6, 9 };
+
+static char json[0x10000], html[0x10000], packed[0x10000];
+
+/** An API response: records with repeated keys and varied values. */
+static size_t make_json()
+{
+        size_t length = 0;
+        for(int x = 0; length + 160 < sizeof(json); ++x)
+                length += (size_t)sprintf(json + length,
+                        "{\"id\":%i,\"login\":\"user%i\",\"score\":%i.%02i,"
+                        "\"active\":%s,\"tags\":[\"t%i\",\"t%i\"]},\n",
+                        x, x * 7919 % 10007, x * 31 % 977, x % 100,
+                        x % 3 ? "true" : "false", x % 13, x % 29);
+        return length;
+}
+
+/** A rendered page: a table of rows in repeated markup. */
+static size_t make_html()
+{
+        size_t length = 0;
+        for(int x = 0; length + 200 < sizeof(html); ++x)
+                length += (size_t)sprintf(html + length,
+                        "<tr class=\"row-%s\"><td><a href=\"/items/%i\">"
+                        "Item %i</a></td><td>%i.%02i</td>"
+                        "<td><span class=\"badge\">%s</span></td></tr>\n",
+                        x % 2 ? "odd" : "even", x * 37 % 5003, x,
+                        x * 13 % 400, x % 100, x % 5 ? "stock" : "sold");
+        return length;
+}
+
+/** CPU against bytes: time and output size per level and body. */
+void bench_levels(
+        law_hgz_t *hgz,
+        const char *name,
+        const char *body,
+        const size_t length)
+{
+        for(size_t l = 0; l < sizeof(LEVELS) / sizeof(*LEVELS); ++l) {
+                size_t out = 0;
+
+                const int64_t start = bench_nanos();
+                for(int x = 0; x < ITERATIONS; ++x)
+                        SEL_TEST(law_hgz_compress(
+                                hgz, NULL, LAW_HGZ_GZIP, LEVELS[l],
+                                body, length,
+                                packed, sizeof(packed),
+                                &out) == LAW_ERR_OK);
+                const int64_t nanos = bench_nanos() - start;
+
+                char bench[32];
+                snprintf(bench, sizeof(bench), "gzip_%s_l%i", name, LEVELS[l]);
+                bench_report_bytes("http_gzip", bench, length, ITERATIONS,
+                        nanos, out);
+        }
+}
+
+/** A deflate state per response, against one reset per response. */
+void bench_setup(law_hgz_t *hgz, const char *body, const size_t length)
+{
+        const size_t small = 1024;
+        size_t out = 0;
+
+        int64_t start = bench_nanos();
+        for(int x = 0; x < ITERATIONS * 10; ++x) {
+                z_stream z;
+                memset(&z, 0, sizeof(z));
+                SEL_TEST(deflateInit2(&z, 5, Z_DEFLATED, 15 + 16, 8,
+                        Z_DEFAULT_STRATEGY) == Z_OK);
+                z.next_in = (Bytef*)body;
+                z.avail_in = (uInt)small;
+                z.next_out = (Bytef*)packed;
+                z.avail_out = sizeof(packed);
+                SEL_TEST(deflate(&z, Z_FINISH) == Z_STREAM_END);
+                out = z.total_out;
+                deflateEnd(&z);
+        }
+        bench_report_bytes("http_gzip", "init_per_body", small,
+                ITERATIONS * 10, bench_nanos() - start, out);
+
+        start = bench_nanos();
+        for(int x = 0; x < ITERATIONS * 10; ++x)
+                SEL_TEST(law_hgz_compress(
+                        hgz, NULL, LAW_HGZ_GZIP, 5,
+                        body, small,
+                        packed, sizeof(packed),
+                        &out) == LAW_ERR_OK);
+        bench_report_bytes("http_gzip", "reset_per_body", small,
+                ITERATIONS * 10, bench_nanos() - start, out);
+}
+
+int main(int argc, char **args)
+{
+        law_server_cfg_t srv_cfg = law_server_sanity();
+        srv_cfg.workers = 1;
+        law_hgz_cfg_t cfg = law_hgz_sanity();
+
+        law_hgz_t *hgz = law_hgz_create(&srv_cfg, &cfg);
+        SEL_TEST(hgz);
+
+        const size_t json_length = make_json();
+        const size_t html_length = make_html();
+
+        bench_levels(hgz, "json", json, json_length);
+        bench_levels(hgz, "html", html, html_length);
+        bench_setup(hgz, json, json_length);
+
+        law_hgz_destroy(hgz);
+        return 0;
+}
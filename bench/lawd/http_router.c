@@ -0,0 +1,126 @@
+
+#include "lawd/http_router.h"
+#include "lawd/error.h"
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SERVICES 50
+#define ROUTES (SERVICES * 20)
+#define PATHS 1024
+#define ITERATIONS 1000
+
+static const char *RESOURCES[] = { "items", "orders", "users", "events" };
+
+static const struct {
+        const char *method;
+        const char *format;
+} SHAPES[] = {
+        { "GET",        "/api/v1/svc%02i/%s" },
+        { "POST",       "/api/v1/svc%02i/%s" },
+        { "GET",        "/api/v1/svc%02i/%s/:id" },
+        { "PUT",        "/api/v1/svc%02i/%s/:id" },
+        { "GET",        "/api/v1/svc%02i/%s/:id/history" },
+};
+
+#define NSHAPES (sizeof(SHAPES) / sizeof(*SHAPES))
+
+static char patterns[ROUTES][64];
+static char literals[ROUTES][64];               /** ":id" as "042" */
+static const char *methods[ROUTES];
+static char paths[PATHS][64];
+static const char *path_methods[PATHS];
+
+static sel_err_t on_route(
+        law_worker_t *worker,
+        law_hts_req_t *req,
+        law_hts_reqline_t *reqline,
+        law_htheaders_t *headers,
+        law_hrt_match_t *match,
+        law_data_t data)
+{
+        return LAW_ERR_OK;
+}
+
+/** An API gateway: 50 services, each with the same 20 routes. */
+static void make_routes()
+{
+        size_t r = 0;
+        for(int s = 0; s < SERVICES; ++s)
+        for(size_t x = 0; x < 4; ++x)
+        for(size_t h = 0; h < NSHAPES; ++h, ++r) {
+                snprintf(patterns[r], sizeof(patterns[r]),
+                        SHAPES[h].format, s, RESOURCES[x]);
+                snprintf(literals[r], sizeof(literals[r]),
+                        SHAPES[h].format, s, RESOURCES[x]);
+                char *id = strstr(literals[r], ":id");
+                if(id) memcpy(id, "042", 3);
+                methods[r] = SHAPES[h].method;
+        }
+}
+
+/** Requests spread over the routes, every eighth one to no route. */
+static void make_paths()
+{
+        for(size_t p = 0; p < PATHS; ++p) {
+                const size_t r = p * 7919 % ROUTES;
+                snprintf(paths[p], sizeof(paths[p]), "%s", literals[r]);
+                if(p % 8 == 7) paths[p][6] = '2';       /* "/api/v2" */
+                path_methods[p] = methods[r];
+        }
+}
+
+/** What handlers do without a router: a chain of comparisons. */
+static long match_linear(const char *method, const char *path)
+{
+        for(size_t r = 0; r < ROUTES; ++r)
+                if(!strcmp(path, literals[r]) && !strcmp(method, methods[r]))
+                        return (long)r;
+        return -1;
+}
+
+int main(int argc, char **args)
+{
+        law_server_cfg_t srv_cfg = law_server_sanity();
+        srv_cfg.workers = 1;
+
+        make_routes();
+        make_paths();
+
+        int64_t start = bench_nanos();
+        law_hrt_t *hrt = law_hrt_create(&srv_cfg);
+        SEL_TEST(hrt);
+        for(size_t r = 0; r < ROUTES; ++r) {
+                law_data_t data;
+                data.ptr = NULL;
+                SEL_TEST(law_hrt_add(hrt, law_hrt_method(methods[r]),
+                        patterns[r], on_route, data, NULL) == LAW_ERR_OK);
+        }
+        SEL_TEST(law_hrt_compile(hrt) == LAW_ERR_OK);
+        bench_report("http_router", "compile", ROUTES, 1,
+                bench_nanos() - start);
+
+        law_hrt_match_t match;
+        size_t found = 0;
+
+        start = bench_nanos();
+        for(int x = 0; x < ITERATIONS; ++x)
+        for(size_t p = 0; p < PATHS; ++p)
+                found += law_hrt_match(hrt, path_methods[p], paths[p],
+                        &match) == LAW_ERR_OK;
+        bench_report("http_router", "radix_match", ROUTES,
+                (size_t)ITERATIONS * PATHS, bench_nanos() - start);
+        SEL_TEST(found == (size_t)ITERATIONS * PATHS / 8 * 7);
+
+        found = 0;
+        start = bench_nanos();
+        for(int x = 0; x < ITERATIONS / 10; ++x)
+        for(size_t p = 0; p < PATHS; ++p)
+                found += match_linear(path_methods[p], paths[p]) >= 0;
+        bench_report("http_router", "linear_strcmp", ROUTES,
+                (size_t)ITERATIONS / 10 * PATHS, bench_nanos() - start);
+        SEL_TEST(found == (size_t)ITERATIONS / 10 * PATHS / 8 * 7);
+
+        law_hrt_destroy(hrt);
+        return 0;
+}
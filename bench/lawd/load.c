@@ -0,0 +1,696 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "lawd/server.h"
+#include "lawd/http_conn.h"
+#include "lawd/private/http_conn.h"
+#include "lawd/time.h"
+#include "bench.h"
+#include "hdr.h"
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/ssl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*
+ * Closed-loop HTTP/1.1 load generator running on lawd's own worker and
+ * coroutine runtime.  Every connection is a task spawned on a server
+ * opened with LAW_PROTOCOL_NONE, so the client side exercises the same
+ * event loop, law_sync and law_htconn_t IO paths as the server under test.
+ *
+ *      bin/load -p 8080 -c 64 -t 2 -d 10 -P 4 -r GET,/,3 -r POST,/echo,1
+ *
+ * The report is a single line of JSON on stdout.
+ */
+
+#define LOAD_BUFFER 0x4000
+#define LOAD_MAX_ROUTES 16
+#define LOAD_MAX_PIPELINE 64
+#define LOAD_MAX_HEAD 0x2000
+
+/** Request Mix Entry */
+typedef struct load_route {
+        char method[16];                        /** Request Method */
+        char path[256];                         /** Request Target */
+        int weight;                             /** Relative Weight */
+} load_route_t;
+
+/** Per-Worker Counters */
+typedef struct load_stats {
+        bench_hdr_t latency;                    /** Latency in Microseconds */
+        uint64_t requests;                      /** Completed Responses */
+        uint64_t errors;                        /** Failed Exchanges */
+        uint64_t connects;                      /** Connections Opened */
+        uint64_t closed;                        /** Closed by the Server */
+        uint64_t bytes;                         /** Response Bytes */
+        uint64_t status[6];                     /** Responses by Class */
+} load_stats_t;
+
+/** Load Generator */
+typedef struct load {
+        const char *host;                       /** Target Address */
+        int port;                               /** Target Port */
+        int connections;                        /** Concurrent Connections */
+        int workers;                            /** Worker Threads */
+        int duration;                           /** Run Time in Seconds */
+        int pipeline;                           /** Requests per Batch */
+        bool keepalive;                         /** Reuse Connections */
+        bool tls;                               /** Connect with TLS */
+        size_t body;                            /** Request Body Length */
+        law_time_t timeout;                     /** IO Timeout */
+        load_route_t routes[LOAD_MAX_ROUTES];   /** Request Mix */
+        int num_routes;                         /** Request Mix Length */
+        int total_weight;                       /** Sum of Weights */
+        struct sockaddr_in addr;                /** Resolved Target */
+        SSL_CTX *ssl_ctx;                       /** TLS Client Context */
+        load_stats_t *stats;                    /** Per-Worker Counters */
+        law_time_t deadline;                    /** End of the Run */
+        atomic_int remaining;                   /** Running Connections */
+} load_t;
+
+static char load_body[LOAD_BUFFER];
+
+static sel_err_t load_on_error(
+        law_server_t *server,
+        sel_err_t error,
+        law_data_t data)
+{
+        return LAW_ERR_OK;
+}
+
+static const load_route_t *load_pick(load_t *load, uint32_t *seed)
+{
+        /* xorshift32 */
+        uint32_t x = *seed;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *seed = x;
+
+        int pick = (int)(x % (uint32_t)load->total_weight);
+        for(int n = 0; n < load->num_routes; ++n) {
+                pick -= load->routes[n].weight;
+                if(pick < 0) return load->routes + n;
+        }
+        return load->routes;
+}
+
+static sel_err_t load_connect_cb(int fd, void *state)
+{
+        load_t *load = state;
+
+        if(connect(
+                fd,
+                (struct sockaddr*)&load->addr,
+                sizeof(load->addr)) == 0)
+        {
+                return LAW_ERR_OK;
+        }
+
+        switch(errno) {
+                case EINPROGRESS:
+                case EALREADY:
+                        return LAW_ERR_WANTW;
+                case EISCONN:
+                        return LAW_ERR_OK;
+                default:
+                        return LAW_ERR_PUSH(LAW_ERR_SYS, "connect");
+        }
+}
+
+static sel_err_t load_connect(
+        law_worker_t *worker,
+        load_t *load,
+        law_htconn_t *conn)
+{
+        const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if(fd == -1) return LAW_ERR_PUSH(LAW_ERR_SYS, "socket");
+
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        sel_err_t err = law_ectl(worker, fd, LAW_EV_ADD, 0, 0, 0);
+        if(err != LAW_ERR_OK) goto CLOSE_SOCKET;
+
+        conn->socket = fd;
+        conn->security = LAW_HTC_UNSECURED;
+        conn->ssl = NULL;
+
+        err = law_sync(worker, load->timeout, load_connect_cb, fd, load);
+        if(err != LAW_ERR_OK) goto CLOSE_SOCKET;
+
+        if(load->tls) {
+                err = law_htc_ssl_connect(conn, load->ssl_ctx);
+                switch(err) {
+                        case LAW_ERR_OK:
+                        case LAW_ERR_WANTR:
+                        case LAW_ERR_WANTW:
+                                break;
+                        default:
+                                goto CLOSE_SOCKET;
+                }
+        }
+
+        return LAW_ERR_OK;
+
+        CLOSE_SOCKET:
+        close(fd);
+        return err;
+}
+
+static void load_disconnect(law_htconn_t *conn)
+{
+        if(conn->ssl) {
+                law_htc_ssl_free(conn);
+                conn->ssl = NULL;
+        }
+        close(conn->socket);
+        conn->socket = -1;
+}
+
+static sel_err_t load_write_request(
+        law_worker_t *worker,
+        load_t *load,
+        law_htconn_t *conn,
+        const load_route_t *route,
+        const bool close)
+{
+        char head[LOAD_MAX_HEAD];
+
+        const bool has_body = load->body &&
+                strcmp(route->method, "GET") &&
+                strcmp(route->method, "HEAD");
+
+        const int len = snprintf(
+                head,
+                sizeof(head),
+                "%s %s HTTP/1.1\r\n"
+                "Host: %s:%d\r\n"
+                "%s"
+                "Content-Length: %zu\r\n"
+                "\r\n",
+                route->method,
+                route->path,
+                load->host,
+                load->port,
+                close ? "Connection: close\r\n" : "",
+                has_body ? load->body : (size_t)0);
+
+        if(len < 0 || (size_t)len >= sizeof(head))
+                return LAW_ERR_OOB;
+
+        sel_err_t err = law_htc_ensure_output_sync(
+                worker,
+                load->timeout,
+                conn,
+                (size_t)len);
+        if(err != LAW_ERR_OK) return err;
+
+        SEL_TEST(pgc_buf_put(conn->out, head, (size_t)len) == LAW_ERR_OK);
+
+        for(size_t sent = 0; has_body && sent < load->body;) {
+                size_t block = load->body - sent;
+                if(block > sizeof(load_body) / 2)
+                        block = sizeof(load_body) / 2;
+                err = law_htc_ensure_output_sync(
+                        worker,
+                        load->timeout,
+                        conn,
+                        block);
+                if(err != LAW_ERR_OK) return err;
+                SEL_TEST(pgc_buf_put(conn->out, load_body, block) ==
+                        LAW_ERR_OK);
+                sent += block;
+        }
+
+        return LAW_ERR_OK;
+}
+
+typedef struct load_scan_args {
+        law_htconn_t *conn;
+        size_t base;
+} load_scan_args_t;
+
+static sel_err_t load_scan_cb(int fd, void *state)
+{
+        load_scan_args_t *args = state;
+        return law_htc_read_scan(args->conn, args->base, "\r\n\r\n", 4);
+}
+
+static sel_err_t load_discard(
+        law_worker_t *worker,
+        load_t *load,
+        law_htconn_t *conn,
+        int64_t length)
+{
+        struct pgc_buf *in = conn->in;
+
+        /* A negative length means the body is delimited by EOF. */
+        while(length) {
+                const size_t
+                        offset = pgc_buf_tell(in),
+                        avail = pgc_buf_end(in) - offset;
+                if(!avail) {
+                        const sel_err_t err = law_htc_ensure_input_sync(
+                                worker,
+                                load->timeout,
+                                conn,
+                                1);
+                        if(err == LAW_ERR_EOF && length < 0)
+                                return LAW_ERR_OK;
+                        if(err != LAW_ERR_OK)
+                                return err;
+                        continue;
+                }
+                size_t n = avail;
+                if(length > 0 && (uint64_t)length < n)
+                        n = (size_t)length;
+                SEL_TEST(pgc_buf_seek(in, offset + n) == LAW_ERR_OK);
+                if(length > 0)
+                        length -= (int64_t)n;
+        }
+
+        return LAW_ERR_OK;
+}
+
+static sel_err_t load_read_response(
+        law_worker_t *worker,
+        load_t *load,
+        law_htconn_t *conn,
+        const load_route_t *route,
+        load_stats_t *stats,
+        bool *close)
+{
+        struct pgc_buf *in = conn->in;
+        const size_t base = pgc_buf_tell(in);
+
+        load_scan_args_t args = { .conn = conn, .base = base };
+        sel_err_t err = law_sync(
+                worker,
+                load->timeout,
+                load_scan_cb,
+                conn->socket,
+                &args);
+        if(err != LAW_ERR_OK) return err;
+
+        const size_t tell = pgc_buf_tell(in);
+        const size_t head_len = tell - base;
+
+        char head[LOAD_BUFFER + 1];
+        SEL_TEST(pgc_buf_seek(in, base) == LAW_ERR_OK);
+        SEL_TEST(pgc_buf_get(in, head, head_len) == LAW_ERR_OK);
+        head[head_len] = 0;
+
+        int status = 0;
+        if(sscanf(head, "HTTP/%*d.%*d %d", &status) != 1)
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "status_line");
+
+        for(char *c = head; *c; ++c) *c = (char)tolower(*c);
+
+        int64_t length = -1;
+        char *field = strstr(head, "\ncontent-length:");
+        if(field) length = strtoll(field + 16, NULL, 10);
+
+        if(strstr(head, "\ntransfer-encoding:"))
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "chunked_unsupported");
+
+        *close = strstr(head, "\nconnection: close") != NULL;
+
+        if(     !strcmp(route->method, "HEAD") ||
+                status == 204 ||
+                status == 304 ||
+                status < 200)
+        {
+                length = 0;
+        } else if(length < 0) {
+                *close = true;
+        }
+
+        if((err = load_discard(worker, load, conn, length)) != LAW_ERR_OK)
+                return err;
+
+        stats->bytes += pgc_buf_tell(in) - base;
+        stats->status[status / 100 < 6 ? status / 100 : 0] += 1;
+
+        return LAW_ERR_OK;
+}
+
+/**
+ * Send one batch of pipelined requests and read every response.  Returns
+ * LAW_ERR_EOF when the connection cannot be reused afterwards.
+ */
+static sel_err_t load_exchange(
+        law_worker_t *worker,
+        load_t *load,
+        law_htconn_t *conn,
+        load_stats_t *stats,
+        uint32_t *seed,
+        int *received)
+{
+        const load_route_t *batch[LOAD_MAX_PIPELINE];
+        const int depth = load->pipeline;
+
+        sel_err_t err = LAW_ERR_OK;
+
+        for(int n = 0; n < depth; ++n) {
+                batch[n] = load_pick(load, seed);
+                err = load_write_request(
+                        worker,
+                        load,
+                        conn,
+                        batch[n],
+                        !load->keepalive && n == depth - 1);
+                if(err != LAW_ERR_OK) return err;
+        }
+
+        const int64_t start = bench_nanos();
+
+        err = law_htc_flush_sync(worker, load->timeout, conn);
+        if(err != LAW_ERR_OK) return err;
+
+        bool close = false;
+
+        for(int n = 0; n < depth; ++n) {
+                err = load_read_response(
+                        worker,
+                        load,
+                        conn,
+                        batch[n],
+                        stats,
+                        &close);
+                if(err != LAW_ERR_OK) return err;
+
+                bench_hdr_record(
+                        &stats->latency,
+                        (bench_nanos() - start) / 1000);
+                stats->requests += 1;
+                *received += 1;
+
+                if(close && n < depth - 1)
+                        return LAW_ERR_PUSH(LAW_ERR_EOF, "pipeline_closed");
+        }
+
+        return close || !load->keepalive ? LAW_ERR_EOF : LAW_ERR_OK;
+}
+
+static sel_err_t load_client(law_worker_t *worker, law_data_t data)
+{
+        load_t *load = data.ptr;
+        load_stats_t *stats = load->stats + law_get_worker_id(worker);
+
+        uint32_t seed = (uint32_t)law_get_active_id(worker) * 2654435761u;
+        if(!seed) seed = 1;
+
+        char in_bytes[LOAD_BUFFER], out_bytes[LOAD_BUFFER];
+        struct pgc_buf in, out;
+
+        while(law_time_millis() < load->deadline) {
+
+                law_htconn_t conn = { .in = &in, .out = &out };
+                pgc_buf_init(&in, in_bytes, LOAD_BUFFER, 0);
+                pgc_buf_init(&out, out_bytes, LOAD_BUFFER, 0);
+
+                if(load_connect(worker, load, &conn) != LAW_ERR_OK) {
+                        stats->errors += 1;
+                        (void)law_ewait(worker, 10, NULL, 0);
+                        continue;
+                }
+
+                stats->connects += 1;
+
+                int received = 0;
+                sel_err_t err = LAW_ERR_OK;
+
+                while(law_time_millis() < load->deadline) {
+                        const int before = received;
+                        err = load_exchange(
+                                worker,
+                                load,
+                                &conn,
+                                stats,
+                                &seed,
+                                &received);
+                        if(err == LAW_ERR_OK) continue;
+                        if(err == LAW_ERR_EOF && received > before) break;
+                        if(received && before == received) {
+                                /* The server closed an idle connection. */
+                                stats->closed += 1;
+                        } else {
+                                stats->errors += 1;
+                        }
+                        break;
+                }
+
+                load_disconnect(&conn);
+        }
+
+        if(atomic_fetch_sub(&load->remaining, 1) == 1)
+                law_stop(law_get_server(worker));
+
+        return LAW_ERR_OK;
+}
+
+static void load_report(load_t *load, const int64_t nanos)
+{
+        load_stats_t *total = malloc(sizeof(load_stats_t));
+        SEL_TEST(total);
+        memset(total, 0, sizeof(load_stats_t));
+        bench_hdr_init(&total->latency);
+
+        for(int n = 0; n < load->workers; ++n) {
+                load_stats_t *s = load->stats + n;
+                bench_hdr_merge(&total->latency, &s->latency);
+                total->requests += s->requests;
+                total->errors += s->errors;
+                total->connects += s->connects;
+                total->closed += s->closed;
+                total->bytes += s->bytes;
+                for(int c = 0; c < 6; ++c) total->status[c] += s->status[c];
+        }
+
+        const bench_hdr_t *h = &total->latency;
+        const double secs = (double)nanos / 1e9;
+
+        printf( "{\"suite\":\"load\",\"bench\":\"%s%s\","
+                "\"connections\":%d,\"workers\":%d,\"pipeline\":%d,"
+                "\"ns\":%lld,\"requests\":%llu,\"errors\":%llu,"
+                "\"connects\":%llu,\"closed\":%llu,\"bytes\":%llu,"
+                "\"requests_per_sec\":%.2f,\"bytes_per_sec\":%.2f,"
+                "\"status\":{\"1xx\":%llu,\"2xx\":%llu,\"3xx\":%llu,"
+                "\"4xx\":%llu,\"5xx\":%llu,\"other\":%llu},"
+                "\"latency_us\":{\"min\":%lld,\"mean\":%.2f,\"p50\":%lld,"
+                "\"p90\":%lld,\"p99\":%lld,\"p999\":%lld,\"p9999\":%lld,"
+                "\"max\":%lld},\"rev\":\"%s\"}\n",
+                load->keepalive ? "keepalive" : "close",
+                load->tls ? "_tls" : "",
+                load->connections,
+                load->workers,
+                load->pipeline,
+                (long long)nanos,
+                (unsigned long long)total->requests,
+                (unsigned long long)total->errors,
+                (unsigned long long)total->connects,
+                (unsigned long long)total->closed,
+                (unsigned long long)total->bytes,
+                secs > 0 ? (double)total->requests / secs : 0,
+                secs > 0 ? (double)total->bytes / secs : 0,
+                (unsigned long long)total->status[1],
+                (unsigned long long)total->status[2],
+                (unsigned long long)total->status[3],
+                (unsigned long long)total->status[4],
+                (unsigned long long)total->status[5],
+                (unsigned long long)total->status[0],
+                (long long)(h->total ? h->min : 0),
+                bench_hdr_mean(h),
+                (long long)bench_hdr_percentile(h, 50),
+                (long long)bench_hdr_percentile(h, 90),
+                (long long)bench_hdr_percentile(h, 99),
+                (long long)bench_hdr_percentile(h, 99.9),
+                (long long)bench_hdr_percentile(h, 99.99),
+                (long long)h->max,
+                bench_rev());
+
+        fflush(stdout);
+        free(total);
+}
+
+static bool load_add_route(load_t *load, char *spec)
+{
+        if(load->num_routes >= LOAD_MAX_ROUTES) return false;
+
+        load_route_t *route = load->routes + load->num_routes;
+
+        char *method = strtok(spec, ",");
+        char *path = strtok(NULL, ",");
+        char *weight = strtok(NULL, ",");
+
+        if(!method || !path) return false;
+        if(strlen(method) >= sizeof(route->method)) return false;
+        if(strlen(path) >= sizeof(route->path)) return false;
+
+        strcpy(route->method, method);
+        strcpy(route->path, path);
+        route->weight = weight ? atoi(weight) : 1;
+
+        if(route->weight < 1) return false;
+
+        load->total_weight += route->weight;
+        load->num_routes += 1;
+
+        return true;
+}
+
+static void load_usage(const char *name)
+{
+        fprintf(stderr,
+                "usage: %s [-h host] [-p port] [-c connections] "
+                "[-t threads] [-d seconds] [-P pipeline] [-C] [-s] "
+                "[-b body_bytes] [-T timeout_ms] "
+                "[-r METHOD,PATH[,WEIGHT]]...\n",
+                name);
+}
+
+int main(int argc, char **argv)
+{
+        law_err_init();
+
+        signal(SIGPIPE, SIG_IGN);
+
+        load_t *load = calloc(1, sizeof(load_t));
+        SEL_TEST(load);
+
+        load->host = "127.0.0.1";
+        load->port = 80;
+        load->connections = 16;
+        load->workers = 1;
+        load->duration = 5;
+        load->pipeline = 1;
+        load->keepalive = true;
+        load->tls = false;
+        load->body = 0;
+        load->timeout = 5000;
+
+        int opt;
+        while((opt = getopt(argc, argv, "h:p:c:t:d:P:Csb:T:r:")) != -1) {
+                switch(opt) {
+                        case 'h': load->host = optarg; break;
+                        case 'p': load->port = atoi(optarg); break;
+                        case 'c': load->connections = atoi(optarg); break;
+                        case 't': load->workers = atoi(optarg); break;
+                        case 'd': load->duration = atoi(optarg); break;
+                        case 'P': load->pipeline = atoi(optarg); break;
+                        case 'C': load->keepalive = false; break;
+                        case 's': load->tls = true; break;
+                        case 'b':
+                                load->body = (size_t)atol(optarg);
+                                break;
+                        case 'T': load->timeout = atol(optarg); break;
+                        case 'r':
+                                if(!load_add_route(load, optarg)) {
+                                        load_usage(argv[0]);
+                                        return EXIT_FAILURE;
+                                }
+                                break;
+                        default:
+                                load_usage(argv[0]);
+                                return EXIT_FAILURE;
+                }
+        }
+
+        if(     load->connections < 1 ||
+                load->workers < 1 ||
+                load->duration < 1 ||
+                load->pipeline < 1 ||
+                load->pipeline > LOAD_MAX_PIPELINE ||
+                load->timeout < 1)
+        {
+                load_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        if(!load->num_routes) {
+                char spec[] = "GET,/";
+                SEL_TEST(load_add_route(load, spec));
+        }
+
+        memset(load_body, 'x', sizeof(load_body));
+
+        load->addr.sin_family = AF_INET;
+        load->addr.sin_port = htons((uint16_t)load->port);
+        if(inet_pton(AF_INET, load->host, &load->addr.sin_addr) != 1) {
+                fprintf(stderr, "invalid IPv4 address: %s\n", load->host);
+                return EXIT_FAILURE;
+        }
+
+        if(load->tls) {
+                load->ssl_ctx = SSL_CTX_new(TLS_client_method());
+                SEL_TEST(load->ssl_ctx);
+                /* Loopback benchmarks run against self-signed certs. */
+                SSL_CTX_set_verify(load->ssl_ctx, SSL_VERIFY_NONE, NULL);
+        }
+
+        load->stats = malloc(sizeof(load_stats_t) * (size_t)load->workers);
+        SEL_TEST(load->stats);
+        for(int n = 0; n < load->workers; ++n) {
+                memset(load->stats + n, 0, sizeof(load_stats_t));
+                bench_hdr_init(&load->stats[n].latency);
+        }
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_NONE;
+        cfg.workers = load->workers;
+        cfg.worker_tasks =
+                (load->connections + load->workers - 1) / load->workers;
+        cfg.server_timeout = 50;
+        cfg.worker_timeout = 50;
+        cfg.stack = 0x40000;
+        cfg.on_error = load_on_error;
+        cfg.data.ptr = load;
+
+        law_server_t *server = law_server_create(&cfg);
+        SEL_TEST(server);
+
+        sel_err_t err = law_open(server);
+        if(err != LAW_ERR_OK) {
+                SEL_REPORT(err);
+                return EXIT_FAILURE;
+        }
+
+        atomic_store(&load->remaining, load->connections);
+
+        const int64_t start = bench_nanos();
+        load->deadline = law_time_millis() + (law_time_t)load->duration * 1000;
+
+        for(int n = 0; n < load->connections; ++n) {
+                err = law_spawn(server, load_client, cfg.data);
+                if(err != LAW_ERR_OK) {
+                        SEL_REPORT(err);
+                        return EXIT_FAILURE;
+                }
+        }
+
+        err = law_start(server);
+        const int64_t nanos = bench_nanos() - start;
+
+        if(err != LAW_ERR_OK) SEL_REPORT(err);
+
+        load_report(load, nanos);
+
+        law_close(server);
+        law_server_destroy(server);
+
+        if(load->ssl_ctx) SSL_CTX_free(load->ssl_ctx);
+        free(load->stats);
+        free(load);
+
+        return err == LAW_ERR_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,237 @@
+
+#include "lawd/server.h"
+#include "lawd/private/server.h"
+#include "bench.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ITERATIONS 1000000
+
+uint64_t law_slot_encode(law_slot_t *slot);
+void law_slot_decode(uint64_t encoding, law_slot_t *slot);
+
+void bench_slot()
+{
+        law_slot_t slot = { .id = 0, .data = 0 };
+        volatile uint64_t sink = 0;
+
+        int64_t start = bench_nanos();
+        for(law_id_t x = 0; x < ITERATIONS; ++x) {
+                slot.id = x;
+                slot.data = (int8_t)x;
+                sink += law_slot_encode(&slot);
+        }
+        bench_report("server", "slot_encode", 0, ITERATIONS, 
+                bench_nanos() - start);
+
+        start = bench_nanos();
+        for(uint64_t x = 0; x < ITERATIONS; ++x) {
+                law_slot_decode(x * 0x9E3779B97F4A7C15UL, &slot);
+                sink += slot.id;
+        }
+        bench_report("server", "slot_decode", 0, ITERATIONS, 
+                bench_nanos() - start);
+
+        (void)sink;
+}
+
+law_task_t *law_task_pool_pop(law_task_pool_t *pool);
+void law_task_pool_push(law_task_pool_t *pool, law_task_t *task);
+law_task_pool_t *law_task_pool_create(law_server_cfg_t *cfg);
+void law_task_pool_destroy(law_task_pool_t *pool);
+
+typedef struct bench_pool_args {
+        law_task_pool_t *pool;
+        size_t iterations;
+} bench_pool_args_t;
+
+void *bench_pool_thread(void *state)
+{
+        bench_pool_args_t *args = state;
+        for(size_t x = 0; x < args->iterations; ++x) {
+                law_task_t *task = law_task_pool_pop(args->pool);
+                SEL_TEST(task);
+                law_task_pool_push(args->pool, task);
+        }
+        return NULL;
+}
+
+void bench_pool(const int nthreads)
+{
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.workers = 1;
+        cfg.worker_tasks = nthreads;
+        cfg.stack = 0x1000;
+
+        law_task_pool_t *pool = law_task_pool_create(&cfg);
+        SEL_TEST(pool);
+
+        pthread_t threads[16];
+        bench_pool_args_t args = { 
+                .pool = pool, 
+                .iterations = ITERATIONS / (size_t)nthreads };
+
+        const int64_t start = bench_nanos();
+
+        for(int n = 0; n < nthreads; ++n) {
+                SEL_TEST(pthread_create(
+                        threads + n, 
+                        NULL, 
+                        bench_pool_thread, 
+                        &args) == 0);
+        }
+        for(int n = 0; n < nthreads; ++n) {
+                pthread_join(threads[n], NULL);
+        }
+
+        /* Each iteration is one pop plus one push. */
+        bench_report(
+                "server", 
+                "task_pool_pop_push", 
+                (size_t)nthreads, 
+                args.iterations * (size_t)nthreads, 
+                bench_nanos() - start);
+
+        law_task_pool_destroy(pool);
+}
+
+sel_err_t law_task_queue_open(law_task_queue_t *queue);
+void law_task_queue_close(law_task_queue_t *queue);
+sel_err_t law_task_queue_push(law_task_queue_t *queue, law_task_t *task);
+sel_err_t law_task_queue_pop(law_task_queue_t *queue, law_task_t **task);
+
+void *bench_queue_producer(void *state)
+{
+        law_task_queue_t *queue = state;
+        for(uintptr_t x = 1; x <= ITERATIONS; ++x) {
+                while(law_task_queue_push(queue, (law_task_t*)x) 
+                        == LAW_ERR_WANTW);
+        }
+        return NULL;
+}
+
+void bench_queue()
+{
+        law_task_queue_t queue;
+        SEL_TEST(law_task_queue_open(&queue) == LAW_ERR_OK);
+
+        pthread_t producer;
+        law_task_t *task = NULL;
+
+        const int64_t start = bench_nanos();
+
+        SEL_TEST(pthread_create(
+                &producer, 
+                NULL, 
+                bench_queue_producer, 
+                &queue) == 0);
+
+        for(uintptr_t x = 1; x <= ITERATIONS; ++x) {
+                while(law_task_queue_pop(&queue, &task) == LAW_ERR_WANTR);
+                SEL_TEST(task == (law_task_t*)x);
+        }
+
+        pthread_join(producer, NULL);
+
+        bench_report(
+                "server", 
+                "task_queue_cross_thread", 
+                0, 
+                ITERATIONS, 
+                bench_nanos() - start);
+
+        law_task_queue_close(&queue);
+}
+
+#define SPAWN_TASKS 64
+#define SPAWN_ITERATIONS 100000
+
+typedef struct bench_spawn_state {
+        law_server_t *server;
+        bool local;
+        size_t spawned;
+        size_t finished;
+} bench_spawn_state_t;
+
+sel_err_t bench_spawn_child(law_worker_t *worker, law_data_t data)
+{
+        bench_spawn_state_t *state = data.ptr;
+        state->finished += 1;
+        return LAW_ERR_OK;
+}
+
+sel_err_t bench_spawn_parent(law_worker_t *worker, law_data_t data)
+{
+        bench_spawn_state_t *state = data.ptr;
+
+        while(state->finished < SPAWN_ITERATIONS) {
+                while(state->spawned < SPAWN_ITERATIONS) {
+                        if(state->local) {
+                                if(!law_spawn_local(
+                                        worker, 
+                                        bench_spawn_child, 
+                                        data)) break;
+                        } else if(law_spawn(
+                                state->server, 
+                                bench_spawn_child, 
+                                data) != LAW_ERR_OK) 
+                        {
+                                break;
+                        }
+                        state->spawned += 1;
+                }
+                (void)law_ewait(worker, 0, NULL, 0);
+        }
+
+        law_stop(state->server);
+        return LAW_ERR_OK;
+}
+
+void bench_spawn(const bool local)
+{
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_NONE;
+        cfg.workers = 1;
+        cfg.worker_tasks = SPAWN_TASKS;
+        cfg.worker_supply = local ? SPAWN_TASKS : 0;
+        cfg.server_timeout = 1;
+        cfg.stack = 0x10000;
+
+        bench_spawn_state_t state = { .local = local };
+        law_server_t *server = law_server_create(&cfg);
+        SEL_TEST(server);
+        state.server = server;
+
+        SEL_TEST(law_open(server) == LAW_ERR_OK);
+        SEL_TEST(law_spawn(
+                server, 
+                bench_spawn_parent, 
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+
+        const int64_t start = bench_nanos();
+        SEL_TEST(law_start(server) == LAW_ERR_OK);
+
+        bench_report(
+                "server", 
+                local ? "spawn_local" : "spawn", 
+                SPAWN_TASKS, 
+                SPAWN_ITERATIONS, 
+                bench_nanos() - start);
+
+        law_close(server);
+        law_server_destroy(server);
+}
+
+int main(int argc, char **args)
+{
+        bench_slot();
+        bench_pool(1);
+        bench_pool(2);
+        bench_pool(4);
+        bench_pool(8);
+        bench_queue();
+        bench_spawn(false);
+        bench_spawn(true);
+        return 0;
+}
@@ -0,0 +1,140 @@
+/* See man getaddrinfo */
+#define _POSIX_C_SOURCE 200112L
+
+#include "lawd/server.h"
+#include "bench.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define PORT 18671
+#define ITERATIONS 2000
+
+typedef struct bench_sockopts_state {
+        law_server_t *server;
+        int64_t nanos;
+} bench_sockopts_state_t;
+
+sel_err_t bench_sockopts_on_error(
+        law_server_t *server,
+        sel_err_t error,
+        law_data_t data)
+{
+        return LAW_ERR_OK;
+}
+
+/* One request per connection, answered like the ping server. */
+sel_err_t bench_sockopts_ping(law_worker_t *worker, int socket, law_data_t data)
+{
+        char buffer[64];
+        ssize_t got = 0;
+
+        SEL_TEST(law_ectl(worker, socket, LAW_EV_ADD, 0, LAW_EV_R, 0) 
+                == LAW_ERR_OK);
+
+        while((got = read(socket, buffer, sizeof(buffer))) == -1 && 
+              errno == EAGAIN) 
+        {
+                law_event_t event;
+                (void)law_ewait(worker, 1000, &event, 1);
+        }
+
+        SEL_TEST(law_ectl(worker, socket, LAW_EV_DEL, 0, 0, 0) == LAW_ERR_OK);
+
+        if(got > 0) (void)write(socket, "pong", 4);
+        close(socket);
+
+        return LAW_ERR_OK;
+}
+
+void *bench_sockopts_client(void *arg)
+{
+        bench_sockopts_state_t *state = arg;
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(struct sockaddr_in));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(PORT);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        const int64_t start = bench_nanos();
+
+        for(int n = 0; n < ITERATIONS; ++n) {
+                char reply[4];
+                const int fd = socket(AF_INET, SOCK_STREAM, 0);
+                SEL_TEST(fd != -1);
+                SEL_TEST(connect(
+                        fd, 
+                        (struct sockaddr*)&addr, 
+                        sizeof(addr)) == 0);
+                SEL_TEST(write(fd, "ping", 4) == 4);
+                SEL_TEST(read(fd, reply, 4) == 4);
+                close(fd);
+        }
+
+        state->nanos = bench_nanos() - start;
+
+        law_stop(state->server);
+
+        return NULL;
+}
+
+void bench_sockopts(const char *name, law_sockopts_t opts)
+{
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.port = PORT;
+        cfg.backlog = 64;
+        cfg.worker_tasks = 64;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.sockopts = opts;
+        cfg.on_accept = bench_sockopts_ping;
+        cfg.on_error = bench_sockopts_on_error;
+
+        bench_sockopts_state_t state = { .nanos = 0 };
+        law_server_t *server = law_server_create(&cfg);
+        SEL_TEST(server);
+        state.server = server;
+
+        /* Some options need privileges (SO_BUSY_POLL above the sysctl). */
+        if(law_open(server) != LAW_ERR_OK) {
+                fprintf(stderr, "sockopts: skipping %s\n", name);
+                law_server_destroy(server);
+                return;
+        }
+
+        pthread_t client;
+        SEL_TEST(pthread_create(
+                &client, 
+                NULL, 
+                bench_sockopts_client, 
+                &state) == 0);
+        SEL_TEST(law_start(server) == LAW_ERR_OK);
+        pthread_join(client, NULL);
+
+        /* Each iteration is connect, request, reply and close. */
+        bench_report("sockopts", name, 0, ITERATIONS, state.nanos);
+
+        law_close(server);
+        law_server_destroy(server);
+}
+
+int main(int argc, char **args)
+{
+        bench_sockopts("default", (law_sockopts_t){ .nodelay = false });
+        bench_sockopts("nodelay", (law_sockopts_t){ .nodelay = true });
+        bench_sockopts("quickack", (law_sockopts_t){ .quickack = true });
+        bench_sockopts("defer_accept", (law_sockopts_t){ .defer_accept = 1 });
+        bench_sockopts("fastopen", (law_sockopts_t){ .fastopen = 64 });
+        bench_sockopts("busy_poll", (law_sockopts_t){ .busy_poll = 50 });
+        bench_sockopts("buffers", (law_sockopts_t){ 
+                .sndbuf = 0x40000, 
+                .rcvbuf = 0x40000 });
+        return 0;
+}
@@ -0,0 +1,50 @@
+
+#include "lawd/table.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <assert.h>
+
+static const size_t SIZES[] = { 16, 256, 4096, 65536 };
+
+void bench_size(const size_t size)
+{
+        law_table_t *table = law_table_create(16);
+        assert(table);
+
+        int64_t start = bench_nanos();
+        for(size_t x = 0; x < size; ++x) {
+                law_table_insert(table, (law_id_t)x, table);
+        }
+        bench_report("table", "insert", size, size, bench_nanos() - start);
+
+        const size_t rounds = 0x100000 / size;
+
+        start = bench_nanos();
+        for(size_t r = 0; r < rounds; ++r) {
+                for(size_t x = 0; x < size; ++x) {
+                        assert(law_table_lookup(table, (law_id_t)x));
+                }
+        }
+        bench_report(
+                "table", 
+                "lookup", 
+                size, 
+                rounds * size, 
+                bench_nanos() - start);
+
+        start = bench_nanos();
+        for(size_t x = 0; x < size; ++x) {
+                law_table_remove(table, (law_id_t)x);
+        }
+        bench_report("table", "remove", size, size, bench_nanos() - start);
+
+        law_table_destroy(table);
+}
+
+int main(int argc, char **args)
+{
+        for(size_t x = 0; x < sizeof(SIZES) / sizeof(size_t); ++x) {
+                bench_size(SIZES[x]);
+        }
+        return 0;
+}
@@ -0,0 +1,64 @@
+
+#include "lawd/time.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <assert.h>
+
+static const size_t SIZES[] = { 16, 256, 4096, 65536 };
+
+void bench_size(const size_t size)
+{
+        law_timer_t *timer = law_timer_create(16);
+        assert(timer);
+
+        law_time_t *dates = malloc(sizeof(law_time_t) * size);
+        assert(dates);
+
+        srand(1);
+        for(size_t x = 0; x < size; ++x) {
+                dates[x] = (law_time_t)(rand() % 100000);
+        }
+
+        int64_t start = bench_nanos();
+        for(size_t x = 0; x < size; ++x) {
+                assert(law_timer_insert(timer, dates[x], x, 0));
+        }
+        bench_report("timer", "insert", size, size, bench_nanos() - start);
+
+        start = bench_nanos();
+        for(size_t x = 0; x < size; ++x) {
+                assert(law_timer_pop(timer, NULL, NULL, NULL));
+        }
+        bench_report("timer", "pop", size, size, bench_nanos() - start);
+
+        /* Steady state, a worker re-arming timers as they expire. */
+        for(size_t x = 0; x < size; ++x) {
+                assert(law_timer_insert(timer, dates[x], x, 0));
+        }
+
+        const size_t rounds = 0x100000;
+        law_time_t expiry = 0;
+
+        start = bench_nanos();
+        for(size_t r = 0; r < rounds; ++r) {
+                assert(law_timer_pop(timer, &expiry, NULL, NULL));
+                assert(law_timer_insert(timer, expiry + 100000, r, 0));
+        }
+        bench_report(
+                "timer", 
+                "pop_insert", 
+                size, 
+                rounds, 
+                bench_nanos() - start);
+
+        free(dates);
+        law_timer_destroy(timer);
+}
+
+int main(int argc, char **args)
+{
+        for(size_t x = 0; x < sizeof(SIZES) / sizeof(size_t); ++x) {
+                bench_size(SIZES[x]);
+        }
+        return 0;
+}
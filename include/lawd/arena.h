@@ -0,0 +1,64 @@
+#ifndef LAWD_ARENA_H
+#define LAWD_ARENA_H
+
+#include <stddef.h>
+
+/** Bump Arena */
+typedef struct law_arena law_arena_t;
+
+/** Per-Worker Chunk Cache */
+typedef struct law_slab law_slab_t;
+
+/** Arena Statistics */
+typedef struct law_arena_stats {
+        size_t used;                            /** Bytes Used Since Reset */
+        size_t reserved;                        /** Bytes Held by the Arena */
+        size_t high_water;                      /** Peak Bytes Used */
+        size_t slab_high_water;                 /** Peak of Any Arena */
+        size_t slab_chunks;                     /** Live Slab Chunks */
+        size_t slab_cached;                     /** Idle Slab Chunks */
+} law_arena_stats_t;
+
+/**
+ * Create a slab that hands out chunks of chunk_length bytes and keeps up to
+ * max_cached released chunks for reuse.
+ *
+ * RETURNS: NULL when out of memory.
+ */
+law_slab_t *law_slab_create(
+        const size_t chunk_length,
+        const size_t max_cached);
+
+/**
+ * Destroy the slab and every cached chunk.  Arenas using the slab must be
+ * reset first.
+ */
+void law_slab_destroy(law_slab_t *slab);
+
+/**
+ * Allocate nbytes aligned for any type.  The arena grows by one slab chunk
+ * at a time; requests larger than a chunk get a dedicated allocation, and
+ * smaller requests go on filling the current chunk.
+ *
+ * RETURNS: NULL when out of memory.
+ */
+void *law_arena_alloc(law_arena_t *arena, const size_t nbytes);
+
+/**
+ * Allocate nbytes of zeroed memory.
+ *
+ * RETURNS: NULL when out of memory.
+ */
+void *law_arena_calloc(law_arena_t *arena, const size_t nbytes);
+
+/**
+ * Free every allocation at once, returning the arena's chunks to its slab.
+ */
+void law_arena_reset(law_arena_t *arena);
+
+/**
+ * Get the arena's statistics.
+ */
+void law_arena_stats(law_arena_t *arena, law_arena_stats_t *stats);
+
+#endif
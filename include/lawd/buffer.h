@@ -29,4 +29,10 @@ intptr_t law_buf_read_SSL(struct pgc_buf *buf, SSL *ssl, const size_t len);
 
 intptr_t law_buf_write_SSL(struct pgc_buf *buf, SSL *ssl, const size_t len);
 
+/**
+ * Write bytes outside of a buffer to the SSL connection, with the same 
+ * results as law_buf_write_SSL.
+ */
+intptr_t law_buf_SSL_write_cb(void *addr, const size_t len, void *state);
+
 #endif
\ No newline at end of file
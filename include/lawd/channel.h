@@ -0,0 +1,98 @@
+#ifndef LAWD_CHANNEL_H
+#define LAWD_CHANNEL_H
+
+#include "lawd/server.h"
+#include "lawd/time.h"
+#include <stddef.h>
+
+/**
+ * Bounded Channel
+ *
+ * A fixed capacity queue of fixed size elements that any number of tasks,
+ * on any workers, may send to and receive from.  The queue itself is
+ * lock-free.  Tasks that block on a full or empty channel are suspended
+ * with law_ewait and woken through their worker's ready set (same worker)
+ * or message queue (other workers).
+ */
+typedef struct law_chan law_chan_t;
+
+/**
+ * Create a channel of elem_size byte elements.  The capacity is rounded up
+ * to the next power of two.
+ *
+ * RETURNS: NULL when out of memory.
+ */
+law_chan_t *law_chan_create(const size_t elem_size, const size_t capacity);
+
+/**
+ * Destroy the channel.  No task may be waiting on it.
+ */
+void law_chan_destroy(law_chan_t *chan);
+
+/**
+ * Get the channel's capacity.
+ */
+size_t law_chan_capacity(law_chan_t *chan);
+
+/**
+ * Close the channel and wake every waiting task.  Elements already sent
+ * can still be received.
+ */
+void law_chan_close(law_worker_t *worker, law_chan_t *chan);
+
+/**
+ * Send a copy of the element without blocking.  The worker is the caller's
+ * worker, or NULL when calling from outside of the server's threads.
+ *
+ * RETURNS:
+ *      LAW_ERR_OK - Element sent.
+ *      LAW_ERR_WANTW - Channel full.
+ *      LAW_ERR_EOF - Channel closed.
+ */
+sel_err_t law_chan_try_send(
+        law_worker_t *worker,
+        law_chan_t *chan,
+        const void *elem);
+
+/**
+ * Receive an element without blocking.  The worker is the caller's worker,
+ * or NULL when calling from outside of the server's threads.
+ *
+ * RETURNS:
+ *      LAW_ERR_OK - Element received.
+ *      LAW_ERR_WANTR - Channel empty.
+ *      LAW_ERR_EOF - Channel closed and empty.
+ */
+sel_err_t law_chan_try_recv(law_worker_t *worker, law_chan_t *chan, void *elem);
+
+/**
+ * Send a copy of the element, suspending the active task while the
+ * channel is full.
+ *
+ * RETURNS:
+ *      LAW_ERR_OK - Element sent.
+ *      LAW_ERR_TIME - Timed out.
+ *      LAW_ERR_EOF - Channel closed.
+ */
+sel_err_t law_chan_send(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_chan_t *chan,
+        const void *elem);
+
+/**
+ * Receive an element, suspending the active task while the channel is
+ * empty.
+ *
+ * RETURNS:
+ *      LAW_ERR_OK - Element received.
+ *      LAW_ERR_TIME - Timed out.
+ *      LAW_ERR_EOF - Channel closed and empty.
+ */
+sel_err_t law_chan_recv(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_chan_t *chan,
+        void *elem);
+
+#endif
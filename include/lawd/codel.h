@@ -0,0 +1,27 @@
+#ifndef LAWD_CODEL_H
+#define LAWD_CODEL_H
+
+#include "lawd/server.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Queue Delay Controller Statistics (one worker) */
+typedef struct law_codel_stats {
+        bool dropping;                          /** In a Dropping Episode */
+        uint32_t count;                         /** Drops This Episode */
+        int64_t delay;                          /** Last Queue Delay (ns) */
+        uint64_t admitted;                      /** Connections Dispatched */
+        uint64_t dropped;                       /** Connections Shed */
+} law_codel_stats_t;
+
+/**
+ * Read the queue delay controller of the server's worker at index.  The 
+ * fields are read one by one while the worker runs, so they may not be 
+ * mutually consistent.
+ */
+void law_codel_stats(
+        law_server_t *server, 
+        int index, 
+        law_codel_stats_t *stats);
+
+#endif
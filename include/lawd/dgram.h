@@ -0,0 +1,55 @@
+#ifndef LAWD_DGRAM_H
+#define LAWD_DGRAM_H
+
+#include "lawd/server.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/socket.h>
+
+/** Received Datagram (valid until the callback returns) */
+typedef struct law_dgram {
+        const void *data;                       /** Payload */
+        size_t size;                            /** Payload Length */
+        bool truncated;                         /** Payload Was Cut Short */
+        const struct sockaddr *addr;            /** Sender Address */
+        socklen_t addrlen;                      /** Sender Address Length */
+} law_dgram_t;
+
+/**
+ * Get the number of datagrams in the batch.
+ */
+size_t law_dgrams_count(law_dgrams_t *dgrams);
+
+/**
+ * Get the datagram at index.
+ */
+void law_dgrams_get(law_dgrams_t *dgrams, size_t index, law_dgram_t *dgram);
+
+/**
+ * Queue a reply to the sender of the datagram at index.  Replies are copied
+ * into the worker's send buffers and go out in one sendmmsg call after the
+ * callback returns.
+ *
+ * RETURNS:
+ *      LAW_ERR_OK - Reply queued.
+ *      LAW_ERR_LIMIT - The batch is full or size exceeds cfg.dgram_size.
+ */
+sel_err_t law_dgrams_reply(
+        law_dgrams_t *dgrams,
+        size_t index,
+        const void *data,
+        size_t size);
+
+/**
+ * Queue a datagram to an arbitrary address.
+ *
+ * RETURNS: LAW_ERR_OK, LAW_ERR_LIMIT
+ */
+sel_err_t law_dgrams_sendto(
+        law_dgrams_t *dgrams,
+        const struct sockaddr *addr,
+        socklen_t addrlen,
+        const void *data,
+        size_t size);
+
+#endif
@@ -13,6 +13,19 @@ enum law_htc_security_mode {                    /** HTTP Security Mode */
 /** HTTP Connection */
 typedef struct law_htconn law_htconn_t;
 
+/** Resumable Delimiter Scan */
+typedef struct law_htc_scan {
+        size_t base;                            /** Stream Offset of the Head */
+        size_t mark;                            /** Searched Up To */
+        size_t work;                            /** Bytes Searched (Total) */
+} law_htc_scan_t;
+
+/** Return a queued segment to its owner once it is sent or dropped. */
+typedef void (*law_htc_release_t)(
+        const void *base, 
+        const size_t length, 
+        void *state);
+
 /** 
  * Get the connection's security mode. 
  */
@@ -74,6 +87,27 @@ sel_err_t law_htc_read_scan(
         void *delim, 
         const size_t delim_len);
 
+/**
+ * Read data and scan input for the delimiter, resuming where the last call
+ * with the same scan stopped, so bytes that trickle in are searched once.
+ * Set scan->base and scan->mark to the start of the head before the first
+ * call.  Upon success the offset of the input buffer points to the end of 
+ * the delimiter; otherwise it is left at scan->base.
+ * 
+ * LAW_ERR_OK
+ * LAW_ERR_WANTR
+ * LAW_ERR_WANTW
+ * LAW_ERR_OOB
+ * LAW_ERR_EOF 
+ * LAW_ERR_SYS
+ * LAW_ERR_SSL
+ */
+sel_err_t law_htc_read_scan_ex(
+        law_htconn_t *conn, 
+        law_htc_scan_t *scan,
+        void *delim, 
+        const size_t delim_len);
+
 /**
  * Ensure nbytes of input are available in the input buffer.
  * 
@@ -133,7 +167,35 @@ sel_err_t law_htc_ensure_output_sync(
         const size_t nbytes);
 
 /**
- * Write data from the output buffer.
+ * Queue caller-owned bytes behind everything in the output buffer, without
+ * copying them.  Bytes put into the output buffer afterwards are sent after
+ * the segment.  The bytes must stay valid until release is called (release
+ * may be NULL); an empty segment is released at once.
+ * 
+ * LAW_ERR_OOB - The queue is full, so the caller keeps the segment.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_htc_queue(
+        law_htconn_t *conn,
+        const void *base,
+        const size_t length,
+        law_htc_release_t release,
+        void *state);
+
+/**
+ * Get the number of unsent bytes in the output buffer and the queue.
+ */
+size_t law_htc_pending(law_htconn_t *conn);
+
+/**
+ * Release every queued segment without sending the rest of it.
+ */
+void law_htc_drop(law_htconn_t *conn);
+
+/**
+ * Write data from the output buffer and queued segments, in order.  The 
+ * output buffer and segments go out together with writev(), or one after 
+ * another over SSL.
  * 
  * LAW_ERR_WNTR - Wants to read
  * LAW_ERR_WNTW - Wants to write
@@ -144,7 +206,7 @@ sel_err_t law_htc_ensure_output_sync(
 intptr_t law_htc_write_data(law_htconn_t *conn);
 
 /**
- * Flush the request's output buffer.
+ * Flush the request's output buffer and queued segments.
  * 
  * LAW_ERR_WANTR - Wants to read
  * LAW_ERR_WANTW - Wants to write
@@ -155,7 +217,7 @@ intptr_t law_htc_write_data(law_htconn_t *conn);
 sel_err_t law_htc_flush(law_htconn_t *conn);
 
 /**
- * Flush the request's output buffer.
+ * Flush the request's output buffer and queued segments.
  * 
  * LAW_ERR_TIMEOUT - Time Exceeded
  * LAW_ERR_SYS - System error
@@ -180,6 +242,20 @@ sel_err_t law_htc_flush_sync(
  */
 sel_err_t law_htc_ssl_accept(law_htconn_t *conn, SSL_CTX *ssl_ctx);
 
+/**
+ * Initiate the client side of an SSL connection.  Like ssl_accept, this 
+ * function should only be called once; a handshake left pending by 
+ * LAW_ERR_WNTR or LAW_ERR_WNTW is completed by the first read or write.
+ * 
+ * LAW_ERR_WNTR - Wants to read.
+ * LAW_ERR_WNTW - Wants to write.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_SYS - Syscall Error
+ * LAW_ERR_EOF - End of File Encountered
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_htc_ssl_connect(law_htconn_t *conn, SSL_CTX *ssl_ctx);
+
 /**
  * Shutdown an SSL connection and free its resources.  This function should
  * be called multiple times until it returns LAW_ERR_OK in order to fully
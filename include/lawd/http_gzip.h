@@ -0,0 +1,171 @@
+#ifndef LAWD_HTTP_GZIP_H
+#define LAWD_HTTP_GZIP_H
+
+#include "lawd/error.h"
+#include "lawd/server.h"
+#include "lawd/http_server.h"
+#include <stddef.h>
+
+/*
+ * Response compression with zlib.  The coding is negotiated from the
+ * request's Accept-Encoding; gzip is preferred over deflate when both are
+ * equally acceptable.
+ *
+ * Each worker keeps a few deflate states that are reset rather than
+ * initialized per response.  Streamed bodies take one for as long as they
+ * last and send what it produces in chunks; when a worker has none free,
+ * bodies go out uncompressed.
+ *
+ * Each worker also caches whole compressed bodies by a key the caller
+ * chooses, so hot responses are compressed once per worker and then sent
+ * by reference.  The key must change when the body does (a path and its
+ * ETag, for example).
+ */
+
+enum law_hgz_coding {                           /** Content Coding */
+        LAW_HGZ_IDENTITY        = 0,            /** Uncompressed */
+        LAW_HGZ_GZIP            = 1,            /** gzip (RFC 1952) */
+        LAW_HGZ_DEFLATE         = 2,            /** zlib (RFC 1950) */
+};
+
+typedef struct law_hgz_cfg {                    /** Compression Config */
+        int level;                              /** Streamed Body Level */
+        int cache_level;                        /** Cached Body Level */
+        int mem_level;                          /** zlib Memory Level */
+        size_t streams;                         /** Deflate States / Worker */
+        size_t chunk;                           /** Compressed Bytes / Write */
+        size_t min_length;                      /** Smallest Compressed Body */
+        size_t cache;                           /** Cached Bytes / Worker */
+} law_hgz_cfg_t;
+
+/** Response Compression */
+typedef struct law_hgz law_hgz_t;
+
+/** A Compressed Body Being Streamed */
+typedef struct law_hgz_stream law_hgz_stream_t;
+
+/**
+ * Get a sane default configuration.
+ */
+law_hgz_cfg_t law_hgz_sanity();
+
+/**
+ * Allocate the deflate states and caches of every server worker.
+ *
+ * RETURNS: The compressor, or NULL (errno is set).
+ */
+law_hgz_t *law_hgz_create(law_server_cfg_t *srv_cfg, law_hgz_cfg_t *cfg);
+
+/**
+ * Free the deflate states and cached bodies.  No response may still be
+ * sending a cached body.
+ */
+void law_hgz_destroy(law_hgz_t *hgz);
+
+/**
+ * Pick the coding for an Accept-Encoding value, or LAW_HGZ_IDENTITY when
+ * neither gzip nor deflate is acceptable (or the value is NULL).
+ */
+int law_hgz_negotiate(const char *accept_encoding);
+
+/**
+ * Compress the bytes in one go into dest.  Used by the cache, and by the
+ * benchmark.
+ *
+ * LAW_ERR_OOM - No deflate state is free.
+ * LAW_ERR_OOB - The result does not fit in dest_size bytes.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hgz_compress(
+        law_hgz_t *hgz,
+        law_worker_t *worker,
+        const int coding,
+        const int level,
+        const void *source,
+        const size_t length,
+        void *dest,
+        const size_t dest_size,
+        size_t *dest_length);
+
+/**
+ * Begin a streamed body like law_hts_begin_stream_sync, compressing it when
+ * the client accepts a coding, the length is at least cfg.min_length, and
+ * a deflate state is free.  Adds Vary, and Content-Encoding when the body
+ * is compressed.  *stream is NULL when it is not; either way, write it
+ * with law_hgz_write_sync and finish it with law_hgz_end_sync.
+ *
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_OOB - Head does not fit in the output buffer.
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hgz_begin_sync(
+        law_hgz_t *hgz,
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request,
+        law_htheaders_t *headers,
+        const size_t length,
+        law_hgz_stream_t **stream);
+
+/**
+ * Compress and write part of a streamed body.
+ *
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_MODE - No stream was begun, or it has ended.
+ * LAW_ERR_LIMIT - More bytes than the Content-Length (uncompressed).
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hgz_write_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request,
+        law_hgz_stream_t *stream,
+        const void *data,
+        const size_t length);
+
+/**
+ * Write the end of the compressed data and end the body.  The deflate
+ * state goes back to the worker even when this fails, so a begun stream
+ * must always be ended.
+ *
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_MODE - No stream was begun, or it has ended.
+ * LAW_ERR_LIMIT - Fewer bytes than the Content-Length (uncompressed).
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hgz_end_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request,
+        law_hgz_stream_t *stream);
+
+/**
+ * End the response head and send a whole body, compressed from the
+ * worker's cache when the client accepts a coding.  A miss compresses the
+ * body at cfg.cache_level and keeps it under the key; cached bodies are
+ * sent by reference, so none of them is copied.  Bodies that do not
+ * shrink are remembered and sent as they are.
+ *
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_OOB - Head does not fit in the output buffer.
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hgz_send_cached_sync(
+        law_hgz_t *hgz,
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request,
+        law_htheaders_t *headers,
+        const char *key,
+        const void *body,
+        const size_t length);
+
+#endif
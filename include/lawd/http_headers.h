@@ -9,11 +9,46 @@ typedef struct law_htheaders law_htheaders_t;
 /** HTTP Headers Iterator */
 typedef struct law_hth_iter law_hth_iter_t;
 
-/** Get the header value by its name.  Returns NULL if not found. */
+/** Well-Known Header Fields */
+enum law_hth_field {
+        LAW_HTH_HOST                    = 0,    /** Host */
+        LAW_HTH_CONNECTION              = 1,    /** Connection */
+        LAW_HTH_CONTENT_LENGTH          = 2,    /** Content-Length */
+        LAW_HTH_CONTENT_TYPE            = 3,    /** Content-Type */
+        LAW_HTH_TRANSFER_ENCODING       = 4,    /** Transfer-Encoding */
+        LAW_HTH_EXPECT                  = 5,    /** Expect */
+        LAW_HTH_UPGRADE                 = 6,    /** Upgrade */
+        LAW_HTH_ORIGIN                  = 7,    /** Origin */
+        LAW_HTH_COOKIE                  = 8,    /** Cookie */
+        LAW_HTH_AUTHORIZATION           = 9,    /** Authorization */
+        LAW_HTH_ACCEPT                  = 10,   /** Accept */
+        LAW_HTH_ACCEPT_ENCODING         = 11,   /** Accept-Encoding */
+        LAW_HTH_USER_AGENT              = 12,   /** User-Agent */
+        LAW_HTH_SEC_WEBSOCKET_KEY       = 13,   /** Sec-WebSocket-Key */
+        LAW_HTH_SEC_WEBSOCKET_VERSION   = 14,   /** Sec-WebSocket-Version */
+        LAW_HTH_SEC_WEBSOCKET_PROTOCOL  = 15,   /** Sec-WebSocket-Protocol */
+        LAW_HTH_SEC_WEBSOCKET_EXTENSIONS = 16,  /** Sec-WebSocket-Extensions */
+        LAW_HTH_FIELDS                  = 17    /** Number of Known Fields */
+};
+
+/** 
+ * Get the header value by its name, ignoring case.  Returns NULL if not 
+ * found, or the first value if the header is repeated.  Headers read by 
+ * the scanner (LAW_HTS_SCAN) are indexed, so the lookup does not depend on
+ * the number of headers.
+ */
 const char *law_hth_get(
         law_htheaders_t *headers,
         const char *field_name);
 
+/** Get a well-known header's value (LAW_HTH_*), or NULL if not found. */
+const char *law_hth_get_field(
+        law_htheaders_t *headers,
+        const int field);
+
+/** Get the name of a well-known header (LAW_HTH_*). */
+const char *law_hth_field_name(const int field);
+
 /** Allocate and initialize an iterator for the header collection. */
 law_hth_iter_t *law_hth_elems(
         law_htheaders_t *headers,
@@ -0,0 +1,174 @@
+#ifndef LAWD_HTTP_ROUTER_H
+#define LAWD_HTTP_ROUTER_H
+
+#include "lawd/error.h"
+#include "lawd/server.h"
+#include "lawd/http_server.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Request routing on the method and target path of the request line.
+ * Routes are added before the server opens and compiled once into a radix
+ * tree: static runs of a path share one label, and the children of a node
+ * are found by their first byte.  Matching walks the path bytes once,
+ * stepping back only where a static segment and a parameter overlap.
+ *
+ * Patterns start with "/".  A segment of the form ":name" matches any one
+ * non-empty segment, and a last segment of the form "*name" matches the
+ * rest of the path, slashes included.  Static segments win over
+ * parameters, and parameters over the rest of the path.  Paths are matched
+ * as they arrive, percent encoded; the query is not part of the path.
+ *
+ * Each worker counts the requests and failed handlers of every route, and
+ * the requests no route took, so counting takes no locked instructions.
+ */
+
+/** Most parameters in one pattern. */
+#define LAW_HRT_PARAMS 8
+
+/** Most segments in one pattern. */
+#define LAW_HRT_SEGMENTS 32
+
+enum law_hrt_method {                           /** Method Mask */
+        LAW_HRT_GET             = 0x001,        /** GET */
+        LAW_HRT_HEAD            = 0x002,        /** HEAD */
+        LAW_HRT_POST            = 0x004,        /** POST */
+        LAW_HRT_PUT             = 0x008,        /** PUT */
+        LAW_HRT_DELETE          = 0x010,        /** DELETE */
+        LAW_HRT_PATCH           = 0x020,        /** PATCH */
+        LAW_HRT_OPTIONS         = 0x040,        /** OPTIONS */
+        LAW_HRT_CONNECT         = 0x080,        /** CONNECT */
+        LAW_HRT_TRACE           = 0x100,        /** TRACE */
+        LAW_HRT_OTHER           = 0x200,        /** Any Other Method */
+        LAW_HRT_ANY             = 0x3FF         /** Every Method */
+};
+
+typedef struct law_hrt_param {                  /** Path Parameter */
+        const char *name;                       /** Name in the Pattern */
+        const char *value;                      /** Start in the Path */
+        size_t length;                          /** Length in the Path */
+} law_hrt_param_t;
+
+typedef struct law_hrt_match {                  /** Matched Route */
+        size_t route;                           /** Route Index */
+        unsigned allow;                         /** Methods of the Path */
+        size_t params;                          /** Parameters Captured */
+        law_hrt_param_t param[LAW_HRT_PARAMS];
+} law_hrt_match_t;
+
+/** Route Handler */
+typedef sel_err_t (*law_hrt_handler_t)(
+        law_worker_t *worker,
+        law_hts_req_t *request,
+        law_hts_reqline_t *reqline,
+        law_htheaders_t *headers,
+        law_hrt_match_t *match,
+        law_data_t data);
+
+typedef struct law_hrt_counts {                 /** Route Counters */
+        uint64_t hits;                          /** Requests Routed */
+        uint64_t errors;                        /** Handler Errors */
+} law_hrt_counts_t;
+
+/** Request Router */
+typedef struct law_hrt law_hrt_t;
+
+/**
+ * Allocate an empty router with counters for every server worker.
+ *
+ * RETURNS: The router, or NULL (errno is set).
+ */
+law_hrt_t *law_hrt_create(law_server_cfg_t *srv_cfg);
+
+/**
+ * Free the router and its routes.
+ */
+void law_hrt_destroy(law_hrt_t *hrt);
+
+/**
+ * Get the method mask bit of a request method, LAW_HRT_OTHER when the
+ * method is not one of the named ones.
+ */
+unsigned law_hrt_method(const char *method);
+
+/**
+ * Add a route for the methods in the mask.  The pattern is copied.  Its
+ * index, in the order routes were added, is stored in route when that is
+ * not NULL.
+ *
+ * LAW_ERR_MODE - The router is already compiled.
+ * LAW_ERR_SYN - The pattern is malformed, or the mask is empty.
+ * LAW_ERR_LIMIT - Too many parameters or segments in the pattern.
+ * LAW_ERR_CMP - A route with the same path shape takes one of the methods.
+ * LAW_ERR_OOM - Out of memory.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hrt_add(
+        law_hrt_t *hrt,
+        const unsigned methods,
+        const char *pattern,
+        law_hrt_handler_t handler,
+        law_data_t data,
+        size_t *route);
+
+/**
+ * Compile the routes into the tree the router matches with, and free what
+ * building it took.  No route can be added afterwards.  Call before
+ * law_htserver_open.
+ *
+ * LAW_ERR_MODE - The router is already compiled.
+ * LAW_ERR_OOM - Out of memory.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hrt_compile(law_hrt_t *hrt);
+
+/**
+ * Match a method and path against the compiled routes.  Parameter values
+ * point into the path.  Nothing is counted.
+ *
+ * LAW_ERR_NOID - No route takes the path.
+ * LAW_ERR_MODE - Routes take the path, but not the method (match->allow).
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hrt_match(
+        law_hrt_t *hrt,
+        const char *method,
+        const char *path,
+        law_hrt_match_t *match);
+
+/**
+ * Find a captured parameter by name.
+ *
+ * RETURNS: The parameter, or NULL when the route has none by that name.
+ */
+const law_hrt_param_t *law_hrt_param(
+        const law_hrt_match_t *match,
+        const char *name);
+
+/**
+ * The on_accept callback of a routed server, with the compiled router as
+ * its data pointer.  Counts the request, then calls the handler of the
+ * route, or responds 404, or 405 with an Allow header.
+ *
+ * RETURNS: What the handler returns, or what the error response does.
+ */
+sel_err_t law_hrt_accept(
+        law_worker_t *worker,
+        law_hts_req_t *request,
+        law_hts_reqline_t *reqline,
+        law_htheaders_t *headers,
+        law_data_t data);
+
+/**
+ * Sum a route's counters over every worker.  The sums may trail requests
+ * still being handled.
+ */
+law_hrt_counts_t law_hrt_counts(law_hrt_t *hrt, const size_t route);
+
+/**
+ * Sum the requests answered with 404 (status 404) or 405 (status 405).
+ */
+uint64_t law_hrt_misses(law_hrt_t *hrt, const int status);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef LAWD_HTTP_SCAN_H
+#define LAWD_HTTP_SCAN_H
+
+#include "lawd/error.h"
+#include "lawd/http_server.h"
+#include "lawd/http_headers.h"
+#include "pgenc/stack.h"
+#include <stddef.h>
+
+/*
+ * A hand-written HTTP/1.x request head parser, the alternative to the
+ * grammar in grammar/http.g.  It works in place on a contiguous copy of the
+ * head: separators are overwritten with NUL so the request line strings
+ * and header fields point straight into the text, and the headers keep
+ * offsets into it.  Only the header table and absolute-form authorities
+ * are allocated from the heap.
+ *
+ * Long runs (the request target and field values) are skipped 16 or 32
+ * bytes at a time with SSE4.2 or AVX2 when the CPU has them.  Tokens are
+ * checked byte by byte.  Unlike the grammar, field values may contain
+ * obs-text (bytes 0x80-0xFF), and trailing whitespace is trimmed.
+ */
+
+enum law_hsc_isa {                              /** Scanner Instruction Set */
+        LAW_HSC_AUTO            = 0,            /** Best Available */
+        LAW_HSC_SCALAR          = 1,            /** Portable C */
+        LAW_HSC_SSE42           = 2,            /** SSE4.2 PCMPESTRI */
+        LAW_HSC_AVX2            = 3,            /** AVX2 */
+};
+
+/**
+ * Get the instruction set the scanner uses, resolving LAW_HSC_AUTO.
+ */
+int law_hsc_get_isa();
+
+/**
+ * Set the instruction set the scanner uses, for every thread.
+ *
+ * RETURNS: LAW_ERR_OK, LAW_ERR_MODE (not supported by this CPU)
+ */
+sel_err_t law_hsc_set_isa(const int isa);
+
+/**
+ * Parse the request line in text, which must end with its CRLF.  The text
+ * is modified, and the request line points into it.
+ *
+ * RETURNS: LAW_ERR_OK, LAW_ERR_SYN, LAW_ERR_OOM
+ */
+sel_err_t law_hsc_reqline(
+        char *text,
+        const size_t length,
+        struct pgc_stk *heap,
+        law_hts_reqline_t *reqline);
+
+/**
+ * Parse the header fields in text, which must end with the empty line
+ * (CRLF) that ends the head.  The text is modified and must outlive the
+ * headers.
+ *
+ * RETURNS: LAW_ERR_OK, LAW_ERR_SYN, LAW_ERR_OOM, LAW_ERR_OOB
+ */
+sel_err_t law_hsc_headers(
+        char *text,
+        const size_t length,
+        struct pgc_stk *heap,
+        law_htheaders_t *headers);
+
+#endif
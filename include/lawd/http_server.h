@@ -5,6 +5,31 @@
 #include "lawd/http_headers.h"
 #include "lawd/http_conn.h"
 #include "lawd/server.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+enum law_hts_parser {                           /** Request Head Parser */
+        LAW_HTS_PGENC           = 0,            /** Grammar (grammar/http.g) */
+        LAW_HTS_SCAN            = 1,            /** Scanner (lawd/http_scan.h) */
+};
+
+enum law_hts_header {                           /** Response Header Name */
+        LAW_HTS_CONTENT_LENGTH  = 0,            /** Content-Length */
+        LAW_HTS_CONTENT_TYPE    = 1,            /** Content-Type */
+        LAW_HTS_CONNECTION      = 2,            /** Connection */
+        LAW_HTS_DATE            = 3,            /** Date */
+        LAW_HTS_SERVER          = 4,            /** Server */
+        LAW_HTS_CACHE_CONTROL   = 5,            /** Cache-Control */
+        LAW_HTS_LOCATION        = 6,            /** Location */
+        LAW_HTS_TRANSFER_ENCODING = 7,          /** Transfer-Encoding */
+        LAW_HTS_KEEP_ALIVE      = 8,            /** Keep-Alive */
+        LAW_HTS_UPGRADE         = 9,            /** Upgrade */
+        LAW_HTS_RETRY_AFTER     = 10,           /** Retry-After */
+        LAW_HTS_SEC_WEBSOCKET_ACCEPT = 11,      /** Sec-WebSocket-Accept */
+        LAW_HTS_CONTENT_ENCODING = 12,          /** Content-Encoding */
+        LAW_HTS_VARY            = 13,           /** Vary */
+        LAW_HTS_HEADERS         = 14            /** Number of Names */
+};
 
 typedef struct law_hts_reqline {                /** HTTP Request Line */
         const char *method;                     /** Request Method */
@@ -39,11 +64,16 @@ typedef struct law_htserver_cfg {               /** HTTP Server Config */
         law_hts_on_error_t on_error;            /** Reject Callback */
         law_data_t data;                        /** User Data */
         int security;                           /** Security Mode */
+        int parser;                             /** Request Head Parser */
         const char *cert;                       /** Certificate File */
         const char *pkey;                       /** Private Key File */
         time_t ssl_shutdown_timeout;            /** SSL Shutdown Timeout */
         time_t reqline_timeout;                 /** Request Line Timeout */
         time_t headers_timeout;                 /** Headers Timeout */
+        time_t idle_timeout;                    /** Keep-Alive Idle Timeout */
+        time_t response_timeout;                /** Response Flush Timeout */
+        int max_requests;                       /** Requests per Connection */
+        size_t max_body;                        /** Body Limit (0: None) */
 } law_htserver_cfg_t;
 
 /** HTTP Server */
@@ -61,6 +91,23 @@ struct pgc_stk *law_hts_get_stack(law_hts_req_t *request);
 /** Get the request's parser heap. */
 struct pgc_stk *law_hts_get_heap(law_hts_req_t *request);
 
+/** 
+ * Check whether the connection stays open for another request after this 
+ * one.  HTTP/1.1 connections persist unless the client sent "Connection: 
+ * close"; HTTP/1.0 connections only persist with "Connection: keep-alive".
+ * A handler that keeps the connection must frame its response with 
+ * Content-Length (or chunked encoding), and should echo the keep-alive 
+ * header to HTTP/1.0 clients.  Responses without framing end with the 
+ * connection.
+ */
+bool law_hts_get_keep_alive(law_hts_req_t *request);
+
+/** 
+ * Close the connection after this response (keep_alive false), or keep it
+ * open (true) when the request allows it.
+ */
+void law_hts_set_keep_alive(law_hts_req_t *request, bool keep_alive);
+
 /** Get the server's security mode. */
 int law_hts_get_security(law_htserver_t *server);
 
@@ -166,7 +213,201 @@ sel_err_t law_hts_add_header(
         const char *field_value);
 
 /**
- * Begin response body.
+ * Set the HTTP/1.1 status line, copied from a table of prebuilt lines.
+ * Status codes without a reason phrase get "Unknown Status Code".
+ * 
+ * LAW_ERR_OOB - Buffer is full.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_put_status(law_hts_req_t *request, const int status);
+
+/**
+ * Add a response header with a well-known name (LAW_HTS_*).
+ * 
+ * LAW_ERR_OOB - Buffer is full.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_put_header(
+        law_hts_req_t *request,
+        const int header,
+        const char *field_value);
+
+/**
+ * Add a Content-Length header.
+ * 
+ * LAW_ERR_OOB - Buffer is full.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_put_length(law_hts_req_t *request, const size_t length);
+
+/**
+ * Add a Date header.  The line is cached per worker and formatted again 
+ * at most once a second.
+ * 
+ * LAW_ERR_OOB - Buffer is full.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_put_date(law_hts_req_t *request);
+
+/**
+ * Read the next span of the request body without copying it.  Content-Length
+ * and chunked bodies are both decoded; span points into the input buffer
+ * and stays valid until the next read from the connection.  A length of 0
+ * means the whole body has been read.
+ * 
+ * LAW_ERR_WANTR - Wants to read.
+ * LAW_ERR_WANTW - Wants to write.
+ * LAW_ERR_SYN - Malformed chunked encoding.
+ * LAW_ERR_OOB - Body exceeds the max_body limit.
+ * LAW_ERR_EOF - Connection closed inside the body.
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_body_span(
+        law_hts_req_t *request,
+        const void **span,
+        size_t *length);
+
+/**
+ * Read the next span of the request body without copying it.
+ * 
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_SYN - Malformed chunked encoding.
+ * LAW_ERR_OOB - Body exceeds the max_body limit.
+ * LAW_ERR_EOF - Connection closed inside the body.
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_body_span_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request,
+        const void **span,
+        size_t *length);
+
+/**
+ * Copy up to size bytes of the request body into buffer.  A length of 0 
+ * means the whole body has been read.
+ * 
+ * LAW_ERR_WANTR - Wants to read.
+ * LAW_ERR_WANTW - Wants to write.
+ * LAW_ERR_SYN - Malformed chunked encoding.
+ * LAW_ERR_OOB - Body exceeds the max_body limit.
+ * LAW_ERR_EOF - Connection closed inside the body.
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_body_read(
+        law_hts_req_t *request,
+        void *buffer,
+        const size_t size,
+        size_t *length);
+
+/**
+ * Copy up to size bytes of the request body into buffer.
+ * 
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_SYN - Malformed chunked encoding.
+ * LAW_ERR_OOB - Body exceeds the max_body limit.
+ * LAW_ERR_EOF - Connection closed inside the body.
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_body_read_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request,
+        void *buffer,
+        const size_t size,
+        size_t *length);
+
+/** Length for law_hts_begin_stream_sync when the body size is unknown. */
+#define LAW_HTS_UNKNOWN_LENGTH SIZE_MAX
+
+/**
+ * End the response head and start a streamed body.  A known length adds a
+ * Content-Length header; LAW_HTS_UNKNOWN_LENGTH adds chunked encoding, or 
+ * closes the connection after the body for HTTP/1.0 clients.  The output 
+ * buffer only needs room for the head; body writes flush it as it fills.
+ * 
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_OOB - Head does not fit in the output buffer.
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_begin_stream_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request,
+        const size_t length);
+
+/**
+ * Write part of a streamed body, waiting for the client to take buffered 
+ * output whenever the output buffer is full.
+ * 
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_MODE - No stream was begun, or it has ended.
+ * LAW_ERR_LIMIT - More bytes than the Content-Length.
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_write_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request,
+        const void *data,
+        const size_t length);
+
+/**
+ * Write part of a streamed body by reference: the bytes are queued on the
+ * connection and sent from where they are, with only chunk framing copied
+ * into the output buffer.  release(data, length, state) is called once they
+ * are sent or the connection is closed, unless an error is returned first.
+ * 
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_MODE - No stream was begun, or it has ended.
+ * LAW_ERR_LIMIT - More bytes than the Content-Length.
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_write_ref_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request,
+        const void *data,
+        const size_t length,
+        law_htc_release_t release,
+        void *state);
+
+/**
+ * End a streamed body.  The rest of the output is sent when the handler
+ * returns.
+ * 
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_MODE - No stream was begun, or it has ended.
+ * LAW_ERR_LIMIT - Fewer bytes than the Content-Length (the connection 
+ *                 closes after the response).
+ * LAW_ERR_SYS - Socket IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hts_end_stream_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *request);
+
+/**
+ * Begin response body.  A head without Content-Length (or chunked encoding)
+ * gets "Connection: close" when the connection would have stayed open, and
+ * the body then ends with the connection.  HEAD requests and the statuses
+ * without a body (1xx, 204, 304) need no framing.
  * 
  * LAW_ERR_OOB - Buffer is full.
  * LAW_ERR_OK - All OK.
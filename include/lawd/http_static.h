@@ -0,0 +1,73 @@
+#ifndef LAWD_HTTP_STATIC_H
+#define LAWD_HTTP_STATIC_H
+
+#include "lawd/error.h"
+#include "lawd/server.h"
+#include "lawd/http_server.h"
+#include <stddef.h>
+
+/*
+ * Static files served from a document root.  Request paths are percent
+ * decoded and resolved below the root; ".." segments and encoded slashes
+ * are refused, but symbolic links inside the root are followed, so the
+ * root should not contain links the server must not serve.
+ *
+ * Each worker keeps an LRU cache of open descriptors with their size,
+ * modification time, ETag and MIME type, so hot files are neither opened
+ * nor stat'ed per request.  Cached entries are checked against the file
+ * system again after cfg.revalidate milliseconds.
+ *
+ * Bodies go out with sendfile(), or through the output buffer with pread()
+ * when the connection is encrypted.  GET and HEAD are supported, with
+ * single byte ranges (Range, If-Range) and conditional requests
+ * (If-None-Match, and If-Modified-Since matching Last-Modified exactly).
+ */
+
+typedef struct law_hsf_cfg {                    /** Static Files Config */
+        const char *root;                       /** Document Root */
+        const char *index;                      /** Directory Index File */
+        size_t entries;                         /** Cached Files per Worker */
+        law_time_t revalidate;                  /** Cache Check Interval */
+        law_time_t timeout;                     /** Send Idle Timeout */
+} law_hsf_cfg_t;
+
+/** Static File Server */
+typedef struct law_hsf law_hsf_t;
+
+/**
+ * Get a sane default configuration.  The root must still be set.
+ */
+law_hsf_cfg_t law_hsf_sanity();
+
+/**
+ * Open the document root and allocate one file cache per server worker.
+ *
+ * RETURNS: The file server, or NULL (errno is set).
+ */
+law_hsf_t *law_hsf_create(law_server_cfg_t *srv_cfg, law_hsf_cfg_t *cfg);
+
+/**
+ * Close every cached file and the document root.
+ */
+void law_hsf_destroy(law_hsf_t *hsf);
+
+/**
+ * Respond to the request with the file its target names.  Missing files,
+ * bad paths and other methods get an error response (404, 400, 405) rather
+ * than an error code.  Call from an on_accept handler.
+ *
+ * LAW_ERR_TIMEOUT - Timed Out
+ * LAW_ERR_OOB - Response head does not fit in the output buffer.
+ * LAW_ERR_EOF - The file shrank while it was sent.
+ * LAW_ERR_SYS - Socket or file IO.
+ * LAW_ERR_SSL - SSL error.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hsf_serve(
+        law_hsf_t *hsf,
+        law_worker_t *worker,
+        law_hts_req_t *request,
+        law_hts_reqline_t *reqline,
+        law_htheaders_t *headers);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef LAWD_OFFLOAD_H
+#define LAWD_OFFLOAD_H
+
+#include "lawd/server.h"
+#include "lawd/time.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** Blocking Work Function */
+typedef sel_err_t (*law_offload_fn_t)(void *arg);
+
+/** Timing of a Single Offloaded Call */
+typedef struct law_offload_timing {
+        int64_t queued;                         /** Nanoseconds Queued */
+        int64_t running;                        /** Nanoseconds Running */
+} law_offload_timing_t;
+
+/** Offload Pool Statistics */
+typedef struct law_offload_stats {
+        int threads;                            /** Pool Threads */
+        int depth;                              /** Job Slots */
+        size_t queued;                          /** Jobs Waiting Now */
+        size_t running;                         /** Jobs Running Now */
+        uint64_t submitted;                     /** Jobs Accepted */
+        uint64_t rejected;                      /** Jobs Refused (Full) */
+        uint64_t completed;                     /** Jobs Finished */
+        uint64_t cancelled;                     /** Timed Out While Queued */
+        uint64_t abandoned;                     /** Timed Out While Running */
+        int64_t queued_total;                   /** Sum of Queue Nanoseconds */
+        int64_t queued_max;                     /** Max Queue Nanoseconds */
+        int64_t running_total;                  /** Sum of Run Nanoseconds */
+        int64_t running_max;                    /** Max Run Nanoseconds */
+} law_offload_stats_t;
+
+/**
+ * Run fn(arg) on the server's offload pool and suspend the active task
+ * until it finishes.  Other tasks on the worker keep running meanwhile.
+ * A job that times out before starting is cancelled; one that times out
+ * while running is abandoned and fn's result is discarded, so arg must
+ * outlive the job in that case.
+ *
+ * RETURNS:
+ *      fn's return value - fn finished in time.
+ *      LAW_ERR_TIME - Timed out.
+ *      LAW_ERR_LIMIT - No free job slots, or the pool has no threads.
+ */
+sel_err_t law_offload(
+        law_worker_t *worker,
+        law_offload_fn_t fn,
+        void *arg,
+        law_time_t timeout);
+
+/**
+ * Same as law_offload, also reporting how long the job waited and ran.
+ * The timing is zeroed for the parts that did not happen.
+ */
+sel_err_t law_offload_timed(
+        law_worker_t *worker,
+        law_offload_fn_t fn,
+        void *arg,
+        law_time_t timeout,
+        law_offload_timing_t *timing);
+
+/**
+ * Get a snapshot of the server's offload pool statistics.
+ */
+void law_offload_stats(law_server_t *server, law_offload_stats_t *stats);
+
+#endif
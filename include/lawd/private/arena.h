@@ -0,0 +1,37 @@
+#ifndef LAWD_PRIVATE_ARENA_H
+#define LAWD_PRIVATE_ARENA_H
+
+#include "lawd/arena.h"
+#include <stddef.h>
+
+typedef struct law_chunk {
+        struct law_chunk *next;                 /** Next Chunk */
+        size_t length;                          /** Usable Bytes */
+        max_align_t data[];                     /** Chunk Memory */
+} law_chunk_t;
+
+typedef struct law_slab {
+        size_t chunk_length;                    /** Standard Chunk Length */
+        size_t max_cached;                      /** Cache Capacity */
+        size_t num_cached;                      /** Cached Chunks */
+        size_t num_chunks;                      /** Live Chunks */
+        size_t high_water;                      /** Peak of Any Arena */
+        law_chunk_t *cache;                     /** Idle Chunks */
+} law_slab_t;
+
+typedef struct law_arena {
+        law_slab_t *slab;                       /** Chunk Source */
+        law_chunk_t *chunks;                    /** Chunks in Use */
+        char *cursor;                           /** Next Free Byte */
+        char *limit;                            /** End of Current Chunk */
+        size_t used;                            /** Bytes Used */
+        size_t reserved;                        /** Bytes Held */
+        size_t high_water;                      /** Peak Bytes Used */
+} law_arena_t;
+
+/**
+ * Initialize an empty arena drawing chunks from the slab.
+ */
+void law_arena_init(law_arena_t *arena, law_slab_t *slab);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef LAWD_PRIVATE_CODEL_H
+#define LAWD_PRIVATE_CODEL_H
+
+#include "lawd/codel.h"
+#include <stdatomic.h>
+
+/** 
+ * CoDel Queue Delay Controller 
+ * 
+ * Once the queue delay has stayed above target for a whole interval the 
+ * controller starts dropping, and keeps dropping at intervals shrinking 
+ * with the square root of the drop count until the delay falls below 
+ * target again.
+ */
+typedef struct law_codel {
+        int64_t target;                         /** Target Delay (ns) */
+        int64_t interval;                       /** Interval (ns) */
+        int64_t first_above;                    /** End of Grace (or 0) */
+        int64_t drop_next;                      /** Next Drop Time */
+        uint32_t last_count;                    /** Drops Last Episode */
+        atomic_bool dropping;                   /** In a Dropping Episode */
+        atomic_uint_least32_t count;            /** Drops This Episode */
+        atomic_int_least64_t delay;             /** Last Queue Delay */
+        atomic_uint_least64_t admitted;         /** Items Admitted */
+        atomic_uint_least64_t dropped;          /** Items Dropped */
+} law_codel_t;
+
+/**
+ * Initialize the controller with target and interval in milliseconds.  A 
+ * target of 0 admits everything.
+ */
+void law_codel_init(law_codel_t *codel, law_time_t target, law_time_t interval);
+
+/**
+ * Get the controller's clock, in monotonic nanoseconds.
+ */
+int64_t law_codel_nanos();
+
+/**
+ * Decide whether an item that waited since enqueued should be served now.
+ * 
+ * RETURNS: false if the item should be dropped.
+ */
+bool law_codel_admit(law_codel_t *codel, int64_t enqueued, int64_t now);
+
+/**
+ * Copy the controller's state.
+ */
+void law_codel_read(law_codel_t *codel, law_codel_stats_t *stats);
+
+#endif
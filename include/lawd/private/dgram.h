@@ -0,0 +1,45 @@
+#ifndef LAWD_PRIVATE_DGRAM_H
+#define LAWD_PRIVATE_DGRAM_H
+
+#include "lawd/dgram.h"
+
+/**
+ * Create receive and send buffers for batch datagrams of up to size bytes
+ * each, on the socket fd.  The batch takes ownership of fd.
+ *
+ * RETURNS: NULL when out of memory.
+ */
+law_dgrams_t *law_dgrams_create(int fd, const size_t batch, const size_t size);
+
+/**
+ * Destroy the buffers and close the socket.
+ */
+void law_dgrams_destroy(law_dgrams_t *dgrams);
+
+/**
+ * Get the batch's socket.
+ */
+int law_dgrams_fd(law_dgrams_t *dgrams);
+
+/**
+ * Receive up to a batch of datagrams with one recvmmsg call, replacing the
+ * previous batch.
+ *
+ * RETURNS: LAW_ERR_OK, LAW_ERR_WANTR, LAW_ERR_SYS
+ */
+sel_err_t law_dgrams_recv(law_dgrams_t *dgrams);
+
+/**
+ * Send the queued datagrams with sendmmsg.  Whatever the socket did not
+ * take stays queued.
+ *
+ * RETURNS: LAW_ERR_OK, LAW_ERR_WANTW, LAW_ERR_SYS
+ */
+sel_err_t law_dgrams_flush(law_dgrams_t *dgrams);
+
+/**
+ * Drop the queued datagrams.
+ */
+void law_dgrams_discard(law_dgrams_t *dgrams);
+
+#endif
@@ -6,11 +6,23 @@
 #include "pgenc/ast.h"
 #include <openssl/ssl.h>
 
+#define LAW_HTC_SEGMENTS 8
+
+typedef struct law_htc_seg {
+        const void *base;
+        size_t length;
+        size_t mark;                            /** Output Position it Follows */
+        law_htc_release_t release;
+        void *state;
+} law_htc_seg_t;
+
 typedef struct law_htconn {
         int socket;
         int security;
         SSL *ssl;
         struct pgc_buf *in, *out;
+        law_htc_seg_t queue[LAW_HTC_SEGMENTS];
+        size_t head, count, sent;
 } law_htconn_t;
 
 sel_err_t law_htc_read_head(
@@ -3,13 +3,46 @@
 
 #include "lawd/http_headers.h"
 #include "pgenc/ast.h"
+#include <stdint.h>
 
+/** Buckets in the Index of Other Headers (a Power of Two) */
+#define LAW_HTH_BUCKETS 32
+
+/** Scanned Header Field (offsets into the head text) */
+struct law_htfield {
+        uint32_t name, name_len;
+        uint32_t value, value_len;
+        uint32_t next;                          /** Next in Bucket (+1) */
+};
+
+/* Headers come either from the grammar (list) or from the scanner (base, 
+ * fields and count), whichever parser the server is configured with.  
+ * Scanned headers are indexed by law_hth_index: well-known fields by slot, 
+ * the rest by a hash of the lowercased name.  Both hold field index + 1 of
+ * the first occurrence, or 0. */
 struct law_htheaders {
         struct pgc_ast_lst *list;
+        const char *base;
+        struct law_htfield *fields;
+        size_t count;
+        uint32_t known[LAW_HTH_FIELDS];
+        uint32_t buckets[LAW_HTH_BUCKETS];
 };
 
 struct law_hth_iter {
         struct pgc_ast_lst *list;
+        const char *base;
+        struct law_htfield *fields;
+        size_t count;
 };
 
+/** 
+ * Classify a header name as a well-known field (LAW_HTH_*), ignoring case.
+ * Returns -1 for other names.
+ */
+int law_hth_classify(const char *name, const size_t length);
+
+/** Build the index of scanned headers (fields and count). */
+void law_hth_index(law_htheaders_t *headers);
+
 #endif
\ No newline at end of file
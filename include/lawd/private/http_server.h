@@ -6,6 +6,7 @@
 #include "lawd/private/http_conn.h"
 #include "pgenc/buffer.h"
 #include "pgenc/stack.h"
+#include <time.h>
 
 typedef struct law_hts_buf {
         struct pgc_buf buffer;
@@ -23,12 +24,17 @@ typedef struct law_hts_pool {
         void *list;
 } law_hts_pool_t;
 
+/** Length of "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n" */
+#define LAW_HTS_DATE_LEN 37
+
 typedef struct law_hts_pool_group {
         law_hts_pool_t 
                 in_pool,
                 out_pool,
                 stack_pool,
                 heap_pool;
+        time_t date_time;                       /** Second of the Date Line */
+        char date[LAW_HTS_DATE_LEN];            /** Cached Date Header Line */
 } law_hts_pool_group_t;
 
 struct law_htserver {
@@ -38,12 +44,65 @@ struct law_htserver {
         int workers;
 };
 
+enum law_hts_body_state {                       /** Request Body Decoder */
+        LAW_HTS_BODY_DONE       = 0,            /** Body Fully Read */
+        LAW_HTS_BODY_DATA       = 1,            /** Content-Length Data */
+        LAW_HTS_BODY_SIZE       = 2,            /** Chunk Size Line */
+        LAW_HTS_BODY_CHUNK      = 3,            /** Chunk Data */
+        LAW_HTS_BODY_CRLF       = 4,            /** CRLF After Chunk Data */
+        LAW_HTS_BODY_TRAILER    = 5,            /** Trailer Fields */
+        LAW_HTS_BODY_ERROR      = 6,            /** Framing Error */
+};
+
+/** Longest chunk size or trailer line the decoder accepts. */
+#define LAW_HTS_BODY_LINE 1024
+
+typedef struct law_hts_body {
+        int state;                              /** Decoder State */
+        sel_err_t error;                        /** Error for BODY_ERROR */
+        size_t remaining;                       /** Bytes Left in Data/Chunk */
+        size_t total;                           /** Body Bytes Framed So Far */
+} law_hts_body_t;
+
+enum law_hts_stream_mode {                      /** Response Body Framing */
+        LAW_HTS_STREAM_NONE     = 0,            /** Not Streaming */
+        LAW_HTS_STREAM_LENGTH   = 1,            /** Content-Length */
+        LAW_HTS_STREAM_CHUNKED  = 2,            /** Chunked Encoding */
+        LAW_HTS_STREAM_CLOSE    = 3,            /** Ends With the Connection */
+        LAW_HTS_STREAM_ENDED    = 4,            /** Body Complete */
+};
+
+/** Chunk size line ("%zx\r\n") plus the CRLF after the data. */
+#define LAW_HTS_CHUNK_OVERHEAD (sizeof(size_t) * 2 + 4)
+
+typedef struct law_hts_stream {
+        int mode;                               /** Framing Mode */
+        bool chunked;                           /** Client Takes Chunks */
+        size_t remaining;                       /** Bytes Left for LENGTH */
+} law_hts_stream_t;
+
 struct law_hts_req {
         law_htconn_t conn;
         struct pgc_stk 
                 *stack, 
                 *heap;
         law_htserver_t *htserver;
+        law_hts_pool_group_t *group;            /** Worker's Pools (or NULL) */
+        int parser;                             /** Request Head Parser */
+        law_htc_scan_t scan;                    /** Head Delimiter Scan */
+        int requests;                           /** Requests Read So Far */
+        bool persistent;                        /** Client Allows Reuse */
+        bool keep_alive;                        /** Reuse After Response */
+        bool framed;                            /** Response Length Is Known */
+        size_t body_end;                        /** End of Request Body */
+        law_hts_body_t body;                    /** Request Body Decoder */
+        law_hts_stream_t stream;                /** Response Body Writer */
 };
 
+/** 
+ * Format "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n" (LAW_HTS_DATE_LEN bytes, 
+ * not terminated) for a UTC time.
+ */
+void law_hts_format_date(char *line, const time_t t);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef LAWD_PRIVATE_OFFLOAD_H
+#define LAWD_PRIVATE_OFFLOAD_H
+
+#include "lawd/offload.h"
+
+/** Offload Thread Pool */
+typedef struct law_opool law_opool_t;
+
+/**
+ * Create a pool of threads threads with depth job slots.  No threads run
+ * until law_opool_start.
+ *
+ * RETURNS: NULL when out of memory.
+ */
+law_opool_t *law_opool_create(const int threads, const int depth);
+
+/**
+ * Destroy the pool.  The pool must be stopped.
+ */
+void law_opool_destroy(law_opool_t *pool);
+
+/**
+ * Start the pool's threads.
+ *
+ * RETURNS: LAW_ERR_OK, LAW_ERR_SYS
+ */
+sel_err_t law_opool_start(law_opool_t *pool);
+
+/**
+ * Stop the pool, waiting for running (possibly abandoned) jobs to finish.
+ */
+void law_opool_stop(law_opool_t *pool);
+
+/**
+ * Get the server's offload pool.
+ */
+law_opool_t *law_get_opool(law_server_t *server);
+
+#endif
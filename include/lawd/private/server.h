@@ -1,6 +1,7 @@
 #ifndef LAWD_PRIVATE_SERVER_H
 #define LAWD_PRIVATE_SERVER_H
 
+#include "lawd/server.h"
 #include "lawd/data.h"
 #include "lawd/id.h"
 #include <pthread.h>
@@ -23,9 +24,11 @@ typedef struct law_task_queue {
         int fds[2];
 } law_task_queue_t;
 
-/** Task Ready Set */
+/** Task Ready Set (FIFO) */
 typedef struct law_ready_set {
-        law_task_t *list;
+        law_task_t *head;
+        law_task_t *tail;
+        size_t size;
 } law_ready_set_t;
 
 /** Task Pool */
@@ -40,4 +43,16 @@ typedef struct law_slot {
         int8_t data;
 } law_slot_t;
 
+/**
+ * Wake the target worker's task with a LAW_EV_WAK event.  When self is the
+ * target (the caller runs on the target worker) the task goes straight to 
+ * the ready set, otherwise a wakeup message is queued.  Self may be NULL.
+ * 
+ * RETURNS: LAW_ERR_OK, LAW_ERR_WANTW, LAW_ERR_SYS
+ */
+sel_err_t law_worker_wake(
+        law_worker_t *self, 
+        law_worker_t *target, 
+        law_id_t id);
+
 #endif
\ No newline at end of file
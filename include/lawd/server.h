@@ -6,6 +6,8 @@
 #include "lawd/event.h"
 #include "lawd/time.h"
 #include "lawd/id.h"
+#include "lawd/arena.h"
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -15,7 +17,14 @@ enum law_network_protocol {
         LAW_PROTOCOL_UDP6               = 2,            /** UDP over IPv6 */
         LAW_PROTOCOL_TCP                = 3,            /** TCP over IPv4 */
         LAW_PROTOCOL_TCP6               = 4,            /** TCP over IPv6 */
-        LAW_PROTOCOL_NONE               = 5             /** No Protocol */
+        LAW_PROTOCOL_NONE               = 5,            /** No Protocol */
+        LAW_PROTOCOL_UNIX               = 6             /** Unix Stream Socket */
+};
+
+/** What the acceptor does when every task is busy */
+enum law_overload_policy {
+        LAW_OVERLOAD_BACKLOG            = 0,            /** Leave in Backlog */
+        LAW_OVERLOAD_REJECT             = 1             /** Reply and Close */
 };
 
 /** Network Server */
@@ -35,12 +44,51 @@ typedef sel_err_t (*law_on_accept_t)(
         int socket,
         law_data_t data);
 
+/** Batch of Received Datagrams (see lawd/dgram.h) */
+typedef struct law_dgrams law_dgrams_t;
+
+/** Datagram Callback */
+typedef sel_err_t (*law_on_dgrams_t)(
+        law_worker_t *worker,
+        law_dgrams_t *dgrams,
+        law_data_t data);
+
 /** On Error Callback */
 typedef sel_err_t (*law_on_error_t)(
         law_server_t *server,
         sel_err_t error,
         law_data_t data);
 
+/** Socket Options (zero leaves the system default) */
+typedef struct law_sockopts {
+        bool nodelay;                           /** TCP_NODELAY */
+        bool quickack;                          /** TCP_QUICKACK at Accept */
+        int defer_accept;                       /** TCP_DEFER_ACCEPT Seconds */
+        int fastopen;                           /** TCP_FASTOPEN Queue */
+        int busy_poll;                          /** SO_BUSY_POLL Microseconds */
+        int sndbuf;                             /** SO_SNDBUF Bytes */
+        int rcvbuf;                             /** SO_RCVBUF Bytes */
+        bool incoming_cpu;                      /** UDP: SO_INCOMING_CPU */
+} law_sockopts_t;
+
+/** Listener Configuration */
+typedef struct law_listener_cfg {
+        int protocol;                           /** TCP, TCP6 or UNIX */
+        int port;                               /** Socket Port */
+        const char *path;                       /** Unix Socket Path */
+        int mode;                               /** Unix Socket Mode (or 0) */
+        int backlog;                            /** Socket Listen Backlog */
+        law_sockopts_t sockopts;                /** Socket Options */
+        law_on_accept_t on_accept;              /** Accept Callback */
+        law_data_t data;                        /** Accept Callback Data */
+
+        /* Connections turned away on overload get this reply, or the 
+         * server's when it is NULL.  A reply of length 0 closes them 
+         * without one, for listeners that do not speak HTTP. */
+        const char *overload_reply;             /** Raw Reply (or NULL) */
+        size_t overload_reply_len;              /** Raw Reply Length */
+} law_listener_cfg_t;
+
 /** Server Configuration */
 typedef struct law_server_cfg {                            
 
@@ -48,19 +96,60 @@ typedef struct law_server_cfg {
         int port;                               /** Socket Port */
         int backlog;                            /** Socket Listen Backlog */
 
+        const char *unix_path;                  /** Unix Socket Path */
+        int unix_mode;                          /** Unix Socket Mode (or 0) */
+
+        /* Listener options go on the listening socket before listen, so 
+         * accepted sockets inherit them; nodelay and quickack are also set
+         * on every accepted socket.  With incoming_cpu each worker's UDP 
+         * socket prefers packets handled by the CPU numbered like the 
+         * worker. */
+        law_sockopts_t sockopts;                /** Socket Options */
+
         int workers;                            /** Number of Worker Threads */
         int worker_tasks;                       /** Max Tasks per Worker */
+        int worker_supply;                      /** Tasks Cached per Worker */
 
         int server_timeout;                     /** Server Polling Timeout */
         int worker_timeout;                     /** Worker Polling Timeout */
 
         size_t stack;                           /** Coroutine Stack Length */
         size_t guards;                          /** Coroutine Stack Guards */
+
+        size_t arena_chunk;                     /** Arena Chunk Length */
+        int arena_cache;                        /** Arena Chunks per Worker */
+
+        int offload_threads;                    /** Offload Pool Threads */
+        int offload_queue;                      /** Offload Job Slots */
+
+        int dgram_batch;                        /** Datagrams per recvmmsg */
+        size_t dgram_size;                      /** Datagram Buffer Length */
+
+        /* With LAW_OVERLOAD_REJECT the acceptor keeps accepting while the 
+         * task pool is empty, writes overload_reply to each connection and 
+         * closes it.  Without a reply a 503 with Retry-After is sent.  
+         * Listeners may set their own reply. */
+        int overload;                           /** Overload Policy */
+        int overload_retry;                     /** Retry-After Seconds */
+        const char *overload_reply;             /** Raw Reply (or NULL) */
+        size_t overload_reply_len;              /** Raw Reply Length */
+
+        /* Accepted connections that waited longer than codel_target before
+         * their first dispatch, for a whole codel_interval, are shed with 
+         * the overload reply at a CoDel rate.  See lawd/codel.h. */
+        law_time_t codel_target;                /** Target Delay (ms, or 0) */
+        law_time_t codel_interval;              /** Interval (ms) */
         
         int server_events;                      /** Server Event Buffer */
         int worker_events;                      /** Worker Event Buffer */
 
         law_on_accept_t on_accept;              /** Accept Callback */
+        law_on_dgrams_t on_dgrams;              /** UDP Datagram Callback */
+
+        /* When num_listeners is 0 a stream server has a single listener 
+         * made of protocol, port, backlog, on_accept and data above. */
+        law_listener_cfg_t *listeners;          /** Listeners (Copied) */
+        int num_listeners;                      /** Number of Listeners */
         law_on_error_t on_error;                /** Error Callback */
 
         law_data_t data;                        /** User Data */
@@ -89,6 +178,16 @@ void law_server_destroy(law_server_t *server);
  */
 int law_get_server_socket(law_server_t *server);
 
+/**
+ * Get the socket of the server's listener at index.
+ */
+int law_get_listener_socket(law_server_t *server, int index);
+
+/**
+ * Get the number of connections rejected under LAW_OVERLOAD_REJECT.
+ */
+uint64_t law_get_rejected(law_server_t *server);
+
 /** 
  * Get a pointer to the worker's server.
  */
@@ -99,6 +198,12 @@ law_server_t *law_get_server(law_worker_t *worker);
  */
 law_id_t law_get_active_id(law_worker_t *worker);
 
+/**
+ * Get the active task's arena.  Allocations live until the task ends, when 
+ * the arena is reset and its chunks return to the worker's slab.
+ */
+law_arena_t *law_task_arena(law_worker_t *worker);
+
 /**
  * Get the worker's id.
  */
@@ -133,6 +238,37 @@ sel_err_t law_start(law_server_t *server);
  */
 sel_err_t law_stop(law_server_t *server);
 
+/**
+ * Hot restart, old process side.  Listen on the Unix socket at path, wait
+ * up to timeout milliseconds for the new process to connect, and pass it 
+ * every listener socket with SCM_RIGHTS.  The server keeps accepting until 
+ * it is stopped, and law_close then leaves Unix listener paths in place for
+ * the new process.  Blocks the caller, so call it from a control thread or 
+ * an offloaded job rather than a task.  UDP servers cannot hand off their 
+ * per-worker sockets and get LAW_ERR_MODE.
+ * 
+ * RETURNS: LAW_ERR_OK, LAW_ERR_MODE, LAW_ERR_TIME, LAW_ERR_SYS
+ */
+sel_err_t law_handoff_send(
+        law_server_t *server, 
+        const char *path, 
+        law_time_t timeout);
+
+/**
+ * Hot restart, new process side.  Connect to the old process at path, 
+ * retrying for up to timeout milliseconds, and adopt the listener sockets 
+ * it sends.  Call between law_server_create and law_open; law_open then 
+ * uses the inherited sockets instead of creating and binding new ones.  
+ * Both servers must configure the same listeners in the same order.  UDP 
+ * servers get LAW_ERR_MODE, as for law_handoff_send.
+ * 
+ * RETURNS: LAW_ERR_OK, LAW_ERR_MODE, LAW_ERR_TIME, LAW_ERR_SYS
+ */
+sel_err_t law_handoff_recv(
+        law_server_t *server, 
+        const char *path, 
+        law_time_t timeout);
+
 /** 
  * Configure events for the file descriptor.  See lawd/events.h for more info.
  * 
@@ -160,6 +296,22 @@ int law_ewait(
         law_event_t *events,
         int max_events);
 
+/**
+ * Suspend the active task for at least millis milliseconds.  Wakeups
+ * delivered to the task in the meantime are absorbed.
+ * 
+ * RETURNS: LAW_ERR_OK, LAW_ERR_OOM
+ */
+sel_err_t law_sleep(law_worker_t *worker, law_time_t millis);
+
+/**
+ * Put the active task at the back of the ready set and let the other 
+ * ready tasks run.  The task resumes in the worker's next tick at the 
+ * latest.  No timer or event registration is involved, so this is cheap 
+ * enough to call inside long CPU-bound loops.
+ */
+void law_yield(law_worker_t *worker);
+
 /** 
  * Spawn a new task. 
  * 
@@ -173,6 +325,19 @@ sel_err_t law_spawn(
         law_callback_t callback,
         law_data_t data);
 
+/**
+ * Spawn a new task on the worker running the caller.  The task is taken 
+ * from the worker's local supply of finished tasks (or the pool when the 
+ * supply is empty) and made ready immediately, without touching the 
+ * worker's incoming queue.  Must be called from the worker's own thread.
+ * 
+ * RETURNS: The new task's id, or 0 when the task limit is reached.
+ */
+law_id_t law_spawn_local(
+        law_worker_t *worker,
+        law_callback_t callback,
+        law_data_t data);
+
 /**
  * Lift a non-blocking IO callback on 'fd' to a synchronous call.
  */
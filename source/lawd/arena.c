@@ -0,0 +1,170 @@
+
+#include "lawd/private/arena.h"
+#include "lawd/error.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LAW_ARENA_ALIGN _Alignof(max_align_t)
+
+law_slab_t *law_slab_create(
+        const size_t chunk_length,
+        const size_t max_cached)
+{
+        SEL_ASSERT(chunk_length);
+
+        law_slab_t *slab = calloc(1, sizeof(law_slab_t));
+        if(!slab) return NULL;
+
+        slab->chunk_length =
+                (chunk_length + LAW_ARENA_ALIGN - 1) & ~(LAW_ARENA_ALIGN - 1);
+        slab->max_cached = max_cached;
+        slab->num_cached = 0;
+        slab->num_chunks = 0;
+        slab->high_water = 0;
+        slab->cache = NULL;
+
+        return slab;
+}
+
+void law_slab_destroy(law_slab_t *slab)
+{
+        if(!slab) return;
+        while(slab->cache) {
+                law_chunk_t *chunk = slab->cache;
+                slab->cache = chunk->next;
+                free(chunk);
+        }
+        free(slab);
+}
+
+/** Take a chunk of at least length bytes from the slab. */
+static law_chunk_t *law_slab_take(law_slab_t *slab, const size_t length)
+{
+        law_chunk_t *chunk = NULL;
+
+        if(length <= slab->chunk_length && slab->cache) {
+                chunk = slab->cache;
+                slab->cache = chunk->next;
+                --slab->num_cached;
+        } else {
+                const size_t chunk_length = length <= slab->chunk_length ?
+                        slab->chunk_length : length;
+                if(chunk_length > SIZE_MAX - sizeof(law_chunk_t))
+                        return NULL;
+                chunk = malloc(sizeof(law_chunk_t) + chunk_length);
+                if(!chunk) return NULL;
+                chunk->length = chunk_length;
+                ++slab->num_chunks;
+        }
+
+        chunk->next = NULL;
+
+        return chunk;
+}
+
+/** Return a chunk to the slab, freeing it if it can not be cached. */
+static void law_slab_give(law_slab_t *slab, law_chunk_t *chunk)
+{
+        if(     chunk->length == slab->chunk_length &&
+                slab->num_cached < slab->max_cached)
+        {
+                chunk->next = slab->cache;
+                slab->cache = chunk;
+                ++slab->num_cached;
+        } else {
+                --slab->num_chunks;
+                free(chunk);
+        }
+}
+
+void law_arena_init(law_arena_t *arena, law_slab_t *slab)
+{
+        SEL_ASSERT(arena);
+        memset(arena, 0, sizeof(law_arena_t));
+        arena->slab = slab;
+}
+
+void *law_arena_alloc(law_arena_t *arena, const size_t nbytes)
+{
+        SEL_ASSERT(arena && arena->slab);
+
+        if(nbytes > SIZE_MAX - LAW_ARENA_ALIGN) return NULL;
+
+        const size_t length = nbytes ?
+                (nbytes + LAW_ARENA_ALIGN - 1) & ~(LAW_ARENA_ALIGN - 1) :
+                LAW_ARENA_ALIGN;
+
+        void *result = NULL;
+
+        if(length > arena->slab->chunk_length) {
+                /* Oversized allocations get a chunk of their own, leaving 
+                 * the current chunk for the small ones that follow. */
+                law_chunk_t *chunk = law_slab_take(arena->slab, length);
+                if(!chunk) return NULL;
+                chunk->next = arena->chunks;
+                arena->chunks = chunk;
+                arena->reserved += chunk->length;
+                result = chunk->data;
+        } else {
+                if((size_t)(arena->limit - arena->cursor) < length) {
+                        law_chunk_t *chunk = law_slab_take(arena->slab, length);
+                        if(!chunk) return NULL;
+                        chunk->next = arena->chunks;
+                        arena->chunks = chunk;
+                        arena->cursor = (char*)chunk->data;
+                        arena->limit = arena->cursor + chunk->length;
+                        arena->reserved += chunk->length;
+                }
+                result = arena->cursor;
+                arena->cursor += length;
+        }
+
+        arena->used += length;
+
+        if(arena->used > arena->high_water) {
+                arena->high_water = arena->used;
+                if(arena->used > arena->slab->high_water)
+                        arena->slab->high_water = arena->used;
+        }
+
+        return result;
+}
+
+void *law_arena_calloc(law_arena_t *arena, const size_t nbytes)
+{
+        void *result = law_arena_alloc(arena, nbytes);
+        if(result) memset(result, 0, nbytes);
+        return result;
+}
+
+void law_arena_reset(law_arena_t *arena)
+{
+        SEL_ASSERT(arena);
+
+        while(arena->chunks) {
+                law_chunk_t *chunk = arena->chunks;
+                arena->chunks = chunk->next;
+                law_slab_give(arena->slab, chunk);
+        }
+
+        arena->cursor = NULL;
+        arena->limit = NULL;
+        arena->used = 0;
+        arena->reserved = 0;
+}
+
+void law_arena_stats(law_arena_t *arena, law_arena_stats_t *stats)
+{
+        SEL_ASSERT(arena && stats);
+
+        stats->used = arena->used;
+        stats->reserved = arena->reserved;
+        stats->high_water = arena->high_water;
+
+        law_slab_t *slab = arena->slab;
+
+        stats->slab_high_water = slab ? slab->high_water : 0;
+        stats->slab_chunks = slab ? slab->num_chunks : 0;
+        stats->slab_cached = slab ? slab->num_cached : 0;
+}
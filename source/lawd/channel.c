@@ -0,0 +1,361 @@
+
+#include "lawd/channel.h"
+#include "lawd/private/server.h"
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LAW_CHAN_LINE 64
+
+/** Blocked Task (lives on the blocked task's stack) */
+typedef struct law_chan_waiter {
+        law_worker_t *worker;                   /** Task's Worker */
+        law_id_t id;                            /** Task Identifier */
+        struct law_chan_waiter *next;           /** Next Waiter */
+} law_chan_waiter_t;
+
+/** Waiting Tasks */
+typedef struct law_chan_waiters {
+        atomic_size_t count;                    /** Fast Path Check */
+        law_chan_waiter_t *list;                /** Guarded by the Lock */
+} law_chan_waiters_t;
+
+struct law_chan {
+        alignas(LAW_CHAN_LINE) atomic_size_t head;      /** Next Receive */
+        alignas(LAW_CHAN_LINE) atomic_size_t tail;      /** Next Send */
+        alignas(LAW_CHAN_LINE) atomic_bool closed;      /** Closed Flag */
+        size_t mask;                                    /** Capacity - 1 */
+        size_t elem_size;                               /** Element Length */
+        atomic_size_t *seqs;                            /** Cell Sequences */
+        unsigned char *elems;                           /** Cell Elements */
+        pthread_mutex_t lock;                           /** Waiters Lock */
+        law_chan_waiters_t senders;                     /** Blocked Senders */
+        law_chan_waiters_t receivers;                   /** Blocked Receivers */
+};
+
+law_chan_t *law_chan_create(const size_t elem_size, const size_t capacity)
+{
+        SEL_ASSERT(elem_size && capacity);
+
+        size_t cap = 1;
+        while(cap < capacity) cap <<= 1;
+
+        law_chan_t *chan = aligned_alloc(
+                LAW_CHAN_LINE,
+                (sizeof(law_chan_t) + LAW_CHAN_LINE - 1) &
+                        ~(size_t)(LAW_CHAN_LINE - 1));
+        if(!chan) return NULL;
+
+        memset(chan, 0, sizeof(law_chan_t));
+
+        if(!(chan->seqs = calloc(cap, sizeof(atomic_size_t))))
+                goto FREE_CHAN;
+
+        if(!(chan->elems = calloc(cap, elem_size)))
+                goto FREE_SEQS;
+
+        for(size_t n = 0; n < cap; ++n) {
+                atomic_init(chan->seqs + n, n);
+        }
+
+        atomic_init(&chan->head, 0);
+        atomic_init(&chan->tail, 0);
+        atomic_init(&chan->closed, false);
+        atomic_init(&chan->senders.count, 0);
+        atomic_init(&chan->receivers.count, 0);
+        chan->senders.list = NULL;
+        chan->receivers.list = NULL;
+        chan->mask = cap - 1;
+        chan->elem_size = elem_size;
+        pthread_mutex_init(&chan->lock, NULL);
+
+        return chan;
+
+        FREE_SEQS:
+        free(chan->seqs);
+
+        FREE_CHAN:
+        free(chan);
+
+        return NULL;
+}
+
+void law_chan_destroy(law_chan_t *chan)
+{
+        if(!chan) return;
+        SEL_ASSERT(!chan->senders.list && !chan->receivers.list);
+        pthread_mutex_destroy(&chan->lock);
+        free(chan->elems);
+        free(chan->seqs);
+        free(chan);
+}
+
+size_t law_chan_capacity(law_chan_t *chan)
+{
+        return chan->mask + 1;
+}
+
+/** 
+ * Register the waiter.  The fence orders the count before the caller's 
+ * check of the cells, pairing with the one in law_chan_wake.
+ */
+static void law_chan_wait(
+        law_chan_t *chan,
+        law_chan_waiters_t *waiters,
+        law_chan_waiter_t *waiter)
+{
+        pthread_mutex_lock(&chan->lock);
+        waiter->next = waiters->list;
+        waiters->list = waiter;
+        atomic_fetch_add(&waiters->count, 1);
+        pthread_mutex_unlock(&chan->lock);
+        atomic_thread_fence(memory_order_seq_cst);
+}
+
+/** Remove the waiter if a waker has not done so already. */
+static void law_chan_unwait(
+        law_chan_t *chan,
+        law_chan_waiters_t *waiters,
+        law_chan_waiter_t *waiter)
+{
+        pthread_mutex_lock(&chan->lock);
+        for(law_chan_waiter_t **w = &waiters->list; *w; w = &(*w)->next) {
+                if(*w == waiter) {
+                        *w = waiter->next;
+                        atomic_fetch_sub(&waiters->count, 1);
+                        break;
+                }
+        }
+        pthread_mutex_unlock(&chan->lock);
+}
+
+/** 
+ * Wake one waiter, or all of them.  Publishing a cell and then reading the
+ * count races a waiter counting itself and then reading the cell; without
+ * the fence on both sides each may miss the other's write.
+ */
+static void law_chan_wake(
+        law_worker_t *self,
+        law_chan_t *chan,
+        law_chan_waiters_t *waiters,
+        const bool all)
+{
+        atomic_thread_fence(memory_order_seq_cst);
+        if(!atomic_load(&waiters->count)) return;
+
+        do {
+                pthread_mutex_lock(&chan->lock);
+                law_chan_waiter_t *waiter = waiters->list;
+                if(!waiter) {
+                        pthread_mutex_unlock(&chan->lock);
+                        return;
+                }
+                waiters->list = waiter->next;
+                atomic_fetch_sub(&waiters->count, 1);
+                law_worker_t *target = waiter->worker;
+                const law_id_t id = waiter->id;
+                pthread_mutex_unlock(&chan->lock);
+
+                (void)law_worker_wake(self, target, id);
+        } while(all);
+}
+
+void law_chan_close(law_worker_t *worker, law_chan_t *chan)
+{
+        atomic_store(&chan->closed, true);
+        law_chan_wake(worker, chan, &chan->receivers, true);
+        law_chan_wake(worker, chan, &chan->senders, true);
+}
+
+/** Vyukov's bounded MPMC enqueue. */
+static bool law_chan_push(law_chan_t *chan, const void *elem)
+{
+        size_t pos = atomic_load_explicit(&chan->tail, memory_order_relaxed);
+
+        for(;;) {
+                atomic_size_t *seq = chan->seqs + (pos & chan->mask);
+                const size_t s = atomic_load_explicit(
+                        seq,
+                        memory_order_acquire);
+                const intptr_t dif = (intptr_t)s - (intptr_t)pos;
+                if(dif == 0) {
+                        if(atomic_compare_exchange_weak_explicit(
+                                &chan->tail,
+                                &pos,
+                                pos + 1,
+                                memory_order_relaxed,
+                                memory_order_relaxed))
+                        {
+                                memcpy(
+                                        chan->elems +
+                                        (pos & chan->mask) * chan->elem_size,
+                                        elem,
+                                        chan->elem_size);
+                                atomic_store_explicit(
+                                        seq,
+                                        pos + 1,
+                                        memory_order_release);
+                                return true;
+                        }
+                } else if(dif < 0) {
+                        return false;
+                } else {
+                        pos = atomic_load_explicit(
+                                &chan->tail,
+                                memory_order_relaxed);
+                }
+        }
+}
+
+/** Vyukov's bounded MPMC dequeue. */
+static bool law_chan_pop(law_chan_t *chan, void *elem)
+{
+        size_t pos = atomic_load_explicit(&chan->head, memory_order_relaxed);
+
+        for(;;) {
+                atomic_size_t *seq = chan->seqs + (pos & chan->mask);
+                const size_t s = atomic_load_explicit(
+                        seq,
+                        memory_order_acquire);
+                const intptr_t dif = (intptr_t)s - (intptr_t)(pos + 1);
+                if(dif == 0) {
+                        if(atomic_compare_exchange_weak_explicit(
+                                &chan->head,
+                                &pos,
+                                pos + 1,
+                                memory_order_relaxed,
+                                memory_order_relaxed))
+                        {
+                                memcpy(
+                                        elem,
+                                        chan->elems +
+                                        (pos & chan->mask) * chan->elem_size,
+                                        chan->elem_size);
+                                atomic_store_explicit(
+                                        seq,
+                                        pos + chan->mask + 1,
+                                        memory_order_release);
+                                return true;
+                        }
+                } else if(dif < 0) {
+                        return false;
+                } else {
+                        pos = atomic_load_explicit(
+                                &chan->head,
+                                memory_order_relaxed);
+                }
+        }
+}
+
+sel_err_t law_chan_try_send(
+        law_worker_t *worker,
+        law_chan_t *chan,
+        const void *elem)
+{
+        if(atomic_load(&chan->closed))
+                return LAW_ERR_EOF;
+
+        if(!law_chan_push(chan, elem))
+                return LAW_ERR_WANTW;
+
+        law_chan_wake(worker, chan, &chan->receivers, false);
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_chan_try_recv(law_worker_t *worker, law_chan_t *chan, void *elem)
+{
+        if(!law_chan_pop(chan, elem))
+                return atomic_load(&chan->closed) ? LAW_ERR_EOF : LAW_ERR_WANTR;
+
+        law_chan_wake(worker, chan, &chan->senders, false);
+
+        return LAW_ERR_OK;
+}
+
+/** Block on the waiters until try_op stops returning want. */
+static sel_err_t law_chan_block(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_chan_t *chan,
+        law_chan_waiters_t *waiters,
+        sel_err_t (*try_op)(law_worker_t*, law_chan_t*, void*),
+        void *elem,
+        const sel_err_t want)
+{
+        const law_time_t expiry = law_time_millis() + timeout;
+
+        law_chan_waiter_t waiter = {
+                .worker = worker,
+                .id = law_get_active_id(worker),
+                .next = NULL
+        };
+
+        for(;;) {
+                sel_err_t err = try_op(worker, chan, elem);
+                if(err != want) return err;
+
+                law_chan_wait(chan, waiters, &waiter);
+
+                /* Catch anything that slipped in before registering. */
+                err = try_op(worker, chan, elem);
+                if(err != want) {
+                        law_chan_unwait(chan, waiters, &waiter);
+                        return err;
+                }
+
+                const law_time_t now = law_time_millis();
+                if(expiry <= now) {
+                        law_chan_unwait(chan, waiters, &waiter);
+                        return LAW_ERR_TIME;
+                }
+
+                (void)law_ewait(worker, expiry - now, NULL, 0);
+
+                law_chan_unwait(chan, waiters, &waiter);
+        }
+}
+
+static sel_err_t law_chan_try_send_cb(
+        law_worker_t *worker,
+        law_chan_t *chan,
+        void *elem)
+{
+        return law_chan_try_send(worker, chan, elem);
+}
+
+sel_err_t law_chan_send(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_chan_t *chan,
+        const void *elem)
+{
+        return law_chan_block(
+                worker,
+                timeout,
+                chan,
+                &chan->senders,
+                law_chan_try_send_cb,
+                (void*)elem,
+                LAW_ERR_WANTW);
+}
+
+sel_err_t law_chan_recv(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_chan_t *chan,
+        void *elem)
+{
+        return law_chan_block(
+                worker,
+                timeout,
+                chan,
+                &chan->receivers,
+                law_chan_try_recv,
+                elem,
+                LAW_ERR_WANTR);
+}
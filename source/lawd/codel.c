@@ -0,0 +1,130 @@
+/* See man clock_gettime */
+#define _POSIX_C_SOURCE 200112L
+
+#include "lawd/private/codel.h"
+#include <time.h>
+
+void law_codel_init(law_codel_t *codel, law_time_t target, law_time_t interval)
+{
+        SEL_ASSERT(codel && 0 <= target && (!target || 0 < interval));
+
+        codel->target = target * 1000000;
+        codel->interval = interval * 1000000;
+        codel->first_above = 0;
+        codel->drop_next = 0;
+        codel->last_count = 0;
+        atomic_init(&codel->dropping, false);
+        atomic_init(&codel->count, 0);
+        atomic_init(&codel->delay, 0);
+        atomic_init(&codel->admitted, 0);
+        atomic_init(&codel->dropped, 0);
+}
+
+int64_t law_codel_nanos()
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;
+}
+
+/** Integer square root, rounded down. */
+static uint32_t law_codel_isqrt(uint32_t x)
+{
+        uint32_t root = 0, bit = 1u << 30;
+        while(bit > x) bit >>= 2;
+        while(bit) {
+                if(x >= root + bit) {
+                        x -= root + bit;
+                        root = (root >> 1) + bit;
+                } else {
+                        root >>= 1;
+                }
+                bit >>= 2;
+        }
+        return root;
+}
+
+/** Time of the next drop, interval / sqrt(count) after t. */
+static int64_t law_codel_control(law_codel_t *codel, int64_t t, uint32_t count)
+{
+        return t + codel->interval / law_codel_isqrt(count ? count : 1);
+}
+
+/** Track how long the delay has been above target. */
+static bool law_codel_above(law_codel_t *codel, int64_t delay, int64_t now)
+{
+        if(delay < codel->target) {
+                codel->first_above = 0;
+                return false;
+        } 
+        
+        if(!codel->first_above) {
+                codel->first_above = now + codel->interval;
+                return false;
+        }
+
+        return codel->first_above <= now;
+}
+
+static bool law_codel_drop(law_codel_t *codel)
+{
+        atomic_fetch_add_explicit(&codel->dropped, 1, memory_order_relaxed);
+        return false;
+}
+
+bool law_codel_admit(law_codel_t *codel, int64_t enqueued, int64_t now)
+{
+        if(!codel->target) return true;
+
+        const int64_t delay = now - enqueued;
+        const bool above = law_codel_above(codel, delay, now);
+        uint32_t count = atomic_load_explicit(
+                &codel->count, 
+                memory_order_relaxed);
+
+        atomic_store_explicit(&codel->delay, delay, memory_order_relaxed);
+
+        if(atomic_load_explicit(&codel->dropping, memory_order_relaxed)) {
+                if(!above) {
+                        atomic_store_explicit(
+                                &codel->dropping, 
+                                false, 
+                                memory_order_relaxed);
+                } else if(codel->drop_next <= now) {
+                        ++count;
+                        atomic_store_explicit(
+                                &codel->count, 
+                                count, 
+                                memory_order_relaxed);
+                        codel->drop_next = law_codel_control(
+                                codel, 
+                                codel->drop_next, 
+                                count);
+                        return law_codel_drop(codel);
+                }
+        } else if(above) {
+                /* Resume near the previous drop rate if the last episode 
+                 * ended recently. */
+                const uint32_t delta = count - codel->last_count;
+                const bool recent = 
+                        now - codel->drop_next < 16 * codel->interval;
+                count = recent && delta > 1 ? delta : 1;
+                codel->last_count = count;
+                atomic_store_explicit(&codel->count, count, memory_order_relaxed);
+                atomic_store_explicit(&codel->dropping, true, memory_order_relaxed);
+                codel->drop_next = law_codel_control(codel, now, count);
+                return law_codel_drop(codel);
+        }
+
+        atomic_fetch_add_explicit(&codel->admitted, 1, memory_order_relaxed);
+        return true;
+}
+
+void law_codel_read(law_codel_t *codel, law_codel_stats_t *stats)
+{
+        stats->dropping = atomic_load(&codel->dropping);
+        stats->count = (uint32_t)atomic_load(&codel->count);
+        stats->delay = (int64_t)atomic_load(&codel->delay);
+        stats->admitted = (uint64_t)atomic_load(&codel->admitted);
+        stats->dropped = (uint64_t)atomic_load(&codel->dropped);
+}
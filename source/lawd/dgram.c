@@ -0,0 +1,219 @@
+/* See man recvmmsg */
+#define _GNU_SOURCE
+
+#include "lawd/private/dgram.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** One Direction of Datagram Buffers */
+typedef struct law_dgram_ring {
+        struct mmsghdr *msgs;                   /** Message Headers */
+        struct iovec *iovs;                     /** Payload Vectors */
+        struct sockaddr_storage *addrs;         /** Peer Addresses */
+        unsigned char *bytes;                   /** Payload Storage */
+} law_dgram_ring_t;
+
+struct law_dgrams {
+        int fd;                                 /** Datagram Socket */
+        size_t batch;                           /** Messages per Batch */
+        size_t size;                            /** Bytes per Message */
+        size_t received;                        /** Messages in rx */
+        size_t queued;                          /** Messages in tx */
+        size_t sent;                            /** Messages Sent from tx */
+        law_dgram_ring_t rx;                    /** Receive Buffers */
+        law_dgram_ring_t tx;                    /** Send Buffers */
+};
+
+static sel_err_t law_dgram_ring_init(
+        law_dgram_ring_t *ring,
+        const size_t batch,
+        const size_t size)
+{
+        if(!(ring->msgs = calloc(batch, sizeof(struct mmsghdr))))
+                return LAW_ERR_OOM;
+        if(!(ring->iovs = calloc(batch, sizeof(struct iovec))))
+                return LAW_ERR_OOM;
+        if(!(ring->addrs = calloc(batch, sizeof(struct sockaddr_storage))))
+                return LAW_ERR_OOM;
+        if(!(ring->bytes = calloc(batch, size)))
+                return LAW_ERR_OOM;
+
+        for(size_t n = 0; n < batch; ++n) {
+                ring->iovs[n].iov_base = ring->bytes + n * size;
+                ring->iovs[n].iov_len = size;
+                ring->msgs[n].msg_hdr.msg_iov = ring->iovs + n;
+                ring->msgs[n].msg_hdr.msg_iovlen = 1;
+                ring->msgs[n].msg_hdr.msg_name = ring->addrs + n;
+                ring->msgs[n].msg_hdr.msg_namelen =
+                        sizeof(struct sockaddr_storage);
+        }
+
+        return LAW_ERR_OK;
+}
+
+static void law_dgram_ring_free(law_dgram_ring_t *ring)
+{
+        free(ring->bytes);
+        free(ring->addrs);
+        free(ring->iovs);
+        free(ring->msgs);
+}
+
+law_dgrams_t *law_dgrams_create(int fd, const size_t batch, const size_t size)
+{
+        SEL_ASSERT(0 <= fd && batch && size);
+
+        law_dgrams_t *dgrams = calloc(1, sizeof(law_dgrams_t));
+        if(!dgrams) return NULL;
+
+        dgrams->fd = fd;
+        dgrams->batch = batch;
+        dgrams->size = size;
+
+        if(law_dgram_ring_init(&dgrams->rx, batch, size) != LAW_ERR_OK ||
+           law_dgram_ring_init(&dgrams->tx, batch, size) != LAW_ERR_OK)
+        {
+                law_dgram_ring_free(&dgrams->tx);
+                law_dgram_ring_free(&dgrams->rx);
+                free(dgrams);
+                return NULL;
+        }
+
+        return dgrams;
+}
+
+void law_dgrams_destroy(law_dgrams_t *dgrams)
+{
+        if(!dgrams) return;
+        close(dgrams->fd);
+        law_dgram_ring_free(&dgrams->tx);
+        law_dgram_ring_free(&dgrams->rx);
+        free(dgrams);
+}
+
+int law_dgrams_fd(law_dgrams_t *dgrams)
+{
+        return dgrams->fd;
+}
+
+sel_err_t law_dgrams_recv(law_dgrams_t *dgrams)
+{
+        law_dgram_ring_t *rx = &dgrams->rx;
+
+        for(size_t n = 0; n < dgrams->received; ++n) {
+                rx->msgs[n].msg_hdr.msg_namelen =
+                        sizeof(struct sockaddr_storage);
+                rx->msgs[n].msg_hdr.msg_flags = 0;
+        }
+
+        dgrams->received = 0;
+
+        const int count = recvmmsg(
+                dgrams->fd,
+                rx->msgs,
+                (unsigned int)dgrams->batch,
+                MSG_DONTWAIT,
+                NULL);
+
+        if(count == -1) {
+                if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                        return LAW_ERR_WANTR;
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "recvmmsg");
+        }
+
+        dgrams->received = (size_t)count;
+
+        return count ? LAW_ERR_OK : LAW_ERR_WANTR;
+}
+
+size_t law_dgrams_count(law_dgrams_t *dgrams)
+{
+        return dgrams->received;
+}
+
+void law_dgrams_get(law_dgrams_t *dgrams, size_t index, law_dgram_t *dgram)
+{
+        SEL_ASSERT(index < dgrams->received);
+
+        struct mmsghdr *msg = dgrams->rx.msgs + index;
+
+        dgram->data = dgrams->rx.iovs[index].iov_base;
+        dgram->size = msg->msg_len;
+        dgram->truncated = msg->msg_hdr.msg_flags & MSG_TRUNC;
+        dgram->addr = (struct sockaddr*)(dgrams->rx.addrs + index);
+        dgram->addrlen = msg->msg_hdr.msg_namelen;
+}
+
+sel_err_t law_dgrams_sendto(
+        law_dgrams_t *dgrams,
+        const struct sockaddr *addr,
+        socklen_t addrlen,
+        const void *data,
+        size_t size)
+{
+        SEL_ASSERT(addr && addrlen <= sizeof(struct sockaddr_storage));
+
+        if(dgrams->queued == dgrams->batch || dgrams->size < size)
+                return LAW_ERR_LIMIT;
+
+        const size_t n = dgrams->queued++;
+        law_dgram_ring_t *tx = &dgrams->tx;
+
+        memcpy(tx->iovs[n].iov_base, data, size);
+        tx->iovs[n].iov_len = size;
+        memcpy(tx->addrs + n, addr, addrlen);
+        tx->msgs[n].msg_hdr.msg_namelen = addrlen;
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_dgrams_reply(
+        law_dgrams_t *dgrams,
+        size_t index,
+        const void *data,
+        size_t size)
+{
+        SEL_ASSERT(index < dgrams->received);
+
+        return law_dgrams_sendto(
+                dgrams,
+                (struct sockaddr*)(dgrams->rx.addrs + index),
+                dgrams->rx.msgs[index].msg_hdr.msg_namelen,
+                data,
+                size);
+}
+
+sel_err_t law_dgrams_flush(law_dgrams_t *dgrams)
+{
+        law_dgram_ring_t *tx = &dgrams->tx;
+
+        while(dgrams->sent < dgrams->queued) {
+
+                const int count = sendmmsg(
+                        dgrams->fd,
+                        tx->msgs + dgrams->sent,
+                        (unsigned int)(dgrams->queued - dgrams->sent),
+                        MSG_DONTWAIT);
+
+                if(count == -1) {
+                        if(errno == EINTR) continue;
+                        if(errno == EAGAIN || errno == EWOULDBLOCK)
+                                return LAW_ERR_WANTW;
+                        return LAW_ERR_PUSH(LAW_ERR_SYS, "sendmmsg");
+                }
+
+                dgrams->sent += (size_t)count;
+        }
+
+        law_dgrams_discard(dgrams);
+
+        return LAW_ERR_OK;
+}
+
+void law_dgrams_discard(law_dgrams_t *dgrams)
+{
+        dgrams->queued = 0;
+        dgrams->sent = 0;
+}
@@ -7,7 +7,9 @@
 #include "lawd/server.h"
 #include "pgenc/lang.h"
 #include <errno.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include <openssl/err.h>
 
 typedef struct law_htc_args2 {
@@ -90,10 +92,198 @@ sel_err_t law_htc_ensure_input_sync(
                 &args);
 }
 
+static law_htc_seg_t *law_htc_seg(law_htconn_t *conn, const size_t index)
+{
+        return &conn->queue[(conn->head + index) % LAW_HTC_SEGMENTS];
+}
+
+sel_err_t law_htc_queue(
+        law_htconn_t *conn,
+        const void *base,
+        const size_t length,
+        law_htc_release_t release,
+        void *state)
+{
+        if(conn->count == LAW_HTC_SEGMENTS) 
+                return LAW_ERR_OOB;
+
+        if(!length) {
+                if(release) release(base, 0, state);
+                return LAW_ERR_OK;
+        }
+
+        law_htc_seg_t *seg = law_htc_seg(conn, conn->count);
+        seg->base = base;
+        seg->length = length;
+        seg->mark = pgc_buf_end(conn->out);
+        seg->release = release;
+        seg->state = state;
+        conn->count += 1;
+
+        return LAW_ERR_OK;
+}
+
+size_t law_htc_pending(law_htconn_t *conn)
+{
+        size_t pending = pgc_buf_end(conn->out) - pgc_buf_tell(conn->out);
+        for(size_t i = 0; i < conn->count; ++i) 
+                pending += law_htc_seg(conn, i)->length;
+        return pending - conn->sent;
+}
+
+static void law_htc_pop(law_htconn_t *conn)
+{
+        law_htc_seg_t *seg = law_htc_seg(conn, 0);
+        conn->head = (conn->head + 1) % LAW_HTC_SEGMENTS;
+        conn->count -= 1;
+        conn->sent = 0;
+        if(seg->release) 
+                seg->release(seg->base, seg->length, seg->state);
+}
+
+void law_htc_drop(law_htconn_t *conn)
+{
+        while(conn->count) 
+                law_htc_pop(conn);
+        conn->head = 0;
+}
+
+typedef struct law_htc_iov_args {
+        struct iovec *iov;
+        size_t count;
+} law_htc_iov_args_t;
+
+static intptr_t law_htc_iov_cb(void *bytes, const size_t n, void *state)
+{
+        law_htc_iov_args_t *args = state;
+        args->iov[args->count].iov_base = bytes;
+        args->iov[args->count].iov_len = n;
+        args->count += 1;
+        return (intptr_t)n;
+}
+
+/** Each segment and each run of the ring around it takes an iovec. */
+#define LAW_HTC_IOVS (3 * LAW_HTC_SEGMENTS + 2)
+
+/** Gather the output in send order: buffered bytes up to each segment's 
+ * mark, the segment, and so on, ending with the bytes after the last. */
+static size_t law_htc_gather(law_htconn_t *conn, struct iovec *iov)
+{
+        struct pgc_buf *out = conn->out;
+        law_htc_iov_args_t args = { .iov = iov, .count = 0 };
+
+        const size_t tell = pgc_buf_tell(out);
+        size_t from = tell;
+
+        for(size_t i = 0; i <= conn->count; ++i) {
+                law_htc_seg_t *seg = i < conn->count ? 
+                        law_htc_seg(conn, i) : NULL;
+                const size_t to = seg ? seg->mark : pgc_buf_end(out);
+
+                if(to > from) {
+                        SEL_TEST(pgc_buf_seek(out, from) == LAW_ERR_OK);
+                        (void)pgc_buf_cbwrite(
+                                out, 
+                                to - from, 
+                                law_htc_iov_cb, 
+                                &args);
+                        from = to;
+                }
+
+                if(seg) {
+                        const size_t sent = i ? 0 : conn->sent;
+                        iov[args.count].iov_base = 
+                                (uint8_t*)seg->base + sent;
+                        iov[args.count].iov_len = seg->length - sent;
+                        args.count += 1;
+                }
+        }
+
+        SEL_TEST(pgc_buf_seek(out, tell) == LAW_ERR_OK);
+        return args.count;
+}
+
+/** Account for n bytes sent, releasing the segments they complete. */
+static void law_htc_advance(law_htconn_t *conn, size_t n)
+{
+        struct pgc_buf *out = conn->out;
+
+        while(n) {
+                const size_t 
+                        tell = pgc_buf_tell(out),
+                        mark = conn->count ? 
+                                law_htc_seg(conn, 0)->mark : 
+                                pgc_buf_end(out);
+
+                if(tell < mark) {
+                        const size_t step = n < mark - tell ? n : mark - tell;
+                        SEL_TEST(pgc_buf_seek(out, tell + step) == LAW_ERR_OK);
+                        n -= step;
+                        continue;
+                }
+
+                SEL_ASSERT(conn->count);
+
+                const size_t 
+                        left = law_htc_seg(conn, 0)->length - conn->sent,
+                        step = n < left ? n : left;
+                conn->sent += step;
+                n -= step;
+
+                if(step == left) 
+                        law_htc_pop(conn);
+        }
+}
+
+static intptr_t law_htc_write_queue(law_htconn_t *conn)
+{
+        struct iovec iov[LAW_HTC_IOVS];
+        const size_t count = law_htc_gather(conn, iov);
+
+        intptr_t total = 0;
+
+        switch(conn->security) {
+                case LAW_HTC_UNSECURED: {
+                        const ssize_t result = 
+                                writev(conn->socket, iov, (int)count);
+                        if(result < 0) {
+                                if(errno == EWOULDBLOCK || errno == EAGAIN)
+                                        return LAW_ERR_WANTW;
+                                return LAW_ERR_SYS;
+                        }
+                        total = result;
+                        break;
+                }
+                case LAW_HTC_SSL: 
+                        /* SSL has no gather write, so one record per run. */
+                        for(size_t i = 0; i < count; ++i) {
+                                const intptr_t result = law_buf_SSL_write_cb(
+                                        iov[i].iov_base, 
+                                        iov[i].iov_len, 
+                                        conn->ssl);
+                                if(result <= 0) {
+                                        if(!total) return result;
+                                        break;
+                                }
+                                total += result;
+                                if((size_t)result < iov[i].iov_len) break;
+                        }
+                        break;
+                default: 
+                        return SEL_HALT();
+        }
+
+        law_htc_advance(conn, (size_t)total);
+        return total;
+}
+
 intptr_t law_htc_write_data(law_htconn_t *conn)
 {
         struct pgc_buf *out = conn->out;
 
+        if(conn->count) 
+                return law_htc_write_queue(conn);
+
         const size_t block = pgc_buf_end(out) - pgc_buf_tell(out);
 
         if(!block) {
@@ -172,12 +362,7 @@ sel_err_t law_htc_ensure_output_sync(
 
 sel_err_t law_htc_flush(law_htconn_t *conn)
 {
-        struct pgc_buf *out = conn->out;
-
-        size_t offset = pgc_buf_tell(out);
-        const size_t end = pgc_buf_end(out);
-
-        if((end - offset) == 0) {
+        if(!law_htc_pending(conn)) {
                 return LAW_ERR_OK;
         }
 
@@ -186,9 +371,7 @@ sel_err_t law_htc_flush(law_htconn_t *conn)
                 return (sel_err_t)result;
         }
 
-        offset = pgc_buf_tell(out);
-
-        return (end - offset) == 0 ? 
+        return !law_htc_pending(conn) ? 
                 LAW_ERR_OK : 
                 LAW_ERR_WANTW;
 }
@@ -261,6 +444,123 @@ sel_err_t law_htc_read_scan(
         return (sel_err_t)result;
 }
 
+typedef struct law_htc_find_args {
+        int byte;
+        size_t position;
+        size_t found;
+        size_t *work;
+} law_htc_find_args_t;
+
+static intptr_t law_htc_find_cb(void *bytes, const size_t n, void *state)
+{
+        law_htc_find_args_t *args = state;
+
+        const uint8_t *hit = memchr(bytes, args->byte, n);
+        if(hit) {
+                const size_t index = (size_t)(hit - (uint8_t*)bytes);
+                *args->work += index + 1;
+                args->found = args->position + index;
+                return 0;
+        }
+
+        *args->work += n;
+        args->position += n;
+        return (intptr_t)n;
+}
+
+/** Find the byte in [from, end) one contiguous run of the ring at a time. */
+static size_t law_htc_find(
+        struct pgc_buf *in,
+        const size_t from,
+        const size_t end,
+        const uint8_t byte,
+        size_t *work)
+{
+        law_htc_find_args_t args = {
+                .byte = byte,
+                .position = from,
+                .found = end,
+                .work = work };
+
+        SEL_TEST(pgc_buf_seek(in, from) == LAW_ERR_OK);
+        (void)pgc_buf_cbwrite(in, end - from, law_htc_find_cb, &args);
+
+        return args.found;
+}
+
+sel_err_t law_htc_read_scan_ex(
+        law_htconn_t *conn, 
+        law_htc_scan_t *scan,
+        void *delim, 
+        const size_t len)
+{
+        SEL_ASSERT(conn && scan && delim && len);
+
+        struct pgc_buf *in = conn->in;
+        const uint8_t *bytes = delim;
+
+        const size_t 
+                max = pgc_buf_max(in),
+                base = scan->base;
+
+        if(max < len) 
+                return LAW_ERR_PUSH(LAW_ERR_OOB, "delim_too_long");
+
+        if(pgc_buf_seek(in, base) != LAW_ERR_OK) 
+                return LAW_ERR_PUSH(LAW_ERR_OOB, "pgc_buf_seek");
+
+        const intptr_t result = law_htc_read_data(conn);
+
+        if(!(result > 0)) {
+                switch(result) {
+                        case LAW_ERR_WANTW:
+                        case LAW_ERR_WANTR: 
+                        case LAW_ERR_EOF:
+                        case LAW_ERR_OOB: 
+                                break;
+                        default:
+                                return LAW_ERR_PUSH(
+                                        (sel_err_t)result,
+                                         "law_htc_read_data");
+                }
+        }
+
+        const size_t end = pgc_buf_end(in);
+
+        /* Search for the delimiter's last byte, then look behind it. */
+        size_t from = scan->mark;
+        if(from < base + len - 1) 
+                from = base + len - 1;
+
+        while(from < end) {
+                const size_t found = law_htc_find(
+                        in, from, end, bytes[len - 1], &scan->work);
+                if(found == end) break;
+
+                SEL_TEST(pgc_buf_seek(in, found + 1 - len) == LAW_ERR_OK);
+                if(pgc_buf_cmp(in, delim, len) == LAW_ERR_OK) {
+                        SEL_TEST(pgc_buf_seek(in, found + 1) == LAW_ERR_OK);
+                        scan->mark = found + 1;
+                        return LAW_ERR_OK;
+                }
+
+                from = found + 1;
+        }
+
+        if(end > scan->mark) 
+                scan->mark = end;
+
+        SEL_TEST(pgc_buf_seek(in, base) == LAW_ERR_OK);
+
+        if(end - base >= max) 
+                return LAW_ERR_OOB;
+
+        if(result > 0) 
+                return LAW_ERR_WANTR;
+
+        return (sel_err_t)result;
+}
+
 sel_err_t law_htc_ssl_accept(law_htconn_t *conn, SSL_CTX *ssl_ctx)
 {
         law_err_clear();
@@ -310,6 +610,58 @@ sel_err_t law_htc_ssl_accept(law_htconn_t *conn, SSL_CTX *ssl_ctx)
         }
 }
 
+sel_err_t law_htc_ssl_connect(law_htconn_t *conn, SSL_CTX *ssl_ctx)
+{
+        law_err_clear();
+        ERR_clear_error();
+
+        SSL *ssl = SSL_new(ssl_ctx);
+        if(!ssl) 
+                return LAW_ERR_PUSH(LAW_ERR_SSL, "SSL_new");
+
+        ERR_clear_error();
+        int ssl_err = SSL_set_fd(ssl, conn->socket);
+        if(ssl_err == 0) {
+                SSL_free(ssl);
+                return LAW_ERR_PUSH(LAW_ERR_SSL, "SSL_set_fd");
+        }
+
+        conn->security = LAW_HTC_SSL;
+        conn->ssl = ssl;
+
+        ERR_clear_error();
+        ssl_err = SSL_connect(ssl);
+
+        if(ssl_err == 0) {
+                /* SSL was shut down gracefully. */
+                SSL_free(ssl);
+                conn->ssl = NULL;
+                return LAW_ERR_EOF;
+        } else if(ssl_err < 0) {
+                ssl_err = SSL_get_error(ssl, ssl_err);
+                switch(ssl_err) {
+                        case SSL_ERROR_WANT_READ: 
+                                return LAW_ERR_WANTR;
+                        case SSL_ERROR_WANT_WRITE: 
+                                return LAW_ERR_WANTW;
+                        case SSL_ERROR_SYSCALL:
+                                SSL_free(ssl);
+                                conn->ssl = NULL;
+                                return LAW_ERR_PUSH(
+                                        LAW_ERR_SYS, 
+                                        "SSL_connect");
+                        default:
+                                SSL_free(ssl);
+                                conn->ssl = NULL;
+                                return LAW_ERR_PUSH(
+                                        LAW_ERR_SSL,
+                                        "SSL_connect");
+                }
+        } else {
+                return LAW_ERR_OK;
+        }
+}
+
 sel_err_t law_htc_ssl_shutdown(law_htconn_t *conn)
 {
         law_err_clear();
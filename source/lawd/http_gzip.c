@@ -0,0 +1,721 @@
+#define _DEFAULT_SOURCE
+#define ZLIB_CONST
+
+#include "lawd/http_gzip.h"
+#include "lawd/private/http_server.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+
+/** Cache chains per worker. */
+#define LAW_HGZ_BUCKETS 256
+
+typedef struct law_hgz_worker law_hgz_worker_t;
+
+struct law_hgz_stream {
+        z_stream z;
+        int coding;                             /** Set Up For (0: Not Yet) */
+        int level;                              /** Current Level */
+        uint8_t *out;                           /** cfg.chunk Bytes */
+        size_t chunk;
+        law_hgz_worker_t *owner;
+        law_hgz_stream_t *next;                 /** Next Free */
+};
+
+typedef struct law_hgz_entry {
+        struct law_hgz_entry *chain;            /** Next in Bucket */
+        struct law_hgz_entry *prev;             /** More Recent */
+        struct law_hgz_entry *next;             /** Less Recent */
+        law_hgz_worker_t *owner;
+        uint32_t hash;                          /** Key and Coding Hash */
+        int coding;
+        bool evicted;                           /** Freed at the Last Ref */
+        size_t refs;                            /** Responses Sending It */
+        size_t source;                          /** Uncompressed Length */
+        size_t length;                          /** Compressed (0: No Gain) */
+        size_t key_len;
+        char data[];                            /** Key, NUL, Body */
+} law_hgz_entry_t;
+
+struct law_hgz_worker {
+        law_hgz_stream_t *streams;
+        law_hgz_stream_t *free;
+        uint8_t *out;                           /** Every Stream's Chunk */
+        law_hgz_entry_t *buckets[LAW_HGZ_BUCKETS];
+        law_hgz_entry_t *head;                  /** Most Recent */
+        law_hgz_entry_t *tail;                  /** Least Recent */
+        size_t used;                            /** Cached Bytes */
+        size_t max;                             /** cfg.cache */
+};
+
+struct law_hgz {
+        law_hgz_cfg_t cfg;
+        int workers;
+        law_hgz_worker_t *states;
+};
+
+law_hgz_cfg_t law_hgz_sanity()
+{
+        law_hgz_cfg_t cfg;
+        memset(&cfg, 0, sizeof(law_hgz_cfg_t));
+        cfg.level               = 5;
+        cfg.cache_level         = 9;
+        cfg.mem_level           = 8;
+        cfg.streams             = 4;
+        cfg.chunk               = 0x4000;
+        cfg.min_length          = 256;
+        cfg.cache               = 0x400000;
+        return cfg;
+}
+
+static size_t law_hgz_entry_size(law_hgz_entry_t *e)
+{
+        return sizeof(law_hgz_entry_t) + e->key_len + 1 + e->length;
+}
+
+static void law_hgz_worker_free(law_hgz_worker_t *w, const size_t streams)
+{
+        if(w->streams) {
+                for(size_t s = 0; s < streams; ++s)
+                        if(w->streams[s].coding)
+                                (void)deflateEnd(&w->streams[s].z);
+                free(w->streams);
+        }
+        free(w->out);
+
+        law_hgz_entry_t *e = w->head;
+        while(e) {
+                law_hgz_entry_t *next = e->next;
+                free(e);
+                e = next;
+        }
+}
+
+static sel_err_t law_hgz_worker_init(
+        law_hgz_worker_t *w,
+        law_hgz_cfg_t *cfg)
+{
+        w->max = cfg->cache;
+        w->streams = calloc(cfg->streams, sizeof(law_hgz_stream_t));
+        w->out = malloc(cfg->streams * cfg->chunk);
+        if(!w->streams || !w->out) return LAW_ERR_OOM;
+
+        /* Deflate states are set up on first use, for the coding asked. */
+        for(size_t s = cfg->streams; s > 0; --s) {
+                law_hgz_stream_t *stream = &w->streams[s - 1];
+                stream->out = w->out + (s - 1) * cfg->chunk;
+                stream->chunk = cfg->chunk;
+                stream->owner = w;
+                stream->next = w->free;
+                w->free = stream;
+        }
+
+        return LAW_ERR_OK;
+}
+
+law_hgz_t *law_hgz_create(law_server_cfg_t *srv_cfg, law_hgz_cfg_t *cfg)
+{
+        SEL_ASSERT(cfg->streams && cfg->chunk && cfg->chunk <= UINT_MAX);
+        SEL_ASSERT(1 <= cfg->level && cfg->level <= 9);
+        SEL_ASSERT(1 <= cfg->cache_level && cfg->cache_level <= 9);
+        SEL_ASSERT(1 <= cfg->mem_level && cfg->mem_level <= 9);
+
+        law_hgz_t *hgz = calloc(1, sizeof(law_hgz_t));
+        if(!hgz) return NULL;
+
+        hgz->cfg = *cfg;
+        hgz->workers = srv_cfg->workers > 0 ? srv_cfg->workers : 1;
+
+        hgz->states = calloc((size_t)hgz->workers, sizeof(law_hgz_worker_t));
+        if(!hgz->states) {
+                law_hgz_destroy(hgz);
+                errno = ENOMEM;
+                return NULL;
+        }
+
+        for(int w = 0; w < hgz->workers; ++w) {
+                if(law_hgz_worker_init(&hgz->states[w], cfg)) {
+                        law_hgz_destroy(hgz);
+                        errno = ENOMEM;
+                        return NULL;
+                }
+        }
+
+        return hgz;
+}
+
+void law_hgz_destroy(law_hgz_t *hgz)
+{
+        if(hgz->states) {
+                for(int w = 0; w < hgz->workers; ++w)
+                        law_hgz_worker_free(&hgz->states[w], hgz->cfg.streams);
+                free(hgz->states);
+        }
+        free(hgz);
+}
+
+static law_hgz_worker_t *law_hgz_worker(law_hgz_t *hgz, law_worker_t *worker)
+{
+        const int id = worker ? law_get_worker_id(worker) : 0;
+        return &hgz->states[id % hgz->workers];
+}
+
+/** Parse a qvalue in thousandths, or -1 when it is malformed. */
+static int law_hgz_qvalue(const char *c, const char *end)
+{
+        if(c == end || (*c != '0' && *c != '1')) return -1;
+
+        int q = (*c++ - '0') * 1000;
+        if(c == end) return q;
+        if(*c++ != '.') return -1;
+
+        for(int scale = 100; c < end && scale; scale /= 10, ++c) {
+                if(*c < '0' || '9' < *c) return -1;
+                q += (*c - '0') * scale;
+        }
+
+        return c == end && q <= 1000 ? q : -1;
+}
+
+/** Get the q parameter of one list member; 1000 when it has none. */
+static int law_hgz_member_q(const char *c, const char *end)
+{
+        while(c < end) {
+                if(*c++ != ';') continue;
+                while(c < end && (*c == ' ' || *c == '\t')) ++c;
+                if(end - c < 2 || (*c != 'q' && *c != 'Q') || c[1] != '=')
+                        continue;
+
+                const char *value = c + 2, *stop = value;
+                while(stop < end && *stop != ';' && *stop != ' ' &&
+                        *stop != '\t')
+                        ++stop;
+                const int q = law_hgz_qvalue(value, stop);
+                return q < 0 ? 0 : q;
+        }
+        return 1000;
+}
+
+int law_hgz_negotiate(const char *value)
+{
+        if(!value) return LAW_HGZ_IDENTITY;
+
+        int q_gzip = -1, q_deflate = -1, q_any = -1;
+
+        const char *c = value;
+        while(*c) {
+                while(*c == ' ' || *c == '\t' || *c == ',') ++c;
+                if(!*c) break;
+
+                const char *name = c;
+                while(*c && *c != ',' && *c != ';' && *c != ' ' && *c != '\t')
+                        ++c;
+                const size_t n = (size_t)(c - name);
+
+                const char *end = c;
+                while(*end && *end != ',') ++end;
+                const int q = law_hgz_member_q(c, end);
+                c = end;
+
+                if(     (n == 4 && !strncasecmp(name, "gzip", 4)) ||
+                        (n == 6 && !strncasecmp(name, "x-gzip", 6)))
+                        q_gzip = q;
+                else if(n == 7 && !strncasecmp(name, "deflate", 7))
+                        q_deflate = q;
+                else if(n == 1 && *name == '*')
+                        q_any = q;
+        }
+
+        if(q_gzip < 0) q_gzip = q_any;
+        if(q_deflate < 0) q_deflate = q_any;
+
+        if(q_gzip <= 0 && q_deflate <= 0)
+                return LAW_HGZ_IDENTITY;
+
+        return q_gzip >= q_deflate ? LAW_HGZ_GZIP : LAW_HGZ_DEFLATE;
+}
+
+/** Ready a deflate state for a new body, reusing it when it can be. */
+static sel_err_t law_hgz_setup(
+        law_hgz_stream_t *s,
+        const int coding,
+        const int level,
+        const int mem_level)
+{
+        if(s->coding == coding) {
+                if(deflateReset(&s->z) != Z_OK)
+                        return LAW_ERR_OOM;
+        } else {
+                if(s->coding)
+                        (void)deflateEnd(&s->z);
+                s->coding = 0;
+
+                (void)memset(&s->z, 0, sizeof(z_stream));
+                const int bits = coding == LAW_HGZ_GZIP ? 15 + 16 : 15;
+                if(deflateInit2(
+                        &s->z,
+                        level,
+                        Z_DEFLATED,
+                        bits,
+                        mem_level,
+                        Z_DEFAULT_STRATEGY) != Z_OK)
+                        return LAW_ERR_OOM;
+
+                s->coding = coding;
+                s->level = level;
+        }
+
+        if(s->level != level) {
+                if(deflateParams(&s->z, level, Z_DEFAULT_STRATEGY) != Z_OK)
+                        return LAW_ERR_OOM;
+                s->level = level;
+        }
+
+        s->z.next_out = s->out;
+        s->z.avail_out = (uInt)s->chunk;
+        return LAW_ERR_OK;
+}
+
+static void law_hgz_release_stream(law_hgz_stream_t *s)
+{
+        s->next = s->owner->free;
+        s->owner->free = s;
+}
+
+/** Take a free deflate state, preferring one set up for the coding. */
+static law_hgz_stream_t *law_hgz_acquire(
+        law_hgz_t *hgz,
+        law_worker_t *worker,
+        const int coding,
+        const int level)
+{
+        law_hgz_worker_t *w = law_hgz_worker(hgz, worker);
+
+        law_hgz_stream_t **pick = NULL;
+        for(law_hgz_stream_t **l = &w->free; *l; l = &(*l)->next) {
+                if(!pick || (*l)->coding == coding) pick = l;
+                if((*l)->coding == coding) break;
+        }
+        if(!pick) return NULL;
+
+        law_hgz_stream_t *s = *pick;
+        *pick = s->next;
+        s->next = NULL;
+
+        if(law_hgz_setup(s, coding, level, hgz->cfg.mem_level) != LAW_ERR_OK){
+                law_hgz_release_stream(s);
+                return NULL;
+        }
+
+        return s;
+}
+
+static uInt law_hgz_cap(const size_t n)
+{
+        return n < UINT_MAX ? (uInt)n : UINT_MAX;
+}
+
+sel_err_t law_hgz_compress(
+        law_hgz_t *hgz,
+        law_worker_t *worker,
+        const int coding,
+        const int level,
+        const void *source,
+        const size_t length,
+        void *dest,
+        const size_t dest_size,
+        size_t *dest_length)
+{
+        SEL_ASSERT(coding == LAW_HGZ_GZIP || coding == LAW_HGZ_DEFLATE);
+
+        law_hgz_stream_t *s = law_hgz_acquire(hgz, worker, coding, level);
+        if(!s) return LAW_ERR_OOM;
+
+        z_stream *z = &s->z;
+        const uint8_t *in = source;
+        uint8_t *out = dest;
+        size_t in_left = length, out_left = dest_size;
+        int zerr = Z_OK;
+
+        do {
+                z->next_in = in;
+                z->avail_in = law_hgz_cap(in_left);
+                z->next_out = out;
+                z->avail_out = law_hgz_cap(out_left);
+
+                const uInt
+                        avail_in = z->avail_in,
+                        avail_out = z->avail_out;
+
+                zerr = deflate(z, in_left == avail_in ? Z_FINISH : Z_NO_FLUSH);
+
+                in += avail_in - z->avail_in;
+                in_left -= avail_in - z->avail_in;
+                out += avail_out - z->avail_out;
+                out_left -= avail_out - z->avail_out;
+        } while(zerr == Z_OK && out_left);
+
+        *dest_length = dest_size - out_left;
+        law_hgz_release_stream(s);
+
+        return zerr == Z_STREAM_END ? LAW_ERR_OK : LAW_ERR_OOB;
+}
+
+/** Send what the deflate state has produced. */
+static sel_err_t law_hgz_emit(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        law_hgz_stream_t *s)
+{
+        const size_t n = s->chunk - s->z.avail_out;
+        s->z.next_out = s->out;
+        s->z.avail_out = (uInt)s->chunk;
+        if(!n) return LAW_ERR_OK;
+        return law_hts_write_sync(worker, timeout, req, s->out, n);
+}
+
+sel_err_t law_hgz_begin_sync(
+        law_hgz_t *hgz,
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        law_htheaders_t *headers,
+        const size_t length,
+        law_hgz_stream_t **stream)
+{
+        *stream = NULL;
+
+        const int coding = headers ?
+                law_hgz_negotiate(law_hth_get_field(
+                        headers,
+                        LAW_HTH_ACCEPT_ENCODING)) :
+                LAW_HGZ_IDENTITY;
+
+        SEL_TRY_QUIETLY(law_hts_put_header(
+                req,
+                LAW_HTS_VARY,
+                "Accept-Encoding"));
+
+        law_hgz_stream_t *s = NULL;
+        if(coding && length >= hgz->cfg.min_length)
+                s = law_hgz_acquire(hgz, worker, coding, hgz->cfg.level);
+
+        if(!s)
+                return law_hts_begin_stream_sync(worker, timeout, req, length);
+
+        sel_err_t err = law_hts_put_header(
+                req,
+                LAW_HTS_CONTENT_ENCODING,
+                coding == LAW_HGZ_GZIP ? "gzip" : "deflate");
+        if(err == LAW_ERR_OK)
+                err = law_hts_begin_stream_sync(
+                        worker,
+                        timeout,
+                        req,
+                        LAW_HTS_UNKNOWN_LENGTH);
+
+        if(err != LAW_ERR_OK) {
+                law_hgz_release_stream(s);
+                return err;
+        }
+
+        *stream = s;
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hgz_write_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        law_hgz_stream_t *stream,
+        const void *data,
+        const size_t length)
+{
+        if(!stream)
+                return law_hts_write_sync(worker, timeout, req, data, length);
+
+        z_stream *z = &stream->z;
+        const uint8_t *bytes = data;
+        size_t left = length;
+
+        while(left) {
+                const uInt piece = law_hgz_cap(left);
+                z->next_in = bytes;
+                z->avail_in = piece;
+
+                /* Input is taken whole unless the chunk fills first. */
+                while(z->avail_in) {
+                        SEL_TEST(deflate(z, Z_NO_FLUSH) != Z_STREAM_ERROR);
+                        if(!z->avail_out)
+                                SEL_TRY_QUIETLY(law_hgz_emit(
+                                        worker,
+                                        timeout,
+                                        req,
+                                        stream));
+                }
+
+                bytes += piece;
+                left -= piece;
+        }
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hgz_end_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        law_hgz_stream_t *stream)
+{
+        if(!stream)
+                return law_hts_end_stream_sync(worker, timeout, req);
+
+        z_stream *z = &stream->z;
+        z->next_in = NULL;
+        z->avail_in = 0;
+
+        sel_err_t err = LAW_ERR_OK;
+
+        for(;;) {
+                const int zerr = deflate(z, Z_FINISH);
+                SEL_TEST(zerr != Z_STREAM_ERROR);
+                if(zerr == Z_STREAM_END || !z->avail_out) {
+                        err = law_hgz_emit(worker, timeout, req, stream);
+                        if(err != LAW_ERR_OK || zerr == Z_STREAM_END)
+                                break;
+                }
+        }
+
+        law_hgz_release_stream(stream);
+
+        if(err != LAW_ERR_OK)
+                return err;
+
+        return law_hts_end_stream_sync(worker, timeout, req);
+}
+
+/** FNV-1a over the key, then the coding. */
+static uint32_t law_hgz_hash(const char *key, const int coding)
+{
+        uint32_t hash = 2166136261u;
+        for(; *key; ++key) {
+                hash ^= (uint8_t)*key;
+                hash *= 16777619u;
+        }
+        hash ^= (uint32_t)coding;
+        hash *= 16777619u;
+        return hash;
+}
+
+static void law_hgz_lru_unlink(law_hgz_worker_t *w, law_hgz_entry_t *e)
+{
+        if(e->prev) e->prev->next = e->next;
+        else w->head = e->next;
+        if(e->next) e->next->prev = e->prev;
+        else w->tail = e->prev;
+        e->prev = e->next = NULL;
+}
+
+static void law_hgz_lru_front(law_hgz_worker_t *w, law_hgz_entry_t *e)
+{
+        e->prev = NULL;
+        e->next = w->head;
+        if(w->head) w->head->prev = e;
+        w->head = e;
+        if(!w->tail) w->tail = e;
+}
+
+/** Free an entry no cache or response holds. */
+static void law_hgz_entry_put(law_hgz_entry_t *e)
+{
+        if(e && e->evicted && !e->refs)
+                free(e);
+}
+
+static void law_hgz_evict(law_hgz_worker_t *w, law_hgz_entry_t *e)
+{
+        law_hgz_entry_t **link = &w->buckets[e->hash % LAW_HGZ_BUCKETS];
+        while(*link != e) link = &(*link)->chain;
+        *link = e->chain;
+
+        law_hgz_lru_unlink(w, e);
+        w->used -= law_hgz_entry_size(e);
+
+        /* Responses still sending it free it when they are done. */
+        e->evicted = true;
+        law_hgz_entry_put(e);
+}
+
+/** Release callback of cached bodies queued on a connection. */
+static void law_hgz_release_entry(
+        const void *base,
+        const size_t length,
+        void *state)
+{
+        law_hgz_entry_t *e = state;
+        e->refs -= 1;
+        law_hgz_entry_put(e);
+}
+
+/**
+ * Find the compressed body, or compress and insert it.  NULL when no
+ * deflate state is free or memory runs out.  An entry too large for the
+ * cache is returned unlinked, and freed once nothing refers to it.
+ */
+static law_hgz_entry_t *law_hgz_cache_get(
+        law_hgz_t *hgz,
+        law_worker_t *worker,
+        const char *key,
+        const int coding,
+        const void *body,
+        const size_t length)
+{
+        law_hgz_worker_t *w = law_hgz_worker(hgz, worker);
+        const uint32_t hash = law_hgz_hash(key, coding);
+        const size_t key_len = strlen(key);
+
+        law_hgz_entry_t *e = w->buckets[hash % LAW_HGZ_BUCKETS];
+        for(; e; e = e->chain) {
+                if(     e->hash == hash &&
+                        e->coding == coding &&
+                        e->source == length &&
+                        e->key_len == key_len &&
+                        !memcmp(e->data, key, key_len))
+                {
+                        law_hgz_lru_unlink(w, e);
+                        law_hgz_lru_front(w, e);
+                        return e;
+                }
+        }
+
+        /* Only a smaller body is worth keeping, so that bounds the result. */
+        e = malloc(sizeof(law_hgz_entry_t) + key_len + 1 + length);
+        if(!e) return NULL;
+
+        (void)memcpy(e->data, key, key_len + 1);
+        switch(law_hgz_compress(
+                hgz,
+                worker,
+                coding,
+                hgz->cfg.cache_level,
+                body,
+                length,
+                e->data + key_len + 1,
+                length - 1,
+                &e->length))
+        {
+                case LAW_ERR_OK:
+                        break;
+                case LAW_ERR_OOB:
+                        e->length = 0;
+                        break;
+                default:
+                        free(e);
+                        return NULL;
+        }
+
+        law_hgz_entry_t *small = realloc(
+                e,
+                sizeof(law_hgz_entry_t) + key_len + 1 + e->length);
+        if(small) e = small;
+
+        e->owner = w;
+        e->hash = hash;
+        e->coding = coding;
+        e->refs = 0;
+        e->source = length;
+        e->key_len = key_len;
+        e->chain = e->prev = e->next = NULL;
+        e->evicted = false;
+
+        const size_t size = law_hgz_entry_size(e);
+        if(size > w->max) {
+                e->evicted = true;
+                return e;
+        }
+
+        while(w->used + size > w->max)
+                law_hgz_evict(w, w->tail);
+
+        law_hgz_entry_t **bucket = &w->buckets[hash % LAW_HGZ_BUCKETS];
+        e->chain = *bucket;
+        *bucket = e;
+        law_hgz_lru_front(w, e);
+        w->used += size;
+
+        return e;
+}
+
+sel_err_t law_hgz_send_cached_sync(
+        law_hgz_t *hgz,
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        law_htheaders_t *headers,
+        const char *key,
+        const void *body,
+        const size_t length)
+{
+        const int coding = headers ?
+                law_hgz_negotiate(law_hth_get_field(
+                        headers,
+                        LAW_HTH_ACCEPT_ENCODING)) :
+                LAW_HGZ_IDENTITY;
+
+        SEL_TRY_QUIETLY(law_hts_put_header(
+                req,
+                LAW_HTS_VARY,
+                "Accept-Encoding"));
+
+        law_hgz_entry_t *e = NULL;
+        if(coding && length && length >= hgz->cfg.min_length)
+                e = law_hgz_cache_get(hgz, worker, key, coding, body, length);
+
+        if(!e || !e->length) {
+                law_hgz_entry_put(e);
+                SEL_TRY_QUIETLY(law_hts_begin_stream_sync(
+                        worker,
+                        timeout,
+                        req,
+                        length));
+                SEL_TRY_QUIETLY(law_hts_write_sync(
+                        worker,
+                        timeout,
+                        req,
+                        body,
+                        length));
+                return law_hts_end_stream_sync(worker, timeout, req);
+        }
+
+        e->refs += 1;
+
+        sel_err_t err = law_hts_put_header(
+                req,
+                LAW_HTS_CONTENT_ENCODING,
+                coding == LAW_HGZ_GZIP ? "gzip" : "deflate");
+        if(err == LAW_ERR_OK)
+                err = law_hts_begin_stream_sync(worker, timeout, req, e->length);
+        if(err == LAW_ERR_OK)
+                err = law_hts_write_ref_sync(
+                        worker,
+                        timeout,
+                        req,
+                        e->data + e->key_len + 1,
+                        e->length,
+                        law_hgz_release_entry,
+                        e);
+
+        /* Until it is queued, the reference is still this call's. */
+        if(err != LAW_ERR_OK) {
+                law_hgz_release_entry(NULL, 0, e);
+                return err;
+        }
+
+        return law_hts_end_stream_sync(worker, timeout, req);
+}
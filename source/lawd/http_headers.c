@@ -3,20 +3,164 @@
 #include "lawd/http_headers.h"
 #include "lawd/private/http_headers.h"
 #include "pgenc/ast.h"
+#include <stdbool.h>
 #include <string.h>
 
+static const struct {
+        const char *name;
+        size_t length;
+} LAW_HTH_NAMES[LAW_HTH_FIELDS] = {
+        [LAW_HTH_HOST]                  = { "Host", 4 },
+        [LAW_HTH_CONNECTION]            = { "Connection", 10 },
+        [LAW_HTH_CONTENT_LENGTH]        = { "Content-Length", 14 },
+        [LAW_HTH_CONTENT_TYPE]          = { "Content-Type", 12 },
+        [LAW_HTH_TRANSFER_ENCODING]     = { "Transfer-Encoding", 17 },
+        [LAW_HTH_EXPECT]                = { "Expect", 6 },
+        [LAW_HTH_UPGRADE]               = { "Upgrade", 7 },
+        [LAW_HTH_ORIGIN]                = { "Origin", 6 },
+        [LAW_HTH_COOKIE]                = { "Cookie", 6 },
+        [LAW_HTH_AUTHORIZATION]         = { "Authorization", 13 },
+        [LAW_HTH_ACCEPT]                = { "Accept", 6 },
+        [LAW_HTH_ACCEPT_ENCODING]       = { "Accept-Encoding", 15 },
+        [LAW_HTH_USER_AGENT]            = { "User-Agent", 10 },
+        [LAW_HTH_SEC_WEBSOCKET_KEY]     = { "Sec-WebSocket-Key", 17 },
+        [LAW_HTH_SEC_WEBSOCKET_VERSION] = { "Sec-WebSocket-Version", 21 },
+        [LAW_HTH_SEC_WEBSOCKET_PROTOCOL] = { "Sec-WebSocket-Protocol", 22 },
+        [LAW_HTH_SEC_WEBSOCKET_EXTENSIONS] =
+                { "Sec-WebSocket-Extensions", 24 },
+};
+
+static char law_hth_lower(const char c)
+{
+        return ('A' <= c && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static bool law_hth_iequal(const char *a, const char *b, const size_t n)
+{
+        for(size_t i = 0; i < n; ++i)
+                if(law_hth_lower(a[i]) != law_hth_lower(b[i]))
+                        return false;
+        return true;
+}
+
+/** FNV-1a over the lowercased name. */
+static uint32_t law_hth_hash(const char *name, const size_t length)
+{
+        uint32_t hash = 2166136261u;
+        for(size_t i = 0; i < length; ++i) {
+                hash ^= (uint8_t)law_hth_lower(name[i]);
+                hash *= 16777619u;
+        }
+        return hash;
+}
+
+int law_hth_classify(const char *name, const size_t length)
+{
+        /* Names of a length are few, so the length and the first letter
+         * rule out almost every candidate before a full compare. */
+        const char first = law_hth_lower(name[0]);
+        for(int f = 0; f < LAW_HTH_FIELDS; ++f) {
+                if(     LAW_HTH_NAMES[f].length == length &&
+                        law_hth_lower(LAW_HTH_NAMES[f].name[0]) == first &&
+                        law_hth_iequal(LAW_HTH_NAMES[f].name, name, length))
+                        return f;
+        }
+        return -1;
+}
+
+void law_hth_index(law_htheaders_t *hdrs)
+{
+        (void)memset(hdrs->known, 0, sizeof(hdrs->known));
+        (void)memset(hdrs->buckets, 0, sizeof(hdrs->buckets));
+
+        /* Walk backwards, so the first of repeated fields ends up in front. */
+        for(size_t i = hdrs->count; i > 0; --i) {
+                struct law_htfield *f = &hdrs->fields[i - 1];
+                const char *name = hdrs->base + f->name;
+
+                const int known = law_hth_classify(name, f->name_len);
+                if(known >= 0) {
+                        f->next = 0;
+                        hdrs->known[known] = (uint32_t)i;
+                        continue;
+                }
+
+                uint32_t *bucket = &hdrs->buckets[
+                        law_hth_hash(name, f->name_len) &
+                        (LAW_HTH_BUCKETS - 1)];
+                f->next = *bucket;
+                *bucket = (uint32_t)i;
+        }
+}
+
+static const char *law_hth_find(
+        law_htheaders_t *hdrs,
+        const char *field_name,
+        const size_t length,
+        const int known)
+{
+        if(known >= 0) {
+                const uint32_t i = hdrs->known[known];
+                return i ? hdrs->base + hdrs->fields[i - 1].value : NULL;
+        }
+
+        uint32_t i = hdrs->buckets[
+                law_hth_hash(field_name, length) & (LAW_HTH_BUCKETS - 1)];
+
+        while(i) {
+                struct law_htfield *f = &hdrs->fields[i - 1];
+                const char *name = hdrs->base + f->name;
+                if(     f->name_len == length && 
+                        law_hth_iequal(name, field_name, length))
+                        return hdrs->base + f->value;
+                i = f->next;
+        }
+
+        return NULL;
+}
+
 const char *law_hth_get(
         law_htheaders_t *hdrs,
         const char *field_name)
 {
+        const size_t length = strlen(field_name);
+
+        if(hdrs->base) {
+                return law_hth_find(
+                        hdrs,
+                        field_name,
+                        length,
+                        law_hth_classify(field_name, length));
+        }
+
         for(struct pgc_ast_lst *l = hdrs->list; l; l = l->nxt) {
                 struct pgc_ast_lst *tpl = pgc_ast_tolst(l->val);
-                if(!strcmp(pgc_ast_tostr(tpl->val), field_name)) 
+                const char *name = pgc_ast_tostr(tpl->val);
+                if(     strlen(name) == length &&
+                        law_hth_iequal(name, field_name, length))
                         return tpl->nxt ? pgc_ast_tostr(tpl->nxt->val) : "";
         }
         return NULL;
 }
 
+const char *law_hth_get_field(
+        law_htheaders_t *hdrs,
+        const int field)
+{
+        SEL_ASSERT(0 <= field && field < LAW_HTH_FIELDS);
+
+        if(hdrs->base)
+                return law_hth_find(hdrs, NULL, 0, field);
+
+        return law_hth_get(hdrs, LAW_HTH_NAMES[field].name);
+}
+
+const char *law_hth_field_name(const int field)
+{
+        SEL_ASSERT(0 <= field && field < LAW_HTH_FIELDS);
+        return LAW_HTH_NAMES[field].name;
+}
+
 law_hth_iter_t *law_hth_elems(
         struct law_htheaders *hdrs,
         void *(alloc)(const size_t, void*),
@@ -25,6 +169,9 @@ law_hth_iter_t *law_hth_elems(
         law_hth_iter_t *iter = alloc(sizeof(law_hth_iter_t), st);
         if(!iter) return NULL;
         iter->list = hdrs->list;
+        iter->base = hdrs->base;
+        iter->fields = hdrs->fields;
+        iter->count = hdrs->count;
         return iter;
 }
 
@@ -33,6 +180,16 @@ law_hth_iter_t *law_hth_next(
         const char **field_name,
         const char **field_value)
 {
+        if(iter->fields) {
+                if(!iter->count) return NULL;
+                if(field_name) 
+                        *field_name = iter->base + iter->fields->name;
+                if(field_value) 
+                        *field_value = iter->base + iter->fields->value;
+                iter->fields += 1;
+                iter->count -= 1;
+                return iter;
+        }
         if(!iter->list) return NULL;
         struct pgc_ast_lst *ele = pgc_ast_tolst(iter->list->val);
         if(field_name) 
@@ -0,0 +1,574 @@
+#define _GNU_SOURCE
+
+#include "lawd/http_router.h"
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** A byte of a pattern, or a parameter, while routes are being added. */
+typedef struct law_hrt_bnode {
+        struct law_hrt_bnode *child;            /** First Static Child */
+        struct law_hrt_bnode *next;             /** Next Sibling */
+        struct law_hrt_bnode *param;            /** ":name" Child */
+        struct law_hrt_bnode *glob;             /** "*name" Child */
+        uint32_t routes;                        /** Routes Ending (Index+1) */
+        unsigned methods;                       /** Methods of Those Routes */
+        uint8_t byte;
+} law_hrt_bnode_t;
+
+/** A run of path bytes, or a parameter, in the compiled tree. */
+typedef struct law_hrt_node {
+        uint32_t label;                         /** Label Offset */
+        uint32_t length;                        /** Label Length */
+        uint32_t first;                         /** First Static Child */
+        uint32_t children;                      /** Static Children */
+        uint32_t param;                         /** ":name" Child (Index+1) */
+        uint32_t glob;                          /** "*name" Child (Index+1) */
+        uint32_t routes;                        /** Routes Ending (Index+1) */
+        unsigned methods;                       /** Methods of Those Routes */
+} law_hrt_node_t;
+
+typedef struct law_hrt_route {
+        unsigned methods;
+        law_hrt_handler_t handler;
+        law_data_t data;
+        char *names;                            /** Parameter Names */
+        size_t params;
+        const char *name[LAW_HRT_PARAMS];
+        uint32_t next;                          /** Same Node (Index+1) */
+} law_hrt_route_t;
+
+/** One worker's counters.  Only that worker writes them. */
+typedef struct law_hrt_slot {
+        atomic_uint_fast64_t hits;
+        atomic_uint_fast64_t errors;
+} law_hrt_slot_t;
+
+struct law_hrt {
+        int workers;
+        law_hrt_route_t *routes;
+        size_t count;                           /** Routes Added */
+        size_t capacity;
+        law_hrt_bnode_t *root;                  /** Until Compiled */
+        size_t bnodes;
+        law_hrt_node_t *nodes;                  /** Once Compiled */
+        uint8_t *keys;                          /** First Label Bytes */
+        char *labels;
+        size_t used;                            /** Nodes Placed */
+        size_t length;                          /** Label Bytes Placed */
+        law_hrt_slot_t **slots;                 /** Per Worker, Routes+2 */
+};
+
+/** Where matching resumes once a static child has failed. */
+typedef struct law_hrt_alt {
+        uint32_t node;
+        uint32_t pos;
+        uint32_t params;
+        int stage;                              /** 1: Parameter, 2: Glob */
+} law_hrt_alt_t;
+
+static const struct {
+        const char *name;
+        unsigned bit;
+} LAW_HRT_METHODS[] = {
+        { "GET",        LAW_HRT_GET },
+        { "HEAD",       LAW_HRT_HEAD },
+        { "POST",       LAW_HRT_POST },
+        { "PUT",        LAW_HRT_PUT },
+        { "DELETE",     LAW_HRT_DELETE },
+        { "PATCH",      LAW_HRT_PATCH },
+        { "OPTIONS",    LAW_HRT_OPTIONS },
+        { "CONNECT",    LAW_HRT_CONNECT },
+        { "TRACE",      LAW_HRT_TRACE },
+};
+
+#define LAW_HRT_NMETHODS (sizeof(LAW_HRT_METHODS) / sizeof(*LAW_HRT_METHODS))
+
+law_hrt_t *law_hrt_create(law_server_cfg_t *srv_cfg)
+{
+        law_hrt_t *hrt = calloc(1, sizeof(law_hrt_t));
+        if(!hrt) return NULL;
+
+        hrt->workers = srv_cfg->workers > 0 ? srv_cfg->workers : 1;
+        hrt->root = calloc(1, sizeof(law_hrt_bnode_t));
+        if(!hrt->root) {
+                free(hrt);
+                return NULL;
+        }
+        hrt->bnodes = 1;
+
+        return hrt;
+}
+
+static void law_hrt_bnode_free(law_hrt_bnode_t *b)
+{
+        while(b) {
+                law_hrt_bnode_t *next = b->next;
+                law_hrt_bnode_free(b->child);
+                law_hrt_bnode_free(b->param);
+                law_hrt_bnode_free(b->glob);
+                free(b);
+                b = next;
+        }
+}
+
+void law_hrt_destroy(law_hrt_t *hrt)
+{
+        law_hrt_bnode_free(hrt->root);
+        for(size_t r = 0; r < hrt->count; ++r)
+                free(hrt->routes[r].names);
+        free(hrt->routes);
+        free(hrt->nodes);
+        free(hrt->keys);
+        free(hrt->labels);
+        if(hrt->slots) {
+                for(int w = 0; w < hrt->workers; ++w)
+                        free(hrt->slots[w]);
+                free(hrt->slots);
+        }
+        free(hrt);
+}
+
+unsigned law_hrt_method(const char *method)
+{
+        if(method) {
+                for(size_t m = 0; m < LAW_HRT_NMETHODS; ++m)
+                        if(!strcmp(method, LAW_HRT_METHODS[m].name))
+                                return LAW_HRT_METHODS[m].bit;
+        }
+        return LAW_HRT_OTHER;
+}
+
+/** Find or add the static child for a byte. */
+static law_hrt_bnode_t *law_hrt_step(
+        law_hrt_t *hrt,
+        law_hrt_bnode_t *b,
+        const uint8_t byte)
+{
+        law_hrt_bnode_t **at = &b->child;
+        for(; *at; at = &(*at)->next)
+                if((*at)->byte == byte) return *at;
+
+        if(!(*at = calloc(1, sizeof(law_hrt_bnode_t)))) return NULL;
+        (*at)->byte = byte;
+        ++hrt->bnodes;
+        return *at;
+}
+
+/** Find or add a parameter child. */
+static law_hrt_bnode_t *law_hrt_child(law_hrt_t *hrt, law_hrt_bnode_t **at)
+{
+        if(!*at && (*at = calloc(1, sizeof(law_hrt_bnode_t))))
+                ++hrt->bnodes;
+        return *at;
+}
+
+/** Check a pattern and copy its parameter names, each ending in a NUL. */
+static sel_err_t law_hrt_parse(const char *pattern, law_hrt_route_t *route)
+{
+        if(pattern[0] != '/') return LAW_ERR_SYN;
+
+        size_t segments = 0;
+        for(const char *p = pattern; *p; ++p) {
+                if(*p != '/') continue;
+                if(++segments > LAW_HRT_SEGMENTS) return LAW_ERR_LIMIT;
+                if(p[1] != ':' && p[1] != '*') continue;
+
+                const char *end = strchr(p + 1, '/');
+                if(p[1] == ':' && (end == p + 2 || p[2] == '\0'))
+                        return LAW_ERR_SYN;
+                if(p[1] == '*' && end) return LAW_ERR_SYN;
+                if(route->params == LAW_HRT_PARAMS) return LAW_ERR_LIMIT;
+                ++route->params;
+        }
+
+        if(!(route->names = strdup(pattern))) return LAW_ERR_OOM;
+
+        size_t n = 0;
+        for(char *p = route->names; *p; ++p)
+                if(*p == '/' && (p[1] == ':' || p[1] == '*'))
+                        route->name[n++] = p + 2;
+
+        for(size_t x = 0; x < n; ++x)
+                *strchrnul(route->name[x], '/') = '\0';
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hrt_add(
+        law_hrt_t *hrt,
+        const unsigned methods,
+        const char *pattern,
+        law_hrt_handler_t handler,
+        law_data_t data,
+        size_t *route)
+{
+        if(hrt->nodes) return LAW_ERR_MODE;
+        if(!(methods & LAW_HRT_ANY)) return LAW_ERR_SYN;
+        if(hrt->count >= UINT32_MAX - 2) return LAW_ERR_LIMIT;
+
+        law_hrt_route_t r;
+        memset(&r, 0, sizeof(law_hrt_route_t));
+        r.methods = methods & LAW_HRT_ANY;
+        r.handler = handler;
+        r.data = data;
+
+        SEL_TRY_QUIETLY(law_hrt_parse(pattern, &r));
+
+        law_hrt_bnode_t *b = hrt->root;
+        for(const char *p = pattern; *p && b; ) {
+                if(p[0] == '/' && p[1] == ':') {
+                        b = law_hrt_step(hrt, b, '/');
+                        if(b) b = law_hrt_child(hrt, &b->param);
+                        p = strchrnul(p + 1, '/');
+                } else if(p[0] == '/' && p[1] == '*') {
+                        b = law_hrt_step(hrt, b, '/');
+                        if(b) b = law_hrt_child(hrt, &b->glob);
+                        p += strlen(p);
+                } else {
+                        b = law_hrt_step(hrt, b, (uint8_t)*p++);
+                }
+        }
+
+        if(!b) {
+                free(r.names);
+                return LAW_ERR_OOM;
+        }
+        if(b->methods & r.methods) {
+                free(r.names);
+                return LAW_ERR_CMP;
+        }
+
+        if(hrt->count == hrt->capacity) {
+                const size_t capacity = hrt->capacity ? hrt->capacity * 2 : 16;
+                law_hrt_route_t *routes = realloc(hrt->routes,
+                        capacity * sizeof(law_hrt_route_t));
+                if(!routes) {
+                        free(r.names);
+                        return LAW_ERR_OOM;
+                }
+                hrt->routes = routes;
+                hrt->capacity = capacity;
+        }
+
+        r.next = b->routes;
+        b->routes = (uint32_t)hrt->count + 1;
+        b->methods |= r.methods;
+        hrt->routes[hrt->count] = r;
+        if(route) *route = hrt->count;
+        ++hrt->count;
+
+        return LAW_ERR_OK;
+}
+
+/** Whether a static node's label runs on into its only child. */
+static bool law_hrt_chain(const law_hrt_bnode_t *b)
+{
+        return  b->child && !b->child->next &&
+                !b->param && !b->glob && !b->routes;
+}
+
+/**
+ * Lay out a node at its slot: gather its label while the build tree does
+ * not branch, reserve the slots of all its children together, then lay
+ * them out in turn.
+ */
+static void law_hrt_place(
+        law_hrt_t *hrt,
+        law_hrt_bnode_t *b,
+        const size_t at,
+        const bool label)
+{
+        law_hrt_node_t *n = &hrt->nodes[at];
+        n->label = (uint32_t)hrt->length;
+
+        if(label) {
+                hrt->labels[hrt->length++] = (char)b->byte;
+                while(law_hrt_chain(b)) {
+                        b = b->child;
+                        hrt->labels[hrt->length++] = (char)b->byte;
+                }
+                hrt->keys[at] = (uint8_t)hrt->labels[n->label];
+        }
+        n->length = (uint32_t)hrt->length - n->label;
+        n->routes = b->routes;
+        n->methods = b->methods;
+
+        n->first = (uint32_t)hrt->used;
+        for(law_hrt_bnode_t *c = b->child; c; c = c->next)
+                ++n->children;
+        hrt->used += n->children;
+        if(b->param) n->param = (uint32_t)++hrt->used;
+        if(b->glob) n->glob = (uint32_t)++hrt->used;
+
+        size_t c_at = n->first;
+        for(law_hrt_bnode_t *c = b->child; c; c = c->next)
+                law_hrt_place(hrt, c, c_at++, true);
+        if(b->param) law_hrt_place(hrt, b->param, n->param - 1, false);
+        if(b->glob) law_hrt_place(hrt, b->glob, n->glob - 1, false);
+}
+
+sel_err_t law_hrt_compile(law_hrt_t *hrt)
+{
+        if(hrt->nodes) return LAW_ERR_MODE;
+
+        hrt->nodes = calloc(hrt->bnodes, sizeof(law_hrt_node_t));
+        hrt->keys = calloc(hrt->bnodes, sizeof(uint8_t));
+        hrt->labels = malloc(hrt->bnodes);
+        hrt->slots = calloc((size_t)hrt->workers, sizeof(law_hrt_slot_t*));
+        if(!hrt->nodes || !hrt->keys || !hrt->labels || !hrt->slots)
+                goto oom;
+
+        for(int w = 0; w < hrt->workers; ++w) {
+                hrt->slots[w] = calloc(hrt->count + 2, sizeof(law_hrt_slot_t));
+                if(!hrt->slots[w]) goto oom;
+        }
+
+        hrt->used = 1;
+        law_hrt_place(hrt, hrt->root, 0, false);
+
+        law_hrt_bnode_free(hrt->root);
+        hrt->root = NULL;
+        return LAW_ERR_OK;
+
+oom:
+        free(hrt->nodes);
+        free(hrt->keys);
+        free(hrt->labels);
+        if(hrt->slots) {
+                for(int w = 0; w < hrt->workers; ++w)
+                        free(hrt->slots[w]);
+                free(hrt->slots);
+        }
+        hrt->nodes = NULL;
+        hrt->keys = NULL;
+        hrt->labels = NULL;
+        hrt->slots = NULL;
+        return LAW_ERR_OOM;
+}
+
+/** Take the first route at a node that takes the method. */
+static bool law_hrt_take(
+        law_hrt_t *hrt,
+        const law_hrt_node_t *n,
+        const unsigned bit,
+        law_hrt_match_t *match)
+{
+        if(!(n->methods & bit)) {
+                match->allow |= n->methods;
+                return false;
+        }
+
+        uint32_t r = n->routes;
+        while(!(hrt->routes[r - 1].methods & bit))
+                r = hrt->routes[r - 1].next;
+        match->route = r - 1;
+        return true;
+}
+
+sel_err_t law_hrt_match(
+        law_hrt_t *hrt,
+        const char *method,
+        const char *path,
+        law_hrt_match_t *match)
+{
+        SEL_ASSERT(hrt->nodes);
+
+        const unsigned bit = law_hrt_method(method);
+        const char *p = path ? path : "";
+
+        law_hrt_alt_t alts[LAW_HRT_SEGMENTS + 1];
+        size_t depth = 0;
+        size_t offsets[LAW_HRT_PARAMS], lengths[LAW_HRT_PARAMS];
+
+        uint32_t node = 0, pos = 0, params = 0;
+        int stage = 0;
+
+        match->allow = 0;
+        for(;;) {
+                const law_hrt_node_t *n = &hrt->nodes[node];
+                const uint8_t c = (uint8_t)p[pos];
+                bool found = false;
+
+                switch(stage) {
+                case 0:
+                        if(!c) {
+                                if(n->routes && law_hrt_take(hrt, n, bit, match))
+                                        goto found;
+                        } else if(n->children) {
+                                const uint8_t *key = memchr(
+                                        hrt->keys + n->first, c, n->children);
+                                if(key) {
+                                        const uint32_t k =
+                                                (uint32_t)(key - hrt->keys);
+                                        const law_hrt_node_t *s =
+                                                &hrt->nodes[k];
+                                        const char *l = hrt->labels + s->label;
+                                        uint32_t x = 1;
+                                        while(x < s->length && p[pos + x] == l[x])
+                                                ++x;
+                                        found = x == s->length;
+                                        if(found && (n->param || n->glob) &&
+                                                depth < LAW_HRT_SEGMENTS + 1)
+                                                alts[depth++] = (law_hrt_alt_t){
+                                                        node, pos, params, 1};
+                                        if(found) {
+                                                node = k;
+                                                pos += x;
+                                                continue;
+                                        }
+                                }
+                        }
+                        /* fall through */
+                case 1:
+                        if(n->param && c && c != '/' && params < LAW_HRT_PARAMS) {
+                                uint32_t end = pos;
+                                while(p[end] && p[end] != '/') ++end;
+                                if(n->glob && depth < LAW_HRT_SEGMENTS + 1)
+                                        alts[depth++] = (law_hrt_alt_t){
+                                                node, pos, params, 2};
+                                offsets[params] = pos;
+                                lengths[params++] = end - pos;
+                                node = n->param - 1;
+                                pos = end;
+                                stage = 0;
+                                continue;
+                        }
+                        /* fall through */
+                case 2:
+                        if(n->glob && params < LAW_HRT_PARAMS) {
+                                const law_hrt_node_t *g = &hrt->nodes[n->glob - 1];
+                                if(law_hrt_take(hrt, g, bit, match)) {
+                                        offsets[params] = pos;
+                                        lengths[params++] = strlen(p + pos);
+                                        goto found;
+                                }
+                        }
+                }
+
+                if(!depth) break;
+                --depth;
+                node = alts[depth].node;
+                pos = alts[depth].pos;
+                params = alts[depth].params;
+                stage = alts[depth].stage;
+        }
+
+        return match->allow ? LAW_ERR_MODE : LAW_ERR_NOID;
+
+found:
+        match->params = params;
+        for(uint32_t x = 0; x < params; ++x) {
+                match->param[x].name = hrt->routes[match->route].name[x];
+                match->param[x].value = p + offsets[x];
+                match->param[x].length = lengths[x];
+        }
+        return LAW_ERR_OK;
+}
+
+const law_hrt_param_t *law_hrt_param(
+        const law_hrt_match_t *match,
+        const char *name)
+{
+        for(size_t x = 0; x < match->params; ++x)
+                if(!strcmp(match->param[x].name, name))
+                        return &match->param[x];
+        return NULL;
+}
+
+/** Count without a locked add: only the worker itself writes its slots. */
+static void law_hrt_bump(atomic_uint_fast64_t *counter)
+{
+        atomic_store_explicit(counter,
+                atomic_load_explicit(counter, memory_order_relaxed) + 1,
+                memory_order_relaxed);
+}
+
+/** Respond with an empty body, listing the methods the path takes. */
+static sel_err_t law_hrt_reply(
+        law_hts_req_t *req,
+        const int status,
+        const unsigned allow)
+{
+        SEL_TRY_QUIETLY(law_hts_put_status(req, status));
+        SEL_TRY_QUIETLY(law_hts_put_date(req));
+        if(status == 405) {
+                char list[80] = "";
+                size_t length = 0;
+                for(size_t m = 0; m < LAW_HRT_NMETHODS; ++m) {
+                        if(!(allow & LAW_HRT_METHODS[m].bit)) continue;
+                        length += (size_t)snprintf(list + length,
+                                sizeof(list) - length, "%s%s",
+                                length ? ", " : "", LAW_HRT_METHODS[m].name);
+                }
+                SEL_TRY_QUIETLY(law_hts_add_header(req, "Allow", list));
+        }
+        SEL_TRY_QUIETLY(law_hts_put_length(req, 0));
+        return law_hts_begin_body(req);
+}
+
+sel_err_t law_hrt_accept(
+        law_worker_t *worker,
+        law_hts_req_t *req,
+        law_hts_reqline_t *reqline,
+        law_htheaders_t *headers,
+        law_data_t data)
+{
+        law_hrt_t *hrt = data.ptr;
+        const int id = worker ? law_get_worker_id(worker) : 0;
+        law_hrt_slot_t *slots = hrt->slots[id % hrt->workers];
+
+        law_hrt_match_t match;
+        switch(law_hrt_match(hrt, reqline->method, reqline->target.path,
+                &match))
+        {
+                case LAW_ERR_OK:
+                        break;
+                case LAW_ERR_MODE:
+                        law_hrt_bump(&slots[hrt->count + 1].hits);
+                        return law_hrt_reply(req, 405, match.allow);
+                default:
+                        law_hrt_bump(&slots[hrt->count].hits);
+                        return law_hrt_reply(req, 404, 0);
+        }
+
+        law_hrt_route_t *route = &hrt->routes[match.route];
+        law_hrt_slot_t *slot = &slots[match.route];
+        law_hrt_bump(&slot->hits);
+
+        const sel_err_t err = route->handler(
+                worker, req, reqline, headers, &match, route->data);
+        if(err != LAW_ERR_OK) law_hrt_bump(&slot->errors);
+        return err;
+}
+
+law_hrt_counts_t law_hrt_counts(law_hrt_t *hrt, const size_t route)
+{
+        SEL_ASSERT(hrt->slots && route < hrt->count);
+
+        law_hrt_counts_t counts = { 0, 0 };
+        for(int w = 0; w < hrt->workers; ++w) {
+                law_hrt_slot_t *slot = &hrt->slots[w][route];
+                counts.hits += atomic_load_explicit(
+                        &slot->hits, memory_order_relaxed);
+                counts.errors += atomic_load_explicit(
+                        &slot->errors, memory_order_relaxed);
+        }
+        return counts;
+}
+
+uint64_t law_hrt_misses(law_hrt_t *hrt, const int status)
+{
+        SEL_ASSERT(hrt->slots && (status == 404 || status == 405));
+
+        const size_t at = hrt->count + (status == 405);
+        uint64_t misses = 0;
+        for(int w = 0; w < hrt->workers; ++w)
+                misses += atomic_load_explicit(
+                        &hrt->slots[w][at].hits, memory_order_relaxed);
+        return misses;
+}
@@ -0,0 +1,416 @@
+
+#include "lawd/http_scan.h"
+#include "lawd/private/http_headers.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LAW_HSC_X86 1
+#include <immintrin.h>
+#endif
+
+/** Find the first byte in [p, end) that fails the span's class. */
+typedef const char *(*law_hsc_span_t)(const char *p, const char *end);
+
+typedef struct law_hsc_impl {
+        law_hsc_span_t target;                  /** Request Target: VCHAR */
+        law_hsc_span_t value;                   /** Field Value */
+} law_hsc_impl_t;
+
+static bool law_hsc_digit(const char c)
+{
+        return '0' <= c && c <= '9';
+}
+
+static bool law_hsc_alpha(const char c)
+{
+        return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+}
+
+/* tchar, for bytes below 0x80; the rest of the table is zero. */
+static const bool LAW_HSC_TCHAR[256] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+        0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0,
+};
+
+static bool law_hsc_tchar(const char c)
+{
+        return LAW_HSC_TCHAR[(unsigned char)c];
+}
+
+static const char *law_hsc_target_scalar(const char *p, const char *end)
+{
+        for(; p < end; ++p) {
+                const unsigned char c = (unsigned char)*p;
+                if(c <= 0x20 || c >= 0x7F) break;
+        }
+        return p;
+}
+
+/* HTAB, SP, VCHAR and obs-text. */
+static const char *law_hsc_value_scalar(const char *p, const char *end)
+{
+        for(; p < end; ++p) {
+                const unsigned char c = (unsigned char)*p;
+                if(c < 0x20 ? c != '\t' : c == 0x7F) break;
+        }
+        return p;
+}
+
+#ifdef LAW_HSC_X86
+
+/* PCMPESTRI in ranges mode stops at the first byte inside any of the
+ * (low, high) pairs, so the ranges list the bytes a span rejects. */
+
+__attribute__((target("sse4.2")))
+static const char *law_hsc_ranges_sse42(
+        const char *p,
+        const char *end,
+        const unsigned char *ranges,
+        const int count)
+{
+        const __m128i r = _mm_loadu_si128((const __m128i*)ranges);
+
+        while(end - p >= 16) {
+                const __m128i b = _mm_loadu_si128((const __m128i*)p);
+                const int i = _mm_cmpestri(r, count, b, 16,
+                        _SIDD_UBYTE_OPS |
+                        _SIDD_CMP_RANGES |
+                        _SIDD_LEAST_SIGNIFICANT);
+                if(i != 16) return p + i;
+                p += 16;
+        }
+
+        return p;
+}
+
+__attribute__((target("sse4.2")))
+static const char *law_hsc_target_sse42(const char *p, const char *end)
+{
+        static const unsigned char ranges[16] = {
+                0x00, 0x20, 0x7F, 0xFF };
+        p = law_hsc_ranges_sse42(p, end, ranges, 4);
+        return law_hsc_target_scalar(p, end);
+}
+
+__attribute__((target("sse4.2")))
+static const char *law_hsc_value_sse42(const char *p, const char *end)
+{
+        static const unsigned char ranges[16] = {
+                0x00, 0x08, 0x0A, 0x1F, 0x7F, 0x7F };
+        p = law_hsc_ranges_sse42(p, end, ranges, 6);
+        return law_hsc_value_scalar(p, end);
+}
+
+/* AVX2 only has signed byte compares, which put obs-text below zero. */
+
+__attribute__((target("avx2")))
+static const char *law_hsc_target_avx2(const char *p, const char *end)
+{
+        const __m256i
+                sp = _mm256_set1_epi8(0x20),
+                del = _mm256_set1_epi8(0x7F);
+
+        while(end - p >= 32) {
+                const __m256i b = _mm256_loadu_si256((const __m256i*)p);
+                const __m256i ok = _mm256_and_si256(
+                        _mm256_cmpgt_epi8(b, sp),
+                        _mm256_cmpgt_epi8(del, b));
+                const uint32_t bad =
+                        ~(uint32_t)_mm256_movemask_epi8(ok);
+                if(bad) return p + __builtin_ctz(bad);
+                p += 32;
+        }
+
+        return law_hsc_target_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *law_hsc_value_avx2(const char *p, const char *end)
+{
+        const __m256i
+                zero = _mm256_setzero_si256(),
+                sp = _mm256_set1_epi8(0x20),
+                tab = _mm256_set1_epi8(0x09),
+                del = _mm256_set1_epi8(0x7F);
+
+        while(end - p >= 32) {
+                const __m256i b = _mm256_loadu_si256((const __m256i*)p);
+                __m256i bad = _mm256_andnot_si256(
+                        _mm256_cmpgt_epi8(zero, b),
+                        _mm256_cmpgt_epi8(sp, b));
+                bad = _mm256_andnot_si256(_mm256_cmpeq_epi8(b, tab), bad);
+                bad = _mm256_or_si256(bad, _mm256_cmpeq_epi8(b, del));
+                const uint32_t mask = (uint32_t)_mm256_movemask_epi8(bad);
+                if(mask) return p + __builtin_ctz(mask);
+                p += 32;
+        }
+
+        return law_hsc_value_scalar(p, end);
+}
+
+#endif
+
+static const law_hsc_impl_t LAW_HSC_IMPLS[] = {
+        [LAW_HSC_SCALAR] = { law_hsc_target_scalar, law_hsc_value_scalar },
+#ifdef LAW_HSC_X86
+        [LAW_HSC_SSE42] = { law_hsc_target_sse42, law_hsc_value_sse42 },
+        [LAW_HSC_AVX2] = { law_hsc_target_avx2, law_hsc_value_avx2 },
+#endif
+};
+
+static atomic_int law_hsc_isa = LAW_HSC_AUTO;
+
+static bool law_hsc_supports(const int isa)
+{
+        switch(isa) {
+                case LAW_HSC_SCALAR:
+                        return true;
+#ifdef LAW_HSC_X86
+                case LAW_HSC_SSE42:
+                        return __builtin_cpu_supports("sse4.2");
+                case LAW_HSC_AVX2:
+                        return __builtin_cpu_supports("avx2");
+#endif
+                default:
+                        return false;
+        }
+}
+
+int law_hsc_get_isa()
+{
+        int isa = atomic_load_explicit(&law_hsc_isa, memory_order_relaxed);
+        if(isa != LAW_HSC_AUTO) return isa;
+
+        isa = LAW_HSC_AVX2;
+        while(!law_hsc_supports(isa)) --isa;
+
+        atomic_store_explicit(&law_hsc_isa, isa, memory_order_relaxed);
+        return isa;
+}
+
+sel_err_t law_hsc_set_isa(const int isa)
+{
+        if(isa != LAW_HSC_AUTO && !law_hsc_supports(isa))
+                return LAW_ERR_PUSH(LAW_ERR_MODE, "law_hsc_supports");
+        atomic_store_explicit(&law_hsc_isa, isa, memory_order_relaxed);
+        return LAW_ERR_OK;
+}
+
+static char *law_hsc_dup(
+        struct pgc_stk *heap,
+        const char *text,
+        const size_t length)
+{
+        char *copy = pgc_stk_push(heap, length + 1);
+        if(!copy) return NULL;
+        (void)memcpy(copy, text, length);
+        copy[length] = '\0';
+        return copy;
+}
+
+/** Split host[:port] into copies, since the text after it is still used. */
+static sel_err_t law_hsc_authority(
+        const char *p,
+        const char *end,
+        struct pgc_stk *heap,
+        law_uri_t *uri)
+{
+        const char *colon = NULL;
+
+        if(p < end && *p == '[') {
+                const char *close = memchr(p, ']', (size_t)(end - p));
+                if(!close) return LAW_ERR_PUSH(LAW_ERR_SYN, "ip_literal");
+                if(close + 1 < end) colon = close + 1;
+        } else {
+                colon = memchr(p, ':', (size_t)(end - p));
+        }
+
+        const char *host_end = colon ? colon : end;
+        if(host_end == p) return LAW_ERR_PUSH(LAW_ERR_SYN, "host");
+
+        if(colon) {
+                if(*colon != ':') return LAW_ERR_PUSH(LAW_ERR_SYN, "port");
+                for(const char *d = colon + 1; d < end; ++d)
+                        if(!law_hsc_digit(*d))
+                                return LAW_ERR_PUSH(LAW_ERR_SYN, "port");
+                uri->port = law_hsc_dup(heap, colon + 1,
+                        (size_t)(end - colon - 1));
+                if(!uri->port) return LAW_ERR_PUSH(LAW_ERR_OOM, "port");
+        }
+
+        uri->host = law_hsc_dup(heap, p, (size_t)(host_end - p));
+        if(!uri->host) return LAW_ERR_PUSH(LAW_ERR_OOM, "host");
+
+        return LAW_ERR_OK;
+}
+
+/** Split the NUL terminated request target in place. */
+static sel_err_t law_hsc_target(
+        char *p,
+        char *end,
+        struct pgc_stk *heap,
+        law_uri_t *uri)
+{
+        (void)memset(uri, 0, sizeof(law_uri_t));
+
+        if(*p != '/') {
+                char *s = p;
+                while(  s < end &&
+                        (law_hsc_alpha(*s) || law_hsc_digit(*s) ||
+                         *s == '+' || *s == '-' || *s == '.'))
+                        ++s;
+
+                /* authority-form (and asterisk-form) */
+                if(     s == p || !law_hsc_alpha(*p) || end - s < 3 ||
+                        memcmp(s, "://", 3))
+                        return law_hsc_authority(p, end, heap, uri);
+
+                /* absolute-form */
+                char *authority = s + 3;
+                *s = '\0';
+                uri->scheme = p;
+
+                p = authority;
+                while(p < end && *p != '/' && *p != '?') ++p;
+
+                sel_err_t err = law_hsc_authority(authority, p, heap, uri);
+                if(err != LAW_ERR_OK) return err;
+
+                if(p == end) return LAW_ERR_OK;
+        }
+
+        char *query = memchr(p, '?', (size_t)(end - p));
+        if(query) {
+                *query = '\0';
+                uri->query = query + 1;
+        }
+
+        if(*p) uri->path = p;
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hsc_reqline(
+        char *text,
+        const size_t length,
+        struct pgc_stk *heap,
+        law_hts_reqline_t *reqline)
+{
+        const law_hsc_impl_t *impl = &LAW_HSC_IMPLS[law_hsc_get_isa()];
+
+        (void)memset(reqline, 0, sizeof(law_hts_reqline_t));
+
+        if(length < 2 || memcmp(text + length - 2, "\r\n", 2))
+                return LAW_ERR_PUSH(LAW_ERR_SYN, "crlf");
+
+        char *p = text, *end = text + length - 2;
+
+        char *method = p;
+        while(p < end && law_hsc_tchar(*p)) ++p;
+        if(p == method || p == end || *p != ' ')
+                return LAW_ERR_PUSH(LAW_ERR_SYN, "method");
+        *p++ = '\0';
+
+        char *target = p;
+        p = (char*)impl->target(p, end);
+        if(p == target || p == end || *p != ' ')
+                return LAW_ERR_PUSH(LAW_ERR_SYN, "request_target");
+        char *target_end = p;
+        *p++ = '\0';
+
+        if(     end - p != 8 || memcmp(p, "HTTP/", 5) ||
+                !law_hsc_digit(p[5]) || p[6] != '.' || !law_hsc_digit(p[7]))
+                return LAW_ERR_PUSH(LAW_ERR_SYN, "version");
+        *end = '\0';
+
+        reqline->method = method;
+        reqline->version = p;
+
+        return law_hsc_target(target, target_end, heap, &reqline->target);
+}
+
+sel_err_t law_hsc_headers(
+        char *text,
+        const size_t length,
+        struct pgc_stk *heap,
+        law_htheaders_t *headers)
+{
+        const law_hsc_impl_t *impl = &LAW_HSC_IMPLS[law_hsc_get_isa()];
+
+        (void)memset(headers, 0, sizeof(law_htheaders_t));
+
+        if(length > UINT32_MAX)
+                return LAW_ERR_PUSH(LAW_ERR_OOB, "length");
+
+        char *p = text, *end = text + length;
+
+        /* Every field ends with a line feed, so they bound the table. */
+        size_t lines = 0;
+        for(const char *n = p; (n = memchr(n, '\n', (size_t)(end - n))); ++n)
+                ++lines;
+
+        struct law_htfield *fields = NULL;
+        if(lines) {
+                fields = pgc_stk_push(
+                        heap,
+                        lines * sizeof(struct law_htfield));
+                if(!fields) return LAW_ERR_PUSH(LAW_ERR_OOM, "fields");
+        }
+
+        size_t count = 0;
+
+        for(;;) {
+                if(end - p < 2)
+                        return LAW_ERR_PUSH(LAW_ERR_SYN, "crlf");
+
+                if(p[0] == '\r' && p[1] == '\n') {
+                        if(p + 2 != end)
+                                return LAW_ERR_PUSH(LAW_ERR_SYN, "trailing");
+                        break;
+                }
+
+                char *name = p;
+                while(p < end && law_hsc_tchar(*p)) ++p;
+                if(p == name || p == end || *p != ':')
+                        return LAW_ERR_PUSH(LAW_ERR_SYN, "field_name");
+                const size_t name_len = (size_t)(p - name);
+                *p++ = '\0';
+
+                while(p < end && (*p == ' ' || *p == '\t')) ++p;
+
+                char *value = p;
+                p = (char*)impl->value(p, end);
+                if(end - p < 2 || p[0] != '\r' || p[1] != '\n')
+                        return LAW_ERR_PUSH(LAW_ERR_SYN, "field_value");
+
+                char *value_end = p;
+                while(  value_end > value &&
+                        (value_end[-1] == ' ' || value_end[-1] == '\t'))
+                        --value_end;
+                *value_end = '\0';
+
+                fields[count++] = (struct law_htfield) {
+                        .name = (uint32_t)(name - text),
+                        .name_len = (uint32_t)name_len,
+                        .value = (uint32_t)(value - text),
+                        .value_len = (uint32_t)(value_end - value) };
+
+                p += 2;
+        }
+
+        headers->base = text;
+        headers->fields = fields;
+        headers->count = count;
+        law_hth_index(headers);
+
+        return LAW_ERR_OK;
+}
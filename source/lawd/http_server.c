@@ -1,12 +1,60 @@
 
 #include "lawd/private/http_server.h"
 #include "lawd/private/http_headers.h"
+#include "lawd/http_scan.h"
 #include "pubmt/linked_list.h"
 #include "pgenc/lang.h"
 #include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <openssl/err.h>
 #include <unistd.h>
 
+/* Status codes and their reason phrases (RFC 2616 section 10). */
+#define LAW_HTS_STATUSES(X) \
+        X(100, "Continue") \
+        X(101, "Switching Protocols") \
+        X(200, "OK") \
+        X(201, "Created") \
+        X(202, "Accepted") \
+        X(203, "Non-Authoritative Information") \
+        X(204, "No Content") \
+        X(205, "Reset Content") \
+        X(206, "Partial Content") \
+        X(300, "Multiple Choices") \
+        X(301, "Moved Permanently") \
+        X(302, "Found") \
+        X(303, "See Other") \
+        X(304, "Not Modified") \
+        X(305, "Use Proxy") \
+        X(307, "Temporary Redirect") \
+        X(400, "Bad Request") \
+        X(401, "Unauthorized") \
+        X(402, "Payment Required") \
+        X(403, "Forbidden") \
+        X(404, "Not Found") \
+        X(405, "Method Not Allowed") \
+        X(406, "Not Acceptable") \
+        X(407, "Proxy Authentication Required") \
+        X(408, "Request Timeout") \
+        X(409, "Conflict") \
+        X(410, "Gone") \
+        X(411, "Length Required") \
+        X(412, "Precondition Failed") \
+        X(413, "Request Entity Too Large") \
+        X(414, "Request-URI Too Long") \
+        X(415, "Unsupported Media Type") \
+        X(416, "Requested Range Not Satisfiable") \
+        X(417, "Expectation Failed") \
+        X(500, "Internal Server Error") \
+        X(501, "Not Implemented") \
+        X(502, "Bad Gateway") \
+        X(503, "Service Unavailable") \
+        X(504, "Gateway Timeout") \
+        X(505, "HTTP Version Not Supported")
+
 extern const struct pgc_par law_htp_request_line;
 
 extern const struct pgc_par law_htp_headers;
@@ -26,6 +74,16 @@ struct pgc_stk *law_hts_get_heap(law_hts_req_t *request)
         return request->heap;
 }
 
+bool law_hts_get_keep_alive(law_hts_req_t *request)
+{
+        return request->keep_alive;
+}
+
+void law_hts_set_keep_alive(law_hts_req_t *request, bool keep_alive)
+{
+        request->keep_alive = keep_alive && request->persistent;
+}
+
 int law_hts_get_security(law_htserver_t *server)
 {
         return server->cfg.security;
@@ -37,40 +95,68 @@ typedef struct law_hts_read_args {
         size_t base;
 } law_hts_read_args_t;
 
-static sel_err_t law_hts_read_scan_parse(
+static sel_err_t law_hts_read_scan(
         law_hts_req_t *req,
         const size_t base,
         void *delim,
-        const size_t dlen,
-        const struct pgc_par *parser,
-        struct pgc_ast_lst **list)
+        const size_t dlen)
 {
         SEL_ASSERT(req);
 
         struct pgc_buf *in = req->conn.in;
-        struct pgc_stk 
-                *stack = req->stack,
-                *heap = req->heap;
         const size_t max = pgc_buf_max(in);
 
-        SEL_ASSERT(in && stack && heap && base <= pgc_buf_end(in));
+        SEL_ASSERT(in && req->stack && req->heap && base <= pgc_buf_end(in));
 
         (void)law_err_clear();
         
         if(pgc_buf_end(in) - base > max) 
                 return LAW_ERR_PUSH(LAW_ERR_OOB, "early_out_check");
 
-        sel_err_t err = law_htc_read_scan(&req->conn, base, delim, dlen);
+        /* Retries after WANTR only search the bytes that came in since. */
+        law_htc_scan_t *scan = &req->scan;
+        if(     scan->base != base || 
+                scan->mark < base || 
+                scan->mark > base + max) 
+        {
+                scan->base = base;
+                scan->mark = base;
+        }
+
+        sel_err_t err = law_htc_read_scan_ex(&req->conn, scan, delim, dlen);
 
         switch(err) {
-                case LAW_ERR_OK:
-                        break;
                 case LAW_ERR_WANTR:
                 case LAW_ERR_WANTW:
                         return err;
                 default:
-                        return LAW_ERR_PUSH(err, "law_htc_read_scan");
+                        break;
         }
+
+        /* Finished, so the next scan from the same base starts over. */
+        scan->mark = SIZE_MAX;
+
+        if(err != LAW_ERR_OK) 
+                return LAW_ERR_PUSH(err, "law_htc_read_scan_ex");
+
+        return LAW_ERR_OK;
+}
+
+static sel_err_t law_hts_read_scan_parse(
+        law_hts_req_t *req,
+        const size_t base,
+        void *delim,
+        const size_t dlen,
+        const struct pgc_par *parser,
+        struct pgc_ast_lst **list)
+{
+        struct pgc_buf *in = req->conn.in;
+        struct pgc_stk 
+                *stack = req->stack,
+                *heap = req->heap;
+
+        sel_err_t err = law_hts_read_scan(req, base, delim, dlen);
+        if(err != LAW_ERR_OK) return err;
         
         const size_t end = pgc_buf_tell(in);
 
@@ -102,6 +188,38 @@ static sel_err_t law_hts_read_scan_parse(
         return LAW_ERR_OK;
 }
 
+/** 
+ * Scan for the delimiter and copy the head out of the ring buffer onto the
+ * heap, so the scanner sees it in one piece.
+ */
+static sel_err_t law_hts_read_scan_copy(
+        law_hts_req_t *req,
+        const size_t base,
+        void *delim,
+        const size_t dlen,
+        char **text,
+        size_t *length)
+{
+        struct pgc_buf *in = req->conn.in;
+
+        sel_err_t err = law_hts_read_scan(req, base, delim, dlen);
+        if(err != LAW_ERR_OK) return err;
+
+        const size_t end = pgc_buf_tell(in);
+
+        *length = end - base;
+        *text = pgc_stk_push(req->heap, *length + 1);
+        if(!*text) 
+                return LAW_ERR_PUSH(LAW_ERR_OOM, "pgc_stk_push");
+
+        SEL_TEST(pgc_buf_seek(in, base) == LAW_ERR_OK);
+        SEL_TEST(pgc_buf_get(in, *text, *length) == LAW_ERR_OK);
+        SEL_TEST(pgc_buf_seek(in, end) == LAW_ERR_OK);
+        (*text)[*length] = '\0';
+
+        return LAW_ERR_OK;
+}
+
 sel_err_t law_hts_read_reqline(
         law_hts_req_t *req,
         law_hts_reqline_t *reqline,
@@ -111,6 +229,15 @@ sel_err_t law_hts_read_reqline(
 
         SEL_ASSERT(reqline);
 
+        if(req->parser == LAW_HTS_SCAN) {
+                char *text = NULL;
+                size_t length = 0;
+                sel_err_t err = law_hts_read_scan_copy(
+                        req, base, CRLF, 2, &text, &length);
+                if(err != LAW_ERR_OK) return err;
+                return law_hsc_reqline(text, length, req->heap, reqline);
+        }
+
         struct pgc_ast_lst *list = NULL;
 
         sel_err_t err = law_hts_read_scan_parse(
@@ -171,6 +298,15 @@ sel_err_t law_hts_read_headers(
 
         (void)memset(headers, 0, sizeof(law_htheaders_t));
 
+        if(req->parser == LAW_HTS_SCAN) {
+                char *text = NULL;
+                size_t length = 0;
+                sel_err_t err = law_hts_read_scan_copy(
+                        req, base, CRLF2, 4, &text, &length);
+                if(err != LAW_ERR_OK) return err;
+                return law_hsc_headers(text, length, req->heap, headers);
+        }
+
         sel_err_t err = law_hts_read_scan_parse(
                 req,
                 base,
@@ -208,18 +344,80 @@ sel_err_t law_hts_read_headers_sync(
                 &args);
 }
 
+/** Write the decimal digits of n, returning their count. */
+static size_t law_hts_utoa(char *str, size_t n)
+{
+        char digits[24];
+        size_t length = 0;
+        do {
+                digits[length++] = (char)('0' + n % 10);
+                n /= 10;
+        } while(n);
+        for(size_t i = 0; i < length; ++i)
+                str[i] = digits[length - i - 1];
+        return length;
+}
+
+/** Write the hex digits of n, returning their count. */
+static size_t law_hts_xtoa(char *str, size_t n)
+{
+        static const char HEX[] = "0123456789abcdef";
+        char digits[24];
+        size_t length = 0;
+        do {
+                digits[length++] = HEX[n & 0xF];
+                n >>= 4;
+        } while(n);
+        for(size_t i = 0; i < length; ++i)
+                str[i] = digits[length - i - 1];
+        return length;
+}
+
+static sel_err_t law_hts_put_str(law_hts_req_t *req, const char *str)
+{
+        return pgc_buf_put(req->conn.out, str, strlen(str));
+}
+
+/** 
+ * Check that a whole line of length bytes fits before any of it is put, 
+ * so a failed line leaves no fragment in the head.
+ */
+static sel_err_t law_hts_line_fits(law_hts_req_t *req, const size_t length)
+{
+        struct pgc_buf *out = req->conn.out;
+        const size_t used = pgc_buf_end(out) - pgc_buf_tell(out);
+        return used + length <= pgc_buf_max(out) ? LAW_ERR_OK : LAW_ERR_OOB;
+}
+
+/** Statuses that never have a body are framed by the head alone. */
+static void law_hts_status_framed(law_hts_req_t *req, const int status)
+{
+        if((100 <= status && status < 200) || status == 204 || status == 304)
+                req->framed = true;
+}
+
 sel_err_t law_hts_set_status(
         law_hts_req_t *req,
         const char *version,
         const int status,
         const char *reason)
 {
-        return pgc_buf_printf(
-                req->conn.out, 
-                "%s %i %s\r\n", 
-                version,
-                status,
-                reason);
+        char code[24] = " ";
+        size_t length = 1;
+        if(status < 0) code[length++] = '-';
+        length += law_hts_utoa(code + length, 
+                status < 0 ? (size_t)-(long)status : (size_t)status);
+        code[length++] = ' ';
+
+        SEL_TRY_QUIETLY(law_hts_line_fits(
+                req, 
+                strlen(version) + length + strlen(reason) + 2));
+        SEL_TRY_QUIETLY(law_hts_put_str(req, version));
+        SEL_TRY_QUIETLY(pgc_buf_put(req->conn.out, code, length));
+        SEL_TRY_QUIETLY(law_hts_put_str(req, reason));
+        SEL_TRY_QUIETLY(pgc_buf_put(req->conn.out, "\r\n", 2));
+        law_hts_status_framed(req, status);
+        return LAW_ERR_OK;
 }
 
 sel_err_t law_hts_add_header(
@@ -227,18 +425,716 @@ sel_err_t law_hts_add_header(
         const char *name,
         const char *value)
 {
-        return pgc_buf_printf(
+        SEL_TRY_QUIETLY(law_hts_line_fits(
+                req, 
+                strlen(name) + 2 + strlen(value) + 2));
+        SEL_TRY_QUIETLY(law_hts_put_str(req, name));
+        SEL_TRY_QUIETLY(pgc_buf_put(req->conn.out, ": ", 2));
+        SEL_TRY_QUIETLY(law_hts_put_str(req, value));
+        SEL_TRY_QUIETLY(pgc_buf_put(req->conn.out, "\r\n", 2));
+        if(law_hth_classify(name, strlen(name)) == LAW_HTH_CONTENT_LENGTH) 
+                req->framed = true;
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hts_put_status(law_hts_req_t *req, const int status)
+{
+        law_hts_status_framed(req, status);
+
+        switch(status) {
+                #define LAW_HTS_LINE(CODE, REASON) \
+                        case CODE: return pgc_buf_put( \
+                                req->conn.out, \
+                                "HTTP/1.1 " #CODE " " REASON "\r\n", \
+                                sizeof("HTTP/1.1 " #CODE " " REASON "\r\n") \
+                                        - 1);
+                LAW_HTS_STATUSES(LAW_HTS_LINE)
+                #undef LAW_HTS_LINE
+                default: return law_hts_set_status(
+                        req,
+                        "HTTP/1.1",
+                        status,
+                        "Unknown Status Code");
+        }
+}
+
+static const struct {
+        const char *prefix;
+        size_t length;
+} LAW_HTS_HEADER_PREFIXES[LAW_HTS_HEADERS] = {
+        [LAW_HTS_CONTENT_LENGTH]        = { "Content-Length: ", 16 },
+        [LAW_HTS_CONTENT_TYPE]          = { "Content-Type: ", 14 },
+        [LAW_HTS_CONNECTION]            = { "Connection: ", 12 },
+        [LAW_HTS_DATE]                  = { "Date: ", 6 },
+        [LAW_HTS_SERVER]                = { "Server: ", 8 },
+        [LAW_HTS_CACHE_CONTROL]         = { "Cache-Control: ", 15 },
+        [LAW_HTS_LOCATION]              = { "Location: ", 10 },
+        [LAW_HTS_TRANSFER_ENCODING]     = { "Transfer-Encoding: ", 19 },
+        [LAW_HTS_KEEP_ALIVE]            = { "Keep-Alive: ", 12 },
+        [LAW_HTS_UPGRADE]               = { "Upgrade: ", 9 },
+        [LAW_HTS_RETRY_AFTER]           = { "Retry-After: ", 13 },
+        [LAW_HTS_SEC_WEBSOCKET_ACCEPT]  = { "Sec-WebSocket-Accept: ", 22 },
+        [LAW_HTS_CONTENT_ENCODING]      = { "Content-Encoding: ", 18 },
+        [LAW_HTS_VARY]                  = { "Vary: ", 6 },
+};
+
+sel_err_t law_hts_put_header(
+        law_hts_req_t *req,
+        const int header,
+        const char *value)
+{
+        SEL_ASSERT(0 <= header && header < LAW_HTS_HEADERS);
+        SEL_TRY_QUIETLY(law_hts_line_fits(
+                req, 
+                LAW_HTS_HEADER_PREFIXES[header].length + strlen(value) + 2));
+        SEL_TRY_QUIETLY(pgc_buf_put(
                 req->conn.out,
-                "%s: %s\r\n",
-                name,
-                value);
+                LAW_HTS_HEADER_PREFIXES[header].prefix,
+                LAW_HTS_HEADER_PREFIXES[header].length));
+        SEL_TRY_QUIETLY(law_hts_put_str(req, value));
+        SEL_TRY_QUIETLY(pgc_buf_put(req->conn.out, "\r\n", 2));
+        if(header == LAW_HTS_CONTENT_LENGTH) 
+                req->framed = true;
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hts_put_length(law_hts_req_t *req, const size_t length)
+{
+        char line[48] = "Content-Length: ";
+        size_t n = 16;
+        n += law_hts_utoa(line + n, length);
+        line[n++] = '\r';
+        line[n++] = '\n';
+        SEL_TRY_QUIETLY(pgc_buf_put(req->conn.out, line, n));
+        req->framed = true;
+        return LAW_ERR_OK;
+}
+
+/** Write two decimal digits. */
+static char *law_hts_put2(char *c, const int n)
+{
+        *c++ = (char)('0' + n / 10 % 10);
+        *c++ = (char)('0' + n % 10);
+        return c;
+}
+
+void law_hts_format_date(char *line, const time_t t)
+{
+        static const char DAYS[] = "ThuFriSatSunMonTueWed";
+        static const char MONTHS[] = "MarAprMayJunJulAugSepOctNovDecJanFeb";
+
+        long long days = (long long)t / 86400;
+        long long secs = (long long)t % 86400;
+        if(secs < 0) {
+                secs += 86400;
+                days -= 1;
+        }
+
+        /* Civil date from the day count, with years starting in March so
+         * the leap day comes last (H. Hinnant, "chrono-Compatible Low-Level
+         * Date Algorithms"). */
+        const long long z = days + 719468;
+        const long long era = (z >= 0 ? z : z - 146096) / 146097;
+        const long long doe = z - era * 146097;
+        const long long yoe =
+                (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const long long mp = (5 * doy + 2) / 153;
+        const int mday = (int)(doy - (153 * mp + 2) / 5 + 1);
+        const int year = (int)(yoe + era * 400 + (mp >= 10));
+        const long long wday = (days % 7 + 7) % 7;
+
+        char *c = line;
+        (void)memcpy(c, "Date: ", 6);
+        (void)memcpy(c + 6, DAYS + wday * 3, 3);
+        (void)memcpy(c + 9, ", ", 2);
+        c = law_hts_put2(c + 11, mday);
+        *c++ = ' ';
+        (void)memcpy(c, MONTHS + mp * 3, 3);
+        c[3] = ' ';
+        c = law_hts_put2(c + 4, year / 100);
+        c = law_hts_put2(c, year);
+        *c++ = ' ';
+        c = law_hts_put2(c, (int)(secs / 3600));
+        *c++ = ':';
+        c = law_hts_put2(c, (int)(secs / 60 % 60));
+        *c++ = ':';
+        c = law_hts_put2(c, (int)(secs % 60));
+        (void)memcpy(c, " GMT\r\n", 6);
+}
+
+sel_err_t law_hts_put_date(law_hts_req_t *req)
+{
+        const time_t now = time(NULL);
+        law_hts_pool_group_t *grp = req->group;
+
+        if(!grp) {
+                char line[LAW_HTS_DATE_LEN];
+                law_hts_format_date(line, now);
+                return pgc_buf_put(req->conn.out, line, LAW_HTS_DATE_LEN);
+        }
+
+        /* The group belongs to one worker, so its line needs no lock. */
+        if(!grp->date[0] || grp->date_time != now) {
+                law_hts_format_date(grp->date, now);
+                grp->date_time = now;
+        }
+        return pgc_buf_put(req->conn.out, grp->date, LAW_HTS_DATE_LEN);
 }
 
 sel_err_t law_hts_begin_body(law_hts_req_t *req)
 {
+        /* Only the connection closing can end an unframed body. */
+        if(!req->framed && req->keep_alive) {
+                SEL_TRY_QUIETLY(law_hts_line_fits(req, 21));
+                SEL_TRY_QUIETLY(pgc_buf_put(
+                        req->conn.out, 
+                        "Connection: close\r\n\r\n", 
+                        21));
+                req->keep_alive = false;
+                return LAW_ERR_OK;
+        }
         return pgc_buf_put(req->conn.out, "\r\n", 2);
 }
 
+/** Fail the body: the rest of the stream cannot be framed, so close. */
+static sel_err_t law_hts_body_fail(law_hts_req_t *req, const sel_err_t err)
+{
+        req->body.state = LAW_HTS_BODY_ERROR;
+        req->body.error = err;
+        req->keep_alive = false;
+        return err;
+}
+
+/** Read more input, turning an empty read into LAW_ERR_WANTR. */
+static sel_err_t law_hts_body_fill(law_hts_req_t *req)
+{
+        const intptr_t result = law_htc_read_data(&req->conn);
+        if(result > 0) return LAW_ERR_OK;
+        if(result == LAW_ERR_OK) return LAW_ERR_WANTR;
+        return (sel_err_t)result;
+}
+
+/** 
+ * Wait for a whole CRLF terminated line at the input offset and return its
+ * length including the CRLF.  The offset is left at the start of the line.
+ */
+static sel_err_t law_hts_body_line(law_hts_req_t *req, size_t *length)
+{
+        struct pgc_buf *in = req->conn.in;
+        const size_t base = pgc_buf_tell(in);
+
+        for(;;) {
+                if(pgc_buf_scan(in, "\r\n", 2) == LAW_ERR_OK) {
+                        *length = pgc_buf_tell(in) - base;
+                        SEL_TEST(pgc_buf_seek(in, base) == LAW_ERR_OK);
+                        if(*length > LAW_HTS_BODY_LINE) 
+                                return LAW_ERR_SYN;
+                        return LAW_ERR_OK;
+                }
+                SEL_TEST(pgc_buf_seek(in, base) == LAW_ERR_OK);
+
+                if(pgc_buf_end(in) - base >= LAW_HTS_BODY_LINE) 
+                        return LAW_ERR_SYN;
+
+                SEL_TRY_QUIETLY(law_hts_body_fill(req));
+        }
+}
+
+/** Parse "1*HEXDIG [ BWS ; chunk-ext ] CRLF" and skip past it. */
+static sel_err_t law_hts_body_size(law_hts_req_t *req, size_t *size)
+{
+        struct pgc_buf *in = req->conn.in;
+
+        size_t length = 0;
+        SEL_TRY_QUIETLY(law_hts_body_line(req, &length));
+
+        char line[24];
+        const size_t n = length < sizeof(line) ? length : sizeof(line);
+        SEL_TEST(pgc_buf_get(in, line, n) == LAW_ERR_OK);
+        SEL_TEST(pgc_buf_seek(in, pgc_buf_tell(in) - n + length) == 
+                LAW_ERR_OK);
+
+        size_t value = 0, digits = 0;
+        for(; digits < n; ++digits) {
+                const char c = line[digits];
+                int x;
+                if('0' <= c && c <= '9')        x = c - '0';
+                else if('a' <= c && c <= 'f')   x = c - 'a' + 10;
+                else if('A' <= c && c <= 'F')   x = c - 'A' + 10;
+                else break;
+                if(value > (SIZE_MAX >> 4)) return LAW_ERR_SYN;
+                value = (value << 4) | (size_t)x;
+        }
+
+        if(!digits || digits == n) return LAW_ERR_SYN;
+
+        switch(line[digits]) {
+                case '\r': case ';': case ' ': case '\t':
+                        break;
+                default:
+                        return LAW_ERR_SYN;
+        }
+
+        *size = value;
+        return LAW_ERR_OK;
+}
+
+/** Count size more body bytes against the server's max_body. */
+static sel_err_t law_hts_body_limit(law_hts_req_t *req, const size_t size)
+{
+        const size_t max = req->htserver ? req->htserver->cfg.max_body : 0;
+        if(     max && 
+                (size > max || req->body.total > max - size))
+                return LAW_ERR_OOB;
+        req->body.total += size;
+        return LAW_ERR_OK;
+}
+
+typedef struct law_hts_span_args {
+        const void *span;
+        size_t length;
+} law_hts_span_args_t;
+
+static intptr_t law_hts_span_cb(void *bytes, const size_t n, void *state)
+{
+        law_hts_span_args_t *args = state;
+        args->span = bytes;
+        args->length = n;
+        return 0;
+}
+
+/** Take up to max bytes of body data from one contiguous run of input. */
+static sel_err_t law_hts_body_data(
+        law_hts_req_t *req,
+        const size_t max,
+        const void **span,
+        size_t *length)
+{
+        struct pgc_buf *in = req->conn.in;
+
+        if(pgc_buf_end(in) == pgc_buf_tell(in)) 
+                SEL_TRY_QUIETLY(law_hts_body_fill(req));
+
+        law_hts_span_args_t args = { .span = NULL, .length = 0 };
+        const size_t 
+                offset = pgc_buf_tell(in),
+                want = req->body.remaining < max ? req->body.remaining : max;
+
+        (void)pgc_buf_cbwrite(in, want, law_hts_span_cb, &args);
+        SEL_TEST(pgc_buf_seek(in, offset + args.length) == LAW_ERR_OK);
+
+        *span = args.span;
+        *length = args.length;
+        req->body.remaining -= args.length;
+        return LAW_ERR_OK;
+}
+
+/** Decode up to max bytes of the body, or nothing once it is done. */
+static sel_err_t law_hts_body_next(
+        law_hts_req_t *req,
+        const size_t max,
+        const void **span,
+        size_t *length)
+{
+        struct pgc_buf *in = req->conn.in;
+        law_hts_body_t *body = &req->body;
+
+        sel_err_t err = LAW_ERR_OK;
+        size_t size = 0;
+
+        *span = NULL;
+        *length = 0;
+
+        for(;;) switch(body->state) {
+                case LAW_HTS_BODY_DONE:
+                        return LAW_ERR_OK;
+
+                case LAW_HTS_BODY_ERROR:
+                        return body->error;
+
+                case LAW_HTS_BODY_DATA:
+                case LAW_HTS_BODY_CHUNK:
+                        err = law_hts_body_data(req, max, span, length);
+                        if(err != LAW_ERR_OK) goto FAIL;
+                        if(body->remaining) 
+                                return LAW_ERR_OK;
+                        body->state = body->state == LAW_HTS_BODY_DATA ? 
+                                LAW_HTS_BODY_DONE : 
+                                LAW_HTS_BODY_CRLF;
+                        return LAW_ERR_OK;
+
+                case LAW_HTS_BODY_SIZE:
+                        err = law_hts_body_size(req, &size);
+                        if(err != LAW_ERR_OK) goto FAIL;
+                        err = law_hts_body_limit(req, size);
+                        if(err != LAW_ERR_OK) goto FAIL;
+                        body->remaining = size;
+                        body->state = size ? 
+                                LAW_HTS_BODY_CHUNK : 
+                                LAW_HTS_BODY_TRAILER;
+                        break;
+
+                case LAW_HTS_BODY_CRLF:
+                        while(pgc_buf_end(in) - pgc_buf_tell(in) < 2) {
+                                err = law_hts_body_fill(req);
+                                if(err != LAW_ERR_OK) goto FAIL;
+                        }
+                        size = pgc_buf_tell(in);
+                        if(pgc_buf_cmp(in, "\r\n", 2) != LAW_ERR_OK) {
+                                err = LAW_ERR_SYN;
+                                goto FAIL;
+                        }
+                        SEL_TEST(pgc_buf_seek(in, size + 2) == LAW_ERR_OK);
+                        body->state = LAW_HTS_BODY_SIZE;
+                        break;
+
+                case LAW_HTS_BODY_TRAILER:
+                        /* Trailer fields are read past and dropped. */
+                        err = law_hts_body_line(req, &size);
+                        if(err != LAW_ERR_OK) goto FAIL;
+                        SEL_TEST(pgc_buf_seek(in, pgc_buf_tell(in) + size) ==
+                                LAW_ERR_OK);
+                        if(size == 2) 
+                                body->state = LAW_HTS_BODY_DONE;
+                        break;
+
+                default:
+                        return SEL_HALT();
+        }
+
+        FAIL:
+
+        if(err == LAW_ERR_WANTR || err == LAW_ERR_WANTW) 
+                return err;
+
+        return law_hts_body_fail(req, err);
+}
+
+sel_err_t law_hts_body_span(
+        law_hts_req_t *req,
+        const void **span,
+        size_t *length)
+{
+        return law_hts_body_next(req, SIZE_MAX, span, length);
+}
+
+typedef struct law_hts_body_args {
+        law_hts_req_t *req;
+        void *buffer;
+        size_t size;
+        const void **span;
+        size_t *length;
+} law_hts_body_args_t;
+
+static sel_err_t law_hts_body_span_cb(int fd, void *state)
+{
+        law_hts_body_args_t *args = state;
+        return law_hts_body_span(args->req, args->span, args->length);
+}
+
+sel_err_t law_hts_body_span_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        const void **span,
+        size_t *length)
+{
+        law_hts_body_args_t args = {
+                .req = req,
+                .span = span,
+                .length = length };
+        return law_sync(
+                worker, 
+                timeout, 
+                law_hts_body_span_cb, 
+                req->conn.socket, 
+                &args);
+}
+
+sel_err_t law_hts_body_read(
+        law_hts_req_t *req,
+        void *buffer,
+        const size_t size,
+        size_t *length)
+{
+        *length = 0;
+
+        /* Copy what is buffered, and only wait when nothing was copied. */
+        while(*length < size) {
+                const void *span = NULL;
+                size_t n = 0;
+                const sel_err_t err = law_hts_body_next(
+                        req, 
+                        size - *length, 
+                        &span, 
+                        &n);
+                if(err != LAW_ERR_OK) 
+                        return *length && (
+                                err == LAW_ERR_WANTR || 
+                                err == LAW_ERR_WANTW) ? LAW_ERR_OK : err;
+                if(!n) break;
+                (void)memcpy((char*)buffer + *length, span, n);
+                *length += n;
+        }
+
+        return LAW_ERR_OK;
+}
+
+static sel_err_t law_hts_body_read_cb(int fd, void *state)
+{
+        law_hts_body_args_t *args = state;
+        return law_hts_body_read(
+                args->req, 
+                args->buffer, 
+                args->size, 
+                args->length);
+}
+
+sel_err_t law_hts_body_read_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        void *buffer,
+        const size_t size,
+        size_t *length)
+{
+        law_hts_body_args_t args = {
+                .req = req,
+                .buffer = buffer,
+                .size = size,
+                .length = length };
+        return law_sync(
+                worker, 
+                timeout, 
+                law_hts_body_read_cb, 
+                req->conn.socket, 
+                &args);
+}
+
+/** Wait until nbytes of the output buffer are free. */
+static sel_err_t law_hts_stream_room(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        const size_t nbytes)
+{
+        struct pgc_buf *out = req->conn.out;
+        const size_t used = pgc_buf_end(out) - pgc_buf_tell(out);
+        if(pgc_buf_max(out) - used >= nbytes) 
+                return LAW_ERR_OK;
+
+        const sel_err_t err = law_htc_ensure_output_sync(
+                worker, 
+                timeout, 
+                &req->conn, 
+                nbytes);
+        if(err != LAW_ERR_OK) 
+                return LAW_ERR_PUSH(err, "law_htc_ensure_output_sync");
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hts_begin_stream_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        const size_t length)
+{
+        law_hts_stream_t *stream = &req->stream;
+
+        /* Chunks need a few times their framing to carry any data. */
+        if(pgc_buf_max(req->conn.out) < 4 * LAW_HTS_CHUNK_OVERHEAD) 
+                return LAW_ERR_OOB;
+
+        /* Content-Length or Transfer-Encoding, then the empty line. */
+        SEL_TRY_QUIETLY(law_hts_stream_room(worker, timeout, req, 64));
+
+        if(length != LAW_HTS_UNKNOWN_LENGTH) {
+                stream->mode = LAW_HTS_STREAM_LENGTH;
+                stream->remaining = length;
+                SEL_TRY_QUIETLY(law_hts_put_length(req, length));
+        } else if(stream->chunked) {
+                stream->mode = LAW_HTS_STREAM_CHUNKED;
+                SEL_TRY_QUIETLY(law_hts_put_header(
+                        req, 
+                        LAW_HTS_TRANSFER_ENCODING, 
+                        "chunked"));
+                req->framed = true;
+        } else {
+                stream->mode = LAW_HTS_STREAM_CLOSE;
+                req->keep_alive = false;
+                SEL_TRY_QUIETLY(law_hts_put_header(
+                        req, 
+                        LAW_HTS_CONNECTION, 
+                        "close"));
+        }
+
+        return law_hts_begin_body(req);
+}
+
+sel_err_t law_hts_write_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        const void *data,
+        const size_t length)
+{
+        law_hts_stream_t *stream = &req->stream;
+        struct pgc_buf *out = req->conn.out;
+        const uint8_t *bytes = data;
+
+        size_t overhead = 0;
+
+        switch(stream->mode) {
+                case LAW_HTS_STREAM_LENGTH:
+                        if(length > stream->remaining) 
+                                return LAW_ERR_LIMIT;
+                        stream->remaining -= length;
+                        break;
+                case LAW_HTS_STREAM_CHUNKED:
+                        overhead = LAW_HTS_CHUNK_OVERHEAD;
+                        break;
+                case LAW_HTS_STREAM_CLOSE:
+                        break;
+                default:
+                        return LAW_ERR_MODE;
+        }
+
+        const size_t max = pgc_buf_max(out);
+        size_t left = length;
+
+        while(left) {
+                size_t room = max - (pgc_buf_end(out) - pgc_buf_tell(out));
+
+                /* Wait for half the buffer rather than send slivers. */
+                if(room < overhead + left && room < max / 2) {
+                        SEL_TRY_QUIETLY(law_hts_stream_room(
+                                worker, 
+                                timeout, 
+                                req, 
+                                max / 2));
+                        room = max - (pgc_buf_end(out) - pgc_buf_tell(out));
+                }
+
+                const size_t piece = 
+                        left < room - overhead ? left : room - overhead;
+
+                if(overhead) {
+                        char line[LAW_HTS_CHUNK_OVERHEAD];
+                        const size_t n = law_hts_xtoa(line, piece);
+                        line[n] = '\r';
+                        line[n + 1] = '\n';
+                        SEL_TEST(pgc_buf_put(out, line, n + 2) == 
+                                LAW_ERR_OK);
+                }
+
+                SEL_TEST(pgc_buf_put(out, bytes, piece) == LAW_ERR_OK);
+
+                if(overhead) 
+                        SEL_TEST(pgc_buf_put(out, "\r\n", 2) == LAW_ERR_OK);
+
+                bytes += piece;
+                left -= piece;
+        }
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hts_write_ref_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req,
+        const void *data,
+        const size_t length,
+        law_htc_release_t release,
+        void *state)
+{
+        law_hts_stream_t *stream = &req->stream;
+
+        switch(stream->mode) {
+                case LAW_HTS_STREAM_LENGTH:
+                        if(length > stream->remaining) 
+                                return LAW_ERR_LIMIT;
+                        break;
+                case LAW_HTS_STREAM_CHUNKED:
+                case LAW_HTS_STREAM_CLOSE:
+                        break;
+                default:
+                        return LAW_ERR_MODE;
+        }
+
+        if(!length) 
+                return law_htc_queue(&req->conn, data, 0, release, state);
+
+        /* A full queue drains before it takes another segment. */
+        if(req->conn.count == LAW_HTC_SEGMENTS) {
+                const sel_err_t err = law_htc_flush_sync(
+                        worker, 
+                        timeout, 
+                        &req->conn);
+                if(err != LAW_ERR_OK) 
+                        return LAW_ERR_PUSH(err, "law_htc_flush_sync");
+        }
+
+        const bool chunked = stream->mode == LAW_HTS_STREAM_CHUNKED;
+
+        if(chunked) {
+                char line[LAW_HTS_CHUNK_OVERHEAD];
+                const size_t n = law_hts_xtoa(line, length);
+                line[n] = '\r';
+                line[n + 1] = '\n';
+                SEL_TRY_QUIETLY(law_hts_stream_room(
+                        worker, 
+                        timeout, 
+                        req, 
+                        LAW_HTS_CHUNK_OVERHEAD));
+                SEL_TEST(pgc_buf_put(req->conn.out, line, n + 2) == 
+                        LAW_ERR_OK);
+        }
+
+        SEL_TEST(law_htc_queue(&req->conn, data, length, release, state) == 
+                LAW_ERR_OK);
+
+        if(stream->mode == LAW_HTS_STREAM_LENGTH) 
+                stream->remaining -= length;
+
+        if(chunked) 
+                return pgc_buf_put(req->conn.out, "\r\n", 2);
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hts_end_stream_sync(
+        law_worker_t *worker,
+        law_time_t timeout,
+        law_hts_req_t *req)
+{
+        law_hts_stream_t *stream = &req->stream;
+        const int mode = stream->mode;
+
+        switch(mode) {
+                case LAW_HTS_STREAM_LENGTH:
+                case LAW_HTS_STREAM_CHUNKED:
+                case LAW_HTS_STREAM_CLOSE:
+                        break;
+                default:
+                        return LAW_ERR_MODE;
+        }
+
+        stream->mode = LAW_HTS_STREAM_ENDED;
+
+        if(mode == LAW_HTS_STREAM_LENGTH && stream->remaining) {
+                req->keep_alive = false;
+                return LAW_ERR_LIMIT;
+        }
+
+        if(mode != LAW_HTS_STREAM_CHUNKED) 
+                return LAW_ERR_OK;
+
+        SEL_TRY_QUIETLY(law_hts_stream_room(worker, timeout, req, 5));
+        return pgc_buf_put(req->conn.out, "0\r\n\r\n", 5);
+}
+
 law_htserver_cfg_t law_htserver_sanity()
 {
         law_htserver_cfg_t cfg;
@@ -248,6 +1144,10 @@ law_htserver_cfg_t law_htserver_sanity()
         cfg.stack               = 0x1000;
         cfg.heap                = 0xF000;
         cfg.security            = LAW_HTC_UNSECURED;
+        cfg.idle_timeout        = 5000;
+        cfg.response_timeout    = 5000;
+        cfg.max_requests        = 100;
+        cfg.max_body            = 0x100000;
         return cfg;
 }
 
@@ -601,9 +1501,155 @@ sel_err_t law_htserver_close(law_htserver_t *server)
         return LAW_ERR_OK;
 }
 
+/** Compare ASCII strings of length n, ignoring case. */
+static bool law_hts_iequal(const char *a, const char *b, const size_t n)
+{
+        for(size_t i = 0; i < n; ++i) {
+                char x = a[i], y = b[i];
+                if('A' <= x && x <= 'Z') x = (char)(x - 'A' + 'a');
+                if('A' <= y && y <= 'Z') y = (char)(y - 'A' + 'a');
+                if(x != y) return false;
+                if(!x) return true;
+        }
+        return true;
+}
+
+/** Check a comma separated header value for token, ignoring case. */
+bool law_hts_has_token(const char *list, const char *token)
+{
+        const size_t length = strlen(token);
+
+        while(*list) {
+                while(*list == ' ' || *list == '\t' || *list == ',') ++list;
+
+                const char *start = list;
+                while(*list && *list != ',') ++list;
+
+                const char *end = list;
+                while(end > start && (end[-1] == ' ' || end[-1] == '\t')) 
+                        --end;
+
+                if(     (size_t)(end - start) == length && 
+                        law_hts_iequal(start, token, length)) 
+                        return true;
+        }
+
+        return false;
+}
+
+/** Check whether chunked is the last transfer coding in the list. */
+static bool law_hts_is_chunked(const char *list)
+{
+        const char *end = list + strlen(list);
+        while(end > list && (end[-1] == ' ' || end[-1] == '\t')) --end;
+
+        const size_t length = (size_t)(end - list);
+        if(length < 7 || !law_hts_iequal(end - 7, "chunked", 7)) 
+                return false;
+
+        const char *before = end - 7;
+        while(before > list && (before[-1] == ' ' || before[-1] == '\t')) 
+                --before;
+        return before == list || before[-1] == ',';
+}
+
+/** Place the header iterator in the caller's frame. */
+static void *law_hts_iter_alloc(const size_t nbytes, void *state)
+{
+        return state;
+}
+
+/** Check that every Content-Length field repeats the first one's value. */
+static bool law_hts_length_agrees(law_htheaders_t *headers, const char *length)
+{
+        law_hth_iter_t iter;
+        const char *name = NULL, *value = NULL;
+
+        (void)law_hth_elems(headers, law_hts_iter_alloc, &iter);
+        while(law_hth_next(&iter, &name, &value)) {
+                if(     law_hth_classify(name, strlen(name)) == 
+                                LAW_HTH_CONTENT_LENGTH && 
+                        strcmp(value, length))
+                        return false;
+        }
+        return true;
+}
+
+/** 
+ * Work out whether the connection can carry another request, and how the 
+ * request body is framed.  Bodies with a transfer coding other than 
+ * chunked, or without a usable Content-Length, end the connection.  So 
+ * do requests framed two ways (Transfer-Encoding with Content-Length, or 
+ * Content-Length fields that disagree), which a proxy in front may have 
+ * split differently (RFC 7230 3.3.3).
+ */
+void law_hts_set_framing(
+        law_hts_req_t *req, 
+        law_hts_reqline_t *reqline, 
+        law_htheaders_t *headers)
+{
+        law_htserver_t *hts = req->htserver;
+        const char 
+                *connection = law_hth_get_field(headers, LAW_HTH_CONNECTION),
+                *length = law_hth_get_field(headers, LAW_HTH_CONTENT_LENGTH);
+        const char *version = reqline->version ? reqline->version : "";
+
+        if(!strcmp(version, "HTTP/1.0")) {
+                req->persistent = connection && 
+                        law_hts_has_token(connection, "keep-alive");
+        } else {
+                req->persistent = !strncmp(version, "HTTP/1.", 7) && 
+                        !(connection && law_hts_has_token(connection, "close"));
+        }
+
+        if(hts->cfg.max_requests && req->requests >= hts->cfg.max_requests) 
+                req->persistent = false;
+
+        const char *coding = 
+                law_hth_get_field(headers, LAW_HTH_TRANSFER_ENCODING);
+
+        req->body_end = pgc_buf_tell(req->conn.in);
+        (void)memset(&req->body, 0, sizeof(law_hts_body_t));
+        (void)memset(&req->stream, 0, sizeof(law_hts_stream_t));
+        req->stream.chunked = !strcmp(version, "HTTP/1.1");
+
+        if(coding) {
+                if(law_hts_is_chunked(coding)) 
+                        req->body.state = LAW_HTS_BODY_SIZE;
+                if(!law_hts_is_chunked(coding) || length) 
+                        req->persistent = false;
+        } else if(length && !law_hts_length_agrees(headers, length)) {
+                req->persistent = false;
+        } else if(length) {
+                char *end = NULL;
+                errno = 0;
+                const unsigned long long n = strtoull(length, &end, 10);
+                if(errno || end == length || *end || *length == '-') {
+                        req->persistent = false;
+                } else if(n) {
+                        req->body_end += (size_t)n;
+                        req->body.state = LAW_HTS_BODY_DATA;
+                        req->body.remaining = (size_t)n;
+                }
+        }
+
+        req->keep_alive = req->persistent;
+        req->framed = reqline->method && !strcmp(reqline->method, "HEAD");
+
+        if(     req->body.state == LAW_HTS_BODY_DATA && 
+                law_hts_body_limit(req, req->body.remaining) != LAW_ERR_OK)
+                (void)law_hts_body_fail(req, LAW_ERR_OOB);
+}
+
+/** 
+ * Read one request and pass it to the handler.  A connection that closes 
+ * or idles out before the next request starts is not an error.
+ */
 sel_err_t law_hts_entry_handler(law_worker_t *worker, law_hts_req_t *req)
 {
         law_htserver_t *hts = req->htserver;
+        struct pgc_buf *in = req->conn.in;
+        const bool idle = req->requests > 0;
 
         law_hts_reqline_t reqline;
         (void)memset(&reqline, 0, sizeof(law_hts_reqline_t));
@@ -613,13 +1659,23 @@ sel_err_t law_hts_entry_handler(law_worker_t *worker, law_hts_req_t *req)
 
         sel_err_t err = -1;
 
-        switch((err = law_hts_read_reqline_sync(
+        req->keep_alive = false;
+        req->persistent = false;
+
+        /* Pipelined requests are already buffered and parse right away. */
+        err = law_hts_read_reqline_sync(
                 worker, 
-                hts->cfg.reqline_timeout, 
+                idle ? hts->cfg.idle_timeout : hts->cfg.reqline_timeout, 
                 req, 
                 &reqline,
-                pgc_buf_tell(req->conn.in))))
-        {
+                pgc_buf_tell(in));
+
+        if(     idle && 
+                (err == LAW_ERR_TIME || err == LAW_ERR_EOF) && 
+                pgc_buf_end(in) == pgc_buf_tell(in)) 
+                return LAW_ERR_OK;
+
+        switch(err) {
                 case LAW_ERR_OK:
                         break;
                 case LAW_ERR_TIME:
@@ -699,6 +1755,9 @@ sel_err_t law_hts_entry_handler(law_worker_t *worker, law_hts_req_t *req)
                         return err;
         }
 
+        req->requests += 1;
+        law_hts_set_framing(req, &reqline, &headers);
+
         return hts->cfg.on_accept(
                 worker, 
                 req, 
@@ -707,9 +1766,149 @@ sel_err_t law_hts_entry_handler(law_worker_t *worker, law_hts_req_t *req)
                 hts->cfg.data);
 }
 
+/** Skip the part of the request body the handler did not read. */
+static sel_err_t law_hts_skip_body(law_worker_t *worker, law_hts_req_t *req)
+{
+        law_htserver_t *hts = req->htserver;
+        struct pgc_buf *in = req->conn.in;
+
+        /* Draining a large body costs more than a new connection. */
+        if(req->body_end - pgc_buf_tell(in) > pgc_buf_max(in)) {
+                req->keep_alive = false;
+                return LAW_ERR_OK;
+        }
+
+        while(pgc_buf_tell(in) < req->body_end) {
+
+                if(pgc_buf_end(in) == pgc_buf_tell(in)) {
+                        const sel_err_t err = law_htc_ensure_input_sync(
+                                worker, 
+                                hts->cfg.idle_timeout, 
+                                &req->conn, 
+                                1);
+                        if(err != LAW_ERR_OK) 
+                                return LAW_ERR_PUSH(
+                                        err, 
+                                        "law_htc_ensure_input_sync");
+                }
+
+                const size_t 
+                        buffered = pgc_buf_end(in) - pgc_buf_tell(in),
+                        remaining = req->body_end - pgc_buf_tell(in),
+                        step = buffered < remaining ? buffered : remaining;
+
+                SEL_TEST(pgc_buf_seek(in, pgc_buf_tell(in) + step) == 
+                        LAW_ERR_OK);
+        }
+
+        return LAW_ERR_OK;
+}
+
+/** Skip the rest of a chunked body the handler did not read. */
+static sel_err_t law_hts_skip_chunks(law_worker_t *worker, law_hts_req_t *req)
+{
+        law_htserver_t *hts = req->htserver;
+        const size_t max = pgc_buf_max(req->conn.in);
+        size_t skipped = 0;
+
+        for(;;) {
+                const void *span = NULL;
+                size_t length = 0;
+
+                const sel_err_t err = law_hts_body_span_sync(
+                        worker,
+                        hts->cfg.idle_timeout,
+                        req,
+                        &span,
+                        &length);
+
+                switch(err) {
+                        case LAW_ERR_OK:
+                                break;
+                        case LAW_ERR_SYN:
+                        case LAW_ERR_OOB:
+                                req->keep_alive = false;
+                                return LAW_ERR_OK;
+                        default:
+                                return LAW_ERR_PUSH(
+                                        err, 
+                                        "law_hts_body_span_sync");
+                }
+
+                if(!length) 
+                        return LAW_ERR_OK;
+
+                /* Like law_hts_skip_body, give up on large bodies. */
+                if((skipped += length) > max) {
+                        req->keep_alive = false;
+                        return LAW_ERR_OK;
+                }
+        }
+}
+
+/** Send what the handler left in the output buffer, then skip the body. */
+static sel_err_t law_hts_entry_finish(
+        law_worker_t *worker, 
+        law_hts_req_t *req)
+{
+        law_htserver_t *hts = req->htserver;
+
+        sel_err_t err = law_htc_flush_sync(
+                worker, 
+                hts->cfg.response_timeout, 
+                &req->conn);
+        if(err != LAW_ERR_OK) {
+                LAW_ERR_PUSH(err, "law_htc_flush_sync");
+                hts->cfg.on_error(worker, req, err, hts->cfg.data);
+                return err;
+        }
+
+        /* A body the handler left unfinished cannot be framed, and one it 
+         * never framed ends with the connection. */
+        switch(req->stream.mode) {
+                case LAW_HTS_STREAM_LENGTH:
+                case LAW_HTS_STREAM_CHUNKED:
+                        req->keep_alive = false;
+                        break;
+        }
+        if(!req->framed) 
+                req->keep_alive = false;
+
+        if(!req->keep_alive) 
+                return LAW_ERR_OK;
+
+        switch(req->body.state) {
+                case LAW_HTS_BODY_SIZE:
+                case LAW_HTS_BODY_CHUNK:
+                case LAW_HTS_BODY_CRLF:
+                case LAW_HTS_BODY_TRAILER:
+                        return law_hts_skip_chunks(worker, req);
+        }
+
+        if(pgc_buf_tell(req->conn.in) < req->body_end) 
+                return law_hts_skip_body(worker, req);
+
+        return LAW_ERR_OK;
+}
+
 sel_err_t law_hts_entry_stream(law_worker_t *worker, law_hts_req_t *req)
 {
-        return law_hts_entry_handler(worker, req);
+        sel_err_t err = LAW_ERR_OK;
+
+        do {
+                /* Leftover input stays in place as the next request. */
+                (void)pgc_stk_zero(req->stack);
+                (void)pgc_stk_zero(req->heap);
+
+                if((err = law_hts_entry_handler(worker, req)) != LAW_ERR_OK) 
+                        return err;
+
+                if((err = law_hts_entry_finish(worker, req)) != LAW_ERR_OK) 
+                        return err;
+
+        } while(req->keep_alive);
+
+        return LAW_ERR_OK;
 }
 
 void law_hts_entry_setup(law_worker_t *worker, law_hts_req_t *req)
@@ -835,6 +2034,8 @@ sel_err_t law_hts_entry(
         SEL_ASSERT(in && out && heap && stack);
 
         req.htserver = server;
+        req.group = grp;
+        req.parser = cfg->parser;
         req.conn.security = cfg->security;
         req.conn.socket = socket;
         req.conn.in = pgc_buf_zero(&in->buffer);
@@ -844,6 +2045,9 @@ sel_err_t law_hts_entry(
 
         (void)law_hts_entry_setup(worker, &req);
 
+        /* Segments a failed response left behind go back to their owners. */
+        (void)law_htc_drop(&req.conn);
+
         (void)law_hts_buf_pool_push(&grp->in_pool, in);
         (void)law_hts_buf_pool_push(&grp->out_pool, out);
         (void)law_hts_stk_pool_push(&grp->heap_pool, heap);
@@ -856,56 +2060,10 @@ const char *law_hts_status_str(const int status_code)
 {
         SEL_ASSERT(status_code > 0);
         switch(status_code) {
-
-                /* Informational 1xx */
-                case 100: return "Continue";
-                case 101: return "Switching Protocols";
-
-                /* Successful 2xx */
-                case 200: return "OK";
-                case 201: return "Created";
-                case 202: return "Accepted";
-                case 203: return "Non-Authoritative Information";
-                case 204: return "No Content";
-                case 205: return "Reset Content";
-
-                /* Redirection 3xx */
-                case 300: return "Multiple Choices";
-                case 301: return "Moved Permanently";
-                case 302: return "Found";
-                case 303: return "See Other";
-                case 304: return "Not Modified";
-                case 305: return "Use Proxy";
-                case 307: return "Temporary Redirect";
-
-                /* Client Error 4xx */
-                case 400: return "Bad Request";
-                case 401: return "Unauthorized";
-                case 402: return "Payment Required";
-                case 403: return "Forbidden";
-                case 404: return "Not Found";
-                case 405: return "Method Not Allowed";
-                case 406: return "Not Acceptable";
-                case 407: return "Proxy Authentication Required";
-                case 408: return "Request Timeout";
-                case 409: return "Conflict";
-                case 410: return "Gone";
-                case 411: return "Length Required";
-                case 412: return "Precondition Failed";
-                case 413: return "Request Entity Too Large";
-                case 414: return "Request-URI Too Long";
-                case 415: return "Unsupported Media Type";
-                case 416: return "Requested Range Not Satisfiable";
-                case 417: return "Expectation Failed";
-
-                /* Server Error 5xx */
-                case 500: return "Internal Server Error";
-                case 501: return "Not Implemented";
-                case 502: return "Bad Gateway";
-                case 503: return "Service Unavailable";
-                case 504: return "Gateway Timeout";
-                case 505: return "HTTP Version Not Supported";
-
+                #define LAW_HTS_REASON(CODE, REASON) \
+                        case CODE: return REASON;
+                LAW_HTS_STATUSES(LAW_HTS_REASON)
+                #undef LAW_HTS_REASON
                 default: return "Unknown Status Code";
         }
 }
\ No newline at end of file
@@ -0,0 +1,739 @@
+#define _GNU_SOURCE
+
+#include "lawd/http_static.h"
+#include "lawd/private/http_server.h"
+#include "lawd/time.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Longest path below the root, including the index file name. */
+#define LAW_HSF_PATH 256
+
+typedef struct law_hsf_file {                   /** Open File */
+        int fd;
+        bool dropped;                           /** Closed at the Last Ref */
+        size_t refs;                            /** Sends Reading It */
+} law_hsf_file_t;
+
+typedef struct law_hsf_entry {
+        char path[LAW_HSF_PATH];                /** Path Below the Root */
+        uint32_t hash;                          /** Path Hash */
+        uint32_t chain;                         /** Next in Bucket (Index+1) */
+        uint32_t prev;                          /** More Recent (Index+1) */
+        uint32_t next;                          /** Less Recent (Index+1) */
+        law_hsf_file_t *file;                   /** Open File (or NULL) */
+        dev_t dev;                              /** Device at Open */
+        ino_t ino;                              /** Inode at Open */
+        off_t size;                             /** Size at Open */
+        time_t mtime;                           /** Modified at Open */
+        law_time_t checked;                     /** Last Stat (ms) */
+        const char *mime;                       /** Content Type */
+        char etag[40];                          /** Quoted Entity Tag */
+        char modified[30];                      /** Last-Modified Value */
+} law_hsf_entry_t;
+
+typedef struct law_hsf_cache {                  /** One Worker's Files */
+        law_hsf_entry_t *entries;
+        uint32_t *buckets;                      /** Chains (Index+1) */
+        size_t count;                           /** Entries in Use */
+        uint32_t mask;                          /** Buckets - 1 */
+        uint32_t head;                          /** Most Recent (Index+1) */
+        uint32_t tail;                          /** Least Recent (Index+1) */
+} law_hsf_cache_t;
+
+struct law_hsf {
+        law_hsf_cfg_t cfg;
+        int root;                               /** Document Root */
+        int workers;
+        law_hsf_cache_t *caches;
+};
+
+static const struct {
+        const char *extension;
+        const char *mime;
+} LAW_HSF_TYPES[] = {
+        { "html",       "text/html; charset=utf-8" },
+        { "htm",        "text/html; charset=utf-8" },
+        { "css",        "text/css; charset=utf-8" },
+        { "js",         "text/javascript; charset=utf-8" },
+        { "mjs",        "text/javascript; charset=utf-8" },
+        { "json",       "application/json" },
+        { "txt",        "text/plain; charset=utf-8" },
+        { "xml",        "application/xml" },
+        { "svg",        "image/svg+xml" },
+        { "png",        "image/png" },
+        { "jpg",        "image/jpeg" },
+        { "jpeg",       "image/jpeg" },
+        { "gif",        "image/gif" },
+        { "webp",       "image/webp" },
+        { "ico",        "image/x-icon" },
+        { "wasm",       "application/wasm" },
+        { "pdf",        "application/pdf" },
+        { "woff",       "font/woff" },
+        { "woff2",      "font/woff2" },
+        { "mp4",        "video/mp4" },
+        { "webm",       "video/webm" },
+};
+
+law_hsf_cfg_t law_hsf_sanity()
+{
+        law_hsf_cfg_t cfg;
+        memset(&cfg, 0, sizeof(law_hsf_cfg_t));
+        cfg.index               = "index.html";
+        cfg.entries             = 256;
+        cfg.revalidate          = 1000;
+        cfg.timeout             = 5000;
+        return cfg;
+}
+
+static sel_err_t law_hsf_cache_init(law_hsf_cache_t *cache, size_t entries)
+{
+        uint32_t buckets = 1;
+        while(buckets < 2 * entries) buckets <<= 1;
+
+        cache->entries = calloc(entries, sizeof(law_hsf_entry_t));
+        cache->buckets = calloc(buckets, sizeof(uint32_t));
+        cache->mask = buckets - 1;
+
+        return cache->entries && cache->buckets ? LAW_ERR_OK : LAW_ERR_OOM;
+}
+
+static void law_hsf_entry_close(law_hsf_entry_t *e);
+
+static void law_hsf_cache_free(law_hsf_cache_t *cache)
+{
+        for(size_t e = 0; e < cache->count; ++e)
+                law_hsf_entry_close(&cache->entries[e]);
+        free(cache->entries);
+        free(cache->buckets);
+}
+
+law_hsf_t *law_hsf_create(law_server_cfg_t *srv_cfg, law_hsf_cfg_t *cfg)
+{
+        SEL_ASSERT(cfg->root && cfg->index && cfg->entries);
+        SEL_ASSERT(cfg->entries < UINT32_MAX / 2);
+
+        law_hsf_t *hsf = calloc(1, sizeof(law_hsf_t));
+        if(!hsf) return NULL;
+
+        hsf->cfg = *cfg;
+        hsf->workers = srv_cfg->workers > 0 ? srv_cfg->workers : 1;
+        hsf->root = open(cfg->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(hsf->root < 0) {
+                free(hsf);
+                return NULL;
+        }
+
+        hsf->caches = calloc((size_t)hsf->workers, sizeof(law_hsf_cache_t));
+        if(!hsf->caches) {
+                law_hsf_destroy(hsf);
+                errno = ENOMEM;
+                return NULL;
+        }
+
+        for(int w = 0; w < hsf->workers; ++w) {
+                if(law_hsf_cache_init(&hsf->caches[w], cfg->entries)) {
+                        law_hsf_destroy(hsf);
+                        errno = ENOMEM;
+                        return NULL;
+                }
+        }
+
+        return hsf;
+}
+
+void law_hsf_destroy(law_hsf_t *hsf)
+{
+        if(hsf->caches) {
+                for(int w = 0; w < hsf->workers; ++w)
+                        law_hsf_cache_free(&hsf->caches[w]);
+                free(hsf->caches);
+        }
+        close(hsf->root);
+        free(hsf);
+}
+
+static int law_hsf_hex(const char c)
+{
+        if('0' <= c && c <= '9') return c - '0';
+        if('a' <= c && c <= 'f') return c - 'a' + 10;
+        if('A' <= c && c <= 'F') return c - 'A' + 10;
+        return -1;
+}
+
+/**
+ * Percent decode the target path into a path relative to the root,
+ * dropping empty and "." segments.  Paths ending in a slash get the index
+ * file appended.
+ *
+ * LAW_ERR_SYN - Bad escape, "..", or an encoded slash or NUL.
+ * LAW_ERR_OOB - Path too long.
+ * LAW_ERR_OK - All OK.
+ */
+sel_err_t law_hsf_path(
+        const char *target,
+        const char *index,
+        char *path)
+{
+        size_t length = 0, segment = 0;
+
+        for(const char *c = target;; ++c) {
+                if(*c == '/' || !*c) {
+                        const size_t n = length - segment;
+                        const char *s = path + segment;
+
+                        if(n == 2 && s[0] == '.' && s[1] == '.')
+                                return LAW_ERR_SYN;
+
+                        if(!n || (n == 1 && s[0] == '.')) {
+                                length = segment;
+                        } else if(*c) {
+                                if(length + 1 >= LAW_HSF_PATH)
+                                        return LAW_ERR_OOB;
+                                path[length++] = '/';
+                        }
+
+                        if(!*c) break;
+                        segment = length;
+                        continue;
+                }
+
+                char byte = *c;
+                if(byte == '%') {
+                        const int hi = law_hsf_hex(c[1]);
+                        const int lo = hi < 0 ? -1 : law_hsf_hex(c[2]);
+                        if(lo < 0) return LAW_ERR_SYN;
+                        byte = (char)(hi << 4 | lo);
+                        if(byte == '/' || byte == '\0') return LAW_ERR_SYN;
+                        c += 2;
+                }
+
+                if(length + 1 >= LAW_HSF_PATH) return LAW_ERR_OOB;
+                path[length++] = byte;
+        }
+
+        /* The last segment was empty or ".", so name the index file. */
+        if(length == segment) {
+                const size_t n = strlen(index);
+                if(length + n >= LAW_HSF_PATH) return LAW_ERR_OOB;
+                (void)memcpy(path + length, index, n);
+                length += n;
+        }
+
+        path[length] = '\0';
+        return LAW_ERR_OK;
+}
+
+/** FNV-1a */
+static uint32_t law_hsf_hash(const char *path)
+{
+        uint32_t hash = 2166136261u;
+        for(; *path; ++path) {
+                hash ^= (uint8_t)*path;
+                hash *= 16777619u;
+        }
+        return hash;
+}
+
+static const char *law_hsf_mime(const char *path)
+{
+        const char *dot = strrchr(path, '.');
+        const char *slash = strrchr(path, '/');
+        if(dot && (!slash || dot > slash)) {
+                const size_t count =
+                        sizeof(LAW_HSF_TYPES) / sizeof(*LAW_HSF_TYPES);
+                for(size_t t = 0; t < count; ++t)
+                        if(!strcasecmp(dot + 1, LAW_HSF_TYPES[t].extension))
+                                return LAW_HSF_TYPES[t].mime;
+        }
+        return "application/octet-stream";
+}
+
+static void law_hsf_lru_unlink(law_hsf_cache_t *cache, const uint32_t i)
+{
+        law_hsf_entry_t *e = &cache->entries[i - 1];
+        if(e->prev) cache->entries[e->prev - 1].next = e->next;
+        else cache->head = e->next;
+        if(e->next) cache->entries[e->next - 1].prev = e->prev;
+        else cache->tail = e->prev;
+        e->prev = e->next = 0;
+}
+
+static void law_hsf_lru_front(law_hsf_cache_t *cache, const uint32_t i)
+{
+        law_hsf_entry_t *e = &cache->entries[i - 1];
+        e->prev = 0;
+        e->next = cache->head;
+        if(cache->head) cache->entries[cache->head - 1].prev = i;
+        cache->head = i;
+        if(!cache->tail) cache->tail = i;
+}
+
+static void law_hsf_bucket_unlink(law_hsf_cache_t *cache, const uint32_t i)
+{
+        law_hsf_entry_t *e = &cache->entries[i - 1];
+        uint32_t *link = &cache->buckets[e->hash & cache->mask];
+        while(*link != i) link = &cache->entries[*link - 1].chain;
+        *link = e->chain;
+        e->chain = 0;
+}
+
+/** Close a file no entry or send holds. */
+static void law_hsf_file_put(law_hsf_file_t *file)
+{
+        if(file && file->dropped && !file->refs) {
+                close(file->fd);
+                free(file);
+        }
+}
+
+/** 
+ * Drop an entry's file, leaving the slot linked for reuse.  Sends still 
+ * reading it close it when they are done, so its descriptor is not reused
+ * under them.
+ */
+static void law_hsf_entry_close(law_hsf_entry_t *e)
+{
+        if(e->file) {
+                e->file->dropped = true;
+                law_hsf_file_put(e->file);
+        }
+        e->file = NULL;
+}
+
+/** Fill an entry from an open regular file. */
+static void law_hsf_entry_set(
+        law_hsf_entry_t *e, 
+        law_hsf_file_t *file, 
+        struct stat *st)
+{
+        e->file = file;
+        e->dev = st->st_dev;
+        e->ino = st->st_ino;
+        e->size = st->st_size;
+        e->mtime = st->st_mtime;
+        e->mime = law_hsf_mime(e->path);
+
+        /* nginx style: hex modification time and size. */
+        (void)snprintf(e->etag, sizeof(e->etag), "\"%llx-%llx\"",
+                (unsigned long long)e->mtime,
+                (unsigned long long)e->size);
+
+        char date[LAW_HTS_DATE_LEN];
+        law_hts_format_date(date, e->mtime);
+        (void)memcpy(e->modified, date + 6, LAW_HTS_DATE_LEN - 8);
+        e->modified[LAW_HTS_DATE_LEN - 8] = '\0';
+}
+
+/** Open a regular file below the root, or NULL (errno is set). */
+static law_hsf_file_t *law_hsf_open(
+        law_hsf_t *hsf, 
+        const char *path, 
+        struct stat *st)
+{
+        const int fd = openat(hsf->root, path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0) return NULL;
+
+        if(fstat(fd, st) || !S_ISREG(st->st_mode)) {
+                close(fd);
+                errno = ENOENT;
+                return NULL;
+        }
+
+        law_hsf_file_t *file = malloc(sizeof(law_hsf_file_t));
+        if(!file) {
+                close(fd);
+                errno = ENOMEM;
+                return NULL;
+        }
+
+        file->fd = fd;
+        file->dropped = false;
+        file->refs = 0;
+        return file;
+}
+
+/**
+ * Find the file in the worker's cache, opening it on a miss and checking a
+ * stale entry against the file system.
+ */
+static law_hsf_entry_t *law_hsf_lookup(
+        law_hsf_t *hsf,
+        law_hsf_cache_t *cache,
+        const char *path)
+{
+        const uint32_t hash = law_hsf_hash(path);
+        const law_time_t now = law_time_millis();
+        struct stat st;
+
+        uint32_t i = cache->buckets[hash & cache->mask];
+        while(i) {
+                law_hsf_entry_t *e = &cache->entries[i - 1];
+                if(e->hash == hash && !strcmp(e->path, path)) break;
+                i = e->chain;
+        }
+
+        if(i) {
+                law_hsf_entry_t *e = &cache->entries[i - 1];
+
+                law_hsf_lru_unlink(cache, i);
+                law_hsf_lru_front(cache, i);
+
+                if(e->file && now - e->checked < hsf->cfg.revalidate)
+                        return e;
+
+                /* Replaced files (a new inode) must be opened again. */
+                if(     e->file &&
+                        !fstatat(hsf->root, path, &st, 0) &&
+                        st.st_dev == e->dev && st.st_ino == e->ino &&
+                        st.st_size == e->size && st.st_mtime == e->mtime) {
+                        e->checked = now;
+                        return e;
+                }
+
+                law_hsf_entry_close(e);
+
+                law_hsf_file_t *file = law_hsf_open(hsf, path, &st);
+                if(!file) return NULL;
+                law_hsf_entry_set(e, file, &st);
+                e->checked = now;
+                return e;
+        }
+
+        law_hsf_file_t *file = law_hsf_open(hsf, path, &st);
+        if(!file) return NULL;
+
+        /* Take a free slot, or the least recently used one. */
+        if(cache->count < hsf->cfg.entries) {
+                i = (uint32_t)++cache->count;
+        } else {
+                i = cache->tail;
+                law_hsf_lru_unlink(cache, i);
+                law_hsf_bucket_unlink(cache, i);
+                law_hsf_entry_close(&cache->entries[i - 1]);
+        }
+
+        law_hsf_entry_t *e = &cache->entries[i - 1];
+        (void)strcpy(e->path, path);
+        e->hash = hash;
+        e->chain = cache->buckets[hash & cache->mask];
+        cache->buckets[hash & cache->mask] = i;
+        law_hsf_lru_front(cache, i);
+
+        law_hsf_entry_set(e, file, &st);
+        e->checked = now;
+        return e;
+}
+
+/** Check an If-None-Match list against the entity tag, weakly. */
+bool law_hsf_etag_match(const char *list, const char *etag)
+{
+        const size_t length = strlen(etag);
+
+        while(*list) {
+                while(*list == ' ' || *list == '\t' || *list == ',') ++list;
+                if(*list == '*') return true;
+                if(list[0] == 'W' && list[1] == '/') list += 2;
+
+                const char *start = list;
+                while(*list && *list != ',') ++list;
+
+                const char *end = list;
+                while(end > start && (end[-1] == ' ' || end[-1] == '\t'))
+                        --end;
+
+                if(     (size_t)(end - start) == length &&
+                        !memcmp(start, etag, length))
+                        return true;
+        }
+
+        return false;
+}
+
+static bool law_hsf_digits(const char **str, unsigned long long *value)
+{
+        const char *c = *str;
+        unsigned long long n = 0;
+        for(; '0' <= *c && *c <= '9'; ++c) {
+                if(n > (ULLONG_MAX - 9) / 10) return false;
+                n = n * 10 + (unsigned long long)(*c - '0');
+        }
+        if(c == *str) return false;
+        *str = c;
+        *value = n;
+        return true;
+}
+
+/**
+ * Parse a single "bytes=" range against the file size.  Returns 1 for a
+ * satisfiable range, -1 for an unsatisfiable one, and 0 when the header
+ * should be ignored (bad syntax, other units, or several ranges).
+ */
+int law_hsf_range(
+        const char *range,
+        const size_t size,
+        size_t *first,
+        size_t *last)
+{
+        if(strncmp(range, "bytes=", 6)) return 0;
+        const char *c = range + 6;
+        while(*c == ' ' || *c == '\t') ++c;
+
+        unsigned long long a = 0, b = 0;
+
+        if(*c == '-') {
+                ++c;
+                if(!law_hsf_digits(&c, &b)) return 0;
+                while(*c == ' ' || *c == '\t') ++c;
+                if(*c) return 0;
+                if(!b || !size) return -1;
+                *first = b < size ? size - (size_t)b : 0;
+                *last = size - 1;
+                return 1;
+        }
+
+        if(!law_hsf_digits(&c, &a) || *c++ != '-') return 0;
+        const bool open = !('0' <= *c && *c <= '9');
+        if(!open && !law_hsf_digits(&c, &b)) return 0;
+        while(*c == ' ' || *c == '\t') ++c;
+        if(*c) return 0;
+        if(!open && b < a) return 0;
+
+        if(a >= size) return -1;
+        *first = (size_t)a;
+        *last = open || b >= size ? size - 1 : (size_t)b;
+        return 1;
+}
+
+/** Respond with an empty body. */
+static sel_err_t law_hsf_reply(law_hts_req_t *req, const int status)
+{
+        SEL_TRY_QUIETLY(law_hts_put_status(req, status));
+        SEL_TRY_QUIETLY(law_hts_put_date(req));
+        if(status == 405)
+                SEL_TRY_QUIETLY(law_hts_add_header(req, "Allow", "GET, HEAD"));
+        SEL_TRY_QUIETLY(law_hts_put_length(req, 0));
+        return law_hts_begin_body(req);
+}
+
+typedef struct law_hsf_send_args {
+        int fd;
+        off_t offset;
+        size_t remaining;
+} law_hsf_send_args_t;
+
+/** Send what the socket takes, succeeding on any progress. */
+static sel_err_t law_hsf_sendfile_cb(int socket, void *state)
+{
+        law_hsf_send_args_t *args = state;
+
+        for(;;) {
+                const ssize_t n = sendfile(
+                        socket,
+                        args->fd,
+                        &args->offset,
+                        args->remaining);
+                if(n > 0) {
+                        args->remaining -= (size_t)n;
+                        return LAW_ERR_OK;
+                }
+                if(n == 0) return LAW_ERR_EOF;
+                if(errno == EINTR) continue;
+                if(errno == EAGAIN || errno == EWOULDBLOCK)
+                        return LAW_ERR_WANTW;
+                return LAW_ERR_SYS;
+        }
+}
+
+static intptr_t law_hsf_pread_cb(void *addr, const size_t n, void *state)
+{
+        law_hsf_send_args_t *args = state;
+
+        for(;;) {
+                const ssize_t r = pread(args->fd, addr, n, args->offset);
+                if(r > 0) {
+                        args->offset += r;
+                        return r;
+                }
+                if(r == 0) return LAW_ERR_EOF;
+                if(errno != EINTR) return LAW_ERR_SYS;
+        }
+}
+
+/** Send the byte range, after the head has been flushed. */
+static sel_err_t law_hsf_send(
+        law_hsf_t *hsf,
+        law_worker_t *worker,
+        law_hts_req_t *req,
+        law_hsf_send_args_t *args)
+{
+        law_htconn_t *conn = &req->conn;
+        sel_err_t err = LAW_ERR_OK;
+
+        if(conn->security == LAW_HTC_UNSECURED) {
+                while(args->remaining) {
+                        err = law_sync(
+                                worker,
+                                hsf->cfg.timeout,
+                                law_hsf_sendfile_cb,
+                                conn->socket,
+                                args);
+                        if(err != LAW_ERR_OK)
+                                return LAW_ERR_PUSH(err, "sendfile");
+                }
+                return LAW_ERR_OK;
+        }
+
+        /* TLS encrypts in user space, so read blocks into the buffer. */
+        struct pgc_buf *out = conn->out;
+        const size_t max = pgc_buf_max(out);
+
+        while(args->remaining) {
+                const size_t want = args->remaining < max / 2 ?
+                        args->remaining : max / 2;
+
+                err = law_htc_ensure_output_sync(
+                        worker,
+                        hsf->cfg.timeout,
+                        conn,
+                        want);
+                if(err != LAW_ERR_OK)
+                        return LAW_ERR_PUSH(err, "law_htc_ensure_output_sync");
+
+                const intptr_t n = pgc_buf_cbread(
+                        out,
+                        want,
+                        law_hsf_pread_cb,
+                        args);
+                if(n <= 0)
+                        return LAW_ERR_PUSH(
+                                n ? (sel_err_t)n : LAW_ERR_EOF,
+                                "pread");
+                args->remaining -= (size_t)n;
+        }
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_hsf_serve(
+        law_hsf_t *hsf,
+        law_worker_t *worker,
+        law_hts_req_t *req,
+        law_hts_reqline_t *reqline,
+        law_htheaders_t *headers)
+{
+        const char *method = reqline->method;
+        const bool head = !strcmp(method, "HEAD");
+
+        if(!head && strcmp(method, "GET"))
+                return law_hsf_reply(req, 405);
+
+        char path[LAW_HSF_PATH];
+        if(     !reqline->target.path ||
+                reqline->target.path[0] != '/')
+                return law_hsf_reply(req, 400);
+
+        switch(law_hsf_path(reqline->target.path, hsf->cfg.index, path)) {
+                case LAW_ERR_OK: break;
+                case LAW_ERR_OOB: return law_hsf_reply(req, 414);
+                default: return law_hsf_reply(req, 400);
+        }
+
+        const int id = worker ? law_get_worker_id(worker) : 0;
+        law_hsf_cache_t *cache = &hsf->caches[id % hsf->workers];
+
+        law_hsf_entry_t *e = law_hsf_lookup(hsf, cache, path);
+        if(!e) return law_hsf_reply(req, errno == EACCES ? 403 : 404);
+
+        /* Conditional requests (RFC 7232 section 6). */
+        const char
+                *inm = law_hth_get(headers, "If-None-Match"),
+                *ims = law_hth_get(headers, "If-Modified-Since");
+        const bool not_modified = inm ?
+                law_hsf_etag_match(inm, e->etag) :
+                ims && !strcmp(ims, e->modified);
+
+        const size_t size = (size_t)e->size;
+        size_t first = 0, last = size ? size - 1 : 0;
+        int range = 0;
+
+        const char
+                *ranges = law_hth_get(headers, "Range"),
+                *if_range = law_hth_get(headers, "If-Range");
+        if(     ranges && !not_modified && (!if_range ||
+                !strcmp(if_range, if_range[0] == '"' ? e->etag : e->modified)))
+                range = law_hsf_range(ranges, size, &first, &last);
+
+        const int status = not_modified ? 304 : range > 0 ? 206 :
+                range < 0 ? 416 : 200;
+
+        SEL_TRY_QUIETLY(law_hts_put_status(req, status));
+        SEL_TRY_QUIETLY(law_hts_put_date(req));
+        SEL_TRY_QUIETLY(law_hts_add_header(req, "ETag", e->etag));
+        SEL_TRY_QUIETLY(law_hts_add_header(req, "Last-Modified", e->modified));
+        SEL_TRY_QUIETLY(law_hts_add_header(req, "Accept-Ranges", "bytes"));
+
+        if(status == 304)
+                return law_hts_begin_body(req);
+
+        char content_range[64];
+        if(status == 416) {
+                (void)snprintf(content_range, sizeof(content_range),
+                        "bytes */%zu", size);
+                SEL_TRY_QUIETLY(law_hts_add_header(
+                        req, "Content-Range", content_range));
+                SEL_TRY_QUIETLY(law_hts_put_length(req, 0));
+                return law_hts_begin_body(req);
+        }
+
+        if(status == 206) {
+                (void)snprintf(content_range, sizeof(content_range),
+                        "bytes %zu-%zu/%zu", first, last, size);
+                SEL_TRY_QUIETLY(law_hts_add_header(
+                        req, "Content-Range", content_range));
+        }
+
+        const size_t length = size ? last - first + 1 : 0;
+
+        SEL_TRY_QUIETLY(law_hts_put_header(req, LAW_HTS_CONTENT_TYPE, e->mime));
+        SEL_TRY_QUIETLY(law_hts_put_length(req, length));
+        SEL_TRY_QUIETLY(law_hts_begin_body(req));
+
+        if(head || !length)
+                return LAW_ERR_OK;
+
+        /* Other tasks may evict or revalidate the entry while this waits. */
+        law_hsf_file_t *file = e->file;
+        file->refs += 1;
+
+        sel_err_t sent = law_htc_flush_sync(
+                worker,
+                hsf->cfg.timeout,
+                &req->conn);
+        if(sent != LAW_ERR_OK) {
+                LAW_ERR_PUSH(sent, "law_htc_flush_sync");
+        } else {
+                law_hsf_send_args_t args = {
+                        .fd = file->fd,
+                        .offset = (off_t)first,
+                        .remaining = length };
+                sent = law_hsf_send(hsf, worker, req, &args);
+        }
+
+        file->refs -= 1;
+        law_hsf_file_put(file);
+
+        /* A failed body cannot be framed, so the connection must close. */
+        if(sent != LAW_ERR_OK)
+                law_hts_set_keep_alive(req, false);
+        return sent;
+}
@@ -31,6 +31,8 @@ char *law_log_ntop(
                 struct sockaddr_in6 *in = (struct sockaddr_in6*)&addr;
                 if(!inet_ntop(AF_INET6, &in->sin6_addr, buf, BUF_LEN)) 
                         return NULL;
+        } else if(addr.ss_family == AF_UNIX) {
+                strcpy(buf, "unix");
         } else {
                 SEL_HALT();
         }
@@ -0,0 +1,347 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "lawd/private/offload.h"
+#include "lawd/private/server.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum law_job_state {                            /** Job State */
+        LAW_JOB_FREE            = 0,            /** Slot Unused */
+        LAW_JOB_QUEUED          = 1,            /** Waiting for a Thread */
+        LAW_JOB_RUNNING         = 2,            /** Running on a Thread */
+        LAW_JOB_DONE            = 3,            /** Result Ready */
+        LAW_JOB_ABANDONED       = 4             /** Caller Timed Out */
+};
+
+typedef struct law_job {
+        int state;                              /** Job State */
+        law_offload_fn_t fn;                    /** Work Function */
+        void *arg;                              /** Work Argument */
+        sel_err_t result;                       /** Work Result */
+        law_worker_t *worker;                   /** Caller's Worker */
+        law_id_t id;                            /** Caller's Task */
+        int64_t submitted;                      /** Submit Timestamp */
+        int64_t started;                        /** Start Timestamp */
+        int64_t finished;                       /** Finish Timestamp */
+        struct law_job *next;                   /** Next Job */
+} law_job_t;
+
+struct law_opool {
+        pthread_mutex_t lock;                   /** Pool Lock */
+        pthread_cond_t cond;                    /** Queue Condition */
+        bool running;                           /** Threads Should Run */
+        int num_threads;                        /** Number of Threads */
+        int num_started;                        /** Threads Started */
+        pthread_t *threads;                     /** Thread Handles */
+        law_job_t *jobs;                        /** Job Slots */
+        law_job_t *free;                        /** Free Slots */
+        law_job_t *head;                        /** Queue Head */
+        law_job_t *tail;                        /** Queue Tail */
+        law_offload_stats_t stats;              /** Statistics */
+};
+
+static int64_t law_opool_nanos()
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;
+}
+
+law_opool_t *law_opool_create(const int threads, const int depth)
+{
+        SEL_ASSERT(0 <= threads && 0 <= depth);
+
+        law_opool_t *pool = calloc(1, sizeof(law_opool_t));
+        if(!pool) return NULL;
+
+        if(threads && depth) {
+                if(!(pool->threads = calloc(
+                        (size_t)threads,
+                        sizeof(pthread_t))))
+                        goto FREE_POOL;
+                if(!(pool->jobs = calloc((size_t)depth, sizeof(law_job_t))))
+                        goto FREE_THREADS;
+        }
+
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_cond_init(&pool->cond, NULL);
+
+        pool->running = false;
+        pool->num_threads = pool->jobs ? threads : 0;
+        pool->num_started = 0;
+        pool->free = NULL;
+        pool->head = NULL;
+        pool->tail = NULL;
+        pool->stats.threads = pool->num_threads;
+        pool->stats.depth = pool->jobs ? depth : 0;
+
+        for(int n = 0; pool->jobs && n < depth; ++n) {
+                pool->jobs[n].next = pool->free;
+                pool->free = pool->jobs + n;
+        }
+
+        return pool;
+
+        FREE_THREADS:
+        free(pool->threads);
+
+        FREE_POOL:
+        free(pool);
+
+        return NULL;
+}
+
+void law_opool_destroy(law_opool_t *pool)
+{
+        if(!pool) return;
+        SEL_ASSERT(!pool->num_started);
+        pthread_cond_destroy(&pool->cond);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->jobs);
+        free(pool->threads);
+        free(pool);
+}
+
+/** Return the slot to the free list.  Requires the lock. */
+static void law_opool_release(law_opool_t *pool, law_job_t *job)
+{
+        job->state = LAW_JOB_FREE;
+        job->next = pool->free;
+        pool->free = job;
+}
+
+static void *law_opool_thread(void *state)
+{
+        law_opool_t *pool = state;
+
+        pthread_mutex_lock(&pool->lock);
+
+        for(;;) {
+                while(pool->running && !pool->head) {
+                        pthread_cond_wait(&pool->cond, &pool->lock);
+                }
+
+                law_job_t *job = pool->head;
+                if(!job) break;
+
+                pool->head = job->next;
+                if(!pool->head) pool->tail = NULL;
+                job->next = NULL;
+                job->state = LAW_JOB_RUNNING;
+                job->started = law_opool_nanos();
+
+                law_offload_stats_t *stats = &pool->stats;
+                const int64_t queued = job->started - job->submitted;
+                stats->queued -= 1;
+                stats->running += 1;
+                stats->queued_total += queued;
+                if(queued > stats->queued_max) stats->queued_max = queued;
+
+                pthread_mutex_unlock(&pool->lock);
+
+                const sel_err_t result = job->fn(job->arg);
+                const int64_t finished = law_opool_nanos();
+
+                pthread_mutex_lock(&pool->lock);
+
+                const int64_t running = finished - job->started;
+                stats->running -= 1;
+                stats->completed += 1;
+                stats->running_total += running;
+                if(running > stats->running_max) stats->running_max = running;
+
+                if(job->state == LAW_JOB_ABANDONED) {
+                        law_opool_release(pool, job);
+                        continue;
+                }
+
+                job->result = result;
+                job->finished = finished;
+                job->state = LAW_JOB_DONE;
+
+                law_worker_t *worker = job->worker;
+                const law_id_t id = job->id;
+
+                pthread_mutex_unlock(&pool->lock);
+                (void)law_worker_wake(NULL, worker, id);
+                pthread_mutex_lock(&pool->lock);
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+
+        return NULL;
+}
+
+sel_err_t law_opool_start(law_opool_t *pool)
+{
+        SEL_ASSERT(pool && !pool->num_started);
+
+        pool->running = true;
+
+        for(int n = 0; n < pool->num_threads; ++n) {
+                if(pthread_create(
+                        pool->threads + n,
+                        NULL,
+                        law_opool_thread,
+                        pool) != 0)
+                {
+                        law_opool_stop(pool);
+                        return LAW_ERR_PUSH(LAW_ERR_SYS, "pthread_create");
+                }
+                ++pool->num_started;
+        }
+
+        return LAW_ERR_OK;
+}
+
+void law_opool_stop(law_opool_t *pool)
+{
+        pthread_mutex_lock(&pool->lock);
+        pool->running = false;
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->lock);
+
+        for(int n = 0; n < pool->num_started; ++n) {
+                pthread_join(pool->threads[n], NULL);
+        }
+
+        pool->num_started = 0;
+}
+
+/** Take a slot and queue the job.  Returns NULL when no slot is free. */
+static law_job_t *law_opool_submit(
+        law_opool_t *pool,
+        law_worker_t *worker,
+        law_offload_fn_t fn,
+        void *arg)
+{
+        pthread_mutex_lock(&pool->lock);
+
+        law_job_t *job = pool->free;
+
+        if(!job || !pool->num_started) {
+                pool->stats.rejected += 1;
+                pthread_mutex_unlock(&pool->lock);
+                return NULL;
+        }
+
+        pool->free = job->next;
+
+        job->state = LAW_JOB_QUEUED;
+        job->fn = fn;
+        job->arg = arg;
+        job->result = LAW_ERR_OK;
+        job->worker = worker;
+        job->id = law_get_active_id(worker);
+        job->submitted = law_opool_nanos();
+        job->started = 0;
+        job->finished = 0;
+        job->next = NULL;
+
+        if(pool->tail) pool->tail->next = job;
+        else pool->head = job;
+        pool->tail = job;
+
+        pool->stats.submitted += 1;
+        pool->stats.queued += 1;
+
+        pthread_cond_signal(&pool->cond);
+        pthread_mutex_unlock(&pool->lock);
+
+        return job;
+}
+
+/** Give up on the job.  Requires the lock. */
+static void law_opool_cancel(law_opool_t *pool, law_job_t *job)
+{
+        if(job->state == LAW_JOB_RUNNING) {
+                job->state = LAW_JOB_ABANDONED;
+                pool->stats.abandoned += 1;
+                return;
+        }
+
+        SEL_ASSERT(job->state == LAW_JOB_QUEUED);
+
+        law_job_t *prev = NULL;
+        for(law_job_t *j = pool->head; j; prev = j, j = j->next) {
+                if(j != job) continue;
+                if(prev) prev->next = j->next;
+                else pool->head = j->next;
+                if(pool->tail == j) pool->tail = prev;
+                break;
+        }
+
+        pool->stats.queued -= 1;
+        pool->stats.cancelled += 1;
+
+        law_opool_release(pool, job);
+}
+
+sel_err_t law_offload_timed(
+        law_worker_t *worker,
+        law_offload_fn_t fn,
+        void *arg,
+        law_time_t timeout,
+        law_offload_timing_t *timing)
+{
+        SEL_ASSERT(worker && fn);
+
+        law_opool_t *pool = law_get_opool(law_get_server(worker));
+
+        if(timing) memset(timing, 0, sizeof(law_offload_timing_t));
+
+        law_job_t *job = law_opool_submit(pool, worker, fn, arg);
+        if(!job) return LAW_ERR_LIMIT;
+
+        const law_time_t expiry = law_time_millis() + timeout;
+
+        for(;;) {
+                pthread_mutex_lock(&pool->lock);
+
+                if(job->state == LAW_JOB_DONE) {
+                        const sel_err_t result = job->result;
+                        if(timing) {
+                                timing->queued = job->started - job->submitted;
+                                timing->running = job->finished - job->started;
+                        }
+                        law_opool_release(pool, job);
+                        pthread_mutex_unlock(&pool->lock);
+                        return result;
+                }
+
+                const law_time_t now = law_time_millis();
+
+                if(expiry <= now) {
+                        if(timing && job->started) {
+                                timing->queued = job->started - job->submitted;
+                        }
+                        law_opool_cancel(pool, job);
+                        pthread_mutex_unlock(&pool->lock);
+                        return LAW_ERR_TIME;
+                }
+
+                pthread_mutex_unlock(&pool->lock);
+
+                (void)law_ewait(worker, expiry - now, NULL, 0);
+        }
+}
+
+sel_err_t law_offload(
+        law_worker_t *worker,
+        law_offload_fn_t fn,
+        void *arg,
+        law_time_t timeout)
+{
+        return law_offload_timed(worker, fn, arg, timeout, NULL);
+}
+
+void law_offload_stats(law_server_t *server, law_offload_stats_t *stats)
+{
+        law_opool_t *pool = law_get_opool(server);
+        pthread_mutex_lock(&pool->lock);
+        *stats = pool->stats;
+        pthread_mutex_unlock(&pool->lock);
+}
@@ -2,6 +2,8 @@
 
 /* See man getaddrinfo */
 #define _POSIX_C_SOURCE 200112L
+/* SO_REUSEPORT */
+#define _DEFAULT_SOURCE
 
 #include "lawd/error.h"
 #include "lawd/server.h"
@@ -9,15 +11,27 @@
 #include "lawd/safemem.h"
 #include "lawd/table.h"
 #include "lawd/private/server.h"
+#include "lawd/private/arena.h"
+#include "lawd/private/offload.h"
+#include "lawd/private/dgram.h"
+#include "lawd/private/codel.h"
 
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <pthread.h>
 #include <errno.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
 #include <math.h>
 
 law_server_cfg_t law_server_sanity()
@@ -28,20 +42,47 @@ law_server_cfg_t law_server_sanity()
         cfg.port                = 80;
         cfg.backlog             = 8;
 
+        cfg.unix_path           = NULL;
+        cfg.unix_mode           = 0;
+
+        cfg.sockopts            = (law_sockopts_t){ .nodelay = false };
+
         cfg.workers             = 1;  
         cfg.worker_tasks        = 4;
+        cfg.worker_supply       = 4;
 
         cfg.worker_timeout      = 5000;
         cfg.server_timeout      = 5000;
 
         cfg.stack               = 0x100000;
         cfg.guards              = 0x1000;
+
+        cfg.arena_chunk         = 0x4000;
+        cfg.arena_cache         = 4;
+
+        cfg.offload_threads     = 2;
+        cfg.offload_queue       = 64;
+
+        cfg.dgram_batch         = 32;
+        cfg.dgram_size          = 0x800;
+
+        cfg.overload            = LAW_OVERLOAD_BACKLOG;
+        cfg.overload_retry      = 1;
+        cfg.overload_reply      = NULL;
+        cfg.overload_reply_len  = 0;
+
+        cfg.codel_target        = 0;
+        cfg.codel_interval      = 100;
         
         cfg.server_events       = 32;
         cfg.worker_events       = 32;
         
         cfg.on_error            = NULL;
         cfg.on_accept           = NULL;
+        cfg.on_dgrams           = NULL;
+
+        cfg.listeners           = NULL;
+        cfg.num_listeners       = 0;
 
         cfg.data                = (law_data_t){ .u64 = 0 };
         
@@ -71,12 +112,15 @@ typedef struct law_task {
         law_smem_t *stack;                      /** Coroutine Stack */
         law_callback_t callback;                /** User Callback */
         law_data_t data;                        /** User Data */
+        int64_t accepted;                       /** Accept Time (or 0) */
+        law_arena_t arena;                      /** Scratch Memory */
         int slots[16];                          /** I/O Slots */
 } law_task_t;
 
 enum law_msg_type {                             /** Message Type */
         LAW_MSG_SHUTDOWN        = 1,            /** Prepare for Shutdown */
-        LAW_MSG_WAKEUP          = 2             /** Wakeup Notification */
+        LAW_MSG_WAKEUP          = 2,            /** Wakeup Notification */
+        LAW_MSG_DRAIN           = 3             /** Return the Task Supply */
 };
 
 struct law_worker {
@@ -91,11 +135,29 @@ struct law_worker {
         law_timer_t *timer;
         law_task_t *active;
         law_evo_t *evo;
+        law_task_t *supply;
+        int supply_size;
+        law_dgrams_t *dgrams;
+        law_id_t dgram_task;
+        law_id_t seed;
+        law_slab_t *slab;
+        law_codel_t codel;
 };
 
+typedef struct law_listener {
+        law_listener_cfg_t cfg;
+        int socket;
+        const char *overload_reply;
+        size_t overload_len;
+} law_listener_t;
+
 struct law_server {
         law_server_cfg_t cfg;
         int socket;
+        law_listener_t *listeners;
+        int num_listeners;
+        int next_listener;
+        bool handed_off;
         int mode;
         law_id_t seed;
         pthread_mutex_t lock;
@@ -103,10 +165,23 @@ struct law_server {
         pthread_t *threads;
         law_worker_t **workers;
         law_evo_t *evo;
+        law_opool_t *opool;
+        const char *overload_reply;
+        size_t overload_len;
+        char overload_buf[128];
+        atomic_uint_least64_t rejected;
+        atomic_bool starved;
 };
 
 #define LAW_ID_MODULO 0x100000000000000
 
+/** 
+ * Ids generated by law_spawn_local have this bit set.  The remaining bits 
+ * hold a per-worker sequence number above the 12 bit worker id, so local ids
+ * never collide with each other or with ids from law_server_genid.
+ */
+#define LAW_ID_LOCAL 0x80000000000000
+
 /** 
  * A slot consists of a 56bit task id along with 8bits of user data.  The id
  * portion is 7 bytes encoded in base_256 in "little endian" order like so:
@@ -347,6 +422,7 @@ law_task_t *law_task_setup(
         task->id = id;
         task->callback = callback;
         task->data = data;
+        task->accepted = 0;
         task->version = (law_vers_t)rand();
         task->mode = LAW_MODE_SPAWNED;
         return task;
@@ -380,6 +456,7 @@ law_task_t *law_task_pool_pop(law_task_pool_t *pool)
         
         if(!pool->list) {
                 SEL_ASSERT(pool->size == 0);
+                pthread_mutex_unlock(&pool->lock);
                 return NULL;
         }
 
@@ -476,32 +553,38 @@ void law_ready_set_init(law_ready_set_t *set)
         memset(set, 0, sizeof(law_ready_set_t));
 }
 
-/** Add the task to the ready set. */
-void law_ready_set_push(law_ready_set_t *set, law_task_t *task)
+/** Append the task to the ready set, unless it is already there. */
+bool law_ready_set_push(law_ready_set_t *set, law_task_t *task)
 {
         SEL_ASSERT(set && task);
 
-        if(task->mark) return;
+        if(task->mark) return false;
 
         task->mark = 1;
+        task->next = NULL;
 
-        set->list = pmt_ll_node_push_front(
-                &law_task_lln_iface, 
-                set->list, 
-                task);
+        if(set->tail) set->tail->next = task;
+        else set->head = task;
+        set->tail = task;
+        set->size += 1;
+
+        return true;
 }
 
-/** Remove the task from the ready set. */
+/** Remove the task at the front of the ready set. */
 law_task_t *law_ready_set_pop(law_ready_set_t *set)
 {
         SEL_ASSERT(set);
 
-        law_task_t *task = pmt_ll_node_remove_first(
-                &law_task_lln_iface,
-                (void**)&set->list);
+        law_task_t *task = set->head;
         if(!task) 
                 return NULL;
 
+        set->head = task->next;
+        if(!set->head) set->tail = NULL;
+        set->size -= 1;
+
+        task->next = NULL;
         task->mark = 0;
 
         return task;
@@ -509,8 +592,8 @@ law_task_t *law_ready_set_pop(law_ready_set_t *set)
 
 void law_task_push_event(law_task_t *task, law_event_t *ev)
 {
-        SEL_ASSERT(task->events && task->num_events <= task->max_events);
-        if(task->num_events < task->max_events)
+        SEL_ASSERT(task->num_events <= task->max_events);
+        if(task->events && task->num_events < task->max_events)
                 task->events[task->num_events++] = *ev;
 }
 
@@ -527,6 +610,10 @@ law_worker_t *law_worker_create(law_server_t *server, const int id)
         w->server = server;
         w->mode = LAW_MODE_CREATED;
         law_ready_set_init(&w->ready);
+        law_codel_init(
+                &w->codel, 
+                server->cfg.codel_target, 
+                server->cfg.codel_interval);
 
         if(!(w->caller = law_cor_create()))
                 goto FREE_WORKER;
@@ -542,8 +629,16 @@ law_worker_t *law_worker_create(law_server_t *server, const int id)
         if(!(w->table = law_table_create(table_size)))
                 goto FREE_EVO;
 
+        if(!(w->slab = law_slab_create(
+                server->cfg.arena_chunk, 
+                (size_t)server->cfg.arena_cache)))
+                goto FREE_TABLE;
+
         return w;
 
+        FREE_TABLE:
+        law_table_destroy(w->table);
+
         FREE_EVO:
         law_evo_destroy(w->evo);
 
@@ -562,6 +657,7 @@ law_worker_t *law_worker_create(law_server_t *server, const int id)
 void law_worker_destroy(law_worker_t *w)
 {
         if(!w) return;
+        law_slab_destroy(w->slab);
         law_table_destroy(w->table);
         law_evo_destroy(w->evo);
         law_timer_destroy(w->timer);
@@ -634,6 +730,36 @@ void law_worker_close(law_worker_t *worker)
         law_task_queue_close(&worker->incoming);
 }
 
+sel_err_t law_worker_wake(
+        law_worker_t *self, 
+        law_worker_t *target, 
+        law_id_t id)
+{
+        SEL_ASSERT(target);
+
+        if(self == target) {
+                law_task_t *task = law_table_lookup(target->table, id);
+                if(!task) return LAW_ERR_OK;
+
+                law_event_t event = { 
+                        .events = LAW_EV_WAK, 
+                        .data = { .ptr = NULL } 
+                };
+
+                (void)law_task_push_event(task, &event);
+                (void)law_ready_set_push(&target->ready, task);
+
+                return LAW_ERR_OK;
+        }
+
+        law_msg_t msg;
+        memset(&msg, 0, sizeof(law_msg_t));
+        msg.type = LAW_MSG_WAKEUP;
+        msg.data.u64 = id;
+
+        return law_msg_queue_push(&target->messages, &msg);
+}
+
 /* law_server ############################################################ */
 
 law_server_t *law_server_create(law_server_cfg_t *cfg)
@@ -660,12 +786,73 @@ law_server_t *law_server_create(law_server_cfg_t *cfg)
         if(!(s->workers = calloc((size_t)nthreads, sizeof(void*))))
                 goto FREE_PTHREADS;
 
-        if(!(s->evo = law_evo_create(cfg->server_events))) 
+        s->num_listeners = cfg->num_listeners ? cfg->num_listeners : 1;
+        s->next_listener = 0;
+        s->handed_off = false;
+        s->cfg.listeners = NULL;
+
+        atomic_init(&s->rejected, 0);
+        atomic_init(&s->starved, false);
+        if(cfg->overload_reply) {
+                s->overload_reply = cfg->overload_reply;
+                s->overload_len = cfg->overload_reply_len;
+        } else {
+                const int len = snprintf(
+                        s->overload_buf, 
+                        sizeof(s->overload_buf),
+                        "HTTP/1.1 503 Service Unavailable\r\n"
+                        "Retry-After: %d\r\n"
+                        "Content-Length: 0\r\n"
+                        "Connection: close\r\n\r\n",
+                        cfg->overload_retry);
+                SEL_ASSERT(0 < len && len < (int)sizeof(s->overload_buf));
+                s->overload_reply = s->overload_buf;
+                s->overload_len = (size_t)len;
+        }
+
+        if(!(s->listeners = calloc(
+                (size_t)s->num_listeners, 
+                sizeof(law_listener_t))))
                 goto FREE_WORKER_PTRS;
 
+        for(int m = 0; m < s->num_listeners; ++m) {
+                if(cfg->num_listeners) {
+                        s->listeners[m].cfg = cfg->listeners[m];
+                } else {
+                        s->listeners[m].cfg = (law_listener_cfg_t){
+                                .protocol = cfg->protocol,
+                                .port = cfg->port,
+                                .path = cfg->unix_path,
+                                .mode = cfg->unix_mode,
+                                .backlog = cfg->backlog,
+                                .sockopts = cfg->sockopts,
+                                .on_accept = cfg->on_accept,
+                                .data = cfg->data };
+                }
+                s->listeners[m].socket = -1;
+
+                law_listener_t *listener = s->listeners + m;
+                if(listener->cfg.overload_reply) {
+                        listener->overload_reply = listener->cfg.overload_reply;
+                        listener->overload_len = 
+                                listener->cfg.overload_reply_len;
+                } else {
+                        listener->overload_reply = s->overload_reply;
+                        listener->overload_len = s->overload_len;
+                }
+        }
+
+        if(!(s->evo = law_evo_create(cfg->server_events))) 
+                goto FREE_LISTENERS;
+
         if(!(s->pool = law_task_pool_create(cfg)))
                 goto FREE_EVO;
 
+        if(!(s->opool = law_opool_create(
+                cfg->offload_threads,
+                cfg->offload_queue)))
+                goto FREE_POOL;
+
         int n = 0;
 
         for(; n < nthreads; ++n) {
@@ -681,11 +868,17 @@ law_server_t *law_server_create(law_server_cfg_t *cfg)
                 law_worker_destroy(s->workers[m]);
         }
 
+        law_opool_destroy(s->opool);
+
+        FREE_POOL:
         law_task_pool_destroy(s->pool);
 
         FREE_EVO:
         law_evo_destroy(s->evo);
 
+        FREE_LISTENERS:
+        free(s->listeners);
+
         FREE_WORKER_PTRS:
         free(s->workers);
 
@@ -704,13 +897,40 @@ void law_server_destroy(law_server_t *srv)
         for(int n = 0; n < srv->cfg.workers; ++n) {
                 law_worker_destroy(srv->workers[n]);
         }
+        law_opool_destroy(srv->opool);
         law_task_pool_destroy(srv->pool);
         law_evo_destroy(srv->evo);
+        free(srv->listeners);
         free(srv->workers);
         free(srv->threads);
         free(srv);
 }
 
+uint64_t law_get_rejected(law_server_t *server)
+{
+        return atomic_load(&server->rejected);
+}
+
+void law_codel_stats(
+        law_server_t *server, 
+        int index, 
+        law_codel_stats_t *stats)
+{
+        SEL_ASSERT(0 <= index && index < server->cfg.workers);
+        law_codel_read(&server->workers[index]->codel, stats);
+}
+
+law_opool_t *law_get_opool(law_server_t *server)
+{
+        return server->opool;
+}
+
+law_arena_t *law_task_arena(law_worker_t *worker)
+{
+        SEL_ASSERT(worker && worker->active);
+        return &worker->active->arena;
+}
+
 law_id_t law_get_active_id(law_worker_t *worker)
 {
         return worker->active->id;
@@ -726,11 +946,17 @@ int law_get_server_socket(law_server_t *server)
         return server->socket;
 }
 
+int law_get_listener_socket(law_server_t *server, int index)
+{
+        SEL_ASSERT(0 <= index && index < server->num_listeners);
+        return server->listeners[index].socket;
+}
+
 law_id_t law_server_genid(law_server_t *server)
 {
         pthread_mutex_lock(&server->lock);
 
-        server->seed = (server->seed + 1) % LAW_ID_MODULO;
+        server->seed = (server->seed + 1) % LAW_ID_LOCAL;
 
         law_id_t id = server->seed;
 
@@ -739,14 +965,19 @@ law_id_t law_server_genid(law_server_t *server)
         return id;
 }
 
-sel_err_t law_create_socket(law_server_t *server, int *socket_fd)
+law_id_t law_worker_genid(law_worker_t *worker)
 {
-        SEL_ASSERT(server);
+        worker->seed = (worker->seed + 1) % (LAW_ID_LOCAL >> 12);
+        return LAW_ID_LOCAL | (worker->seed << 12) | (law_id_t)worker->id;
+}
 
+/** Create a non-blocking socket for the protocol. */
+static sel_err_t law_socket_create(const int protocol, int *socket_fd)
+{
         int     domain = -1, 
                 type = -1;
         
-        switch(server->cfg.protocol) {
+        switch(protocol) {
                 case LAW_PROTOCOL_TCP: 
                         domain = AF_INET;
                         type = SOCK_STREAM;
@@ -763,6 +994,10 @@ sel_err_t law_create_socket(law_server_t *server, int *socket_fd)
                         domain = AF_INET6;
                         type = SOCK_DGRAM;
                         break;
+                case LAW_PROTOCOL_UNIX:
+                        domain = AF_UNIX;
+                        type = SOCK_STREAM;
+                        break;
                 default: 
                         SEL_HALT();
         }
@@ -781,8 +1016,7 @@ sel_err_t law_create_socket(law_server_t *server, int *socket_fd)
                 goto FAILURE;
         }
         
-        server->socket = fd;
-        if(socket_fd) *socket_fd = fd;
+        *socket_fd = fd;
 
         return SEL_ERR_OK;
 
@@ -793,57 +1027,216 @@ sel_err_t law_create_socket(law_server_t *server, int *socket_fd)
         return SEL_ERR_SYS;
 }
 
-sel_err_t law_bind_socket(law_server_t *server)
+/** 
+ * Remove the socket file at path if nothing is listening on it any more.
+ * A live socket, or a file that is not a socket, is left alone and reported 
+ * as EADDRINUSE.
+ */
+static sel_err_t law_unlink_stale(const char *path)
 {
-        SEL_ASSERT(server);
+        struct stat st;
+
+        if(lstat(path, &st) == -1) {
+                if(errno == ENOENT) return LAW_ERR_OK;
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "lstat");
+        }
+
+        if(!S_ISSOCK(st.st_mode)) {
+                errno = EADDRINUSE;
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "S_ISSOCK");
+        }
+
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(struct sockaddr_un));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd == -1) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "socket");
+
+        const int live = connect(
+                fd, 
+                (struct sockaddr*)&addr, 
+                sizeof(struct sockaddr_un));
+        const int connect_errno = errno;
+
+        close(fd);
+
+        if(live == 0 || connect_errno != ECONNREFUSED) {
+                errno = EADDRINUSE;
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "connect");
+        }
+
+        if(unlink(path) == -1) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "unlink");
+
+        return LAW_ERR_OK;
+}
+
+/** Set an integer socket option unless value is 0. */
+static sel_err_t law_sockopt(
+        const int fd, 
+        const int level, 
+        const int name, 
+        const int value)
+{
+        if(value && setsockopt(fd, level, name, &value, sizeof(int)) == -1) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "setsockopt");
+        return LAW_ERR_OK;
+}
+
+/** Apply the options that belong on a listening or datagram socket. */
+static sel_err_t law_sockopts_bind(
+        const int fd, 
+        const int protocol, 
+        const law_sockopts_t *opts)
+{
+        const bool tcp = 
+                protocol == LAW_PROTOCOL_TCP || 
+                protocol == LAW_PROTOCOL_TCP6;
+
+        if(     law_sockopt(fd, SOL_SOCKET, SO_SNDBUF, opts->sndbuf) ||
+                law_sockopt(fd, SOL_SOCKET, SO_RCVBUF, opts->rcvbuf) ||
+                law_sockopt(fd, SOL_SOCKET, SO_BUSY_POLL, opts->busy_poll))
+                return LAW_ERR_SYS;
+
+        if(!tcp) return LAW_ERR_OK;
+
+        if(     law_sockopt(fd, IPPROTO_TCP, TCP_NODELAY, opts->nodelay) ||
+                law_sockopt(
+                        fd, 
+                        IPPROTO_TCP, 
+                        TCP_DEFER_ACCEPT, 
+                        opts->defer_accept) ||
+                law_sockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, opts->fastopen))
+                return LAW_ERR_SYS;
+
+        return LAW_ERR_OK;
+}
+
+/** 
+ * Apply the options that accepted sockets do not inherit, or that the 
+ * kernel may clear.  Failures only cost performance, so they are ignored.
+ */
+static void law_sockopts_accept(
+        const int fd, 
+        const int protocol, 
+        const law_sockopts_t *opts)
+{
+        if(protocol != LAW_PROTOCOL_TCP && protocol != LAW_PROTOCOL_TCP6) 
+                return;
+        (void)law_sockopt(fd, IPPROTO_TCP, TCP_NODELAY, opts->nodelay);
+        (void)law_sockopt(fd, IPPROTO_TCP, TCP_QUICKACK, opts->quickack);
+}
 
+/** Bind the socket to the listener's wildcard address, or to its path. */
+static sel_err_t law_socket_bind(const int fd, const law_listener_cfg_t *cfg)
+{
         struct sockaddr_storage addr;
         memset(&addr, 0, sizeof(struct sockaddr_storage));
         struct sockaddr_in *in = NULL;
         struct sockaddr_in6 *in6 = NULL;
+        struct sockaddr_un *un = NULL;
         unsigned int addrlen;
 
-        switch(server->cfg.protocol) {
+        switch(cfg->protocol) {
                 case LAW_PROTOCOL_TCP: 
-                        addrlen = sizeof(struct sockaddr_in);
-                        in = (struct sockaddr_in*)&addr;
-                        in->sin_family = AF_INET;
-                        in->sin_port = htons((uint16_t)server->cfg.port);
-                        in->sin_addr.s_addr = htonl(INADDR_ANY);
-                        break;
-                case LAW_PROTOCOL_TCP6:
-                        addrlen = sizeof(struct sockaddr_in6);
-                        in6 = (struct sockaddr_in6*)&addr;
-                        in6->sin6_family = AF_INET6;
-                        in6->sin6_port = htons((uint16_t)server->cfg.port);
-                        in6->sin6_addr = in6addr_any;
-                        break;
                 case LAW_PROTOCOL_UDP:
                         addrlen = sizeof(struct sockaddr_in);
                         in = (struct sockaddr_in*)&addr;
                         in->sin_family = AF_INET;
-                        in->sin_port = htons((uint16_t)server->cfg.port);
+                        in->sin_port = htons((uint16_t)cfg->port);
                         in->sin_addr.s_addr = htonl(INADDR_ANY);
                         break;
+                case LAW_PROTOCOL_TCP6:
                 case LAW_PROTOCOL_UDP6:
                         addrlen = sizeof(struct sockaddr_in6);
                         in6 = (struct sockaddr_in6*)&addr;
                         in6->sin6_family = AF_INET6;
-                        in6->sin6_port = htons((uint16_t)server->cfg.port);
+                        in6->sin6_port = htons((uint16_t)cfg->port);
                         in6->sin6_addr = in6addr_any;
                         break;
+                case LAW_PROTOCOL_UNIX:
+                        SEL_ASSERT(cfg->path);
+                        addrlen = sizeof(struct sockaddr_un);
+                        un = (struct sockaddr_un*)&addr;
+                        un->sun_family = AF_UNIX;
+                        if(strlen(cfg->path) >= sizeof(un->sun_path)) {
+                                errno = ENAMETOOLONG;
+                                return LAW_ERR_PUSH(LAW_ERR_SYS, "sun_path");
+                        }
+                        strcpy(un->sun_path, cfg->path);
+                        if(law_unlink_stale(cfg->path) != LAW_ERR_OK) 
+                                return LAW_ERR_PUSH(
+                                        LAW_ERR_SYS, 
+                                        "law_unlink_stale");
+                        break;
                 default: 
                         SEL_HALT();
         }
 
-        SEL_ASSERT(server->socket);
+        /* Connections the server closes first, such as overload rejections,
+         * leave TIME_WAIT entries that would otherwise block a restart. */
+        const int reuse = 1;
+        if(     (cfg->protocol == LAW_PROTOCOL_TCP || 
+                 cfg->protocol == LAW_PROTOCOL_TCP6) &&
+                setsockopt(
+                        fd, 
+                        SOL_SOCKET, 
+                        SO_REUSEADDR, 
+                        &reuse, 
+                        sizeof(int)) == -1)
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "setsockopt");
+
+        if(law_sockopts_bind(
+                fd, 
+                cfg->protocol, 
+                &cfg->sockopts) != LAW_ERR_OK) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "law_sockopts_bind");
 
-        if(bind(server->socket, (struct sockaddr*)&addr, addrlen) == -1) 
+        if(bind(fd, (struct sockaddr*)&addr, addrlen) == -1) 
                 return LAW_ERR_PUSH(LAW_ERR_SYS, "bind");
+
+        if(un && cfg->mode && chmod(cfg->path, (mode_t)cfg->mode) == -1) {
+                LAW_ERR_PUSH(LAW_ERR_SYS, "chmod");
+                (void)unlink(cfg->path);
+                return LAW_ERR_SYS;
+        }
         
         return LAW_ERR_OK;
 }
 
+sel_err_t law_create_socket(law_server_t *server, int *socket_fd)
+{
+        SEL_ASSERT(server);
+
+        int fd = -1;
+
+        if(law_socket_create(server->cfg.protocol, &fd) != LAW_ERR_OK) 
+                return SEL_ERR_SYS;
+
+        server->socket = fd;
+        if(socket_fd) *socket_fd = fd;
+
+        return SEL_ERR_OK;
+}
+
+sel_err_t law_bind_socket(law_server_t *server)
+{
+        SEL_ASSERT(server && server->socket);
+
+        const law_listener_cfg_t cfg = {
+                .protocol = server->cfg.protocol,
+                .port = server->cfg.port,
+                .path = server->cfg.unix_path,
+                .mode = server->cfg.unix_mode,
+                .sockopts = server->cfg.sockopts
+        };
+
+        return law_socket_bind(server->socket, &cfg);
+}
+
 sel_err_t law_listen(law_server_t *server)
 {
         SEL_ASSERT(server && server->socket);
@@ -854,116 +1247,312 @@ sel_err_t law_listen(law_server_t *server)
         return SEL_ERR_OK;
 }
 
-sel_err_t law_open(law_server_t *server)
+/** Open the workers of a server that has no listening socket. */
+static sel_err_t law_open_workers(law_server_t *server)
 {
-        SEL_ASSERT(server && server->socket);
-
-        sel_err_t error = LAW_ERR_SYS;
-        int n = 0; 
+        law_worker_t **ws = server->workers;
+        sel_err_t error = LAW_ERR_OK;
+        int n = 0;
 
-        int socket = 0;
+        for(; n < server->cfg.workers; ++n) {
+                if((error = law_worker_open(ws[n])) != LAW_ERR_OK) 
+                        goto CLOSE_WORKERS;
+        }
 
-        law_err_clear();
+        if(law_evo_open(server->evo) == -1) {
+                error = LAW_ERR_PUSH(LAW_ERR_SYS, "law_evo_open");
+                goto CLOSE_WORKERS;
+        }
 
-        if(law_create_socket(server, &socket) == LAW_ERR_SYS) 
-                return LAW_ERR_PUSH(LAW_ERR_SYS, "law_create_socket");
+        return LAW_ERR_OK;
 
-        if(law_bind_socket(server) == LAW_ERR_SYS) {
-                LAW_ERR_PUSH(LAW_ERR_SYS, "law_bind_socket");
-                goto CLOSE_SOCKET;
+        CLOSE_WORKERS:
+        for(int m = 0; m < n; ++m) {
+                law_worker_close(ws[m]);
         }
 
-        if(law_listen(server) == LAW_ERR_SYS) {
-                LAW_ERR_PUSH(LAW_ERR_SYS, "law_listen");
-                goto CLOSE_SOCKET;
-        }
+        return error;
+}
 
-        if(law_evo_open(server->evo) == -1) {
-                LAW_ERR_PUSH(LAW_ERR_SYS, "law_evo_open");
-                goto CLOSE_SOCKET;
-        }
+/** True when the server serves datagrams rather than connections. */
+static bool law_is_dgram(law_server_t *server)
+{
+        return  server->cfg.protocol == LAW_PROTOCOL_UDP ||
+                server->cfg.protocol == LAW_PROTOCOL_UDP6;
+}
 
-        law_event_t event = { .events = LAW_EV_R, .data = { .ptr = NULL } };
-        if(law_evo_ctl(
-                server->evo, 
-                server->socket, 
-                LAW_EV_ADD, 
-                0, 
-                &event) == -1) 
-        {
-                LAW_ERR_PUSH(LAW_ERR_SYS, "law_evo_ctl");
-                goto CLOSE_EVO;
+/** Destroy the workers' datagram sockets and buffers. */
+static void law_close_dgrams(law_server_t *server)
+{
+        for(int n = 0; n < server->cfg.workers; ++n) {
+                law_dgrams_destroy(server->workers[n]->dgrams);
+                server->workers[n]->dgrams = NULL;
         }
-                
+}
+
+/** 
+ * Give every worker its own socket bound to the port with SO_REUSEPORT, so
+ * the kernel spreads datagrams across workers without a shared queue. 
+ */
+static sel_err_t law_open_dgrams(law_server_t *server)
+{
+        SEL_ASSERT(server->cfg.on_dgrams);
+        SEL_ASSERT(0 < server->cfg.dgram_batch && server->cfg.dgram_size);
+
+        sel_err_t error = law_open_workers(server);
+        if(error != LAW_ERR_OK) return error;
 
         law_worker_t **ws = server->workers;
+        int fd = -1;
 
-        for(; n < server->cfg.workers; ++n) {
-                if((error = law_worker_open(ws[n])) != LAW_ERR_OK) {
-                        goto CLOSE_WORKERS;
+        for(int n = 0; n < server->cfg.workers; ++n) {
+
+                if(law_create_socket(server, &fd) == LAW_ERR_SYS) {
+                        error = LAW_ERR_PUSH(LAW_ERR_SYS, "law_create_socket");
+                        goto CLOSE_DGRAMS;
                 }
-        }
 
-        return LAW_ERR_OK;
+                const int one = 1;
+                if(setsockopt(
+                        fd, 
+                        SOL_SOCKET, 
+                        SO_REUSEPORT, 
+                        &one, 
+                        sizeof(one)) == -1) 
+                {
+                        error = LAW_ERR_PUSH(LAW_ERR_SYS, "setsockopt");
+                        goto CLOSE_SOCKET;
+                }
 
-        CLOSE_WORKERS:
-        for(int m = 0; m < n; ++m) {
-                law_worker_close(ws[m]);
+                if(law_bind_socket(server) == LAW_ERR_SYS) {
+                        error = LAW_ERR_PUSH(LAW_ERR_SYS, "law_bind_socket");
+                        goto CLOSE_SOCKET;
+                }
+
+                if(     server->cfg.sockopts.incoming_cpu && 
+                        setsockopt(
+                                fd, 
+                                SOL_SOCKET, 
+                                SO_INCOMING_CPU, 
+                                &n, 
+                                sizeof(n)) == -1) 
+                {
+                        error = LAW_ERR_PUSH(LAW_ERR_SYS, "setsockopt");
+                        goto CLOSE_SOCKET;
+                }
+
+                if(!(ws[n]->dgrams = law_dgrams_create(
+                        fd,
+                        (size_t)server->cfg.dgram_batch,
+                        server->cfg.dgram_size)))
+                {
+                        error = LAW_ERR_PUSH(LAW_ERR_OOM, "law_dgrams_create");
+                        goto CLOSE_SOCKET;
+                }
         }
 
-        CLOSE_EVO:
-        law_evo_close(server->evo);
+        server->socket = law_dgrams_fd(ws[0]->dgrams);
+
+        return LAW_ERR_OK;
 
         CLOSE_SOCKET:
-        close(socket);
+        close(fd);
+
+        CLOSE_DGRAMS:
+        law_close_dgrams(server);
+
+        for(int n = 0; n < server->cfg.workers; ++n) {
+                law_worker_close(ws[n]);
+        }
+        law_evo_close(server->evo);
 
         return error;
 }
 
-sel_err_t law_close(law_server_t *server)
+/** Close the listeners' sockets and remove their socket files. */
+static void law_close_listeners(law_server_t *server)
 {
-        if(!server) return SEL_ERR_OK;
-        for(int n = 0; n < server->cfg.workers; ++ n) {
-                law_worker_close(server->workers[n]);
+        for(int n = 0; n < server->num_listeners; ++n) {
+                law_listener_t *listener = server->listeners + n;
+                if(listener->socket == -1) continue;
+                close(listener->socket);
+                listener->socket = -1;
+                if(     listener->cfg.protocol == LAW_PROTOCOL_UNIX && 
+                        !server->handed_off) 
+                        (void)unlink(listener->cfg.path);
         }
-        law_evo_close(server->evo);
-        close(server->socket);
-        return SEL_ERR_OK;
 }
 
-sel_err_t law_ectl(
-        law_worker_t *worker,
-        int fd,
-        int op,
-        law_event_bits_t flags,
-        law_event_bits_t events,
-        int8_t data)
+/** Add the listeners' sockets to, or remove them from, the server's evo. */
+static sel_err_t law_watch_listeners(law_server_t *server, const int op)
 {
-        SEL_ASSERT(worker);
-
-        law_task_t *task = worker->active;
-        law_slot_t slot = { 
-                .id = task->id, 
-                .data = data };
-
         law_event_t event = { 
-                .events = events, 
-                .data = { .u64 = law_slot_encode(&slot) } };
-
-        if(law_evo_ctl(
-                worker->evo, 
-                fd, 
-                op, 
-                flags, 
-                &event) == -1) 
-        {
-                return LAW_ERR_SYS;
+                .events = op == LAW_EV_DEL ? 0 : LAW_EV_R, 
+                .data = { .ptr = NULL } 
+        };
+
+        for(int n = 0; n < server->num_listeners; ++n) {
+                if(law_evo_ctl(
+                        server->evo, 
+                        server->listeners[n].socket, 
+                        op, 
+                        0, 
+                        &event) == -1)
+                        return LAW_ERR_PUSH(LAW_ERR_SYS, "law_evo_ctl");
         }
 
         return LAW_ERR_OK;
 }
 
-int law_ewait(
+/** 
+ * Create, bind and listen on every listener's socket, except for sockets 
+ * inherited with law_handoff_recv, which are already listening.
+ */
+static sel_err_t law_open_listeners(law_server_t *server)
+{
+        for(int n = 0; n < server->num_listeners; ++n) {
+
+                law_listener_t *listener = server->listeners + n;
+                const law_listener_cfg_t *cfg = &listener->cfg;
+
+                if(listener->socket != -1) continue;
+
+                SEL_ASSERT(
+                        cfg->protocol == LAW_PROTOCOL_TCP || 
+                        cfg->protocol == LAW_PROTOCOL_TCP6 ||
+                        cfg->protocol == LAW_PROTOCOL_UNIX);
+                SEL_ASSERT(cfg->on_accept);
+
+                if(law_socket_create(
+                        cfg->protocol, 
+                        &listener->socket) != LAW_ERR_OK) 
+                {
+                        LAW_ERR_PUSH(LAW_ERR_SYS, "law_socket_create");
+                        goto CLOSE_LISTENERS;
+                }
+
+                if(law_socket_bind(listener->socket, cfg) != LAW_ERR_OK) {
+                        LAW_ERR_PUSH(LAW_ERR_SYS, "law_socket_bind");
+                        close(listener->socket);
+                        listener->socket = -1;
+                        goto CLOSE_LISTENERS;
+                }
+
+                if(listen(listener->socket, cfg->backlog) == -1) {
+                        LAW_ERR_PUSH(LAW_ERR_SYS, "listen");
+                        goto CLOSE_LISTENERS;
+                }
+        }
+
+        server->socket = server->listeners[0].socket;
+
+        return LAW_ERR_OK;
+
+        CLOSE_LISTENERS:
+        law_close_listeners(server);
+
+        return LAW_ERR_SYS;
+}
+
+sel_err_t law_open(law_server_t *server)
+{
+        SEL_ASSERT(server);
+
+        sel_err_t error = LAW_ERR_SYS;
+        int n = 0; 
+
+        law_err_clear();
+
+        if(server->cfg.protocol == LAW_PROTOCOL_NONE) 
+                return law_open_workers(server);
+
+        if(law_is_dgram(server)) 
+                return law_open_dgrams(server);
+
+        if(law_open_listeners(server) != LAW_ERR_OK) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "law_open_listeners");
+
+        if(law_evo_open(server->evo) == -1) {
+                LAW_ERR_PUSH(LAW_ERR_SYS, "law_evo_open");
+                goto CLOSE_LISTENERS;
+        }
+
+        if(law_watch_listeners(server, LAW_EV_ADD) != LAW_ERR_OK) {
+                LAW_ERR_PUSH(LAW_ERR_SYS, "law_watch_listeners");
+                goto CLOSE_EVO;
+        }
+
+        law_worker_t **ws = server->workers;
+
+        for(; n < server->cfg.workers; ++n) {
+                if((error = law_worker_open(ws[n])) != LAW_ERR_OK) {
+                        goto CLOSE_WORKERS;
+                }
+        }
+
+        return LAW_ERR_OK;
+
+        CLOSE_WORKERS:
+        for(int m = 0; m < n; ++m) {
+                law_worker_close(ws[m]);
+        }
+
+        CLOSE_EVO:
+        law_evo_close(server->evo);
+
+        CLOSE_LISTENERS:
+        law_close_listeners(server);
+
+        return error;
+}
+
+sel_err_t law_close(law_server_t *server)
+{
+        if(!server) return SEL_ERR_OK;
+        for(int n = 0; n < server->cfg.workers; ++ n) {
+                law_worker_close(server->workers[n]);
+        }
+        law_evo_close(server->evo);
+        if(law_is_dgram(server)) 
+                law_close_dgrams(server);
+        else if(server->cfg.protocol != LAW_PROTOCOL_NONE) 
+                law_close_listeners(server);
+        return SEL_ERR_OK;
+}
+
+sel_err_t law_ectl(
+        law_worker_t *worker,
+        int fd,
+        int op,
+        law_event_bits_t flags,
+        law_event_bits_t events,
+        int8_t data)
+{
+        SEL_ASSERT(worker);
+
+        law_task_t *task = worker->active;
+        law_slot_t slot = { 
+                .id = task->id, 
+                .data = data };
+
+        law_event_t event = { 
+                .events = events, 
+                .data = { .u64 = law_slot_encode(&slot) } };
+
+        if(law_evo_ctl(
+                worker->evo, 
+                fd, 
+                op, 
+                flags, 
+                &event) == -1) 
+        {
+                return LAW_ERR_SYS;
+        }
+
+        return LAW_ERR_OK;
+}
+
+int law_ewait(
         law_worker_t *w,
         law_time_t millis,
         law_event_t *events,
@@ -993,6 +1582,31 @@ int law_ewait(
         return num_events;
 }
 
+sel_err_t law_sleep(law_worker_t *w, law_time_t millis)
+{
+        SEL_ASSERT(w && w->active && 0 <= millis);
+
+        const law_time_t expiry = law_time_millis() + millis;
+
+        for(;;) {
+                const law_time_t now = law_time_millis();
+                if(expiry <= now) return LAW_ERR_OK;
+
+                const int err = law_ewait(w, expiry - now, NULL, 0);
+                if(err < 0) return err;
+        }
+}
+
+void law_yield(law_worker_t *w)
+{
+        SEL_ASSERT(w && w->active);
+
+        law_task_t *task = w->active;
+
+        (void)law_ready_set_push(&w->ready, task);
+        (void)law_cor_yield(w->caller, task->callee, LAW_MODE_SUSPENDED);
+}
+
 static bool law_spawn_dispatch_once(law_server_t *s, law_task_t *task)
 {
         int num_workers = s->cfg.workers;
@@ -1010,10 +1624,9 @@ static bool law_spawn_dispatch_once(law_server_t *s, law_task_t *task)
                 }
         }
 
-        law_event_t event = { .events = 0, .data = { .ptr = NULL } };
-        SEL_TEST(law_evo_ctl(s->evo, s->socket, LAW_EV_DEL, 0, &event) == 0);
-        
-        event.events = LAW_EV_W;
+        SEL_TEST(law_watch_listeners(s, LAW_EV_DEL) == LAW_ERR_OK);
+
+        law_event_t event = { .events = LAW_EV_W, .data = { .ptr = NULL } };
         for(int x = 0; x < num_workers; ++x) {
                 SEL_TEST(law_evo_ctl(
                         s->evo, 
@@ -1025,8 +1638,7 @@ static bool law_spawn_dispatch_once(law_server_t *s, law_task_t *task)
 
         SEL_TEST(law_evo_wait(s->evo, 100) != -1);
 
-        event.events = LAW_EV_R;
-        SEL_TEST(law_evo_ctl(s->evo, s->socket, LAW_EV_ADD, 0, &event) == 0);
+        SEL_TEST(law_watch_listeners(s, LAW_EV_ADD) == LAW_ERR_OK);
 
         event.events = 0;
         for(int x = 0; x < num_workers; ++x) {
@@ -1060,9 +1672,11 @@ sel_err_t law_spawn(
         law_task_setup(task, law_server_genid(server), callback, data);
 
         law_worker_t **ws = server->workers;
+        const int num_workers = server->cfg.workers;
 
-        for(int x = 0; x < server->cfg.workers; ++x) {
-                switch(law_task_queue_push(&ws[x]->incoming, task)) {
+        for(size_t x = 0; x < num_workers; ++x) {
+                const size_t index = (x + task->id) % (size_t)num_workers;
+                switch(law_task_queue_push(&ws[index]->incoming, task)) {
                         case LAW_ERR_WANTW: 
                                 continue; 
                         case LAW_ERR_OK: 
@@ -1075,6 +1689,44 @@ sel_err_t law_spawn(
         return LAW_ERR_WANTW;
 }
 
+law_id_t law_spawn_local(
+        law_worker_t *worker,
+        law_callback_t callback,
+        law_data_t data)
+{
+        SEL_ASSERT(worker && callback);
+
+        law_server_t *server = worker->server;
+
+        if(law_table_size(worker->table) > server->cfg.worker_tasks) 
+                return 0;
+
+        law_task_t *task = worker->supply;
+
+        if(task) {
+                worker->supply = task->next;
+                task->next = NULL;
+                --worker->supply_size;
+        } else if(!(task = law_task_pool_pop(server->pool))) {
+                return 0;
+        }
+
+        task->id = law_worker_genid(worker);
+        task->callback = callback;
+        task->data = data;
+        task->accepted = 0;
+        task->mode = LAW_MODE_SPAWNED;
+
+        SEL_TEST(law_table_insert(
+                worker->table, 
+                task->id, 
+                task) == PMT_HM_SUCCESS);
+
+        (void)law_ready_set_push(&worker->ready, task);
+
+        return task->id;
+}
+
 static sel_err_t law_sync_wait(
         law_worker_t *w,
         law_time_t timeout,
@@ -1142,14 +1794,81 @@ static int law_task_cor_trampoline(
         return task->callback(worker, task->data);
 }
 
+/** 
+ * Return a finished task to the worker's supply, or to the pool.  While 
+ * the server is waiting on the pool to accept, it goes to the pool.
+ */
+static void law_worker_release(law_worker_t *w, law_task_t *task)
+{
+        if(w->supply_size < w->server->cfg.worker_supply && 
+           !atomic_load(&w->server->starved)) {
+                task->next = w->supply;
+                w->supply = task;
+                ++w->supply_size;
+        } else {
+                law_task_pool_push(w->server->pool, task);
+        }
+}
+
+/** 
+ * Move every task in the supply back to the pool.  The server waits for 
+ * the pool to fill before shutting down, so an idle worker keeps nothing,
+ * and neither does a busy one while accepts wait on the pool.
+ */
+static void law_worker_drain_supply(law_worker_t *w)
+{
+        while(w->supply) {
+                law_task_t *task = w->supply;
+                w->supply = task->next;
+                task->next = NULL;
+                law_task_pool_push(w->server->pool, task);
+        }
+        w->supply_size = 0;
+}
+
+static void law_turn_away(
+        law_server_t *server, 
+        const int index, 
+        const int fd);
+
+/** 
+ * Shed an accepted connection that has not started yet, if the worker's 
+ * queue delay controller says so.
+ */
+static bool law_worker_shed(law_worker_t *w, law_task_t *task)
+{
+        if(!task->accepted || !w->codel.target) 
+                return false;
+
+        if(law_codel_admit(&w->codel, task->accepted, law_codel_nanos())) 
+                return false;
+
+        law_turn_away(
+                w->server, 
+                (int)(task->data.u64 >> 32), 
+                (int)(uint32_t)task->data.u64);
+
+        SEL_TEST(law_table_remove(w->table, task->id) == task);
+        law_worker_release(w, task);
+
+        return true;
+}
+
 static void law_worker_dispatch(law_worker_t *w)
 {
         law_task_t *task = NULL;
 
-        while((task = law_ready_set_pop(&w->ready))) {
+        /* Tasks made ready during this round (yields, local spawns and 
+         * wakeups) run in the next tick, after the worker polls for I/O. */
+        size_t round = w->ready.size;
+
+        while(round-- && (task = law_ready_set_pop(&w->ready))) {
 
                 SEL_ASSERT(task && task->next == NULL && !task->mark);
 
+                if(task->mode == LAW_MODE_SPAWNED && law_worker_shed(w, task))
+                        continue;
+
                 ++task->version;
                 w->active = task;
 
@@ -1158,6 +1877,7 @@ static void law_worker_dispatch(law_worker_t *w)
                 switch(task->mode) {
                         case LAW_MODE_SPAWNED:
                                 task->mode = LAW_MODE_RUNNING;
+                                law_arena_init(&task->arena, w->slab);
                                 signal = law_cor_call(
                                         w->caller, 
                                         task->callee, 
@@ -1182,11 +1902,15 @@ static void law_worker_dispatch(law_worker_t *w)
                 }
  
                 SEL_TEST(law_table_remove(w->table, task->id) == task);
-                
-                law_task_pool_push(w->server->pool, task);
+
+                law_arena_reset(&task->arena);
+                law_worker_release(w, task);
 
                 task = NULL;
         }
+
+        if(!law_table_size(w->table) || atomic_load(&w->server->starved)) 
+                law_worker_drain_supply(w);
 }
 
 static bool law_worker_tick(law_worker_t *worker)
@@ -1195,8 +1919,6 @@ static bool law_worker_tick(law_worker_t *worker)
         law_timer_t *timer = worker->timer;
         law_ready_set_t *ready = &worker->ready;
         law_table_t *table = worker->table;
-        law_on_error_t on_error = server->cfg.on_error;
-        law_data_t data = server->cfg.data;
 
         law_time_t 
                 timeout = server->cfg.worker_timeout,
@@ -1216,6 +1938,8 @@ static bool law_worker_tick(law_worker_t *worker)
                         timeout = timeout < wake ? timeout : wake;
                 }
         }
+
+        if(ready->size) timeout = 0;
        
         SEL_TEST(law_evo_wait(worker->evo, (int)timeout) >= 0);
 
@@ -1233,17 +1957,11 @@ static bool law_worker_tick(law_worker_t *worker)
 
                 SEL_TEST(law_timer_pop(timer, NULL, NULL, NULL));
 
+                /* A timer outlives a wait that ended early or a task that 
+                 * finished; such stale timers are expected and dropped. */
                 law_task_t *task = law_table_lookup(table, id);
-                if(!task) {
-                        LAW_ERR_PUSH(LAW_ERR_NOID, "law_table_lookup");
-                        (void)on_error(server, LAW_ERR_NOID, data);
+                if(!task || task->version != version) 
                         continue;
-                }
-                if(task->version != version) {
-                        LAW_ERR_PUSH(LAW_ERR_VERS, "law_table_lookup");
-                        (void)on_error(server, LAW_ERR_VERS, data);
-                        continue;
-                }
 
                 (void)law_task_push_event(task, &event);
                 (void)law_ready_set_push(ready, task);
@@ -1285,6 +2003,10 @@ static bool law_worker_tick(law_worker_t *worker)
 
                         reloop = false;
 
+                } else if(msg.type == LAW_MSG_DRAIN) {
+
+                        law_worker_drain_supply(worker);
+
                 } else if(msg.type == LAW_MSG_WAKEUP) {
 
                         law_task_t *task = law_table_lookup(
@@ -1335,22 +2057,108 @@ static void *law_worker_thread(void *state)
         return NULL;
 }
 
+/* Accepted connections carry the listener index in the high 32 bits of the 
+ * task data and the socket in the low 32 bits. */
+
 static sel_err_t law_accept_callback(law_worker_t *worker, law_data_t data)
 {
         law_server_t *s = worker->server;
-        return s->cfg.on_accept(worker, data.fd, s->cfg.data);
+        law_listener_t *listener = s->listeners + (data.u64 >> 32);
+        const int fd = (int)(uint32_t)data.u64;
+        return listener->cfg.on_accept(worker, fd, listener->cfg.data);
+}
+
+/** 
+ * Write the listener's overload reply to a connection and close it.  The 
+ * reply is a single best effort send; a client whose receive window cannot
+ * take it just sees the connection close.
+ */
+static void law_turn_away(
+        law_server_t *server, 
+        const int index, 
+        const int fd)
+{
+        law_listener_t *listener = server->listeners + index;
+
+        if(listener->overload_len) {
+                char scratch[512];
+
+                /* Unread request bytes would turn the close into a reset 
+                 * that discards the reply, so read what already arrived. */
+                (void)recv(fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+                (void)send(
+                        fd, 
+                        listener->overload_reply, 
+                        listener->overload_len, 
+                        MSG_DONTWAIT | MSG_NOSIGNAL);
+                (void)shutdown(fd, SHUT_WR);
+        }
+        close(fd);
+}
+
+/** 
+ * Have the workers hand back their supplies until the listener runs dry.  
+ * Workers parked on I/O are woken to return theirs at once.
+ */
+static void law_server_starve(law_server_t *server)
+{
+        if(atomic_exchange(&server->starved, true)) 
+                return;
+
+        law_msg_t msg;
+        memset(&msg, 0, sizeof(law_msg_t));
+        msg.type = LAW_MSG_DRAIN;
+
+        for(int n = 0; n < server->cfg.workers; ++n) 
+                (void)law_msg_queue_push(&server->workers[n]->messages, &msg);
+}
+
+/** Accept and turn away connections while the task pool is empty. */
+static sel_err_t law_server_reject(law_server_t *server, const int index)
+{
+        const int socket = server->listeners[index].socket;
+
+        while(law_task_pool_is_empty(server->pool)) {
+
+                const int fd = accept(socket, NULL, NULL);
+
+                if(fd == -1) {
+                        if(errno == EAGAIN || errno == EWOULDBLOCK) 
+                                return LAW_ERR_OK;
+                        if(errno == ECONNABORTED || errno == EPROTO) 
+                                continue;
+                        return LAW_ERR_PUSH(LAW_ERR_SYS, "accept");
+                }
+
+                law_turn_away(server, index, fd);
+
+                atomic_fetch_add(&server->rejected, 1);
+        }
+
+        return LAW_ERR_OK;
 }
 
-static sel_err_t law_server_accept(law_server_t *server) 
+/** 
+ * Accept until the listener would block.
+ * 
+ * RETURNS: LAW_ERR_OK, LAW_ERR_LIMIT (out of tasks), LAW_ERR_SYS
+ */
+static sel_err_t law_server_accept(law_server_t *server, const int index) 
 {
-        while(!law_task_pool_is_empty(server->pool)) {
+        law_task_t *task = NULL;
+        const int socket = server->listeners[index].socket;
+
+        /* Workers draw from the pool as well, so take the task first. */
+        while((task = law_task_pool_pop(server->pool))) {
 
                 law_err_clear();
 
-                const int fd = accept(server->socket, NULL, NULL);
+                const int fd = accept(socket, NULL, NULL);
 
                 if(fd == -1) {
+                        law_task_pool_push(server->pool, task);
                         if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                                atomic_store(&server->starved, false);
                                 return LAW_ERR_OK;
                         }
                         LAW_ERR_PUSH(LAW_ERR_SYS, "accept");
@@ -1377,46 +2185,192 @@ static sel_err_t law_server_accept(law_server_t *server)
 
                 const int flags = fcntl(fd, F_GETFL);
                 if(flags == -1) {
+                        law_task_pool_push(server->pool, task);
                         close(fd);
                         return LAW_ERR_PUSH(SEL_ERR_SYS, "fcntl");
                 }
 
                 if(fcntl(fd, F_SETFL, O_NONBLOCK | flags) == -1) {
+                        law_task_pool_push(server->pool, task);
                         close(fd);
                         return LAW_ERR_PUSH(SEL_ERR_SYS, "fcntl"); 
                 }
 
-                law_task_t *const task = law_task_pool_pop(server->pool);
-                SEL_TEST(task);
+                law_sockopts_accept(
+                        fd, 
+                        server->listeners[index].cfg.protocol,
+                        &server->listeners[index].cfg.sockopts);
 
-                law_data_t data = { .fd = fd };
+                law_data_t data = { 
+                        .u64 = (uint64_t)index << 32 | (uint32_t)fd 
+                };
 
                 (void)law_task_setup(
                         task, 
                         law_server_genid(server), 
                         law_accept_callback, 
                         data);
+                task->accepted = law_codel_nanos();
                 
                 law_spawn_dispatch(server, task);
         }
 
-        law_time_sleep(75);
+        law_server_starve(server);
+
+        if(server->cfg.overload == LAW_OVERLOAD_REJECT) 
+                return law_server_reject(server, index);
+
+        return LAW_ERR_LIMIT;
+}
+
+/** Accept on every listener, starting after the last one to run dry. */
+static sel_err_t law_server_accept_all(law_server_t *server)
+{
+        const int num = server->num_listeners;
+
+        for(int x = 0; x < num; ++x) {
+
+                const int index = (server->next_listener + x) % num;
+
+                const sel_err_t err = law_server_accept(server, index);
+
+                if(err == LAW_ERR_LIMIT) {
+                        server->next_listener = (index + 1) % num;
+                        law_time_sleep(75);
+                        return LAW_ERR_OK;
+                }
+
+                if(err != LAW_ERR_OK) 
+                        return err;
+        }
 
         return LAW_ERR_OK;
 }
 
+static sel_err_t law_dgram_flush_cb(int fd, void *state)
+{
+        return law_dgrams_flush(state);
+}
+
+/** Send the queued datagrams, waiting for the socket when it is full. */
+static void law_dgram_flush(law_worker_t *worker, law_dgrams_t *dgrams)
+{
+        law_server_t *s = worker->server;
+        const int fd = law_dgrams_fd(dgrams);
+
+        sel_err_t err = law_dgrams_flush(dgrams);
+
+        if(err == LAW_ERR_WANTW) {
+                err = law_sync(
+                        worker, 
+                        s->cfg.worker_timeout, 
+                        law_dgram_flush_cb,
+                        fd, 
+                        dgrams);
+                (void)law_ectl(worker, fd, LAW_EV_MOD, 0, LAW_EV_R, 0);
+        }
+
+        if(err != LAW_ERR_OK) {
+                law_dgrams_discard(dgrams);
+                if(s->cfg.on_error) (void)s->cfg.on_error(s, err, s->cfg.data);
+        }
+}
+
+/** Receive batches on the worker's socket until the server stops. */
+static sel_err_t law_dgram_callback(law_worker_t *worker, law_data_t data)
+{
+        law_server_t *s = worker->server;
+        law_dgrams_t *dgrams = worker->dgrams;
+        const int fd = law_dgrams_fd(dgrams);
+
+        sel_err_t err = law_ectl(worker, fd, LAW_EV_ADD, 0, LAW_EV_R, 0);
+        if(err != LAW_ERR_OK) 
+                return LAW_ERR_PUSH(err, "law_ectl");
+
+        while(s->mode == LAW_MODE_RUNNING) {
+
+                err = law_dgrams_recv(dgrams);
+
+                if(err == LAW_ERR_WANTR) {
+                        (void)law_ewait(worker, s->cfg.worker_timeout, NULL, 0);
+                        continue;
+                }
+
+                if(err != LAW_ERR_OK) {
+                        if(s->cfg.on_error) 
+                                (void)s->cfg.on_error(s, err, s->cfg.data);
+                        (void)law_sleep(worker, 1);
+                        continue;
+                }
+
+                (void)s->cfg.on_dgrams(worker, dgrams, s->cfg.data);
+
+                law_dgram_flush(worker, dgrams);
+
+                /* A busy socket must not starve the worker's other tasks. */
+                law_yield(worker);
+        }
+
+        (void)law_ectl(worker, fd, LAW_EV_DEL, 0, 0, 0);
+
+        return LAW_ERR_OK;
+}
+
+/** Start one datagram receiver task on every worker. */
+static void law_server_start_dgrams(law_server_t *s)
+{
+        for(int n = 0; n < s->cfg.workers; ++n) {
+
+                law_task_t *task = law_task_pool_pop(s->pool);
+                SEL_ASSERT(task);
+
+                s->workers[n]->dgram_task = law_server_genid(s);
+                (void)law_task_setup(
+                        task, 
+                        s->workers[n]->dgram_task, 
+                        law_dgram_callback, 
+                        (law_data_t){ .ptr = NULL });
+
+                SEL_TEST(law_task_queue_push(
+                        &s->workers[n]->incoming, 
+                        task) == LAW_ERR_OK);
+        }
+}
+
+/** Wake every datagram receiver task to see that the server stopped. */
+static void law_server_stop_dgrams(law_server_t *s)
+{
+        for(int n = 0; n < s->cfg.workers; ++n) 
+                (void)law_worker_wake(
+                        NULL, 
+                        s->workers[n], 
+                        s->workers[n]->dgram_task);
+}
+
 static sel_err_t law_server_spin(law_server_t *s)
 {
         sel_err_t error = LAW_ERR_OK;
 
+        const bool accepts = 
+                s->cfg.protocol != LAW_PROTOCOL_NONE && !law_is_dgram(s);
+
+        if(law_is_dgram(s)) 
+                law_server_start_dgrams(s);
+
         while(s->mode == LAW_MODE_RUNNING) {
 
-                error = law_server_accept(s);
-                if(error != LAW_ERR_OK) break;
+                if(accepts) {
+                        error = law_server_accept_all(s);
+                        if(error != LAW_ERR_OK) break;
+                }
 
                 SEL_TEST(law_evo_wait(s->evo, s->cfg.server_timeout) >= 0);
         }
 
+        /* Datagram tasks wait for a whole worker_timeout; end that now. */
+        if(law_is_dgram(s)) 
+                law_server_stop_dgrams(s);
+
         while(!law_task_pool_is_full(s->pool)) {
                 law_time_sleep(50);
         }
@@ -1467,9 +2421,14 @@ sel_err_t law_start(law_server_t *s)
         if(s->mode != LAW_MODE_CREATED) 
                 return LAW_ERR_MODE;
 
+        if(law_opool_start(s->opool) != LAW_ERR_OK)
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "law_opool_start");
+
         s->mode = LAW_MODE_RUNNING;
         
         sel_err_t error = law_server_run_threads(s);
+
+        law_opool_stop(s->opool);
         
         s->mode = LAW_MODE_STOPPED;
         
@@ -1485,3 +2444,258 @@ sel_err_t law_stop(law_server_t *s)
         
         return LAW_ERR_OK;
 }
+
+/* hot restart ########################################################### */
+
+/** Fill addr with the Unix socket path. */
+static sel_err_t law_handoff_addr(struct sockaddr_un *addr, const char *path)
+{
+        memset(addr, 0, sizeof(struct sockaddr_un));
+        addr->sun_family = AF_UNIX;
+        if(strlen(path) >= sizeof(addr->sun_path)) {
+                errno = ENAMETOOLONG;
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "sun_path");
+        }
+        strcpy(addr->sun_path, path);
+        return LAW_ERR_OK;
+}
+
+/** Send the listener count along with the listener sockets. */
+static sel_err_t law_handoff_sendmsg(law_server_t *server, const int peer)
+{
+        const int count = server->num_listeners;
+        const size_t fds_len = sizeof(int) * (size_t)count;
+
+        unsigned char *control = calloc(1, CMSG_SPACE(fds_len));
+        if(!control) 
+                return LAW_ERR_PUSH(LAW_ERR_OOM, "calloc");
+
+        uint32_t header = (uint32_t)count;
+        struct iovec iov = { .iov_base = &header, .iov_len = sizeof(header) };
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(struct msghdr));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(fds_len);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(fds_len);
+
+        for(int n = 0; n < count; ++n) {
+                memcpy(
+                        CMSG_DATA(cmsg) + sizeof(int) * (size_t)n, 
+                        &server->listeners[n].socket, 
+                        sizeof(int));
+        }
+
+        const ssize_t sent = sendmsg(peer, &msg, MSG_NOSIGNAL);
+
+        free(control);
+
+        if(sent != sizeof(header)) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "sendmsg");
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t law_handoff_send(
+        law_server_t *server, 
+        const char *path, 
+        law_time_t timeout)
+{
+        SEL_ASSERT(server && path && 0 <= timeout);
+
+        /* Datagram sockets belong to the workers, not to listeners. */
+        if(law_is_dgram(server)) 
+                return LAW_ERR_MODE;
+
+        for(int n = 0; n < server->num_listeners; ++n) {
+                SEL_ASSERT(server->listeners[n].socket != -1);
+        }
+
+        struct sockaddr_un addr;
+        sel_err_t error = LAW_ERR_SYS;
+
+        if(law_handoff_addr(&addr, path) != LAW_ERR_OK) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "law_handoff_addr");
+
+        if(law_unlink_stale(path) != LAW_ERR_OK) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "law_unlink_stale");
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd == -1) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "socket");
+
+        if(bind(fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_un)) == -1) {
+                LAW_ERR_PUSH(LAW_ERR_SYS, "bind");
+                goto CLOSE_SOCKET;
+        }
+
+        if(listen(fd, 1) == -1) {
+                LAW_ERR_PUSH(LAW_ERR_SYS, "listen");
+                goto UNLINK_PATH;
+        }
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+
+        const int ready = poll(&pfd, 1, (int)timeout);
+        if(ready == -1) {
+                LAW_ERR_PUSH(LAW_ERR_SYS, "poll");
+                goto UNLINK_PATH;
+        } else if(ready == 0) {
+                error = LAW_ERR_PUSH(LAW_ERR_TIME, "poll");
+                goto UNLINK_PATH;
+        }
+
+        const int peer = accept(fd, NULL, NULL);
+        if(peer == -1) {
+                LAW_ERR_PUSH(LAW_ERR_SYS, "accept");
+                goto UNLINK_PATH;
+        }
+
+        if((error = law_handoff_sendmsg(server, peer)) == LAW_ERR_OK) 
+                server->handed_off = true;
+
+        close(peer);
+
+        UNLINK_PATH:
+        (void)unlink(path);
+
+        CLOSE_SOCKET:
+        close(fd);
+
+        return error;
+}
+
+/** Receive the listener sockets sent by law_handoff_sendmsg. */
+static sel_err_t law_handoff_recvmsg(law_server_t *server, const int peer)
+{
+        const int count = server->num_listeners;
+        const size_t fds_len = sizeof(int) * (size_t)count;
+
+        unsigned char *control = calloc(1, CMSG_SPACE(fds_len));
+        if(!control) 
+                return LAW_ERR_PUSH(LAW_ERR_OOM, "calloc");
+
+        uint32_t header = 0;
+        struct iovec iov = { .iov_base = &header, .iov_len = sizeof(header) };
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(struct msghdr));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(fds_len);
+
+        sel_err_t error = LAW_ERR_OK;
+
+        const ssize_t received = recvmsg(peer, &msg, MSG_CMSG_CLOEXEC);
+        if(received == -1) {
+                error = (errno == EAGAIN || errno == EWOULDBLOCK) ?
+                        LAW_ERR_PUSH(LAW_ERR_TIME, "recvmsg") : 
+                        LAW_ERR_PUSH(LAW_ERR_SYS, "recvmsg");
+                goto FREE_CONTROL;
+        }
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+        const bool valid = 
+                received == sizeof(header) &&
+                header == (uint32_t)count &&
+                !(msg.msg_flags & MSG_CTRUNC) &&
+                cmsg && 
+                cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_RIGHTS &&
+                cmsg->cmsg_len == CMSG_LEN(fds_len);
+
+        for(int n = 0; cmsg && cmsg->cmsg_type == SCM_RIGHTS; ++n) {
+                const size_t offset = sizeof(int) * (size_t)n;
+                if(CMSG_LEN(offset + sizeof(int)) > cmsg->cmsg_len) break;
+                int fd = -1;
+                memcpy(&fd, CMSG_DATA(cmsg) + offset, sizeof(int));
+                if(valid) server->listeners[n].socket = fd;
+                else close(fd);
+        }
+
+        if(!valid) {
+                errno = EPROTO;
+                error = LAW_ERR_PUSH(LAW_ERR_SYS, "recvmsg");
+                goto FREE_CONTROL;
+        }
+
+        server->socket = server->listeners[0].socket;
+
+        FREE_CONTROL:
+        free(control);
+
+        return error;
+}
+
+sel_err_t law_handoff_recv(
+        law_server_t *server, 
+        const char *path, 
+        law_time_t timeout)
+{
+        SEL_ASSERT(server && path && 0 <= timeout);
+        SEL_ASSERT(server->mode == LAW_MODE_CREATED);
+
+        if(law_is_dgram(server)) 
+                return LAW_ERR_MODE;
+
+        struct sockaddr_un addr;
+
+        if(law_handoff_addr(&addr, path) != LAW_ERR_OK) 
+                return LAW_ERR_PUSH(LAW_ERR_SYS, "law_handoff_addr");
+
+        const law_time_t expiry = law_time_millis() + timeout;
+        int fd = -1;
+
+        /* The old process may not be listening yet. */
+        for(;;) {
+                if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) 
+                        return LAW_ERR_PUSH(LAW_ERR_SYS, "socket");
+
+                if(connect(
+                        fd, 
+                        (struct sockaddr*)&addr, 
+                        sizeof(struct sockaddr_un)) == 0) 
+                        break;
+
+                const int connect_errno = errno;
+                close(fd);
+
+                if(connect_errno != ENOENT && connect_errno != ECONNREFUSED) {
+                        errno = connect_errno;
+                        return LAW_ERR_PUSH(LAW_ERR_SYS, "connect");
+                }
+
+                if(expiry <= law_time_millis()) 
+                        return LAW_ERR_PUSH(LAW_ERR_TIME, "connect");
+
+                law_time_sleep(10);
+        }
+
+        law_time_t remaining = expiry - law_time_millis();
+        if(remaining < 1) remaining = 1;
+
+        struct timeval tv = { 
+                .tv_sec = remaining / 1000, 
+                .tv_usec = (remaining % 1000) * 1000 
+        };
+
+        sel_err_t error = LAW_ERR_OK;
+
+        if(setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == -1) {
+                error = LAW_ERR_PUSH(LAW_ERR_SYS, "setsockopt");
+        } else {
+                error = law_handoff_recvmsg(server, fd);
+        }
+
+        close(fd);
+
+        return error;
+}
@@ -0,0 +1,136 @@
+
+#include "lawd/private/arena.h"
+#include "lawd/error.h"
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+void test_slab_create_destroy()
+{
+        SEL_INFO();
+
+        law_slab_t *slab = law_slab_create(100, 4);
+        assert(slab);
+        assert(slab->chunk_length % _Alignof(max_align_t) == 0);
+        assert(slab->chunk_length >= 100);
+        law_slab_destroy(slab);
+}
+
+void test_arena_alloc()
+{
+        SEL_INFO();
+
+        law_slab_t *slab = law_slab_create(256, 4);
+        law_arena_t arena;
+        law_arena_init(&arena, slab);
+
+        char *a = law_arena_alloc(&arena, 1);
+        char *b = law_arena_alloc(&arena, 3);
+        char *c = law_arena_alloc(&arena, 0);
+
+        assert(a && b && c);
+        assert((uintptr_t)a % _Alignof(max_align_t) == 0);
+        assert((uintptr_t)b % _Alignof(max_align_t) == 0);
+        assert((uintptr_t)c % _Alignof(max_align_t) == 0);
+        assert(a < b && b < c);
+        assert(slab->num_chunks == 1);
+
+        /* Growing past the first chunk takes another one from the slab. */
+        char *d = law_arena_alloc(&arena, 240);
+        assert(d);
+        memset(d, 0xFF, 240);
+        assert(slab->num_chunks == 2);
+
+        /* Oversized requests get a dedicated chunk. */
+        char *e = law_arena_alloc(&arena, 1000);
+        assert(e);
+        memset(e, 0xFF, 1000);
+        assert(slab->num_chunks == 3);
+
+        /* Small requests after it keep filling the current chunk. */
+        char *f = law_arena_calloc(&arena, 16);
+        assert(f && f[0] == 0 && f[15] == 0);
+        assert(f == d + 240);
+        assert(slab->num_chunks == 3);
+
+        law_arena_reset(&arena);
+        law_slab_destroy(slab);
+}
+
+void test_arena_reset()
+{
+        SEL_INFO();
+
+        law_slab_t *slab = law_slab_create(256, 1);
+        law_arena_t arena;
+        law_arena_init(&arena, slab);
+
+        assert(law_arena_alloc(&arena, 200));
+        assert(law_arena_alloc(&arena, 200));
+        assert(law_arena_alloc(&arena, 1000));
+        assert(slab->num_chunks == 3);
+
+        /* Only one standard chunk fits in the cache. */
+        law_arena_reset(&arena);
+        assert(slab->num_chunks == 1);
+        assert(slab->num_cached == 1);
+
+        char *a = law_arena_alloc(&arena, 8);
+        assert(a);
+        assert(slab->num_chunks == 1);
+        assert(slab->num_cached == 0);
+
+        law_arena_reset(&arena);
+        law_slab_destroy(slab);
+}
+
+void test_arena_stats()
+{
+        SEL_INFO();
+
+        law_slab_t *slab = law_slab_create(256, 4);
+        law_arena_t arena;
+        law_arena_stats_t stats;
+
+        law_arena_init(&arena, slab);
+        assert(law_arena_alloc(&arena, 100));
+        assert(law_arena_alloc(&arena, 100));
+
+        law_arena_stats(&arena, &stats);
+        assert(stats.used >= 200);
+        assert(stats.reserved == slab->chunk_length);
+        assert(stats.high_water == stats.used);
+        assert(stats.slab_high_water == stats.used);
+        assert(stats.slab_chunks == 1);
+        assert(stats.slab_cached == 0);
+
+        const size_t peak = stats.used;
+
+        law_arena_reset(&arena);
+        assert(law_arena_alloc(&arena, 16));
+
+        law_arena_stats(&arena, &stats);
+        assert(stats.used == 16);
+        assert(stats.high_water == peak);
+        assert(stats.slab_high_water == peak);
+
+        /* A fresh arena keeps the slab's peak but starts its own. */
+        law_arena_reset(&arena);
+        law_arena_init(&arena, slab);
+        law_arena_stats(&arena, &stats);
+        assert(stats.high_water == 0);
+        assert(stats.slab_high_water == peak);
+        assert(stats.slab_cached == 1);
+
+        law_slab_destroy(slab);
+}
+
+int main(int argc, char **args)
+{
+        SEL_INFO();
+
+        test_slab_create_destroy();
+        test_arena_alloc();
+        test_arena_reset();
+        test_arena_stats();
+}
@@ -0,0 +1,312 @@
+
+#include "lawd/channel.h"
+#include <assert.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define TEST_MESSAGES 10000
+
+void test_chan_create_destroy()
+{
+        SEL_INFO();
+
+        law_chan_t *chan = law_chan_create(sizeof(int), 5);
+        assert(chan);
+        assert(law_chan_capacity(chan) == 8);
+        law_chan_destroy(chan);
+}
+
+void test_chan_try_send_recv()
+{
+        SEL_INFO();
+
+        law_chan_t *chan = law_chan_create(sizeof(int), 4);
+        int x = 0;
+
+        for(int n = 0; n < 4; ++n) {
+                assert(law_chan_try_send(NULL, chan, &n) == LAW_ERR_OK);
+        }
+        assert(law_chan_try_send(NULL, chan, &x) == LAW_ERR_WANTW);
+
+        for(int n = 0; n < 4; ++n) {
+                assert(law_chan_try_recv(NULL, chan, &x) == LAW_ERR_OK);
+                assert(x == n);
+        }
+        assert(law_chan_try_recv(NULL, chan, &x) == LAW_ERR_WANTR);
+
+        x = 7;
+        assert(law_chan_try_send(NULL, chan, &x) == LAW_ERR_OK);
+        law_chan_close(NULL, chan);
+        assert(law_chan_try_send(NULL, chan, &x) == LAW_ERR_EOF);
+        x = 0;
+        assert(law_chan_try_recv(NULL, chan, &x) == LAW_ERR_OK);
+        assert(x == 7);
+        assert(law_chan_try_recv(NULL, chan, &x) == LAW_ERR_EOF);
+
+        law_chan_destroy(chan);
+}
+
+typedef struct test_chan_state {
+        law_server_t *server;
+        law_chan_t *chan;
+        atomic_int done;
+        int producer_worker;
+        int consumer_worker;
+        long sum;
+        int received;
+        sel_err_t timeout_error;
+} test_chan_state_t;
+
+sel_err_t test_chan_on_error(
+        law_server_t *server,
+        sel_err_t error,
+        law_data_t data)
+{
+        return LAW_ERR_OK;
+}
+
+sel_err_t test_chan_producer(law_worker_t *worker, law_data_t data)
+{
+        test_chan_state_t *state = data.ptr;
+        state->producer_worker = law_get_worker_id(worker);
+
+        for(int n = 1; n <= TEST_MESSAGES; ++n) {
+                assert(law_chan_send(worker, 5000, state->chan, &n) ==
+                        LAW_ERR_OK);
+        }
+        law_chan_close(worker, state->chan);
+
+        if(atomic_fetch_add(&state->done, 1) == 1)
+                law_stop(state->server);
+
+        return LAW_ERR_OK;
+}
+
+sel_err_t test_chan_consumer(law_worker_t *worker, law_data_t data)
+{
+        test_chan_state_t *state = data.ptr;
+        state->consumer_worker = law_get_worker_id(worker);
+
+        int x = 0;
+        sel_err_t err;
+
+        while((err = law_chan_recv(worker, 5000, state->chan, &x)) ==
+                LAW_ERR_OK)
+        {
+                state->sum += x;
+                state->received += 1;
+        }
+        assert(err == LAW_ERR_EOF);
+
+        if(atomic_fetch_add(&state->done, 1) == 1)
+                law_stop(state->server);
+
+        return LAW_ERR_OK;
+}
+
+void test_chan_pipeline(const int workers)
+{
+        SEL_INFO();
+
+        test_chan_state_t state;
+        memset(&state, 0, sizeof(test_chan_state_t));
+        atomic_init(&state.done, 0);
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_NONE;
+        cfg.workers = workers;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.on_error = test_chan_on_error;
+
+        law_server_t *server = law_server_create(&cfg);
+        state.server = server;
+        state.chan = law_chan_create(sizeof(int), 4);
+
+        assert(law_open(server) == LAW_ERR_OK);
+        assert(law_spawn(
+                server,
+                test_chan_consumer,
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_spawn(
+                server,
+                test_chan_producer,
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_start(server) == LAW_ERR_OK);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(state.received == TEST_MESSAGES);
+        assert(state.sum == (long)TEST_MESSAGES * (TEST_MESSAGES + 1) / 2);
+        if(workers == 1) {
+                assert(state.producer_worker == state.consumer_worker);
+        } else {
+                assert(state.producer_worker != state.consumer_worker);
+        }
+
+        law_chan_destroy(state.chan);
+        law_server_destroy(server);
+}
+
+sel_err_t test_chan_timeout_task(law_worker_t *worker, law_data_t data)
+{
+        test_chan_state_t *state = data.ptr;
+        int x = 0;
+
+        state->timeout_error = law_chan_recv(worker, 20, state->chan, &x);
+
+        law_stop(state->server);
+        return LAW_ERR_OK;
+}
+
+void test_chan_timeout()
+{
+        SEL_INFO();
+
+        test_chan_state_t state;
+        memset(&state, 0, sizeof(test_chan_state_t));
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_NONE;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.on_error = test_chan_on_error;
+
+        law_server_t *server = law_server_create(&cfg);
+        state.server = server;
+        state.chan = law_chan_create(sizeof(int), 1);
+
+        assert(law_open(server) == LAW_ERR_OK);
+        assert(law_spawn(
+                server,
+                test_chan_timeout_task,
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_start(server) == LAW_ERR_OK);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(state.timeout_error == LAW_ERR_TIME);
+
+        law_chan_destroy(state.chan);
+        law_server_destroy(server);
+}
+
+#define TEST_PINGS 20000
+
+typedef struct test_ping_state {
+        law_server_t *server;
+        law_chan_t *there;
+        law_chan_t *back;
+        atomic_int done;
+        int workers[2];
+        int pings;
+        int pongs;
+        sel_err_t errors[2];                    /** Ping, Pong */
+} test_ping_state_t;
+
+static void test_ping_finish(
+        test_ping_state_t *state, 
+        const int side, 
+        const sel_err_t err)
+{
+        state->errors[side] = err;
+        if(atomic_fetch_add(&state->done, 1) == 1)
+                law_stop(state->server);
+}
+
+sel_err_t test_ping_task(law_worker_t *worker, law_data_t data)
+{
+        test_ping_state_t *state = data.ptr;
+        state->workers[0] = law_get_worker_id(worker);
+
+        sel_err_t err = LAW_ERR_OK;
+        for(int n = 0; n < TEST_PINGS && err == LAW_ERR_OK; ++n) {
+                int x = n;
+                err = law_chan_send(worker, 1000, state->there, &x);
+                if(err == LAW_ERR_OK) 
+                        err = law_chan_recv(worker, 1000, state->back, &x);
+                if(err == LAW_ERR_OK && x == n) 
+                        state->pings += 1;
+        }
+
+        test_ping_finish(state, 0, err);
+        return LAW_ERR_OK;
+}
+
+sel_err_t test_pong_task(law_worker_t *worker, law_data_t data)
+{
+        test_ping_state_t *state = data.ptr;
+        state->workers[1] = law_get_worker_id(worker);
+
+        sel_err_t err = LAW_ERR_OK;
+        for(int n = 0; n < TEST_PINGS && err == LAW_ERR_OK; ++n) {
+                int x = 0;
+                err = law_chan_recv(worker, 1000, state->there, &x);
+                if(err == LAW_ERR_OK) 
+                        err = law_chan_send(worker, 1000, state->back, &x);
+                if(err == LAW_ERR_OK) 
+                        state->pongs += 1;
+        }
+
+        test_ping_finish(state, 1, err);
+        return LAW_ERR_OK;
+}
+
+/** 
+ * Every send wakes a receiver parked on another worker; one lost wakeup 
+ * times out.
+ */
+void test_chan_ping_pong()
+{
+        SEL_INFO();
+
+        test_ping_state_t state;
+        memset(&state, 0, sizeof(test_ping_state_t));
+        atomic_init(&state.done, 0);
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_NONE;
+        cfg.workers = 2;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.on_error = test_chan_on_error;
+
+        law_server_t *server = law_server_create(&cfg);
+        state.server = server;
+        state.there = law_chan_create(sizeof(int), 1);
+        state.back = law_chan_create(sizeof(int), 1);
+
+        assert(law_open(server) == LAW_ERR_OK);
+        assert(law_spawn(
+                server,
+                test_pong_task,
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_spawn(
+                server,
+                test_ping_task,
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_start(server) == LAW_ERR_OK);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(state.workers[0] != state.workers[1]);
+        assert(state.errors[0] == LAW_ERR_OK);
+        assert(state.errors[1] == LAW_ERR_OK);
+        assert(state.pings == TEST_PINGS && state.pongs == TEST_PINGS);
+
+        law_chan_destroy(state.there);
+        law_chan_destroy(state.back);
+        law_server_destroy(server);
+}
+
+int main(int argc, char **args)
+{
+        SEL_INFO();
+
+        test_chan_create_destroy();
+        test_chan_try_send_recv();
+        test_chan_pipeline(1);
+        test_chan_pipeline(2);
+        test_chan_timeout();
+        test_chan_ping_pong();
+}
@@ -0,0 +1,90 @@
+
+#include "lawd/private/codel.h"
+#include <assert.h>
+
+#define MS 1000000
+
+void test_codel_disabled()
+{
+        SEL_INFO();
+
+        law_codel_t codel;
+        law_codel_init(&codel, 0, 100);
+
+        for(int64_t now = 0; now < 1000 * MS; now += MS) {
+                assert(law_codel_admit(&codel, 0, now));
+        }
+
+        law_codel_stats_t stats;
+        law_codel_read(&codel, &stats);
+        assert(stats.dropped == 0);
+        assert(!stats.dropping);
+}
+
+void test_codel_short_burst()
+{
+        SEL_INFO();
+
+        law_codel_t codel;
+        law_codel_init(&codel, 5, 100);
+
+        /* Above target for less than an interval is tolerated. */
+        int64_t now = 1000 * MS;
+        for(; now < 1090 * MS; now += MS) {
+                assert(law_codel_admit(&codel, now - 20 * MS, now));
+        }
+
+        /* Dropping below target resets the grace period. */
+        assert(law_codel_admit(&codel, now - 1 * MS, now));
+        now += MS;
+        for(; now < 1180 * MS; now += MS) {
+                assert(law_codel_admit(&codel, now - 20 * MS, now));
+        }
+
+        law_codel_stats_t stats;
+        law_codel_read(&codel, &stats);
+        assert(stats.dropped == 0);
+        assert(stats.delay == 20 * MS);
+}
+
+void test_codel_standing_queue()
+{
+        SEL_INFO();
+
+        law_codel_t codel;
+        law_codel_init(&codel, 5, 100);
+
+        int64_t now = 1000 * MS;
+        int drops = 0, first = 0;
+
+        for(; now < 2000 * MS; now += MS) {
+                if(!law_codel_admit(&codel, now - 20 * MS, now)) {
+                        if(!drops++) first = (int)(now / MS);
+                }
+        }
+
+        /* The first drop comes one interval in, then drops speed up. */
+        assert(first == 1100);
+        assert(drops > 10 && drops < 100);
+
+        law_codel_stats_t stats;
+        law_codel_read(&codel, &stats);
+        assert(stats.dropping);
+        assert(stats.count == (uint32_t)drops);
+        assert(stats.dropped == (uint64_t)drops);
+        assert(stats.admitted + stats.dropped == 1000);
+
+        /* Once the delay is back under target the episode ends. */
+        assert(law_codel_admit(&codel, now - 1 * MS, now));
+        law_codel_read(&codel, &stats);
+        assert(!stats.dropping);
+}
+
+int main(int argc, char **args)
+{
+        SEL_INFO();
+
+        test_codel_disabled();
+        test_codel_short_burst();
+        test_codel_standing_queue();
+}
@@ -0,0 +1,176 @@
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "lawd/dgram.h"
+#include <assert.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define TEST_PORT 18611
+#define TEST_CLIENTS 4
+#define TEST_MESSAGES 64
+#define TEST_HANDOFF_PATH "/tmp/lawd_test_dgram_handoff.sock"
+
+typedef struct test_dgram_state {
+        law_server_t *server;
+        atomic_int received;
+        atomic_int batches;
+        int replies;
+        long sum;
+        law_time_t stopped;                     /** When law_stop Was Called */
+} test_dgram_state_t;
+
+static test_dgram_state_t state;
+
+sel_err_t test_dgram_on_error(
+        law_server_t *server,
+        sel_err_t error,
+        law_data_t data)
+{
+        return LAW_ERR_OK;
+}
+
+sel_err_t test_dgram_echo(
+        law_worker_t *worker,
+        law_dgrams_t *dgrams,
+        law_data_t data)
+{
+        const size_t count = law_dgrams_count(dgrams);
+        assert(0 < count && count <= 4);
+
+        atomic_fetch_add(&state.batches, 1);
+
+        for(size_t n = 0; n < count; ++n) {
+                law_dgram_t dgram;
+                law_dgrams_get(dgrams, n, &dgram);
+                assert(!dgram.truncated);
+                assert(dgram.size == sizeof(int));
+                assert(dgram.addr->sa_family == AF_INET);
+
+                int x = 0;
+                memcpy(&x, dgram.data, sizeof(int));
+                x *= 2;
+
+                assert(law_dgrams_reply(
+                        dgrams,
+                        n,
+                        &x,
+                        sizeof(int)) == LAW_ERR_OK);
+                atomic_fetch_add(&state.received, 1);
+        }
+
+        return LAW_ERR_OK;
+}
+
+void *test_dgram_client(void *arg)
+{
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(struct sockaddr_in));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(TEST_PORT);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int fds[TEST_CLIENTS];
+        struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
+
+        for(int c = 0; c < TEST_CLIENTS; ++c) {
+                fds[c] = socket(AF_INET, SOCK_DGRAM, 0);
+                assert(fds[c] != -1);
+                assert(setsockopt(
+                        fds[c],
+                        SOL_SOCKET,
+                        SO_RCVTIMEO,
+                        &tv,
+                        sizeof(tv)) == 0);
+                assert(connect(
+                        fds[c],
+                        (struct sockaddr*)&addr,
+                        sizeof(addr)) == 0);
+        }
+
+        for(int n = 1; n <= TEST_MESSAGES; ++n) {
+                const int fd = fds[n % TEST_CLIENTS];
+                assert(send(fd, &n, sizeof(int), 0) == sizeof(int));
+        }
+
+        for(int c = 0; c < TEST_CLIENTS; ++c) {
+                for(int n = 0; n < TEST_MESSAGES / TEST_CLIENTS; ++n) {
+                        int x = 0;
+                        if(recv(fds[c], &x, sizeof(int), 0) != sizeof(int))
+                                break;
+                        state.sum += x;
+                        state.replies += 1;
+                }
+                close(fds[c]);
+        }
+
+        state.stopped = law_time_millis();
+        law_stop(state.server);
+
+        return NULL;
+}
+
+void test_dgram_echo_server(const int workers)
+{
+        SEL_INFO();
+
+        memset(&state, 0, sizeof(test_dgram_state_t));
+        atomic_init(&state.received, 0);
+        atomic_init(&state.batches, 0);
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_UDP;
+        cfg.port = TEST_PORT;
+        cfg.workers = workers;
+        cfg.server_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.dgram_batch = 4;
+        cfg.dgram_size = 64;
+        cfg.on_dgrams = test_dgram_echo;
+        cfg.on_error = test_dgram_on_error;
+
+        law_server_t *server = law_server_create(&cfg);
+        state.server = server;
+
+        /* The per-worker sockets cannot be handed off. */
+        assert(law_handoff_recv(server, TEST_HANDOFF_PATH, 0) == 
+                LAW_ERR_MODE);
+
+        assert(law_open(server) == LAW_ERR_OK);
+
+        assert(law_handoff_send(server, TEST_HANDOFF_PATH, 0) == 
+                LAW_ERR_MODE);
+
+        pthread_t client;
+        assert(pthread_create(&client, NULL, test_dgram_client, NULL) == 0);
+
+        assert(law_start(server) == LAW_ERR_OK);
+        const law_time_t returned = law_time_millis();
+        pthread_join(client, NULL);
+
+        /* Receivers are woken on stop, not at their next worker_timeout. */
+        assert(returned - state.stopped < cfg.worker_timeout / 5);
+
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(atomic_load(&state.received) == TEST_MESSAGES);
+        assert(atomic_load(&state.batches) >= TEST_MESSAGES / 4);
+        assert(state.replies == TEST_MESSAGES);
+        assert(state.sum == (long)TEST_MESSAGES * (TEST_MESSAGES + 1));
+
+        law_server_destroy(server);
+}
+
+int main(int argc, char **args)
+{
+        SEL_INFO();
+
+        test_dgram_echo_server(1);
+        test_dgram_echo_server(2);
+}
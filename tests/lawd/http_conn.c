@@ -1,6 +1,7 @@
 
 #include "lawd/http_conn.h"
 #include "lawd/private/http_conn.h"
+#include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -235,6 +236,82 @@ void test_read_scan()
         close(fds[0]);
 }
 
+void test_read_scan_ex()
+{
+        SEL_INFO();
+
+        static uint8_t bytes[0x4000];
+        static char head[0x3000];
+
+        struct pgc_buf in;
+        pgc_buf_init(&in, bytes, sizeof(bytes), 0);
+
+        int fds[2];
+        pipe(fds);
+
+        int flags = fcntl(fds[0], F_GETFL);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK | flags);
+
+        law_htconn_t conn = { 
+                .in = &in, 
+                .security = LAW_HTC_UNSECURED, 
+                .socket = fds[0],
+                .ssl = NULL,
+                .out = NULL };
+
+        size_t length = 0;
+        for(int x = 0; x < 300; ++x) 
+                length += (size_t)sprintf(head + length, 
+                        "X-Field-%03i: some value\r\n", x);
+        length += (size_t)sprintf(head + length, "\r\n");
+
+        /* Drip the head one byte per read: each byte is searched once. */
+        law_htc_scan_t scan = { .base = 0, .mark = 0, .work = 0 };
+
+        for(size_t x = 0; x < length - 1; ++x) {
+                SEL_TEST(write(fds[1], head + x, 1) == 1);
+                SEL_TEST(law_htc_read_scan_ex(
+                        &conn, &scan, "\r\n\r\n", 4) == LAW_ERR_WANTR);
+                SEL_TEST(pgc_buf_tell(&in) == 0);
+                SEL_TEST(scan.mark == x + 1);
+        }
+
+        SEL_TEST(write(fds[1], head + length - 1, 1) == 1);
+        SEL_TEST(law_htc_read_scan_ex(
+                &conn, &scan, "\r\n\r\n", 4) == LAW_ERR_OK);
+        SEL_TEST(pgc_buf_tell(&in) == length);
+        SEL_TEST(scan.work <= length);
+
+        /* A delimiter split across the end of the ring. */
+        uint8_t small[8];
+        pgc_buf_init(&in, small, 8, 0);
+        SEL_TEST(write(fds[1], "abcdef", 6) == 6);
+        SEL_TEST(law_htc_ensure_input(&conn, 6) == LAW_ERR_OK);
+        SEL_TEST(pgc_buf_seek(&in, 6) == LAW_ERR_OK);
+
+        scan = (law_htc_scan_t){ .base = 6, .mark = 6, .work = 0 };
+        SEL_TEST(write(fds[1], "x;", 2) == 2);
+        SEL_TEST(law_htc_read_scan_ex(&conn, &scan, ";;", 2) == 
+                LAW_ERR_WANTR);
+        SEL_TEST(write(fds[1], ";y", 2) == 2);
+        SEL_TEST(law_htc_read_scan_ex(&conn, &scan, ";;", 2) == LAW_ERR_OK);
+        SEL_TEST(pgc_buf_tell(&in) == 9);
+
+        /* Full buffer without a delimiter. */
+        scan = (law_htc_scan_t){ .base = 9, .mark = 9, .work = 0 };
+        SEL_TEST(write(fds[1], "1234567", 7) == 7);
+        SEL_TEST(law_htc_read_scan_ex(&conn, &scan, ";;", 2) == LAW_ERR_OOB);
+        SEL_TEST(pgc_buf_tell(&in) == 9);
+
+        close(fds[1]);
+
+        pgc_buf_init(&in, small, 8, 0);
+        scan = (law_htc_scan_t){ .base = 0, .mark = 0, .work = 0 };
+        SEL_TEST(law_htc_read_scan_ex(&conn, &scan, ";;", 2) == LAW_ERR_EOF);
+
+        close(fds[0]);
+}
+
 void test_flush()
 {
         SEL_INFO();
@@ -274,6 +351,110 @@ void test_flush()
         close(fds[1]);
 }
 
+static size_t released = 0;
+
+static void count_release(const void *base, const size_t length, void *state)
+{
+        released += length;
+        *(int*)state += 1;
+}
+
+void test_queue()
+{
+        SEL_INFO();
+
+        uint8_t bytes[8] = { 0 };
+        static char big[100000], wire[100000];
+
+        struct pgc_buf out;
+        pgc_buf_init(&out, bytes, 8, 0);
+
+        int fds[2];
+        pipe(fds);
+
+        int flags = fcntl(fds[0], F_GETFL);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK | flags);
+
+        flags = fcntl(fds[1], F_GETFL);
+        fcntl(fds[1], F_SETFL, O_NONBLOCK | flags);
+
+        law_htconn_t conn = { 
+                .out = &out, 
+                .security = LAW_HTC_UNSECURED, 
+                .socket = fds[1],
+                .ssl = NULL,
+                .in = NULL };
+
+        int calls = 0;
+
+        /* Buffered bytes and segments interleave in the order queued. */
+        pgc_buf_put(&out, "HEAD", 4);
+        SEL_TEST(law_htc_queue(&conn, "body-one", 8, count_release, &calls) ==
+                LAW_ERR_OK);
+        pgc_buf_put(&out, "\r\n", 2);
+        SEL_TEST(law_htc_queue(&conn, "two", 3, count_release, &calls) == 
+                LAW_ERR_OK);
+        SEL_TEST(law_htc_queue(&conn, "", 0, count_release, &calls) == 
+                LAW_ERR_OK);
+        SEL_TEST(calls == 1);
+        pgc_buf_put(&out, "!", 1);
+        SEL_TEST(law_htc_pending(&conn) == 18);
+
+        SEL_TEST(law_htc_write_data(&conn) == 18);
+        SEL_TEST(read(fds[0], wire, sizeof(wire)) == 18);
+        SEL_TEST(!memcmp(wire, "HEADbody-one\r\ntwo!", 18));
+        SEL_TEST(calls == 3 && released == 11);
+        SEL_TEST(law_htc_pending(&conn) == 0);
+        SEL_TEST(law_htc_flush(&conn) == LAW_ERR_OK);
+
+        /* The ring wraps between segments. */
+        pgc_buf_put(&out, "abcdef", 6);
+        SEL_TEST(law_htc_queue(&conn, "12", 2, NULL, NULL) == LAW_ERR_OK);
+        SEL_TEST(law_htc_flush(&conn) == LAW_ERR_OK);
+        SEL_TEST(read(fds[0], wire, sizeof(wire)) == 8);
+        SEL_TEST(!memcmp(wire, "abcdef12", 8));
+
+        /* Partial writes resume inside a segment. */
+        (void)memset(big, 'z', sizeof(big));
+        calls = 0;
+        pgc_buf_put(&out, "<", 1);
+        SEL_TEST(law_htc_queue(&conn, big, sizeof(big), count_release, &calls)
+                == LAW_ERR_OK);
+        pgc_buf_put(&out, ">", 1);
+
+        size_t total = 0;
+        char last = 0;
+        sel_err_t err = LAW_ERR_WANTW;
+        while(err == LAW_ERR_WANTW) {
+                err = law_htc_flush(&conn);
+                ssize_t n = 0;
+                while((n = read(fds[0], wire, sizeof(wire))) > 0) {
+                        if(!total) SEL_TEST(wire[0] == '<');
+                        total += (size_t)n;
+                        last = wire[n - 1];
+                }
+                if(err == LAW_ERR_WANTW) SEL_TEST(calls == 0);
+        }
+        SEL_TEST(err == LAW_ERR_OK);
+        SEL_TEST(total == sizeof(big) + 2);
+        SEL_TEST(last == '>');
+        SEL_TEST(calls == 1);
+
+        /* A full queue refuses more, and dropping releases what is left. */
+        calls = 0;
+        for(int x = 0; x < LAW_HTC_SEGMENTS; ++x) 
+                SEL_TEST(law_htc_queue(&conn, "q", 1, count_release, &calls) ==
+                        LAW_ERR_OK);
+        SEL_TEST(law_htc_queue(&conn, "q", 1, count_release, &calls) == 
+                LAW_ERR_OOB);
+        law_htc_drop(&conn);
+        SEL_TEST(calls == LAW_HTC_SEGMENTS);
+        SEL_TEST(law_htc_pending(&conn) == 0);
+
+        close(fds[0]);
+        close(fds[1]);
+}
+
 int main(int argc, char **args)
 {
         SEL_INFO();
@@ -282,5 +463,7 @@ int main(int argc, char **args)
         test_ensure_input();
         test_ensure_output();
         test_read_scan();
+        test_read_scan_ex();
         test_flush();
+        test_queue();
 }
\ No newline at end of file
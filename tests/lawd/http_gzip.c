@@ -0,0 +1,370 @@
+
+#define _DEFAULT_SOURCE
+
+#include "lawd/http_gzip.h"
+#include "lawd/http_scan.h"
+#include "lawd/private/http_server.h"
+#include "lawd/private/http_headers.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+static char out_bs[2][4096], heap_bs[0x2000], wire[0x8000], body[0x8000];
+static char text[20000];
+
+static struct pgc_buf out[2];
+static struct pgc_stk heap;
+static law_hts_req_t req;
+static law_htheaders_t headers;
+static int fds[2];
+
+/** 
+ * Start a response to a request with the given header lines.  Output 
+ * buffers alternate, so one response can be left open during the next.
+ */
+static void open_req(const char *head)
+{
+        static int slot = 0;
+        slot ^= 1;
+
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
+        req.conn.out = pgc_buf_init(
+                &out[slot], 
+                out_bs[slot], 
+                sizeof(out_bs[slot]), 
+                0);
+        req.conn.security = LAW_HTC_UNSECURED;
+        req.keep_alive = true;
+        req.stream.chunked = true;
+
+        SEL_ASSERT(pipe(fds) == 0);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK | fcntl(fds[0], F_GETFL));
+        req.conn.socket = fds[1];
+
+        static char lines[512];
+        (void)snprintf(lines, sizeof(lines), "%s%s\r\n",
+                head, *head ? "\r\n" : "");
+        pgc_stk_init(&heap, heap_bs, sizeof(heap_bs));
+        SEL_ASSERT(law_hsc_headers(lines, strlen(lines), &heap, &headers) ==
+                LAW_ERR_OK);
+}
+
+/** Send the rest of the response into wire and return its length. */
+static size_t close_req()
+{
+        SEL_TEST(law_htc_flush(&req.conn) == LAW_ERR_OK);
+        const ssize_t n = read(fds[0], wire, sizeof(wire) - 1);
+        wire[n > 0 ? n : 0] = '\0';
+        close(fds[0]);
+        close(fds[1]);
+        return n > 0 ? (size_t)n : 0;
+}
+
+/** Undo the framing and the coding of a response body. */
+static size_t decode(const char *response, const size_t size)
+{
+        static char raw[sizeof(wire)];
+        const char *head_end = strstr(response, "\r\n\r\n");
+        SEL_ASSERT(head_end);
+        const char *c = head_end + 4, *end = response + size;
+        size_t length = 0;
+
+        if(strstr(response, "Transfer-Encoding: chunked\r\n")) {
+                for(;;) {
+                        char *line_end = NULL;
+                        const size_t n = strtoul(c, &line_end, 16);
+                        SEL_TEST(line_end[0] == '\r' && line_end[1] == '\n');
+                        c = line_end + 2;
+                        if(!n) break;
+                        (void)memcpy(raw + length, c, n);
+                        length += n;
+                        c += n + 2;
+                }
+        } else {
+                length = (size_t)(end - c);
+                (void)memcpy(raw, c, length);
+        }
+
+        if(!strstr(response, "Content-Encoding: ")) {
+                (void)memcpy(body, raw, length);
+                return length;
+        }
+
+        z_stream z;
+        (void)memset(&z, 0, sizeof(z));
+        SEL_ASSERT(inflateInit2(&z, 15 + 32) == Z_OK);
+        z.next_in = (Bytef*)raw;
+        z.avail_in = (uInt)length;
+        z.next_out = (Bytef*)body;
+        z.avail_out = sizeof(body);
+        SEL_TEST(inflate(&z, Z_FINISH) == Z_STREAM_END);
+        SEL_TEST(z.avail_in == 0);
+        (void)inflateEnd(&z);
+        return sizeof(body) - z.avail_out;
+}
+
+void test_negotiate()
+{
+        SEL_INFO();
+
+        SEL_TEST(law_hgz_negotiate(NULL) == LAW_HGZ_IDENTITY);
+        SEL_TEST(law_hgz_negotiate("") == LAW_HGZ_IDENTITY);
+        SEL_TEST(law_hgz_negotiate("gzip") == LAW_HGZ_GZIP);
+        SEL_TEST(law_hgz_negotiate("gzip, deflate, br") == LAW_HGZ_GZIP);
+        SEL_TEST(law_hgz_negotiate("deflate, gzip") == LAW_HGZ_GZIP);
+        SEL_TEST(law_hgz_negotiate("br, deflate") == LAW_HGZ_DEFLATE);
+        SEL_TEST(law_hgz_negotiate("GZIP;Q=0.5") == LAW_HGZ_GZIP);
+        SEL_TEST(law_hgz_negotiate("x-gzip") == LAW_HGZ_GZIP);
+        SEL_TEST(law_hgz_negotiate("gzip;q=0.5, deflate") == LAW_HGZ_DEFLATE);
+        SEL_TEST(law_hgz_negotiate("gzip ; q=0.8,deflate;q=0.9") ==
+                LAW_HGZ_DEFLATE);
+        SEL_TEST(law_hgz_negotiate("gzip;q=0") == LAW_HGZ_IDENTITY);
+        SEL_TEST(law_hgz_negotiate("gzip;q=0.000, deflate;q=0") ==
+                LAW_HGZ_IDENTITY);
+        SEL_TEST(law_hgz_negotiate("*") == LAW_HGZ_GZIP);
+        SEL_TEST(law_hgz_negotiate("*;q=0.1, gzip;q=0") == LAW_HGZ_DEFLATE);
+        SEL_TEST(law_hgz_negotiate("identity, br") == LAW_HGZ_IDENTITY);
+        SEL_TEST(law_hgz_negotiate("gzipx, xdeflate") == LAW_HGZ_IDENTITY);
+        SEL_TEST(law_hgz_negotiate("gzip;q=2") == LAW_HGZ_IDENTITY);
+        SEL_TEST(law_hgz_negotiate("gzip;q=0.5x") == LAW_HGZ_IDENTITY);
+        SEL_TEST(law_hgz_negotiate("gzip;level=1;q=1.000") == LAW_HGZ_GZIP);
+}
+
+void test_compress(law_hgz_t *hgz)
+{
+        SEL_INFO();
+
+        static char packed[sizeof(text)];
+        size_t length = 0;
+
+        for(int coding = LAW_HGZ_GZIP; coding <= LAW_HGZ_DEFLATE; ++coding) {
+                for(int level = 1; level <= 9; level += 4) {
+                        SEL_TEST(law_hgz_compress(
+                                hgz, NULL, coding, level,
+                                text, sizeof(text),
+                                packed, sizeof(packed),
+                                &length) == LAW_ERR_OK);
+                        SEL_TEST(length < sizeof(text) / 4);
+
+                        z_stream z;
+                        (void)memset(&z, 0, sizeof(z));
+                        SEL_ASSERT(inflateInit2(&z,
+                                coding == LAW_HGZ_GZIP ? 15 + 16 : 15) ==
+                                Z_OK);
+                        z.next_in = (Bytef*)packed;
+                        z.avail_in = (uInt)length;
+                        z.next_out = (Bytef*)body;
+                        z.avail_out = sizeof(body);
+                        SEL_TEST(inflate(&z, Z_FINISH) == Z_STREAM_END);
+                        SEL_TEST(sizeof(body) - z.avail_out == sizeof(text));
+                        SEL_TEST(!memcmp(body, text, sizeof(text)));
+                        (void)inflateEnd(&z);
+                }
+        }
+
+        SEL_TEST(law_hgz_compress(
+                hgz, NULL, LAW_HGZ_GZIP, 6, text, sizeof(text),
+                packed, 16, &length) == LAW_ERR_OOB);
+}
+
+void test_stream(law_hgz_t *hgz)
+{
+        SEL_INFO();
+
+        law_hgz_stream_t *stream = NULL;
+
+        /* Streamed in pieces, sent in chunks as the compressor fills. */
+        open_req("Accept-Encoding: gzip, deflate");
+        SEL_TEST(law_hgz_begin_sync(
+                hgz, NULL, 0, &req, &headers, LAW_HTS_UNKNOWN_LENGTH,
+                &stream) == LAW_ERR_OK);
+        SEL_TEST(stream);
+        for(size_t i = 0; i < sizeof(text); i += 1000)
+                SEL_TEST(law_hgz_write_sync(
+                        NULL, 0, &req, stream, text + i, 1000) == LAW_ERR_OK);
+        SEL_TEST(law_hgz_end_sync(NULL, 0, &req, stream) == LAW_ERR_OK);
+
+        size_t size = close_req();
+        const char *r = wire;
+        SEL_TEST(strstr(r, "Vary: Accept-Encoding\r\n"));
+        SEL_TEST(strstr(r, "Content-Encoding: gzip\r\n"));
+        SEL_TEST(size < sizeof(text) / 4);
+        SEL_TEST(decode(r, size) == sizeof(text));
+        SEL_TEST(!memcmp(body, text, sizeof(text)));
+
+        /* The reset state is reused, here for the other coding. */
+        open_req("Accept-Encoding: deflate");
+        SEL_TEST(law_hgz_begin_sync(
+                hgz, NULL, 0, &req, &headers, sizeof(text), &stream) ==
+                LAW_ERR_OK);
+        SEL_TEST(law_hgz_write_sync(
+                NULL, 0, &req, stream, text, sizeof(text)) == LAW_ERR_OK);
+        SEL_TEST(law_hgz_end_sync(NULL, 0, &req, stream) == LAW_ERR_OK);
+        size = close_req();
+        SEL_TEST(strstr(r, "Content-Encoding: deflate\r\n"));
+        SEL_TEST(decode(r, size) == sizeof(text));
+        SEL_TEST(!memcmp(body, text, sizeof(text)));
+
+        /* Not accepted, or too small: sent as it is. */
+        open_req("");
+        SEL_TEST(law_hgz_begin_sync(
+                hgz, NULL, 0, &req, &headers, 1000, &stream) == LAW_ERR_OK);
+        SEL_TEST(!stream);
+        SEL_TEST(law_hgz_write_sync(
+                NULL, 0, &req, stream, text, 1000) == LAW_ERR_OK);
+        SEL_TEST(law_hgz_end_sync(NULL, 0, &req, stream) == LAW_ERR_OK);
+        size = close_req();
+        SEL_TEST(strstr(r, "Content-Length: 1000\r\n"));
+        SEL_TEST(!strstr(r, "Content-Encoding"));
+        SEL_TEST(decode(r, size) == 1000);
+
+        open_req("Accept-Encoding: gzip");
+        SEL_TEST(law_hgz_begin_sync(
+                hgz, NULL, 0, &req, &headers, 100, &stream) == LAW_ERR_OK);
+        SEL_TEST(!stream);
+        SEL_TEST(law_hgz_end_sync(NULL, 0, &req, stream) == LAW_ERR_LIMIT);
+        (void)close_req();
+
+        /* Every deflate state busy: the next body is not compressed. */
+        law_hgz_stream_t *busy = NULL;
+        open_req("Accept-Encoding: gzip");
+        SEL_TEST(law_hgz_begin_sync(
+                hgz, NULL, 0, &req, &headers, LAW_HTS_UNKNOWN_LENGTH,
+                &busy) == LAW_ERR_OK);
+        SEL_TEST(busy);
+        law_hts_req_t first = req;
+        int first_fds[2] = { fds[0], fds[1] };
+
+        open_req("Accept-Encoding: gzip");
+        SEL_TEST(law_hgz_begin_sync(
+                hgz, NULL, 0, &req, &headers, LAW_HTS_UNKNOWN_LENGTH,
+                &stream) == LAW_ERR_OK);
+        SEL_TEST(!stream);
+        SEL_TEST(law_hgz_end_sync(NULL, 0, &req, stream) == LAW_ERR_OK);
+        size = close_req();
+        SEL_TEST(!strstr(r, "Content-Encoding"));
+
+        req = first;
+        fds[0] = first_fds[0];
+        fds[1] = first_fds[1];
+        SEL_TEST(law_hgz_end_sync(NULL, 0, &req, busy) == LAW_ERR_OK);
+        size = close_req();
+        SEL_TEST(decode(r, size) == 0);
+}
+
+static size_t send_cached(
+        law_hgz_t *hgz,
+        const char *accept,
+        const char *key,
+        const void *data,
+        const size_t length)
+{
+        open_req(accept);
+        SEL_TEST(law_hgz_send_cached_sync(
+                hgz, NULL, 0, &req, &headers, key, data, length) ==
+                LAW_ERR_OK);
+        SEL_TEST(law_htc_pending(&req.conn) > 0);
+        SEL_TEST(law_htc_flush(&req.conn) == LAW_ERR_OK);
+        const ssize_t n = read(fds[0], wire, sizeof(wire) - 1);
+        SEL_ASSERT(n > 0);
+        wire[n] = '\0';
+        close(fds[0]);
+        close(fds[1]);
+        return (size_t)n;
+}
+
+void test_cache(law_hgz_t *hgz)
+{
+        SEL_INFO();
+
+        static char noise[4000], first[sizeof(wire)];
+
+        /* A hit sends the same bytes as the miss that filled it. */
+        size_t n = send_cached(hgz, "Accept-Encoding: gzip", "/a",
+                text, sizeof(text));
+        SEL_TEST(strstr(wire, "Content-Encoding: gzip\r\n"));
+        SEL_TEST(strstr(wire, "Vary: Accept-Encoding\r\n"));
+        SEL_TEST(!strstr(wire, "Transfer-Encoding"));
+        SEL_TEST(decode(wire, n) == sizeof(text));
+        SEL_TEST(!memcmp(body, text, sizeof(text)));
+        (void)memcpy(first, wire, n);
+
+        SEL_TEST(send_cached(hgz, "Accept-Encoding: gzip", "/a",
+                text, sizeof(text)) == n);
+        SEL_TEST(!memcmp(first, wire, n));
+
+        n = send_cached(hgz, "Accept-Encoding: deflate", "/a",
+                text, sizeof(text));
+        SEL_TEST(strstr(wire, "Content-Encoding: deflate\r\n"));
+        SEL_TEST(decode(wire, n) == sizeof(text));
+
+        n = send_cached(hgz, "", "/a", text, sizeof(text));
+        SEL_TEST(!strstr(wire, "Content-Encoding"));
+        SEL_TEST(decode(wire, n) == sizeof(text));
+
+        /* Bytes that do not shrink go out as they are. */
+        srand(7);
+        for(size_t i = 0; i < sizeof(noise); ++i)
+                noise[i] = (char)rand();
+        for(int x = 0; x < 2; ++x) {
+                n = send_cached(hgz, "Accept-Encoding: gzip", "/noise",
+                        noise, sizeof(noise));
+                SEL_TEST(!strstr(wire, "Content-Encoding"));
+                SEL_TEST(decode(wire, n) == sizeof(noise));
+                SEL_TEST(!memcmp(body, noise, sizeof(noise)));
+        }
+
+        /* Many keys through a small cache evict the least recent. */
+        char key[32];
+        for(int k = 0; k < 50; ++k) {
+                (void)snprintf(key, sizeof(key), "/page/%i", k % 10);
+                n = send_cached(hgz, "Accept-Encoding: gzip", key,
+                        text + k % 10, sizeof(text) - 100);
+                SEL_TEST(strstr(wire, "Content-Encoding: gzip\r\n"));
+                SEL_TEST(decode(wire, n) == sizeof(text) - 100);
+                SEL_TEST(!memcmp(body, text + k % 10, sizeof(text) - 100));
+        }
+
+        /* Dropped before it is sent, the body is still released. */
+        open_req("Accept-Encoding: gzip");
+        SEL_TEST(law_hgz_send_cached_sync(
+                hgz, NULL, 0, &req, &headers, "/a", text, sizeof(text)) ==
+                LAW_ERR_OK);
+        law_htc_drop(&req.conn);
+        close(fds[0]);
+        close(fds[1]);
+}
+
+int main(int argc, char **args)
+{
+        SEL_INFO();
+
+        law_err_init();
+
+        size_t length = 0;
+        for(int x = 0; length + 80 < sizeof(text); ++x)
+                length += (size_t)sprintf(text + length,
+                        "{\"id\":%i,\"name\":\"user%i\",\"active\":%s},\n",
+                        x, x * 7 % 100, x % 3 ? "true" : "false");
+        (void)memset(text + length, ' ', sizeof(text) - length);
+
+        law_server_cfg_t srv_cfg = law_server_sanity();
+        srv_cfg.workers = 1;
+        law_hgz_cfg_t cfg = law_hgz_sanity();
+        cfg.streams = 1;
+        cfg.chunk = 1024;
+        cfg.cache = 8000;
+
+        law_hgz_t *hgz = law_hgz_create(&srv_cfg, &cfg);
+        SEL_ASSERT(hgz);
+
+        test_negotiate();
+        test_compress(hgz);
+        test_stream(hgz);
+        test_cache(hgz);
+
+        law_hgz_destroy(hgz);
+}
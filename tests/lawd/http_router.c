@@ -0,0 +1,360 @@
+
+#include "lawd/http_router.h"
+#include "lawd/private/http_server.h"
+#include "lawd/private/http_headers.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static sel_err_t on_route(
+        law_worker_t *worker,
+        law_hts_req_t *req,
+        law_hts_reqline_t *reqline,
+        law_htheaders_t *headers,
+        law_hrt_match_t *match,
+        law_data_t data)
+{
+        SEL_TRY_QUIETLY(law_hts_put_status(req, data.i32));
+        SEL_TRY_QUIETLY(law_hts_put_length(req, 0));
+        return law_hts_begin_body(req);
+}
+
+static sel_err_t on_fail(
+        law_worker_t *worker,
+        law_hts_req_t *req,
+        law_hts_reqline_t *reqline,
+        law_htheaders_t *headers,
+        law_hrt_match_t *match,
+        law_data_t data)
+{
+        return LAW_ERR_SYS;
+}
+
+static law_data_t status(const int32_t code)
+{
+        law_data_t data;
+        data.i32 = code;
+        return data;
+}
+
+static law_hrt_t *create(law_server_cfg_t *srv_cfg)
+{
+        law_hrt_t *hrt = law_hrt_create(srv_cfg);
+        SEL_ASSERT(hrt);
+        return hrt;
+}
+
+/** Match and return the route, or -1 for 404 and -2 for 405. */
+static long route_of(
+        law_hrt_t *hrt,
+        const char *method,
+        const char *path,
+        law_hrt_match_t *match)
+{
+        switch(law_hrt_match(hrt, method, path, match)) {
+                case LAW_ERR_OK: return (long)match->route;
+                case LAW_ERR_NOID: return -1;
+                case LAW_ERR_MODE: return -2;
+                default: return -3;
+        }
+}
+
+static bool param_is(
+        law_hrt_match_t *match,
+        const char *name,
+        const char *value)
+{
+        const law_hrt_param_t *param = law_hrt_param(match, name);
+        return  param && param->length == strlen(value) &&
+                !memcmp(param->value, value, param->length);
+}
+
+void test_method()
+{
+        SEL_INFO();
+
+        SEL_TEST(law_hrt_method("GET") == LAW_HRT_GET);
+        SEL_TEST(law_hrt_method("DELETE") == LAW_HRT_DELETE);
+        SEL_TEST(law_hrt_method("TRACE") == LAW_HRT_TRACE);
+        SEL_TEST(law_hrt_method("get") == LAW_HRT_OTHER);
+        SEL_TEST(law_hrt_method("PROPFIND") == LAW_HRT_OTHER);
+        SEL_TEST(law_hrt_method(NULL) == LAW_HRT_OTHER);
+}
+
+void test_add()
+{
+        SEL_INFO();
+
+        law_server_cfg_t srv_cfg = law_server_sanity();
+        law_hrt_t *hrt = create(&srv_cfg);
+        law_data_t data = status(200);
+        size_t route = 99;
+
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, "/", on_route, data,
+                &route) == LAW_ERR_OK);
+        SEL_TEST(route == 0);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, "/a/:id", on_route, data,
+                &route) == LAW_ERR_OK);
+        SEL_TEST(route == 1);
+
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, "a", on_route, data,
+                NULL) == LAW_ERR_SYN);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, "", on_route, data,
+                NULL) == LAW_ERR_SYN);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, "/a/:", on_route, data,
+                NULL) == LAW_ERR_SYN);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, "/a/:/b", on_route, data,
+                NULL) == LAW_ERR_SYN);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, "/a/*rest/b", on_route, data,
+                NULL) == LAW_ERR_SYN);
+        SEL_TEST(law_hrt_add(hrt, 0, "/b", on_route, data,
+                NULL) == LAW_ERR_SYN);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET,
+                "/:a/:b/:c/:d/:e/:f/:g/:h/:i", on_route, data,
+                NULL) == LAW_ERR_LIMIT);
+
+        char deep[2 * LAW_HRT_SEGMENTS + 3] = "";
+        for(int s = 0; s <= LAW_HRT_SEGMENTS; ++s)
+                strcat(deep, "/x");
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, deep, on_route, data,
+                NULL) == LAW_ERR_LIMIT);
+
+        /* same shape: the parameter name does not matter */
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET | LAW_HRT_HEAD, "/a/:name",
+                on_route, data, NULL) == LAW_ERR_CMP);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_POST, "/a/:name", on_route, data,
+                &route) == LAW_ERR_OK);
+        SEL_TEST(route == 2);
+
+        SEL_TEST(law_hrt_compile(hrt) == LAW_ERR_OK);
+        SEL_TEST(law_hrt_compile(hrt) == LAW_ERR_MODE);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, "/c", on_route, data,
+                NULL) == LAW_ERR_MODE);
+
+        law_hrt_match_t match;
+        SEL_TEST(route_of(hrt, "GET", "/a/7", &match) == 1);
+        SEL_TEST(param_is(&match, "id", "7"));
+        SEL_TEST(!law_hrt_param(&match, "name"));
+        SEL_TEST(route_of(hrt, "POST", "/a/7", &match) == 2);
+        SEL_TEST(param_is(&match, "name", "7"));
+
+        law_hrt_destroy(hrt);
+}
+
+void test_match()
+{
+        SEL_INFO();
+
+        static const struct {
+                unsigned methods;
+                const char *pattern;
+        } ROUTES[] = {
+                { LAW_HRT_GET,                  "/" },                  /* 0 */
+                { LAW_HRT_GET,                  "/users" },             /* 1 */
+                { LAW_HRT_POST,                 "/users" },             /* 2 */
+                { LAW_HRT_GET,                  "/users/new" },         /* 3 */
+                { LAW_HRT_GET | LAW_HRT_PUT,    "/users/:id" },         /* 4 */
+                { LAW_HRT_GET,  "/users/:id/posts/:post" },             /* 5 */
+                { LAW_HRT_GET,                  "/users/:id/edit" },    /* 6 */
+                { LAW_HRT_GET,                  "/usage" },             /* 7 */
+                { LAW_HRT_GET,                  "/files/*path" },       /* 8 */
+                { LAW_HRT_GET,                  "/files/readme" },      /* 9 */
+                { LAW_HRT_DELETE,               "/users/new" },         /* 10 */
+                { LAW_HRT_ANY,                  "/any" },               /* 11 */
+                { LAW_HRT_GET,                  "/v1/x:batch" },        /* 12 */
+                { LAW_HRT_GET,                  "/a/b/c" },             /* 13 */
+                { LAW_HRT_GET,                  "/a/:x/d" },            /* 14 */
+        };
+
+        law_server_cfg_t srv_cfg = law_server_sanity();
+        law_hrt_t *hrt = create(&srv_cfg);
+
+        for(size_t r = 0; r < sizeof(ROUTES) / sizeof(*ROUTES); ++r)
+                SEL_TEST(law_hrt_add(hrt, ROUTES[r].methods,
+                        ROUTES[r].pattern, on_route, status(200),
+                        NULL) == LAW_ERR_OK);
+        SEL_TEST(law_hrt_compile(hrt) == LAW_ERR_OK);
+
+        law_hrt_match_t match;
+
+        SEL_TEST(route_of(hrt, "GET", "/", &match) == 0);
+        SEL_TEST(match.params == 0);
+        SEL_TEST(route_of(hrt, "GET", "/users", &match) == 1);
+        SEL_TEST(route_of(hrt, "POST", "/users", &match) == 2);
+        SEL_TEST(route_of(hrt, "GET", "/usage", &match) == 7);
+        SEL_TEST(route_of(hrt, "GET", "/use", &match) == -1);
+        SEL_TEST(route_of(hrt, "GET", "/users/", &match) == -1);
+        SEL_TEST(route_of(hrt, "GET", "/userss", &match) == -1);
+        SEL_TEST(route_of(hrt, "GET", NULL, &match) == -1);
+        SEL_TEST(route_of(hrt, "GET", "", &match) == -1);
+
+        /* static wins, parameters take the rest */
+        SEL_TEST(route_of(hrt, "GET", "/users/new", &match) == 3);
+        SEL_TEST(match.params == 0);
+        SEL_TEST(route_of(hrt, "GET", "/users/42", &match) == 4);
+        SEL_TEST(param_is(&match, "id", "42"));
+        SEL_TEST(route_of(hrt, "GET", "/users/ne", &match) == 4);
+        SEL_TEST(param_is(&match, "id", "ne"));
+        SEL_TEST(route_of(hrt, "GET", "/users/newer", &match) == 4);
+        SEL_TEST(param_is(&match, "id", "newer"));
+        SEL_TEST(route_of(hrt, "PUT", "/users/42", &match) == 4);
+
+        /* back from a static segment that matched to a parameter */
+        SEL_TEST(route_of(hrt, "GET", "/users/new/edit", &match) == 6);
+        SEL_TEST(param_is(&match, "id", "new"));
+        SEL_TEST(route_of(hrt, "GET", "/a/b/d", &match) == 14);
+        SEL_TEST(param_is(&match, "x", "b"));
+        SEL_TEST(route_of(hrt, "GET", "/a/b/c", &match) == 13);
+
+        /* and from a static route to a parameter that takes the method */
+        SEL_TEST(route_of(hrt, "PUT", "/users/new", &match) == 4);
+        SEL_TEST(param_is(&match, "id", "new"));
+        SEL_TEST(route_of(hrt, "DELETE", "/users/new", &match) == 10);
+
+        SEL_TEST(route_of(hrt, "GET", "/users/9/posts/abc", &match) == 5);
+        SEL_TEST(match.params == 2);
+        SEL_TEST(param_is(&match, "id", "9"));
+        SEL_TEST(param_is(&match, "post", "abc"));
+        SEL_TEST(!strcmp(match.param[1].name, "post"));
+        SEL_TEST(route_of(hrt, "GET", "/users/9/posts/", &match) == -1);
+        SEL_TEST(route_of(hrt, "GET", "/users/9/posts", &match) == -1);
+
+        SEL_TEST(route_of(hrt, "GET", "/files/readme", &match) == 9);
+        SEL_TEST(route_of(hrt, "GET", "/files/readme.md", &match) == 8);
+        SEL_TEST(param_is(&match, "path", "readme.md"));
+        SEL_TEST(route_of(hrt, "GET", "/files/a/b/c.txt", &match) == 8);
+        SEL_TEST(param_is(&match, "path", "a/b/c.txt"));
+        SEL_TEST(route_of(hrt, "GET", "/files/", &match) == 8);
+        SEL_TEST(param_is(&match, "path", ""));
+        SEL_TEST(route_of(hrt, "GET", "/files", &match) == -1);
+
+        SEL_TEST(route_of(hrt, "GET", "/v1/x:batch", &match) == 12);
+        SEL_TEST(match.params == 0);
+
+        SEL_TEST(route_of(hrt, "PROPFIND", "/any", &match) == 11);
+        SEL_TEST(route_of(hrt, "PATCH", "/any", &match) == 11);
+
+        /* the path is there, the method is not */
+        SEL_TEST(route_of(hrt, "DELETE", "/users", &match) == -2);
+        SEL_TEST(match.allow == (LAW_HRT_GET | LAW_HRT_POST));
+        SEL_TEST(route_of(hrt, "POST", "/users/new", &match) == -2);
+        SEL_TEST(match.allow ==
+                (LAW_HRT_GET | LAW_HRT_DELETE | LAW_HRT_PUT));
+        SEL_TEST(route_of(hrt, "PROPFIND", "/", &match) == -2);
+        SEL_TEST(match.allow == LAW_HRT_GET);
+
+        law_hrt_destroy(hrt);
+}
+
+static char out_bs[1024], wire[1024];
+
+/** Dispatch one request and return what went out on the wire. */
+static const char *dispatch(
+        law_hrt_t *hrt,
+        const char *method,
+        const char *path,
+        sel_err_t *err)
+{
+        struct pgc_buf out;
+        int fds[2];
+
+        law_hts_req_t req;
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
+        req.conn.out = pgc_buf_init(&out, out_bs, sizeof(out_bs), 0);
+        req.conn.security = LAW_HTC_UNSECURED;
+        req.keep_alive = true;
+
+        SEL_ASSERT(pipe(fds) == 0);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK | fcntl(fds[0], F_GETFL));
+        req.conn.socket = fds[1];
+
+        law_hts_reqline_t reqline;
+        (void)memset(&reqline, 0, sizeof(reqline));
+        reqline.method = method;
+        static char target[256];
+        (void)snprintf(target, sizeof(target), "%s", path);
+        reqline.target.path = target;
+
+        law_htheaders_t headers;
+        (void)memset(&headers, 0, sizeof(headers));
+
+        law_data_t data;
+        data.ptr = hrt;
+        *err = law_hrt_accept(NULL, &req, &reqline, &headers, data);
+        SEL_TEST(law_htc_flush(&req.conn) == LAW_ERR_OK);
+
+        const ssize_t n = read(fds[0], wire, sizeof(wire) - 1);
+        wire[n > 0 ? n : 0] = '\0';
+        close(fds[0]);
+        close(fds[1]);
+        return wire;
+}
+
+void test_accept()
+{
+        SEL_INFO();
+
+        law_server_cfg_t srv_cfg = law_server_sanity();
+        srv_cfg.workers = 2;
+        law_hrt_t *hrt = create(&srv_cfg);
+
+        size_t ok, created, fail;
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET | LAW_HRT_HEAD, "/items/:id",
+                on_route, status(200), &ok) == LAW_ERR_OK);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_POST, "/items",
+                on_route, status(201), &created) == LAW_ERR_OK);
+        SEL_TEST(law_hrt_add(hrt, LAW_HRT_GET, "/fail",
+                on_fail, status(0), &fail) == LAW_ERR_OK);
+        SEL_TEST(law_hrt_compile(hrt) == LAW_ERR_OK);
+
+        sel_err_t err;
+        const char *response;
+
+        response = dispatch(hrt, "GET", "/items/3", &err);
+        SEL_TEST(err == LAW_ERR_OK);
+        SEL_TEST(!strncmp(response, "HTTP/1.1 200 ", 13));
+        response = dispatch(hrt, "HEAD", "/items/4", &err);
+        SEL_TEST(!strncmp(response, "HTTP/1.1 200 ", 13));
+        response = dispatch(hrt, "POST", "/items", &err);
+        SEL_TEST(!strncmp(response, "HTTP/1.1 201 ", 13));
+
+        response = dispatch(hrt, "GET", "/nothing", &err);
+        SEL_TEST(err == LAW_ERR_OK);
+        SEL_TEST(!strncmp(response, "HTTP/1.1 404 ", 13));
+        SEL_TEST(strstr(response, "Content-Length: 0\r\n"));
+
+        response = dispatch(hrt, "DELETE", "/items/3", &err);
+        SEL_TEST(err == LAW_ERR_OK);
+        SEL_TEST(!strncmp(response, "HTTP/1.1 405 ", 13));
+        SEL_TEST(strstr(response, "Allow: GET, HEAD\r\n"));
+        response = dispatch(hrt, "PUT", "/items", &err);
+        SEL_TEST(strstr(response, "Allow: POST\r\n"));
+
+        (void)dispatch(hrt, "GET", "/fail", &err);
+        SEL_TEST(err == LAW_ERR_SYS);
+
+        law_hrt_counts_t counts = law_hrt_counts(hrt, ok);
+        SEL_TEST(counts.hits == 2 && counts.errors == 0);
+        counts = law_hrt_counts(hrt, created);
+        SEL_TEST(counts.hits == 1 && counts.errors == 0);
+        counts = law_hrt_counts(hrt, fail);
+        SEL_TEST(counts.hits == 1 && counts.errors == 1);
+        SEL_TEST(law_hrt_misses(hrt, 404) == 1);
+        SEL_TEST(law_hrt_misses(hrt, 405) == 2);
+
+        law_hrt_destroy(hrt);
+}
+
+int main(int argc, char **args)
+{
+        SEL_INFO();
+
+        law_err_init();
+
+        test_method();
+        test_add();
+        test_match();
+        test_accept();
+}
@@ -0,0 +1,230 @@
+
+#include "lawd/http_scan.h"
+#include "lawd/private/http_headers.h"
+#include <stdio.h>
+#include <string.h>
+
+static char heap_bs[0x2000];
+static struct pgc_stk heap;
+
+static sel_err_t scan_reqline(const char *text, law_hts_reqline_t *reqline)
+{
+        static char copy[512];
+        const size_t length = strlen(text);
+        (void)memcpy(copy, text, length + 1);
+        pgc_stk_init(&heap, heap_bs, sizeof(heap_bs));
+        return law_hsc_reqline(copy, length, &heap, reqline);
+}
+
+static sel_err_t scan_headers(const char *text, law_htheaders_t *headers)
+{
+        static char copy[4096];
+        const size_t length = strlen(text);
+        (void)memcpy(copy, text, length + 1);
+        pgc_stk_init(&heap, heap_bs, sizeof(heap_bs));
+        return law_hsc_headers(copy, length, &heap, headers);
+}
+
+void test_reqline()
+{
+        SEL_INFO();
+
+        law_hts_reqline_t rl;
+
+        SEL_TEST(scan_reqline("POST / HTTP/1.1\r\n", &rl) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(rl.method, "POST"));
+        SEL_TEST(!strcmp(rl.target.path, "/"));
+        SEL_TEST(!strcmp(rl.version, "HTTP/1.1"));
+        SEL_TEST(!rl.target.query && !rl.target.host);
+
+        SEL_TEST(scan_reqline(
+                "GET /api/v1/users/1234/orders?limit=20&offset=40 HTTP/1.0\r\n",
+                &rl) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(rl.target.path, "/api/v1/users/1234/orders"));
+        SEL_TEST(!strcmp(rl.target.query, "limit=20&offset=40"));
+        SEL_TEST(!strcmp(rl.version, "HTTP/1.0"));
+
+        SEL_TEST(scan_reqline(
+                "GET http://h.com/path?query HTTP/1.1\r\n",
+                &rl) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(rl.target.scheme, "http"));
+        SEL_TEST(!strcmp(rl.target.host, "h.com"));
+        SEL_TEST(!rl.target.port);
+        SEL_TEST(!strcmp(rl.target.path, "/path"));
+        SEL_TEST(!strcmp(rl.target.query, "query"));
+
+        SEL_TEST(scan_reqline(
+                "GET https://[::1]:8443 HTTP/1.1\r\n",
+                &rl) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(rl.target.host, "[::1]"));
+        SEL_TEST(!strcmp(rl.target.port, "8443"));
+        SEL_TEST(!rl.target.path);
+
+        SEL_TEST(scan_reqline(
+                "CONNECT h.com:443 HTTP/1.1\r\n",
+                &rl) == LAW_ERR_OK);
+        SEL_TEST(!rl.target.scheme);
+        SEL_TEST(!strcmp(rl.target.host, "h.com"));
+        SEL_TEST(!strcmp(rl.target.port, "443"));
+
+        SEL_TEST(scan_reqline("POST / HTTX/1.1\r\n", &rl) == LAW_ERR_SYN);
+        SEL_TEST(scan_reqline("POST / HTTP/1.1 \r\n", &rl) == LAW_ERR_SYN);
+        SEL_TEST(scan_reqline("POST  / HTTP/1.1\r\n", &rl) == LAW_ERR_SYN);
+        SEL_TEST(scan_reqline("POST / HTTP/1.1\n", &rl) == LAW_ERR_SYN);
+        SEL_TEST(scan_reqline("P(ST / HTTP/1.1\r\n", &rl) == LAW_ERR_SYN);
+        SEL_TEST(scan_reqline("GET /a\tb HTTP/1.1\r\n", &rl) == LAW_ERR_SYN);
+        SEL_TEST(scan_reqline("GET h.com:4x HTTP/1.1\r\n", &rl) == LAW_ERR_SYN);
+        SEL_TEST(scan_reqline("\r\n", &rl) == LAW_ERR_SYN);
+
+        /* Long targets cross the vector width and stop on the last byte. */
+        SEL_TEST(scan_reqline(
+                "GET /0123456789abcdef0123456789abcdef0123456789abcdef/\x7f"
+                " HTTP/1.1\r\n", &rl) == LAW_ERR_SYN);
+        SEL_TEST(scan_reqline(
+                "GET /0123456789abcdef0123456789abcdef0123456789abcdef/x"
+                " HTTP/1.1\r\n", &rl) == LAW_ERR_OK);
+        SEL_TEST(strlen(rl.target.path) == 51);
+}
+
+void test_headers()
+{
+        SEL_INFO();
+
+        law_htheaders_t hs;
+
+        SEL_TEST(scan_headers(
+                "Host: api.example.com\r\n"
+                "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) "
+                        "Gecko/20100101 Firefox/115.0\r\n"
+                "X-Empty:\r\n"
+                "X-Pad:  \t padded value \t \r\n"
+                "X-Obs: caf\xc3\xa9\r\n"
+                "\r\n", &hs) == LAW_ERR_OK);
+        SEL_TEST(hs.count == 5);
+        SEL_TEST(!strcmp(law_hth_get(&hs, "Host"), "api.example.com"));
+        SEL_TEST(!strcmp(law_hth_get(&hs, "User-Agent"),
+                "Mozilla/5.0 (X11; Linux x86_64; rv:109.0) "
+                "Gecko/20100101 Firefox/115.0"));
+        SEL_TEST(!strcmp(law_hth_get(&hs, "X-Empty"), ""));
+        SEL_TEST(!strcmp(law_hth_get(&hs, "X-Pad"), "padded value"));
+        SEL_TEST(!strcmp(law_hth_get(&hs, "X-Obs"), "caf\xc3\xa9"));
+        SEL_TEST(hs.fields[3].value_len == 12);
+        SEL_TEST(!law_hth_get(&hs, "Accept"));
+
+        law_hth_iter_t iter = { 0 };
+        const char *name = NULL, *value = NULL;
+        iter.base = hs.base;
+        iter.fields = hs.fields;
+        iter.count = hs.count;
+        SEL_TEST(law_hth_next(&iter, &name, &value));
+        SEL_TEST(!strcmp(name, "Host"));
+        int count = 1;
+        while(law_hth_next(&iter, &name, &value)) ++count;
+        SEL_TEST(count == 5);
+        SEL_TEST(!strcmp(name, "X-Obs"));
+
+        SEL_TEST(scan_headers("\r\n", &hs) == LAW_ERR_OK);
+        SEL_TEST(hs.count == 0);
+        SEL_TEST(!law_hth_get(&hs, "Host"));
+
+        SEL_TEST(scan_headers("Host : h\r\n\r\n", &hs) == LAW_ERR_SYN);
+        SEL_TEST(scan_headers(": h\r\n\r\n", &hs) == LAW_ERR_SYN);
+        SEL_TEST(scan_headers(" Fold: h\r\n\r\n", &hs) == LAW_ERR_SYN);
+        SEL_TEST(scan_headers("Host: h\n\r\n", &hs) == LAW_ERR_SYN);
+        SEL_TEST(scan_headers("Host: h\r\n", &hs) == LAW_ERR_SYN);
+        SEL_TEST(scan_headers("Host: h\r\n\r\nX", &hs) == LAW_ERR_SYN);
+        SEL_TEST(scan_headers(
+                "Cookie: 0123456789abcdef0123456789abcdef\x01\r\n\r\n",
+                &hs) == LAW_ERR_SYN);
+        SEL_TEST(scan_headers(
+                "Cookie: 0123456789abcdef0123456789abcdef\x7f\r\n\r\n",
+                &hs) == LAW_ERR_SYN);
+
+        pgc_stk_init(&heap, heap_bs, 8);
+        char text[] = "A: 1\r\nB: 2\r\n\r\n";
+        SEL_TEST(law_hsc_headers(text, strlen(text), &heap, &hs) ==
+                LAW_ERR_OOM);
+}
+
+void test_index()
+{
+        SEL_INFO();
+
+        law_htheaders_t hs;
+
+        SEL_TEST(scan_headers(
+                "host: a.com\r\n"
+                "CONTENT-LENGTH: 12\r\n"
+                "X-Trace: 1\r\n"
+                "x-trace: 2\r\n"
+                "Sec-Websocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                "Connection: keep-alive\r\n"
+                "Connection: close\r\n"
+                "\r\n", &hs) == LAW_ERR_OK);
+
+        SEL_TEST(!strcmp(law_hth_get(&hs, "Host"), "a.com"));
+        SEL_TEST(!strcmp(law_hth_get(&hs, "HOST"), "a.com"));
+        SEL_TEST(!strcmp(law_hth_get_field(&hs, LAW_HTH_HOST), "a.com"));
+        SEL_TEST(!strcmp(law_hth_get_field(
+                &hs, LAW_HTH_CONTENT_LENGTH), "12"));
+        SEL_TEST(!strcmp(law_hth_get(&hs, "content-length"), "12"));
+        SEL_TEST(!strcmp(law_hth_get_field(
+                &hs, LAW_HTH_SEC_WEBSOCKET_KEY), "dGhlIHNhbXBsZSBub25jZQ=="));
+        SEL_TEST(!law_hth_get_field(&hs, LAW_HTH_UPGRADE));
+        SEL_TEST(!law_hth_get(&hs, "Upgrade"));
+
+        /* Repeated fields give their first value. */
+        SEL_TEST(!strcmp(law_hth_get(&hs, "x-TRACE"), "1"));
+        SEL_TEST(!strcmp(law_hth_get_field(
+                &hs, LAW_HTH_CONNECTION), "keep-alive"));
+        SEL_TEST(!law_hth_get(&hs, "X-Trac"));
+        SEL_TEST(!law_hth_get(&hs, "X-Traces"));
+
+        SEL_TEST(law_hth_classify("sec-websocket-version", 21) ==
+                LAW_HTH_SEC_WEBSOCKET_VERSION);
+        SEL_TEST(law_hth_classify("Hosts", 5) == -1);
+        SEL_TEST(law_hth_classify("", 0) == -1);
+        for(int f = 0; f < LAW_HTH_FIELDS; ++f) {
+                const char *name = law_hth_field_name(f);
+                SEL_TEST(law_hth_classify(name, strlen(name)) == f);
+        }
+
+        /* More other fields than buckets, so buckets chain. */
+        static char text[4096];
+        size_t length = 0;
+        for(int x = 0; x < 100; ++x)
+                length += (size_t)sprintf(text + length, 
+                        "X-Field-%i: %i\r\n", x, x);
+        length += (size_t)sprintf(text + length, "\r\n");
+
+        SEL_TEST(scan_headers(text, &hs) == LAW_ERR_OK);
+        SEL_TEST(hs.count == 100);
+
+        for(int x = 0; x < 100; ++x) {
+                char name[32], value[32];
+                (void)sprintf(name, "x-field-%i", x);
+                (void)sprintf(value, "%i", x);
+                SEL_TEST(!strcmp(law_hth_get(&hs, name), value));
+        }
+        SEL_TEST(!law_hth_get(&hs, "X-Field-100"));
+}
+
+int main(int argc, char **args)
+{
+        SEL_INFO();
+
+        law_err_init();
+
+        SEL_TEST(law_hsc_get_isa() != LAW_HSC_AUTO);
+
+        for(int isa = LAW_HSC_SCALAR; isa <= LAW_HSC_AVX2; ++isa) {
+                if(law_hsc_set_isa(isa) != LAW_ERR_OK) continue;
+                SEL_TEST(law_hsc_get_isa() == isa);
+                test_reqline();
+                test_headers();
+                test_index();
+        }
+
+        SEL_TEST(law_hsc_set_isa(LAW_HSC_AUTO) == LAW_ERR_OK);
+        SEL_TEST(law_hsc_set_isa(LAW_HSC_AVX2 + 1) == LAW_ERR_MODE);
+}
@@ -1,9 +1,14 @@
 
 #include "lawd/http_server.h"
 #include "lawd/private/http_server.h"
+#include "lawd/private/http_headers.h"
+#include "lawd/http_scan.h"
 #include "lawd/error.h"
 #include <unistd.h>
 #include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
 
 law_hts_buf_t *law_hts_buf_create(const size_t length);
 void law_hts_buf_destroy(law_hts_buf_t *buf);
@@ -192,6 +197,7 @@ void test_read_reqline()
         fcntl(fds[1], F_SETFL, O_NONBLOCK | flags);
 
         law_hts_req_t req;
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
         
         req.conn.in = &in;
         req.conn.security = LAW_HTC_UNSECURED;
@@ -261,8 +267,676 @@ void test_read_reqline()
         SEL_ASSERT(law_hts_read_reqline(
                 &req, &reqline, pgc_buf_tell(&in)) == LAW_ERR_OOM);
 
+        pgc_stk_init(&heap, heap_bs, 0x10000);
+        req.parser = LAW_HTS_SCAN;
+
+        pgc_buf_zero(&in);
+        write(fds[1], "GET http://h.com/path?query HTTP/1.1\r\n", 39);
+        SEL_ASSERT(law_hts_read_reqline(
+                &req, &reqline, pgc_buf_tell(&in)) == LAW_ERR_OK);
+        SEL_ASSERT(strcmp(reqline.method, "GET") == 0);
+        SEL_ASSERT(strcmp(reqline.target.host, "h.com") == 0);
+        SEL_ASSERT(strcmp(reqline.target.path, "/path") == 0);
+        SEL_ASSERT(strcmp(reqline.target.query, "query") == 0);
+        SEL_ASSERT(pgc_buf_tell(&in) == 39);
+
+        pgc_buf_zero(&in);
+        write(fds[1], "POST / HTTX/1.1\r\n", 17);
+        SEL_ASSERT(law_hts_read_reqline(
+                &req, &reqline, pgc_buf_tell(&in)) == LAW_ERR_SYN);
+
+        close(fds[0]);
+        close(fds[1]);
+}
+
+bool law_hts_has_token(const char *list, const char *token);
+
+void test_has_token()
+{
+        SEL_INFO();
+
+        SEL_TEST(law_hts_has_token("close", "close"));
+        SEL_TEST(law_hts_has_token("Close", "close"));
+        SEL_TEST(law_hts_has_token("Keep-Alive", "keep-alive"));
+        SEL_TEST(law_hts_has_token("TE, close", "close"));
+        SEL_TEST(law_hts_has_token(" upgrade ,\tclose\t", "close"));
+        SEL_TEST(law_hts_has_token("close, TE", "te"));
+        SEL_TEST(!law_hts_has_token("", "close"));
+        SEL_TEST(!law_hts_has_token("closed", "close"));
+        SEL_TEST(!law_hts_has_token("keep-alive", "close"));
+        SEL_TEST(!law_hts_has_token("clos", "close"));
+}
+
+void law_hts_set_framing(
+        law_hts_req_t *req, 
+        law_hts_reqline_t *reqline, 
+        law_htheaders_t *headers);
+
+/** Frame a request with the head fields and return its keep-alive. */
+static bool framing_of(law_hts_req_t *req, const char *fields)
+{
+        static char in_bs[64], heap_bs[0x1000], text[256];
+        static struct pgc_buf in;
+        static struct pgc_stk heap;
+        static law_htserver_t server;
+        static law_htheaders_t headers;
+
+        (void)memset(&server, 0, sizeof(server));
+        (void)memset(req, 0, sizeof(law_hts_req_t));
+        req->htserver = &server;
+        req->conn.in = pgc_buf_init(&in, in_bs, sizeof(in_bs), 0);
+
+        law_hts_reqline_t reqline;
+        (void)memset(&reqline, 0, sizeof(reqline));
+        reqline.method = "POST";
+        reqline.version = "HTTP/1.1";
+
+        (void)snprintf(text, sizeof(text), "%s\r\n\r\n", fields);
+        pgc_stk_init(&heap, heap_bs, sizeof(heap_bs));
+        SEL_ASSERT(law_hsc_headers(text, strlen(text), &heap, &headers) ==
+                LAW_ERR_OK);
+
+        law_hts_set_framing(req, &reqline, &headers);
+        return req->keep_alive;
+}
+
+void test_framing()
+{
+        SEL_INFO();
+
+        law_hts_req_t req;
+
+        SEL_TEST(framing_of(&req, "Content-Length: 5"));
+        SEL_TEST(req.body.state == LAW_HTS_BODY_DATA);
+        SEL_TEST(req.body.remaining == 5);
+
+        SEL_TEST(framing_of(&req, "Transfer-Encoding: chunked"));
+        SEL_TEST(req.body.state == LAW_HTS_BODY_SIZE);
+
+        /* A repeated length is one length. */
+        SEL_TEST(framing_of(&req, 
+                "Content-Length: 5\r\nHost: a\r\nContent-Length: 5"));
+        SEL_TEST(req.body.remaining == 5);
+
+        /* Framed two ways: decode as chunked, then close. */
+        SEL_TEST(!framing_of(&req, 
+                "Transfer-Encoding: chunked\r\nContent-Length: 5"));
+        SEL_TEST(req.body.state == LAW_HTS_BODY_SIZE);
+        SEL_TEST(!framing_of(&req, 
+                "Content-Length: 5\r\nTransfer-Encoding: chunked"));
+        SEL_TEST(req.body.state == LAW_HTS_BODY_SIZE);
+
+        /* Lengths that disagree frame no body, and close. */
+        SEL_TEST(!framing_of(&req, 
+                "Content-Length: 5\r\nContent-Length: 50"));
+        SEL_TEST(req.body.state == LAW_HTS_BODY_DONE);
+        SEL_TEST(!framing_of(&req, 
+                "content-length: 5\r\nCONTENT-LENGTH: 6"));
+        SEL_TEST(req.body.state == LAW_HTS_BODY_DONE);
+}
+
+static bool out_equals(struct pgc_buf *out, const char *text)
+{
+        const size_t length = strlen(text);
+        return  pgc_buf_end(out) == length &&
+                !memcmp(out->addr, text, length);
+}
+
+void test_put_head()
+{
+        SEL_INFO();
+
+        char out_bs[256];
+        struct pgc_buf out;
+
+        law_hts_req_t req;
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
+        req.conn.out = &out;
+
+        pgc_buf_init(&out, out_bs, 256, 0);
+        SEL_TEST(law_hts_put_status(&req, 200) == LAW_ERR_OK);
+        SEL_TEST(law_hts_put_status(&req, 404) == LAW_ERR_OK);
+        SEL_TEST(law_hts_put_status(&req, 299) == LAW_ERR_OK);
+        SEL_TEST(out_equals(&out, 
+                "HTTP/1.1 200 OK\r\n"
+                "HTTP/1.1 404 Not Found\r\n"
+                "HTTP/1.1 299 Unknown Status Code\r\n"));
+
+        pgc_buf_init(&out, out_bs, 256, 0);
+        SEL_TEST(law_hts_set_status(&req, "HTTP/1.0", 503, "Busy") == 
+                LAW_ERR_OK);
+        SEL_TEST(law_hts_add_header(&req, "X-Id", "7") == LAW_ERR_OK);
+        SEL_TEST(law_hts_put_header(&req, LAW_HTS_CONTENT_TYPE, "text/plain")
+                == LAW_ERR_OK);
+        SEL_TEST(law_hts_put_length(&req, 0) == LAW_ERR_OK);
+        SEL_TEST(law_hts_put_length(&req, 18446744073709551615ull) == 
+                LAW_ERR_OK);
+        SEL_TEST(out_equals(&out, 
+                "HTTP/1.0 503 Busy\r\n"
+                "X-Id: 7\r\n"
+                "Content-Type: text/plain\r\n"
+                "Content-Length: 0\r\n"
+                "Content-Length: 18446744073709551615\r\n"));
+
+        /* Without a pool group the line is formatted every time. */
+        pgc_buf_init(&out, out_bs, 256, 0);
+        SEL_TEST(law_hts_put_date(&req) == LAW_ERR_OK);
+        SEL_TEST(pgc_buf_end(&out) == LAW_HTS_DATE_LEN);
+
+        char expect[64];
+        const time_t now = time(NULL);
+        (void)strftime(expect, sizeof(expect), 
+                "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", gmtime(&now));
+
+        law_hts_pool_group_t group;
+        (void)memset(&group, 0, sizeof(group));
+        req.group = &group;
+
+        pgc_buf_init(&out, out_bs, 256, 0);
+        SEL_TEST(law_hts_put_date(&req) == LAW_ERR_OK);
+        SEL_TEST(group.date_time >= now);
+        if(group.date_time == now)
+                SEL_TEST(out_equals(&out, expect));
+
+        /* A stale second is formatted again. */
+        group.date_time = 784111777;
+        (void)memcpy(group.date, "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n", 
+                LAW_HTS_DATE_LEN);
+        pgc_buf_init(&out, out_bs, 256, 0);
+        SEL_TEST(law_hts_put_date(&req) == LAW_ERR_OK);
+        SEL_TEST(group.date_time != 784111777);
+        SEL_TEST(memcmp(out_bs, "Date: Sun, 06 Nov 1994", 22));
+
+        /* A full buffer fails. */
+        pgc_buf_init(&out, out_bs, 8, 0);
+        SEL_TEST(law_hts_put_status(&req, 200) == LAW_ERR_OOB);
+
+        /* A line that does not fit leaves nothing of itself behind. */
+        pgc_buf_init(&out, out_bs, 20, 0);
+        SEL_TEST(law_hts_add_header(&req, "X-Id", "7") == LAW_ERR_OK);
+        SEL_TEST(law_hts_add_header(&req, "X-Name", "value") == 
+                LAW_ERR_OOB);
+        SEL_TEST(law_hts_put_header(&req, LAW_HTS_CONTENT_TYPE, "text/plain")
+                == LAW_ERR_OOB);
+        SEL_TEST(law_hts_set_status(&req, "HTTP/1.1", 200, "OK") == 
+                LAW_ERR_OOB);
+        SEL_TEST(out_equals(&out, "X-Id: 7\r\n"));
+        SEL_TEST(law_hts_add_header(&req, "X-A", "bc") == LAW_ERR_OK);
+        SEL_TEST(out_equals(&out, "X-Id: 7\r\nX-A: bc\r\n"));
+}
+
+static void body_setup(
+        law_hts_req_t *req, 
+        struct pgc_buf *in, 
+        void *in_bs,
+        const size_t in_max,
+        int fds[2], 
+        const char *text)
+{
+        pgc_buf_init(in, in_bs, in_max, 0);
+
+        (void)memset(req, 0, sizeof(law_hts_req_t));
+        req->conn.in = in;
+        req->conn.security = LAW_HTC_UNSECURED;
+        req->keep_alive = true;
+
+        SEL_ASSERT(pipe(fds) == 0);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK | fcntl(fds[0], F_GETFL));
+        req->conn.socket = fds[0];
+
+        const size_t length = strlen(text);
+        SEL_ASSERT(write(fds[1], text, length) == (ssize_t)length);
+}
+
+static size_t body_drain(law_hts_req_t *req, char *body, sel_err_t *err)
+{
+        size_t total = 0;
+        for(;;) {
+                const void *span = NULL;
+                size_t length = 0;
+                *err = law_hts_body_span(req, &span, &length);
+                if(*err != LAW_ERR_OK || !length) 
+                        return total;
+                (void)memcpy(body + total, span, length);
+                total += length;
+        }
+}
+
+void test_body()
+{
+        SEL_INFO();
+
+        char in_bs[64], body[256], rest[8];
+        struct pgc_buf in;
+        law_hts_req_t req;
+        int fds[2];
+        size_t length = 0;
+        sel_err_t err = -1;
+
+        /* Content-Length body, copied out a few bytes at a time. */
+        body_setup(&req, &in, in_bs, 64, fds, "hello worldGET");
+        req.body.state = LAW_HTS_BODY_DATA;
+        req.body.remaining = 11;
+        SEL_TEST(law_hts_body_read(&req, body, 4, &length) == LAW_ERR_OK);
+        SEL_TEST(length == 4 && !memcmp(body, "hell", 4));
+        SEL_TEST(law_hts_body_read(&req, body, 4, &length) == LAW_ERR_OK);
+        SEL_TEST(length == 4 && !memcmp(body, "o wo", 4));
+        SEL_TEST(law_hts_body_read(&req, body, 4, &length) == LAW_ERR_OK);
+        SEL_TEST(length == 3 && !memcmp(body, "rld", 3));
+        SEL_TEST(law_hts_body_read(&req, body, 4, &length) == LAW_ERR_OK);
+        SEL_TEST(length == 0);
+        SEL_TEST(pgc_buf_get(&in, rest, 3) == LAW_ERR_OK);
+        SEL_TEST(!memcmp(rest, "GET", 3));
+        close(fds[0]);
+        close(fds[1]);
+
+        /* Chunked body with extensions and trailers, through a small ring. */
+        body_setup(&req, &in, in_bs, 32, fds, 
+                "5;ext=\"a\"\r\nhello\r\n"
+                "1A\r\n abcdefghijklmnopqrstuvwxy\r\n"
+                "0\r\nX-Trailer: 1\r\n\r\nNEXT");
+        req.body.state = LAW_HTS_BODY_SIZE;
+        SEL_TEST(body_drain(&req, body, &err) == 31);
+        SEL_TEST(err == LAW_ERR_OK);
+        SEL_TEST(!memcmp(body, "hello abcdefghijklmnopqrstuvwxy", 31));
+        SEL_TEST(req.body.state == LAW_HTS_BODY_DONE);
+        SEL_TEST(pgc_buf_get(&in, rest, 4) == LAW_ERR_OK);
+        SEL_TEST(!memcmp(rest, "NEXT", 4));
         close(fds[0]);
         close(fds[1]);
+
+        /* A chunk split across reads waits for the rest. */
+        body_setup(&req, &in, in_bs, 64, fds, "4\r\nab");
+        req.body.state = LAW_HTS_BODY_SIZE;
+        SEL_TEST(body_drain(&req, body, &err) == 2);
+        SEL_TEST(err == LAW_ERR_WANTR);
+        SEL_TEST(write(fds[1], "cd\r\n0\r\n\r\n", 9) == 9);
+        SEL_TEST(body_drain(&req, body, &err) == 2);
+        SEL_TEST(err == LAW_ERR_OK && !memcmp(body, "cd", 2));
+        SEL_TEST(req.keep_alive);
+        close(fds[0]);
+        close(fds[1]);
+
+        /* Malformed framing fails every later call and ends the connection. */
+        const char *bad[] = { 
+                "zz\r\n", 
+                "\r\n", 
+                "3x\r\nabc\r\n", 
+                "3\r\nabcXY", 
+                "11111111111111111\r\n" };
+        for(size_t b = 0; b < sizeof(bad) / sizeof(*bad); ++b) {
+                body_setup(&req, &in, in_bs, 64, fds, bad[b]);
+                req.body.state = LAW_HTS_BODY_SIZE;
+                (void)body_drain(&req, body, &err);
+                SEL_TEST(err == LAW_ERR_SYN);
+                SEL_TEST(law_hts_body_read(&req, body, 4, &length) == 
+                        LAW_ERR_SYN);
+                SEL_TEST(!req.keep_alive);
+                close(fds[0]);
+                close(fds[1]);
+        }
+
+        /* Chunks past the limit. */
+        law_htserver_t server;
+        (void)memset(&server, 0, sizeof(server));
+        server.cfg.max_body = 8;
+        body_setup(&req, &in, in_bs, 64, fds, 
+                "5\r\nhello\r\n5\r\nworld\r\n0\r\n\r\n");
+        req.htserver = &server;
+        req.body.state = LAW_HTS_BODY_SIZE;
+        SEL_TEST(body_drain(&req, body, &err) == 5);
+        SEL_TEST(err == LAW_ERR_OOB && !req.keep_alive);
+        close(fds[0]);
+        close(fds[1]);
+
+        /* The client goes away inside the body. */
+        body_setup(&req, &in, in_bs, 64, fds, "abc");
+        req.body.state = LAW_HTS_BODY_DATA;
+        req.body.remaining = 10;
+        close(fds[1]);
+        SEL_TEST(body_drain(&req, body, &err) == 3);
+        SEL_TEST(err == LAW_ERR_EOF);
+        close(fds[0]);
+}
+
+void test_stream()
+{
+        SEL_INFO();
+
+        char out_bs[128], in_bs[64], wire[4096], data[1000], body[1000];
+        struct pgc_buf out, in;
+        law_hts_req_t req;
+        int fds[2];
+        sel_err_t err = -1;
+
+        for(size_t i = 0; i < sizeof(data); ++i) 
+                data[i] = (char)('a' + i % 26);
+
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
+        req.conn.out = pgc_buf_init(&out, out_bs, 128, 0);
+        req.conn.security = LAW_HTC_UNSECURED;
+        req.keep_alive = true;
+        SEL_ASSERT(pipe(fds) == 0);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK | fcntl(fds[0], F_GETFL));
+        req.conn.socket = fds[1];
+
+        SEL_TEST(law_hts_write_sync(NULL, 0, &req, "x", 1) == LAW_ERR_MODE);
+        SEL_TEST(law_hts_end_stream_sync(NULL, 0, &req) == LAW_ERR_MODE);
+
+        /* Content-Length bodies are written as they are. */
+        SEL_TEST(law_hts_begin_stream_sync(NULL, 0, &req, 10) == LAW_ERR_OK);
+        SEL_TEST(law_hts_write_sync(NULL, 0, &req, "0123", 4) == LAW_ERR_OK);
+        SEL_TEST(law_hts_write_sync(NULL, 0, &req, "456789", 6) == 
+                LAW_ERR_OK);
+        SEL_TEST(law_hts_write_sync(NULL, 0, &req, "x", 1) == LAW_ERR_LIMIT);
+        SEL_TEST(law_hts_end_stream_sync(NULL, 0, &req) == LAW_ERR_OK);
+        SEL_TEST(law_hts_end_stream_sync(NULL, 0, &req) == LAW_ERR_MODE);
+        SEL_TEST(law_htc_flush(&req.conn) == LAW_ERR_OK);
+        SEL_TEST(read(fds[0], wire, sizeof(wire)) == 32);
+        SEL_TEST(!memcmp(wire, "Content-Length: 10\r\n\r\n0123456789", 32));
+        SEL_TEST(req.keep_alive);
+
+        SEL_TEST(law_hts_begin_stream_sync(NULL, 0, &req, 10) == LAW_ERR_OK);
+        SEL_TEST(law_hts_end_stream_sync(NULL, 0, &req) == LAW_ERR_LIMIT);
+        SEL_TEST(!req.keep_alive);
+        SEL_TEST(law_htc_flush(&req.conn) == LAW_ERR_OK);
+        (void)read(fds[0], wire, sizeof(wire));
+
+        /* Chunked bodies much larger than the output buffer. */
+        req.stream.chunked = true;
+        SEL_TEST(law_hts_begin_stream_sync(
+                NULL, 0, &req, LAW_HTS_UNKNOWN_LENGTH) == LAW_ERR_OK);
+        for(size_t i = 0; i < sizeof(data); i += 250)
+                SEL_TEST(law_hts_write_sync(NULL, 0, &req, data + i, 250) ==
+                        LAW_ERR_OK);
+        SEL_TEST(law_hts_end_stream_sync(NULL, 0, &req) == LAW_ERR_OK);
+        SEL_TEST(law_htc_flush(&req.conn) == LAW_ERR_OK);
+
+        const ssize_t length = read(fds[0], wire, sizeof(wire));
+        SEL_TEST(length > 1000);
+        SEL_TEST(!memcmp(wire, "Transfer-Encoding: chunked\r\n\r\n", 30));
+        close(fds[0]);
+        close(fds[1]);
+
+        /* Decode what was sent with the request body reader. */
+        wire[length] = '\0';
+        body_setup(&req, &in, in_bs, 64, fds, wire + 30);
+        req.body.state = LAW_HTS_BODY_SIZE;
+        SEL_TEST(body_drain(&req, body, &err) == sizeof(data));
+        SEL_TEST(err == LAW_ERR_OK);
+        SEL_TEST(!memcmp(body, data, sizeof(data)));
+        SEL_TEST(req.body.state == LAW_HTS_BODY_DONE);
+        close(fds[0]);
+        close(fds[1]);
+
+        /* HTTP/1.0 clients get the body up to the end of the connection. */
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
+        req.conn.out = pgc_buf_init(&out, out_bs, 128, 0);
+        req.keep_alive = true;
+        SEL_TEST(law_hts_begin_stream_sync(
+                NULL, 0, &req, LAW_HTS_UNKNOWN_LENGTH) == LAW_ERR_OK);
+        SEL_TEST(!req.keep_alive);
+        SEL_TEST(law_hts_write_sync(NULL, 0, &req, "abc", 3) == LAW_ERR_OK);
+        SEL_TEST(law_hts_end_stream_sync(NULL, 0, &req) == LAW_ERR_OK);
+        SEL_TEST(pgc_buf_end(&out) == 24);
+        SEL_TEST(!memcmp(out_bs, "Connection: close\r\n\r\nabc", 24));
+
+        /* Too small to carry chunks. */
+        pgc_buf_init(&out, out_bs, 32, 0);
+        SEL_TEST(law_hts_begin_stream_sync(NULL, 0, &req, 1) == LAW_ERR_OOB);
+}
+
+static void release_ref(const void *base, const size_t length, void *state)
+{
+        *(size_t*)state += length;
+}
+
+void test_write_ref()
+{
+        SEL_INFO();
+
+        static char data[3000], body[3000];
+        char out_bs[128], in_bs[64], wire[4096];
+        struct pgc_buf out, in;
+        law_hts_req_t req;
+        int fds[2];
+        sel_err_t err = -1;
+        size_t released = 0;
+
+        for(size_t i = 0; i < sizeof(data); ++i) 
+                data[i] = (char)('a' + i % 26);
+
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
+        req.conn.out = pgc_buf_init(&out, out_bs, 128, 0);
+        req.conn.security = LAW_HTC_UNSECURED;
+        req.keep_alive = true;
+        req.stream.chunked = true;
+        SEL_ASSERT(pipe(fds) == 0);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK | fcntl(fds[0], F_GETFL));
+        req.conn.socket = fds[1];
+
+        SEL_TEST(law_hts_write_ref_sync(
+                NULL, 0, &req, "x", 1, release_ref, &released) == 
+                LAW_ERR_MODE);
+
+        /* Segments far larger than the output buffer, never copied in. */
+        SEL_TEST(law_hts_begin_stream_sync(
+                NULL, 0, &req, LAW_HTS_UNKNOWN_LENGTH) == LAW_ERR_OK);
+        for(size_t i = 0; i < sizeof(data); i += 300)
+                SEL_TEST(law_hts_write_ref_sync(
+                        NULL, 0, &req, data + i, 300, 
+                        release_ref, &released) == LAW_ERR_OK);
+        SEL_TEST(law_hts_end_stream_sync(NULL, 0, &req) == LAW_ERR_OK);
+        SEL_TEST(law_htc_flush(&req.conn) == LAW_ERR_OK);
+        SEL_TEST(released == sizeof(data));
+
+        const ssize_t length = read(fds[0], wire, sizeof(wire));
+        SEL_TEST(length > (ssize_t)sizeof(data));
+        SEL_TEST(!memcmp(wire, "Transfer-Encoding: chunked\r\n\r\n", 30));
+        close(fds[0]);
+        close(fds[1]);
+
+        wire[length] = '\0';
+        body_setup(&req, &in, in_bs, 64, fds, wire + 30);
+        req.body.state = LAW_HTS_BODY_SIZE;
+        SEL_TEST(body_drain(&req, body, &err) == sizeof(data));
+        SEL_TEST(err == LAW_ERR_OK);
+        SEL_TEST(!memcmp(body, data, sizeof(data)));
+        close(fds[0]);
+        close(fds[1]);
+
+        /* Content-Length bodies mix references and copies. */
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
+        req.conn.out = pgc_buf_init(&out, out_bs, 128, 0);
+        req.keep_alive = true;
+        released = 0;
+        SEL_TEST(law_hts_begin_stream_sync(NULL, 0, &req, 7) == LAW_ERR_OK);
+        SEL_TEST(law_hts_write_ref_sync(
+                NULL, 0, &req, "abc", 3, release_ref, &released) == 
+                LAW_ERR_OK);
+        SEL_TEST(law_hts_write_sync(NULL, 0, &req, "de", 2) == LAW_ERR_OK);
+        SEL_TEST(law_hts_write_ref_sync(
+                NULL, 0, &req, "fgh", 3, release_ref, &released) == 
+                LAW_ERR_LIMIT);
+        SEL_TEST(law_hts_write_ref_sync(
+                NULL, 0, &req, "fg", 2, release_ref, &released) == 
+                LAW_ERR_OK);
+        SEL_TEST(law_htc_pending(&req.conn) == 21 + 7);
+        law_htc_drop(&req.conn);
+        SEL_TEST(released == 5);
+}
+
+sel_err_t law_hts_entry_stream(law_worker_t *worker, law_hts_req_t *req);
+
+static struct {
+        int client;                             /** Peer of the Server */
+        const char *later;                      /** Sent After /a Arrives */
+        int served;
+        char paths[8][16];
+        int errors;
+        char reply[512];                        /** What the Client Read */
+} entry;
+
+static sel_err_t entry_on_accept(
+        law_worker_t *worker,
+        law_hts_req_t *req,
+        law_hts_reqline_t *reqline,
+        law_htheaders_t *headers,
+        law_data_t data)
+{
+        const char *path = reqline->target.path ? reqline->target.path : "";
+        if(entry.served < 8)
+                (void)snprintf(entry.paths[entry.served], 16, "%s", path);
+        entry.served += 1;
+
+        /* The rest of a request that was cut short arrives now. */
+        if(entry.later && !strcmp(path, "/a")) {
+                const size_t length = strlen(entry.later);
+                SEL_ASSERT(write(entry.client, entry.later, length) == 
+                        (ssize_t)length);
+        }
+
+        /* Handlers written before keep-alive leave the length out. */
+        SEL_TRY_QUIETLY(law_hts_put_status(req, 200));
+        if(strcmp(path, "/raw")) 
+                SEL_TRY_QUIETLY(law_hts_put_length(req, 2));
+        SEL_TRY_QUIETLY(law_hts_begin_body(req));
+        return pgc_buf_put(req->conn.out, "ok", 2);
+}
+
+static sel_err_t entry_on_error(
+        law_worker_t *worker,
+        law_hts_req_t *req,
+        sel_err_t error,
+        law_data_t data)
+{
+        entry.errors += 1;
+        return LAW_ERR_OK;
+}
+
+/** 
+ * Run the request loop over a socket pair holding the input, with no 
+ * worker: every timeout is 0, so a read that would block times out.
+ */
+static sel_err_t entry_run(
+        const char *input, 
+        const char *later, 
+        const int max_requests)
+{
+        static char in_bs[256], out_bs[256], heap_bs[0x2000], stack_bs[0x1000];
+        static struct pgc_buf in, out;
+        static struct pgc_stk heap, stack;
+        static law_htserver_t server;
+
+        (void)memset(&server, 0, sizeof(server));
+        server.cfg = law_htserver_sanity();
+        server.cfg.idle_timeout = 0;
+        server.cfg.response_timeout = 0;
+        server.cfg.max_requests = max_requests;
+        server.cfg.on_accept = entry_on_accept;
+        server.cfg.on_error = entry_on_error;
+
+        law_hts_req_t req;
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
+        req.htserver = &server;
+        req.parser = LAW_HTS_SCAN;
+        req.conn.security = LAW_HTC_UNSECURED;
+        req.conn.in = pgc_buf_init(&in, in_bs, sizeof(in_bs), 0);
+        req.conn.out = pgc_buf_init(&out, out_bs, sizeof(out_bs), 0);
+        req.heap = pgc_stk_init(&heap, heap_bs, sizeof(heap_bs));
+        req.stack = pgc_stk_init(&stack, stack_bs, sizeof(stack_bs));
+
+        int fds[2];
+        SEL_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK | fcntl(fds[0], F_GETFL));
+        req.conn.socket = fds[0];
+
+        (void)memset(&entry, 0, sizeof(entry));
+        entry.client = fds[1];
+        entry.later = later;
+
+        const size_t length = strlen(input);
+        SEL_ASSERT(write(fds[1], input, length) == (ssize_t)length);
+
+        const sel_err_t err = law_hts_entry_stream(NULL, &req);
+
+        close(fds[0]);
+        const ssize_t n = read(fds[1], entry.reply, sizeof(entry.reply) - 1);
+        entry.reply[n > 0 ? n : 0] = '\0';
+        close(fds[1]);
+        return err;
+}
+
+void test_entry_stream()
+{
+        SEL_INFO();
+
+        /* Two pipelined requests in one read, then a quiet idle close. */
+        SEL_TEST(entry_run(
+                "GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+                "GET /b HTTP/1.1\r\nHost: x\r\n\r\n", 
+                NULL, 0) == LAW_ERR_OK);
+        SEL_TEST(entry.served == 2 && entry.errors == 0);
+        SEL_TEST(!strcmp(entry.paths[0], "/a"));
+        SEL_TEST(!strcmp(entry.paths[1], "/b"));
+        SEL_TEST(!strcmp(entry.reply, 
+                "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"
+                "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"));
+
+        /* Bytes past one request are the start of the next. */
+        SEL_TEST(entry_run(
+                "GET /a HTTP/1.1\r\nHost: x\r\n\r\nGET /b HT", 
+                "TP/1.1\r\nHost: x\r\n\r\n", 0) == LAW_ERR_OK);
+        SEL_TEST(entry.served == 2 && entry.errors == 0);
+        SEL_TEST(!strcmp(entry.paths[1], "/b"));
+
+        /* max_requests closes the connection. */
+        SEL_TEST(entry_run(
+                "GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+                "GET /b HTTP/1.1\r\nHost: x\r\n\r\n"
+                "GET /c HTTP/1.1\r\nHost: x\r\n\r\n", 
+                NULL, 2) == LAW_ERR_OK);
+        SEL_TEST(entry.served == 2 && entry.errors == 0);
+
+        /* HTTP/1.0 closes unless asked to keep alive; 1.1 when asked to. */
+        SEL_TEST(entry_run(
+                "GET /a HTTP/1.0\r\nHost: x\r\n\r\nGET /b HTTP/1.0\r\nHost: x\r\n\r\n", 
+                NULL, 0) == LAW_ERR_OK);
+        SEL_TEST(entry.served == 1);
+        SEL_TEST(entry_run(
+                "GET /a HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"
+                "GET /b HTTP/1.0\r\nHost: x\r\n\r\n", 
+                NULL, 0) == LAW_ERR_OK);
+        SEL_TEST(entry.served == 2);
+        SEL_TEST(entry_run(
+                "GET /a HTTP/1.1\r\nConnection: close\r\n\r\n"
+                "GET /b HTTP/1.1\r\nHost: x\r\n\r\n", 
+                NULL, 0) == LAW_ERR_OK);
+        SEL_TEST(entry.served == 1);
+
+        /* Unframed responses end with the connection, and say so. */
+        SEL_TEST(entry_run(
+                "GET /raw HTTP/1.1\r\nHost: x\r\n\r\n"
+                "GET /b HTTP/1.1\r\nHost: x\r\n\r\n", 
+                NULL, 0) == LAW_ERR_OK);
+        SEL_TEST(entry.served == 1 && entry.errors == 0);
+        SEL_TEST(!strcmp(entry.reply, 
+                "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\nok"));
+
+        /* Bodies the handler did not read are skipped. */
+        SEL_TEST(entry_run(
+                "POST /a HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+                "GET /b HTTP/1.1\r\nHost: x\r\n\r\n", 
+                NULL, 0) == LAW_ERR_OK);
+        SEL_TEST(entry.served == 2 && entry.errors == 0);
+        SEL_TEST(!strcmp(entry.paths[1], "/b"));
+        SEL_TEST(entry_run(
+                "POST /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "5\r\nhello\r\n0\r\n\r\n"
+                "GET /b HTTP/1.1\r\nHost: x\r\n\r\n", 
+                NULL, 0) == LAW_ERR_OK);
+        SEL_TEST(entry.served == 2 && entry.errors == 0);
+        SEL_TEST(!strcmp(entry.paths[1], "/b"));
 }
 
 int main(int argc, char **args)
@@ -279,4 +953,11 @@ int main(int argc, char **args)
         test_pool_groups_create_destroy();
         test_htserver_create_destroy();
         test_read_reqline();
+        test_has_token();
+        test_framing();
+        test_put_head();
+        test_body();
+        test_stream();
+        test_write_ref();
+        test_entry_stream();
 }
\ No newline at end of file
@@ -0,0 +1,439 @@
+
+#define _DEFAULT_SOURCE
+
+#include "lawd/http_static.h"
+#include "lawd/http_scan.h"
+#include "lawd/private/http_server.h"
+#include "lawd/private/http_headers.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+sel_err_t law_hsf_path(const char *target, const char *index, char *path);
+bool law_hsf_etag_match(const char *list, const char *etag);
+int law_hsf_range(
+        const char *range,
+        const size_t size,
+        size_t *first,
+        size_t *last);
+
+static char root[] = "/tmp/law_hsf_XXXXXX";
+
+static void put_file(const char *name, const char *text)
+{
+        char path[128], temp[128];
+        (void)snprintf(path, sizeof(path), "%s/%s", root, name);
+        (void)snprintf(temp, sizeof(temp), "%s/.tmp", root);
+        FILE *file = fopen(temp, "w");
+        SEL_ASSERT(file);
+        (void)fputs(text, file);
+        (void)fclose(file);
+        SEL_ASSERT(!rename(temp, path));
+}
+
+void test_path()
+{
+        SEL_INFO();
+
+        char path[256];
+
+        SEL_TEST(law_hsf_path("/", "index.html", path) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(path, "index.html"));
+        SEL_TEST(law_hsf_path("/a/b.css", "index.html", path) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(path, "a/b.css"));
+        SEL_TEST(law_hsf_path("//a/./b//", "i", path) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(path, "a/b/i"));
+        SEL_TEST(law_hsf_path("/a/.", "i", path) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(path, "a/i"));
+        SEL_TEST(law_hsf_path("/my%20file.txt", "i", path) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(path, "my file.txt"));
+        SEL_TEST(law_hsf_path("/...", "i", path) == LAW_ERR_OK);
+        SEL_TEST(!strcmp(path, "..."));
+
+        SEL_TEST(law_hsf_path("/../etc/passwd", "i", path) == LAW_ERR_SYN);
+        SEL_TEST(law_hsf_path("/a/..", "i", path) == LAW_ERR_SYN);
+        SEL_TEST(law_hsf_path("/%2e%2e/x", "i", path) == LAW_ERR_SYN);
+        SEL_TEST(law_hsf_path("/..%2f..", "i", path) == LAW_ERR_SYN);
+        SEL_TEST(law_hsf_path("/a%00.txt", "i", path) == LAW_ERR_SYN);
+        SEL_TEST(law_hsf_path("/a%2", "i", path) == LAW_ERR_SYN);
+        SEL_TEST(law_hsf_path("/a%zz", "i", path) == LAW_ERR_SYN);
+
+        char target[400] = "/";
+        (void)memset(target + 1, 'x', 300);
+        target[301] = '\0';
+        SEL_TEST(law_hsf_path(target, "i", path) == LAW_ERR_OOB);
+}
+
+void test_range()
+{
+        SEL_INFO();
+
+        size_t first = 0, last = 0;
+
+        SEL_TEST(law_hsf_range("bytes=0-99", 1000, &first, &last) == 1);
+        SEL_TEST(first == 0 && last == 99);
+        SEL_TEST(law_hsf_range("bytes=500-", 1000, &first, &last) == 1);
+        SEL_TEST(first == 500 && last == 999);
+        SEL_TEST(law_hsf_range("bytes=-100", 1000, &first, &last) == 1);
+        SEL_TEST(first == 900 && last == 999);
+        SEL_TEST(law_hsf_range("bytes=-5000", 1000, &first, &last) == 1);
+        SEL_TEST(first == 0 && last == 999);
+        SEL_TEST(law_hsf_range("bytes=900-5000", 1000, &first, &last) == 1);
+        SEL_TEST(first == 900 && last == 999);
+
+        SEL_TEST(law_hsf_range("bytes=1000-", 1000, &first, &last) == -1);
+        SEL_TEST(law_hsf_range("bytes=-0", 1000, &first, &last) == -1);
+        SEL_TEST(law_hsf_range("bytes=0-", 0, &first, &last) == -1);
+
+        SEL_TEST(law_hsf_range("bytes=5-1", 1000, &first, &last) == 0);
+        SEL_TEST(law_hsf_range("bytes=0-1,5-6", 1000, &first, &last) == 0);
+        SEL_TEST(law_hsf_range("items=0-1", 1000, &first, &last) == 0);
+        SEL_TEST(law_hsf_range("bytes=x-1", 1000, &first, &last) == 0);
+        SEL_TEST(law_hsf_range("bytes=-", 1000, &first, &last) == 0);
+        SEL_TEST(law_hsf_range(
+                "bytes=99999999999999999999-", 1000, &first, &last) == 0);
+}
+
+void test_etag_match()
+{
+        SEL_INFO();
+
+        SEL_TEST(law_hsf_etag_match("\"a-1\"", "\"a-1\""));
+        SEL_TEST(law_hsf_etag_match("W/\"a-1\"", "\"a-1\""));
+        SEL_TEST(law_hsf_etag_match("\"x\", \"a-1\" ", "\"a-1\""));
+        SEL_TEST(law_hsf_etag_match("*", "\"a-1\""));
+        SEL_TEST(!law_hsf_etag_match("\"a-2\"", "\"a-1\""));
+        SEL_TEST(!law_hsf_etag_match("a-1", "\"a-1\""));
+        SEL_TEST(!law_hsf_etag_match("", "\"a-1\""));
+}
+
+static char wire[8192];
+
+/** Serve one request onto the socket, from a task or without a worker. */
+static sel_err_t serve_on(
+        law_hsf_t *hsf,
+        law_worker_t *worker,
+        const int socket,
+        const char *method,
+        const char *path,
+        const char *head)
+{
+        char out_bs[4096], heap_bs[0x2000], target[256], text[1024];
+        struct pgc_buf out;
+        struct pgc_stk heap;
+
+        law_hts_req_t req;
+        (void)memset(&req, 0, sizeof(law_hts_req_t));
+        req.conn.out = pgc_buf_init(&out, out_bs, sizeof(out_bs), 0);
+        req.conn.security = LAW_HTC_UNSECURED;
+        req.conn.socket = socket;
+        req.keep_alive = true;
+
+        law_hts_reqline_t reqline;
+        (void)memset(&reqline, 0, sizeof(reqline));
+        reqline.method = method;
+        (void)snprintf(target, sizeof(target), "%s", path);
+        reqline.target.path = target;
+
+        law_htheaders_t headers;
+        (void)snprintf(text, sizeof(text), "%s%s\r\n", 
+                head, *head ? "\r\n" : "");
+        pgc_stk_init(&heap, heap_bs, sizeof(heap_bs));
+        SEL_ASSERT(law_hsc_headers(text, strlen(text), &heap, &headers) ==
+                LAW_ERR_OK);
+
+        SEL_TRY_QUIETLY(law_hsf_serve(hsf, worker, &req, &reqline, &headers));
+        return law_htc_flush_sync(worker, 5000, &req.conn);
+}
+
+/** Serve one request and return what went out on the wire. */
+static const char *serve(
+        law_hsf_t *hsf,
+        const char *method,
+        const char *path,
+        const char *head)
+{
+        int fds[2];
+        SEL_ASSERT(pipe(fds) == 0);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK | fcntl(fds[0], F_GETFL));
+
+        SEL_TEST(serve_on(hsf, NULL, fds[1], method, path, head) == 
+                LAW_ERR_OK);
+
+        const ssize_t n = read(fds[0], wire, sizeof(wire) - 1);
+        wire[n > 0 ? n : 0] = '\0';
+        close(fds[0]);
+        close(fds[1]);
+        return wire;
+}
+
+static const char *body_of(const char *response)
+{
+        const char *body = strstr(response, "\r\n\r\n");
+        return body ? body + 4 : "";
+}
+
+void test_serve()
+{
+        SEL_INFO();
+
+        SEL_ASSERT(mkdtemp(root));
+        put_file("hello.txt", "hello world\n");
+        put_file("index.html", "<p>home</p>");
+        put_file("a.css", "a{}");
+        put_file("b.js", "b()");
+
+        law_server_cfg_t srv_cfg = law_server_sanity();
+        srv_cfg.workers = 1;
+        law_hsf_cfg_t cfg = law_hsf_sanity();
+        cfg.root = root;
+        cfg.entries = 2;
+
+        law_hsf_t *hsf = law_hsf_create(&srv_cfg, &cfg);
+        SEL_ASSERT(hsf);
+
+        const char *r = serve(hsf, "GET", "/hello.txt", "");
+        SEL_TEST(!strncmp(r, "HTTP/1.1 200 OK\r\n", 17));
+        SEL_TEST(strstr(r, "Content-Length: 12\r\n"));
+        SEL_TEST(strstr(r, "Content-Type: text/plain; charset=utf-8\r\n"));
+        SEL_TEST(strstr(r, "Accept-Ranges: bytes\r\n"));
+        SEL_TEST(!strcmp(body_of(r), "hello world\n"));
+
+        char etag[64] = "If-None-Match: ", modified[64] = "If-Range: ";
+        const char *tag = strstr(r, "ETag: ") + 6;
+        (void)strncat(etag, tag, (size_t)(strchr(tag, '\r') - tag));
+        const char *lm = strstr(r, "Last-Modified: ") + 15;
+        (void)strncat(modified, lm, (size_t)(strchr(lm, '\r') - lm));
+
+        r = serve(hsf, "HEAD", "/hello.txt", "");
+        SEL_TEST(strstr(r, "Content-Length: 12\r\n"));
+        SEL_TEST(!strcmp(body_of(r), ""));
+
+        r = serve(hsf, "GET", "/hello.txt", etag);
+        SEL_TEST(!strncmp(r, "HTTP/1.1 304 Not Modified\r\n", 27));
+        SEL_TEST(!strcmp(body_of(r), ""));
+
+        r = serve(hsf, "GET", "/hello.txt", "Range: bytes=1-3");
+        SEL_TEST(!strncmp(r, "HTTP/1.1 206 Partial Content\r\n", 30));
+        SEL_TEST(strstr(r, "Content-Range: bytes 1-3/12\r\n"));
+        SEL_TEST(!strcmp(body_of(r), "ell"));
+
+        char head[160];
+        (void)snprintf(head, sizeof(head), "Range: bytes=-6\r\n%s", modified);
+        r = serve(hsf, "GET", "/hello.txt", head);
+        SEL_TEST(!strcmp(body_of(r), "world\n"));
+
+        r = serve(hsf, "GET", "/hello.txt",
+                "Range: bytes=-6\r\nIf-Range: \"stale\"");
+        SEL_TEST(!strncmp(r, "HTTP/1.1 200 OK\r\n", 17));
+
+        r = serve(hsf, "GET", "/hello.txt", "Range: bytes=50-");
+        SEL_TEST(!strncmp(r, "HTTP/1.1 416 ", 13));
+        SEL_TEST(strstr(r, "Content-Range: bytes */12\r\n"));
+
+        r = serve(hsf, "GET", "/", "");
+        SEL_TEST(strstr(r, "Content-Type: text/html; charset=utf-8\r\n"));
+        SEL_TEST(!strcmp(body_of(r), "<p>home</p>"));
+
+        SEL_TEST(!strncmp(serve(hsf, "GET", "/nope", ""),
+                "HTTP/1.1 404 ", 13));
+        SEL_TEST(!strncmp(serve(hsf, "GET", "/../x", ""),
+                "HTTP/1.1 400 ", 13));
+        r = serve(hsf, "POST", "/hello.txt", "");
+        SEL_TEST(!strncmp(r, "HTTP/1.1 405 ", 13));
+        SEL_TEST(strstr(r, "Allow: GET, HEAD\r\n"));
+
+        /* More files than cache entries evict the least recently used. */
+        SEL_TEST(!strcmp(body_of(serve(hsf, "GET", "/a.css", "")), "a{}"));
+        SEL_TEST(!strcmp(body_of(serve(hsf, "GET", "/b.js", "")), "b()"));
+        SEL_TEST(!strcmp(body_of(serve(hsf, "GET", "/hello.txt", "")),
+                "hello world\n"));
+
+        /* Replaced files are picked up once the entry is revalidated. */
+        put_file("hello.txt", "goodbye\n");
+        law_hsf_destroy(hsf);
+        cfg.revalidate = 0;
+        SEL_ASSERT((hsf = law_hsf_create(&srv_cfg, &cfg)));
+        SEL_TEST(!strcmp(body_of(serve(hsf, "GET", "/hello.txt", "")),
+                "goodbye\n"));
+        put_file("hello.txt", "hello again\n");
+        SEL_TEST(!strcmp(body_of(serve(hsf, "GET", "/hello.txt", "")),
+                "hello again\n"));
+        law_hsf_destroy(hsf);
+
+        const char *names[] = { "hello.txt", "index.html", "a.css", "b.js" };
+        for(size_t n = 0; n < sizeof(names) / sizeof(*names); ++n) {
+                char path[128];
+                (void)snprintf(path, sizeof(path), "%s/%s", root, names[n]);
+                (void)unlink(path);
+        }
+        (void)rmdir(root);
+}
+
+#define TEST_BIG 0x40000
+
+typedef struct test_send_state {
+        law_server_t *server;
+        law_hsf_t *hsf;
+        int fds[2];                             /** Server, Client */
+        atomic_int sending;                     /** 1: Started, 2: Done */
+        sel_err_t sent;
+        size_t length;                          /** Bytes the Client Read */
+        size_t body;                            /** Body Bytes of 'a' */
+} test_send_state_t;
+
+static test_send_state_t send_state;
+
+/** Write a file of one repeated byte. */
+static void put_big(const char *name, const char c)
+{
+        static char text[TEST_BIG + 1];
+        (void)memset(text, c, TEST_BIG);
+        text[TEST_BIG] = '\0';
+        put_file(name, text);
+}
+
+sel_err_t test_send_big(law_worker_t *worker, law_data_t data)
+{
+        test_send_state_t *state = data.ptr;
+        SEL_ASSERT(law_ectl(worker, state->fds[0], LAW_EV_ADD, 0, 0, 0) == 
+                LAW_ERR_OK);
+        atomic_store(&state->sending, 1);
+        state->sent = serve_on(
+                state->hsf, 
+                worker, 
+                state->fds[0], 
+                "GET", 
+                "/big.bin", 
+                "");
+        atomic_store(&state->sending, 2);
+        (void)law_ectl(worker, state->fds[0], LAW_EV_DEL, 0, 0, 0);
+        return LAW_ERR_OK;
+}
+
+/** Replace the file while it is being sent, then read the response. */
+sel_err_t test_send_replace(law_worker_t *worker, law_data_t data)
+{
+        test_send_state_t *state = data.ptr;
+
+        while(!atomic_load(&state->sending)) 
+                (void)law_sleep(worker, 1);
+        (void)law_sleep(worker, 20);
+
+        /* Revalidating the entry reopens the file; with the old descriptor 
+         * closed, the new one may take its number. */
+        put_big("big.bin", 'b');
+        int fds[2];
+        SEL_ASSERT(pipe(fds) == 0);
+        SEL_TEST(serve_on(state->hsf, worker, fds[1], "HEAD", "/big.bin", "")
+                == LAW_ERR_OK);
+        close(fds[0]);
+        close(fds[1]);
+
+        const char *body = NULL;
+        static char reply[TEST_BIG + 512];
+        while(state->length < sizeof(reply) - 1) {
+                const ssize_t n = read(
+                        state->fds[1], 
+                        reply + state->length, 
+                        sizeof(reply) - 1 - state->length);
+                if(n == 0) break;
+                if(n < 0) {
+                        SEL_ASSERT(errno == EAGAIN);
+                        if(atomic_load(&state->sending) == 2) break;
+                        (void)law_sleep(worker, 1);
+                        continue;
+                }
+                state->length += (size_t)n;
+                reply[state->length] = '\0';
+                if(!body && (body = strstr(reply, "\r\n\r\n"))) 
+                        body += 4;
+                if(body && reply + state->length - body == TEST_BIG) 
+                        break;
+        }
+
+        for(const char *c = body; c && c < reply + state->length; ++c) 
+                state->body += *c == 'a';
+
+        law_stop(state->server);
+        return LAW_ERR_OK;
+}
+
+void test_send_while_replaced()
+{
+        SEL_INFO();
+
+        test_send_state_t *state = &send_state;
+        (void)memset(state, 0, sizeof(test_send_state_t));
+        atomic_init(&state->sending, 0);
+
+        SEL_ASSERT(mkdtemp(strcpy(root, "/tmp/law_hsf_XXXXXX")));
+        put_big("big.bin", 'a');
+
+        law_server_cfg_t srv_cfg = law_server_sanity();
+        srv_cfg.protocol = LAW_PROTOCOL_NONE;
+        srv_cfg.workers = 1;
+        srv_cfg.server_timeout = 10;
+        srv_cfg.worker_timeout = 10;
+        srv_cfg.stack = 0x20000;
+
+        law_hsf_cfg_t cfg = law_hsf_sanity();
+        cfg.root = root;
+        cfg.revalidate = 0;
+
+        SEL_ASSERT((state->hsf = law_hsf_create(&srv_cfg, &cfg)));
+        SEL_ASSERT((state->server = law_server_create(&srv_cfg)));
+
+        /* A small send buffer makes the send wait on the client. */
+        const int sndbuf = 4096;
+        SEL_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, state->fds) == 0);
+        SEL_ASSERT(!setsockopt(state->fds[0], SOL_SOCKET, SO_SNDBUF, 
+                &sndbuf, sizeof(sndbuf)));
+        for(int n = 0; n < 2; ++n) 
+                fcntl(state->fds[n], F_SETFL, 
+                        O_NONBLOCK | fcntl(state->fds[n], F_GETFL));
+
+        SEL_ASSERT(law_open(state->server) == LAW_ERR_OK);
+        SEL_ASSERT(law_spawn(
+                state->server, 
+                test_send_big, 
+                (law_data_t){ .ptr = state }) == LAW_ERR_OK);
+        SEL_ASSERT(law_spawn(
+                state->server, 
+                test_send_replace, 
+                (law_data_t){ .ptr = state }) == LAW_ERR_OK);
+        SEL_ASSERT(law_start(state->server) == LAW_ERR_OK);
+        SEL_ASSERT(law_close(state->server) == LAW_ERR_OK);
+
+        /* The response is the file as it was opened. */
+        SEL_TEST(state->sent == LAW_ERR_OK);
+        SEL_TEST(state->body == TEST_BIG);
+
+        close(state->fds[0]);
+        close(state->fds[1]);
+        law_server_destroy(state->server);
+        law_hsf_destroy(state->hsf);
+
+        char path[128];
+        (void)snprintf(path, sizeof(path), "%s/big.bin", root);
+        (void)unlink(path);
+        (void)rmdir(root);
+}
+
+int main(int argc, char **args)
+{
+        SEL_INFO();
+
+        law_err_init();
+
+        test_path();
+        test_range();
+        test_etag_match();
+        test_serve();
+        test_send_while_replaced();
+}
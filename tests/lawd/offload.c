@@ -0,0 +1,225 @@
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "lawd/offload.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct test_offload_state {
+        law_server_t *server;
+        pthread_t caller;
+        pthread_t callee;
+        atomic_int ticks;
+        atomic_int release;
+        sel_err_t result;
+        sel_err_t second;
+        int ticks_during;
+        law_offload_timing_t timing;
+        law_offload_stats_t stats;
+} test_offload_state_t;
+
+sel_err_t test_offload_on_error(
+        law_server_t *server,
+        sel_err_t error,
+        law_data_t data)
+{
+        return LAW_ERR_OK;
+}
+
+static void test_offload_sleep(const long ms)
+{
+        struct timespec ts = {
+                .tv_sec = ms / 1000,
+                .tv_nsec = (ms % 1000) * 1000000
+        };
+        nanosleep(&ts, NULL);
+}
+
+static law_server_t *test_offload_server(
+        const int threads,
+        const int queue)
+{
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_NONE;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.offload_threads = threads;
+        cfg.offload_queue = queue;
+        cfg.on_error = test_offload_on_error;
+
+        law_server_t *server = law_server_create(&cfg);
+        assert(server);
+        assert(law_open(server) == LAW_ERR_OK);
+        return server;
+}
+
+sel_err_t test_offload_slow(void *arg)
+{
+        test_offload_state_t *state = arg;
+        state->callee = pthread_self();
+        test_offload_sleep(50);
+        return 7;
+}
+
+sel_err_t test_offload_ticker(law_worker_t *worker, law_data_t data)
+{
+        test_offload_state_t *state = data.ptr;
+        for(int n = 0; n < 100; ++n) {
+                atomic_fetch_add(&state->ticks, 1);
+                (void)law_ewait(worker, 1, NULL, 0);
+        }
+        return LAW_ERR_OK;
+}
+
+sel_err_t test_offload_caller(law_worker_t *worker, law_data_t data)
+{
+        test_offload_state_t *state = data.ptr;
+        state->caller = pthread_self();
+
+        assert(law_spawn_local(
+                worker,
+                test_offload_ticker,
+                data) != 0);
+
+        const int before = atomic_load(&state->ticks);
+        state->result = law_offload_timed(
+                worker,
+                test_offload_slow,
+                state,
+                5000,
+                &state->timing);
+        state->ticks_during = atomic_load(&state->ticks) - before;
+
+        law_stop(state->server);
+        return LAW_ERR_OK;
+}
+
+void test_offload_result()
+{
+        SEL_INFO();
+
+        test_offload_state_t state;
+        memset(&state, 0, sizeof(test_offload_state_t));
+
+        law_server_t *server = test_offload_server(2, 4);
+        state.server = server;
+
+        assert(law_spawn(
+                server,
+                test_offload_caller,
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_start(server) == LAW_ERR_OK);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(state.result == 7);
+        assert(!pthread_equal(state.caller, state.callee));
+        assert(state.ticks_during > 0);
+        assert(state.timing.running >= 40000000);
+        assert(state.timing.queued >= 0);
+
+        law_offload_stats(server, &state.stats);
+        assert(state.stats.threads == 2);
+        assert(state.stats.depth == 4);
+        assert(state.stats.submitted == 1);
+        assert(state.stats.completed == 1);
+        assert(state.stats.queued == 0);
+        assert(state.stats.running == 0);
+        assert(state.stats.running_max >= 40000000);
+
+        law_server_destroy(server);
+}
+
+sel_err_t test_offload_block(void *arg)
+{
+        test_offload_state_t *state = arg;
+        while(!atomic_load(&state->release)) test_offload_sleep(1);
+        return LAW_ERR_OK;
+}
+
+sel_err_t test_offload_second(law_worker_t *worker, law_data_t data)
+{
+        test_offload_state_t *state = data.ptr;
+        state->second = law_offload(worker, test_offload_block, state, 1000);
+        return LAW_ERR_OK;
+}
+
+sel_err_t test_offload_timeout_task(law_worker_t *worker, law_data_t data)
+{
+        test_offload_state_t *state = data.ptr;
+
+        /* Only one slot, so a second job is refused while this one waits. */
+        assert(law_spawn_local(worker, test_offload_second, data) != 0);
+
+        state->result = law_offload(worker, test_offload_block, state, 20);
+        atomic_store(&state->release, 1);
+
+        law_stop(state->server);
+        return LAW_ERR_OK;
+}
+
+void test_offload_timeout()
+{
+        SEL_INFO();
+
+        test_offload_state_t state;
+        memset(&state, 0, sizeof(test_offload_state_t));
+        atomic_init(&state.release, 0);
+
+        law_server_t *server = test_offload_server(1, 1);
+        state.server = server;
+
+        assert(law_spawn(
+                server,
+                test_offload_timeout_task,
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_start(server) == LAW_ERR_OK);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(state.result == LAW_ERR_TIME);
+        assert(state.second == LAW_ERR_LIMIT);
+
+        law_offload_stats(server, &state.stats);
+        assert(state.stats.submitted == 1);
+        assert(state.stats.rejected == 1);
+        assert(state.stats.abandoned == 1);
+        assert(state.stats.completed == 1);
+
+        law_server_destroy(server);
+}
+
+void test_offload_no_threads()
+{
+        SEL_INFO();
+
+        test_offload_state_t state;
+        memset(&state, 0, sizeof(test_offload_state_t));
+
+        law_server_t *server = test_offload_server(0, 4);
+        state.server = server;
+
+        assert(law_spawn(
+                server,
+                test_offload_timeout_task,
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        atomic_store(&state.release, 1);
+        assert(law_start(server) == LAW_ERR_OK);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(state.result == LAW_ERR_LIMIT);
+        assert(state.second == LAW_ERR_LIMIT);
+
+        law_server_destroy(server);
+}
+
+int main(int argc, char **args)
+{
+        SEL_INFO();
+
+        test_offload_result();
+        test_offload_timeout();
+        test_offload_no_threads();
+}
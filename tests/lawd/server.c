@@ -1,10 +1,23 @@
 
+/* S_ISSOCK */
+#define _DEFAULT_SOURCE
 #include "lawd/server.h"
 #include "lawd/private/server.h"
+#include "lawd/codel.h"
 #include <assert.h>
 #include <string.h>
 #include <pthread.h>
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
 
 sel_err_t law_msg_queue_open(law_msg_queue_t *queue);
 void law_msg_queue_close(law_msg_queue_t *queue);
@@ -178,6 +191,10 @@ void test_task_pool_pop_push()
         assert(law_task_pool_size(pool) == 0);
         law_task_destroy(task);
 
+        assert(!law_task_pool_pop(pool));
+        assert(!law_task_pool_pop(pool));
+        assert(law_task_pool_is_empty(pool));
+
         law_task_pool_destroy(pool);
 }
 
@@ -195,12 +212,21 @@ void test_ready_set_push_pop()
 
         law_task_pool_t *pool = law_task_pool_create(&cfg);
 
+        law_task_t *first = law_task_pool_pop(pool);
+        law_task_t *second = law_task_pool_pop(pool);
+
         law_ready_set_init(&ready);
-        assert(law_ready_set_push(&ready, law_task_pool_pop(pool)));
-        assert(law_ready_set_push(&ready, law_task_pool_pop(pool)));
+        assert(law_ready_set_push(&ready, first));
+        assert(law_ready_set_push(&ready, second));
+        assert(!law_ready_set_push(&ready, first));
+        assert(ready.size == 2);
         
-        law_task_pool_push(pool, law_ready_set_pop(&ready));
-        law_task_pool_push(pool, law_ready_set_pop(&ready));
+        assert(law_ready_set_pop(&ready) == first);
+        assert(law_ready_set_pop(&ready) == second);
+        assert(!law_ready_set_pop(&ready));
+
+        law_task_pool_push(pool, first);
+        law_task_pool_push(pool, second);
 
         law_task_pool_destroy(pool);
 }
@@ -218,6 +244,939 @@ void test_server_create_destroy()
         law_server_destroy(server);
 }
 
+typedef struct test_spawn_state {
+        law_server_t *server;
+        int children;
+        int limited;
+        law_id_t ids[8];
+} test_spawn_state_t;
+
+sel_err_t test_spawn_child(law_worker_t *worker, law_data_t data)
+{
+        test_spawn_state_t *state = data.ptr;
+        state->children += 1;
+        return LAW_ERR_OK;
+}
+
+sel_err_t test_spawn_parent(law_worker_t *worker, law_data_t data)
+{
+        test_spawn_state_t *state = data.ptr;
+
+        /* The parent holds one of the four tasks. */
+        for(int n = 0; n < 8; ++n) {
+                state->ids[n] = law_spawn_local(
+                        worker, 
+                        test_spawn_child, 
+                        data);
+                if(!state->ids[n]) state->limited += 1;
+        }
+
+        assert(state->children == 0);
+        assert(state->limited == 5);
+        assert(state->ids[0] != state->ids[1]);
+        assert(state->ids[1] != state->ids[2]);
+
+        while(state->children < 3) (void)law_ewait(worker, 1, NULL, 0);
+
+        /* Finished children come back through the worker's supply. */
+        for(int n = 0; n < 3; ++n) {
+                state->ids[n] = law_spawn_local(
+                        worker, 
+                        test_spawn_child, 
+                        data);
+                assert(state->ids[n]);
+        }
+        
+        while(state->children < 6) (void)law_ewait(worker, 1, NULL, 0);
+
+        law_stop(state->server);
+        return LAW_ERR_OK;
+}
+
+void test_spawn_local()
+{
+        test_spawn_state_t state;
+        memset(&state, 0, sizeof(test_spawn_state_t));
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_NONE;
+        cfg.workers = 1;
+        cfg.worker_tasks = 4;
+        cfg.worker_supply = 2;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+
+        law_server_t *server = law_server_create(&cfg);
+        state.server = server;
+
+        assert(law_open(server) == LAW_ERR_OK);
+        assert(law_spawn(
+                server, 
+                test_spawn_parent, 
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_start(server) == LAW_ERR_OK);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(state.children == 6);
+
+        law_server_destroy(server);
+}
+
+typedef struct test_arena_state {
+        law_server_t *server;
+        int runs;
+        law_arena_stats_t stats;
+} test_arena_state_t;
+
+sel_err_t test_arena_task(law_worker_t *worker, law_data_t data)
+{
+        test_arena_state_t *state = data.ptr;
+        law_arena_t *arena = law_task_arena(worker);
+
+        law_arena_stats(arena, &state->stats);
+        assert(state->stats.used == 0);
+        assert(state->stats.high_water == 0);
+
+        assert(law_arena_alloc(arena, 100));
+        assert(law_arena_alloc(arena, 0x8000));
+
+        law_arena_stats(arena, &state->stats);
+        assert(state->stats.used >= 0x8000 + 100);
+
+        if(++state->runs == 2) {
+                /* The first run's chunks came back to the worker. */
+                assert(state->stats.slab_cached == 0);
+                assert(state->stats.slab_high_water == state->stats.used);
+                law_stop(state->server);
+        } else {
+                assert(law_spawn_local(worker, test_arena_task, data));
+        }
+
+        return LAW_ERR_OK;
+}
+
+void test_task_arena()
+{
+        test_arena_state_t state;
+        memset(&state, 0, sizeof(test_arena_state_t));
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_NONE;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.arena_chunk = 0x100;
+
+        law_server_t *server = law_server_create(&cfg);
+        state.server = server;
+
+        assert(law_open(server) == LAW_ERR_OK);
+        assert(law_spawn(
+                server, 
+                test_arena_task, 
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_start(server) == LAW_ERR_OK);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(state.runs == 2);
+
+        law_server_destroy(server);
+}
+
+typedef struct test_yield_state {
+        law_server_t *server;
+        char trace[8];
+        int length;
+        law_time_t slept;
+} test_yield_state_t;
+
+sel_err_t test_yield_child(law_worker_t *worker, law_data_t data)
+{
+        test_yield_state_t *state = data.ptr;
+        for(int n = 0; n < 3; ++n) {
+                state->trace[state->length++] = 'b';
+                law_yield(worker);
+        }
+        return LAW_ERR_OK;
+}
+
+sel_err_t test_yield_parent(law_worker_t *worker, law_data_t data)
+{
+        test_yield_state_t *state = data.ptr;
+
+        assert(law_spawn_local(worker, test_yield_child, data));
+
+        for(int n = 0; n < 3; ++n) {
+                state->trace[state->length++] = 'a';
+                law_yield(worker);
+        }
+
+        const law_time_t start = law_time_millis();
+        assert(law_sleep(worker, 20) == LAW_ERR_OK);
+        state->slept = law_time_millis() - start;
+
+        law_stop(state->server);
+        return LAW_ERR_OK;
+}
+
+void test_yield_sleep()
+{
+        test_yield_state_t state;
+        memset(&state, 0, sizeof(test_yield_state_t));
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_NONE;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+
+        law_server_t *server = law_server_create(&cfg);
+        state.server = server;
+
+        assert(law_open(server) == LAW_ERR_OK);
+        assert(law_spawn(
+                server, 
+                test_yield_parent, 
+                (law_data_t){ .ptr = &state }) == LAW_ERR_OK);
+        assert(law_start(server) == LAW_ERR_OK);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(!strcmp(state.trace, "ababab"));
+        assert(state.slept >= 20);
+
+        law_server_destroy(server);
+}
+
+typedef struct test_listener_state {
+        law_server_t *server;
+        atomic_int accepted[2];
+} test_listener_state_t;
+
+static test_listener_state_t listener_state;
+
+sel_err_t test_listener_on_accept(
+        law_worker_t *worker, 
+        int socket, 
+        law_data_t data)
+{
+        char byte;
+
+        /* Wait for the client to hang up so the TIME_WAIT stays client side. */
+        while(read(socket, &byte, 1) == -1 && errno == EAGAIN) 
+                (void)law_sleep(worker, 1);
+
+        close(socket);
+        atomic_fetch_add(&listener_state.accepted[data.i32], 1);
+        return LAW_ERR_OK;
+}
+
+void *test_listener_client(void *arg)
+{
+        test_listener_state_t *state = arg;
+        const int ports[] = { 18621, 18622, 18622 };
+
+        for(int n = 0; n < 3; ++n) {
+                struct sockaddr_in addr;
+                memset(&addr, 0, sizeof(struct sockaddr_in));
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons((uint16_t)ports[n]);
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+                const int fd = socket(AF_INET, SOCK_STREAM, 0);
+                assert(fd != -1);
+                assert(connect(
+                        fd, 
+                        (struct sockaddr*)&addr, 
+                        sizeof(addr)) == 0);
+                close(fd);
+        }
+
+        while(atomic_load(&state->accepted[0]) + 
+              atomic_load(&state->accepted[1]) < 3) 
+                law_time_sleep(1);
+
+        law_stop(state->server);
+
+        return NULL;
+}
+
+void test_listeners()
+{
+        test_listener_state_t *state = &listener_state;
+        atomic_init(&state->accepted[0], 0);
+        atomic_init(&state->accepted[1], 0);
+
+        law_listener_cfg_t listeners[2] = {
+                {
+                        .protocol = LAW_PROTOCOL_TCP,
+                        .port = 18621,
+                        .backlog = 8,
+                        .on_accept = test_listener_on_accept,
+                        .data = { .i32 = 0 }
+                },
+                {
+                        .protocol = LAW_PROTOCOL_TCP,
+                        .port = 18622,
+                        .backlog = 8,
+                        .on_accept = test_listener_on_accept,
+                        .data = { .i32 = 1 }
+                }
+        };
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.workers = 2;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.listeners = listeners;
+        cfg.num_listeners = 2;
+
+        law_server_t *server = law_server_create(&cfg);
+        state->server = server;
+
+        assert(law_open(server) == LAW_ERR_OK);
+        assert(law_get_listener_socket(server, 0) == 
+                law_get_server_socket(server));
+        assert(law_get_listener_socket(server, 1) != 
+                law_get_server_socket(server));
+
+        pthread_t client;
+        assert(pthread_create(
+                &client, 
+                NULL, 
+                test_listener_client, 
+                state) == 0);
+
+        assert(law_start(server) == LAW_ERR_OK);
+        pthread_join(client, NULL);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(atomic_load(&state->accepted[0]) == 1);
+        assert(atomic_load(&state->accepted[1]) == 2);
+
+        law_server_destroy(server);
+}
+
+#define TEST_UNIX_PATH "/tmp/lawd_test_server.sock"
+
+void *test_unix_client(void *arg)
+{
+        test_listener_state_t *state = arg;
+
+        struct stat st;
+        assert(stat(TEST_UNIX_PATH, &st) == 0);
+        assert(S_ISSOCK(st.st_mode));
+        assert((st.st_mode & 0777) == 0600);
+
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(struct sockaddr_un));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, TEST_UNIX_PATH);
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(fd != -1);
+        assert(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        close(fd);
+
+        /* The other server's liveness probe was a connection too. */
+        while(atomic_load(&state->accepted[0]) < 2) 
+                law_time_sleep(1);
+
+        law_stop(state->server);
+
+        return NULL;
+}
+
+void test_unix_listener()
+{
+        test_listener_state_t *state = &listener_state;
+        atomic_init(&state->accepted[0], 0);
+        atomic_init(&state->accepted[1], 0);
+
+        /* Leave a stale socket file behind for the server to replace. */
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(struct sockaddr_un));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, TEST_UNIX_PATH);
+        (void)unlink(TEST_UNIX_PATH);
+        const int stale = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(bind(stale, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        close(stale);
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.protocol = LAW_PROTOCOL_UNIX;
+        cfg.unix_path = TEST_UNIX_PATH;
+        cfg.unix_mode = 0600;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.on_accept = test_listener_on_accept;
+
+        law_server_t *server = law_server_create(&cfg);
+        state->server = server;
+
+        assert(law_open(server) == LAW_ERR_OK);
+
+        /* A second server must not steal a live socket. */
+        law_server_t *other = law_server_create(&cfg);
+        assert(law_open(other) == LAW_ERR_SYS);
+        law_server_destroy(other);
+
+        pthread_t client;
+        assert(pthread_create(
+                &client, 
+                NULL, 
+                test_unix_client, 
+                state) == 0);
+
+        assert(law_start(server) == LAW_ERR_OK);
+        pthread_join(client, NULL);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(atomic_load(&state->accepted[0]) == 2);
+        assert(access(TEST_UNIX_PATH, F_OK) == -1);
+
+        law_server_destroy(server);
+}
+
+#define TEST_HANDOFF_PATH "/tmp/lawd_test_handoff.sock"
+
+typedef struct test_handoff_state {
+        law_server_t *old;
+        sel_err_t sent;
+} test_handoff_state_t;
+
+void *test_handoff_sender(void *arg)
+{
+        test_handoff_state_t *handoff = arg;
+        handoff->sent = law_handoff_send(handoff->old, TEST_HANDOFF_PATH, 2000);
+        return NULL;
+}
+
+void *test_handoff_client(void *arg)
+{
+        test_listener_state_t *state = arg;
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(struct sockaddr_in));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(18631);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(fd != -1);
+        assert(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        close(fd);
+
+        while(atomic_load(&state->accepted[0]) + 
+              atomic_load(&state->accepted[1]) < 2) 
+                law_time_sleep(1);
+
+        law_stop(state->server);
+
+        return NULL;
+}
+
+void test_handoff()
+{
+        test_listener_state_t *state = &listener_state;
+        atomic_init(&state->accepted[0], 0);
+        atomic_init(&state->accepted[1], 0);
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.port = 18631;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.on_accept = test_listener_on_accept;
+
+        law_server_t *old = law_server_create(&cfg);
+        law_server_t *new = law_server_create(&cfg);
+        assert(law_open(old) == LAW_ERR_OK);
+
+        /* Nobody is sending yet. */
+        assert(law_handoff_recv(new, TEST_HANDOFF_PATH, 20) == LAW_ERR_TIME);
+
+        /* A connection made before the handoff waits in the shared backlog. */
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(struct sockaddr_in));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(18631);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const int early = socket(AF_INET, SOCK_STREAM, 0);
+        assert(connect(early, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        close(early);
+
+        test_handoff_state_t handoff = { .old = old, .sent = LAW_ERR_SYS };
+        pthread_t sender;
+        assert(pthread_create(
+                &sender, 
+                NULL, 
+                test_handoff_sender, 
+                &handoff) == 0);
+        assert(law_handoff_recv(new, TEST_HANDOFF_PATH, 2000) == LAW_ERR_OK);
+        pthread_join(sender, NULL);
+        assert(handoff.sent == LAW_ERR_OK);
+        assert(access(TEST_HANDOFF_PATH, F_OK) == -1);
+
+        struct sockaddr_in inherited;
+        socklen_t len = sizeof(inherited);
+        assert(getsockname(
+                law_get_server_socket(new), 
+                (struct sockaddr*)&inherited, 
+                &len) == 0);
+        assert(ntohs(inherited.sin_port) == 18631);
+
+        /* Closing the old server leaves the inherited copy listening. */
+        assert(law_close(old) == LAW_ERR_OK);
+        law_server_destroy(old);
+
+        state->server = new;
+        assert(law_open(new) == LAW_ERR_OK);
+
+        pthread_t client;
+        assert(pthread_create(
+                &client, 
+                NULL, 
+                test_handoff_client, 
+                state) == 0);
+
+        assert(law_start(new) == LAW_ERR_OK);
+        pthread_join(client, NULL);
+        assert(law_close(new) == LAW_ERR_OK);
+
+        assert(atomic_load(&state->accepted[0]) == 2);
+
+        law_server_destroy(new);
+}
+
+typedef struct test_overload_state {
+        law_server_t *server;
+        atomic_int accepted;
+        atomic_int release;
+        char reply[256];
+        ssize_t raw;                            /** Read on the Raw Listener */
+} test_overload_state_t;
+
+static test_overload_state_t overload_state;
+
+sel_err_t test_overload_on_accept(
+        law_worker_t *worker, 
+        int socket, 
+        law_data_t data)
+{
+        atomic_fetch_add(&overload_state.accepted, 1);
+
+        /* Hold the only task until the client has been turned away. */
+        while(!atomic_load(&overload_state.release)) 
+                (void)law_sleep(worker, 1);
+
+        close(socket);
+        return LAW_ERR_OK;
+}
+
+static int test_overload_connect(const int port)
+{
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(struct sockaddr_in));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(fd != -1);
+        assert(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        return fd;
+}
+
+void *test_overload_client(void *arg)
+{
+        test_overload_state_t *state = arg;
+
+        const int busy = test_overload_connect(18641);
+        while(atomic_load(&state->accepted) < 1) 
+                law_time_sleep(1);
+
+        const int turned = test_overload_connect(18641);
+        size_t length = 0;
+        ssize_t got = 0;
+        while((got = read(
+                turned, 
+                state->reply + length, 
+                sizeof(state->reply) - 1 - length)) > 0) 
+                length += (size_t)got;
+        close(turned);
+
+        /* A listener that does not speak HTTP closes without a reply. */
+        char scratch[64];
+        const int raw = test_overload_connect(18642);
+        state->raw = read(raw, scratch, sizeof(scratch));
+        close(raw);
+
+        atomic_store(&state->release, 1);
+        close(busy);
+
+        law_stop(state->server);
+
+        return NULL;
+}
+
+void test_overload_reject()
+{
+        test_overload_state_t *state = &overload_state;
+        memset(state->reply, 0, sizeof(state->reply));
+        atomic_init(&state->accepted, 0);
+        atomic_init(&state->release, 0);
+        state->raw = -1;
+
+        law_listener_cfg_t listeners[2] = {
+                { 
+                        .protocol = LAW_PROTOCOL_TCP, 
+                        .port = 18641, 
+                        .backlog = 8,
+                        .on_accept = test_overload_on_accept },
+                { 
+                        .protocol = LAW_PROTOCOL_TCP, 
+                        .port = 18642, 
+                        .backlog = 8,
+                        .on_accept = test_overload_on_accept,
+                        .overload_reply = "",
+                        .overload_reply_len = 0 },
+        };
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.listeners = listeners;
+        cfg.num_listeners = 2;
+        cfg.worker_tasks = 1;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.overload = LAW_OVERLOAD_REJECT;
+        cfg.overload_retry = 3;
+
+        law_server_t *server = law_server_create(&cfg);
+        state->server = server;
+
+        assert(law_open(server) == LAW_ERR_OK);
+
+        pthread_t client;
+        assert(pthread_create(
+                &client, 
+                NULL, 
+                test_overload_client, 
+                state) == 0);
+
+        assert(law_start(server) == LAW_ERR_OK);
+        pthread_join(client, NULL);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(atomic_load(&state->accepted) == 1);
+        assert(law_get_rejected(server) == 2);
+        assert(state->raw == 0);
+        assert(!strncmp(state->reply, "HTTP/1.1 503 ", 13));
+        assert(strstr(state->reply, "Retry-After: 3\r\n"));
+
+        law_server_destroy(server);
+}
+
+typedef struct test_supply_state {
+        law_server_t *server;
+        atomic_int accepted;
+        atomic_int release;
+} test_supply_state_t;
+
+static test_supply_state_t supply_state;
+
+sel_err_t test_supply_on_accept(
+        law_worker_t *worker, 
+        int socket, 
+        law_data_t data)
+{
+        /* The first connection stays open, keeping the worker busy. */
+        if(atomic_fetch_add(&supply_state.accepted, 1) == 0) {
+                while(!atomic_load(&supply_state.release)) 
+                        (void)law_sleep(worker, 1);
+        }
+
+        (void)write(socket, "ok", 2);
+        close(socket);
+        return LAW_ERR_OK;
+}
+
+/** Read a connection to the end: true when the server wrote "ok". */
+static bool test_supply_served(const int fd)
+{
+        char reply[8];
+        memset(reply, 0, sizeof(reply));
+        size_t length = 0;
+        ssize_t got = 0;
+        while(length < sizeof(reply) - 1 && (got = read(
+                fd, 
+                reply + length, 
+                sizeof(reply) - 1 - length)) > 0) 
+                length += (size_t)got;
+        close(fd);
+        return !strcmp(reply, "ok");
+}
+
+void *test_supply_client(void *arg)
+{
+        test_supply_state_t *state = arg;
+
+        const int busy = test_overload_connect(18646);
+        while(atomic_load(&state->accepted) < 1) 
+                law_time_sleep(1);
+
+        /* Each finished task is cached by the busy worker, and every 
+         * task of the pool passes through it. */
+        for(int n = 0; n < 4; ++n) 
+                assert(test_supply_served(test_overload_connect(18646)));
+
+        atomic_store(&state->release, 1);
+        assert(test_supply_served(busy));
+
+        law_stop(state->server);
+
+        return NULL;
+}
+
+void test_supply_release()
+{
+        test_supply_state_t *state = &supply_state;
+        atomic_init(&state->accepted, 0);
+        atomic_init(&state->release, 0);
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.port = 18646;
+        cfg.worker_tasks = 2;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.on_accept = test_supply_on_accept;
+
+        assert(cfg.worker_supply > 1);
+
+        law_server_t *server = law_server_create(&cfg);
+        state->server = server;
+
+        assert(law_open(server) == LAW_ERR_OK);
+
+        pthread_t client;
+        assert(pthread_create(
+                &client, 
+                NULL, 
+                test_supply_client, 
+                state) == 0);
+
+        assert(law_start(server) == LAW_ERR_OK);
+        pthread_join(client, NULL);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(atomic_load(&state->accepted) == 5);
+
+        law_server_destroy(server);
+}
+
+sel_err_t test_supply_parked_on_accept(
+        law_worker_t *worker, 
+        int socket, 
+        law_data_t data)
+{
+        /* The first connection parks its worker in one long wait. */
+        if(atomic_fetch_add(&supply_state.accepted, 1) == 0) 
+                (void)law_sleep(worker, 3000);
+
+        (void)write(socket, "ok", 2);
+        close(socket);
+        return LAW_ERR_OK;
+}
+
+void *test_supply_parked_client(void *arg)
+{
+        test_supply_state_t *state = arg;
+
+        const int busy = test_overload_connect(18647);
+        while(atomic_load(&state->accepted) < 1) 
+                law_time_sleep(1);
+
+        /* Later connections need the task the parked worker has cached. */
+        const law_time_t start = law_time_millis();
+        for(int n = 0; n < 3; ++n) 
+                assert(test_supply_served(test_overload_connect(18647)));
+        assert(law_time_millis() - start < 1000);
+
+        assert(test_supply_served(busy));
+
+        law_stop(state->server);
+
+        return NULL;
+}
+
+void test_supply_parked()
+{
+        test_supply_state_t *state = &supply_state;
+        atomic_init(&state->accepted, 0);
+        atomic_init(&state->release, 0);
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.port = 18647;
+        cfg.worker_tasks = 2;
+        cfg.server_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.on_accept = test_supply_parked_on_accept;
+
+        assert(cfg.worker_supply > 1 && cfg.worker_timeout > 1000);
+
+        law_server_t *server = law_server_create(&cfg);
+        state->server = server;
+
+        assert(law_open(server) == LAW_ERR_OK);
+
+        pthread_t client;
+        assert(pthread_create(
+                &client, 
+                NULL, 
+                test_supply_parked_client, 
+                state) == 0);
+
+        assert(law_start(server) == LAW_ERR_OK);
+        pthread_join(client, NULL);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        assert(atomic_load(&state->accepted) == 4);
+
+        law_server_destroy(server);
+}
+
+#define TEST_CODEL_CLIENTS 12
+
+typedef struct test_codel_state {
+        law_server_t *server;
+        atomic_int served;
+        int shed;
+} test_codel_state_t;
+
+static test_codel_state_t codel_state;
+
+sel_err_t test_codel_on_accept(
+        law_worker_t *worker, 
+        int socket, 
+        law_data_t data)
+{
+        /* Block the worker so the connections behind this one queue up. */
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = 10000000 };
+        nanosleep(&ts, NULL);
+        close(socket);
+        atomic_fetch_add(&codel_state.served, 1);
+        return LAW_ERR_OK;
+}
+
+void *test_codel_client(void *arg)
+{
+        test_codel_state_t *state = arg;
+        int fds[TEST_CODEL_CLIENTS];
+
+        for(int n = 0; n < TEST_CODEL_CLIENTS; ++n) {
+                fds[n] = test_overload_connect(18651);
+        }
+
+        for(int n = 0; n < TEST_CODEL_CLIENTS; ++n) {
+                char reply[16];
+                memset(reply, 0, sizeof(reply));
+                if(read(fds[n], reply, 12) == 12 && 
+                   !strcmp(reply, "HTTP/1.1 503")) 
+                        ++state->shed;
+                close(fds[n]);
+        }
+
+        law_stop(state->server);
+
+        return NULL;
+}
+
+void test_codel_shed()
+{
+        test_codel_state_t *state = &codel_state;
+        atomic_init(&state->served, 0);
+        state->shed = 0;
+
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.port = 18651;
+        cfg.backlog = TEST_CODEL_CLIENTS;
+        cfg.worker_tasks = TEST_CODEL_CLIENTS;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.codel_target = 5;
+        cfg.codel_interval = 20;
+        cfg.on_accept = test_codel_on_accept;
+
+        law_server_t *server = law_server_create(&cfg);
+        state->server = server;
+
+        assert(law_open(server) == LAW_ERR_OK);
+
+        pthread_t client;
+        assert(pthread_create(
+                &client, 
+                NULL, 
+                test_codel_client, 
+                state) == 0);
+
+        assert(law_start(server) == LAW_ERR_OK);
+        pthread_join(client, NULL);
+        assert(law_close(server) == LAW_ERR_OK);
+
+        law_codel_stats_t stats;
+        law_codel_stats(server, 0, &stats);
+
+        assert(stats.dropped > 0);
+        assert(stats.dropped == (uint64_t)state->shed);
+        assert(stats.admitted == (uint64_t)atomic_load(&state->served));
+        assert(stats.admitted + stats.dropped == TEST_CODEL_CLIENTS);
+
+        law_server_destroy(server);
+}
+
+void test_sockopts()
+{
+        law_server_cfg_t cfg = law_server_sanity();
+        cfg.port = 18661;
+        cfg.server_timeout = 10;
+        cfg.worker_timeout = 10;
+        cfg.stack = 0x10000;
+        cfg.sockopts.nodelay = true;
+        cfg.sockopts.defer_accept = 1;
+        cfg.sockopts.rcvbuf = 0x10000;
+        cfg.on_accept = test_listener_on_accept;
+
+        law_server_t *server = law_server_create(&cfg);
+        assert(law_open(server) == LAW_ERR_OK);
+
+        const int fd = law_get_server_socket(server);
+        int value = 0;
+        socklen_t len = sizeof(int);
+
+        assert(getsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &value, &len) == 0);
+        assert(value == 1);
+        assert(getsockopt(
+                fd, 
+                IPPROTO_TCP, 
+                TCP_DEFER_ACCEPT, 
+                &value, 
+                &len) == 0);
+        assert(value > 0);
+        assert(getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &value, &len) == 0);
+        assert(value >= 0x10000);
+
+        /* Options left at zero keep the system default. */
+        assert(getsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &value, &len) == 0);
+        assert(value == 0);
+
+        assert(law_close(server) == LAW_ERR_OK);
+        law_server_destroy(server);
+}
 
 uint64_t law_slot_encode(law_slot_t *slot);
 
@@ -258,6 +1217,17 @@ int main(int argc, char **args)
         test_ready_set_push_pop();
 
         test_server_create_destroy();
+        test_spawn_local();
+        test_task_arena();
+        test_yield_sleep();
+        test_listeners();
+        test_unix_listener();
+        test_handoff();
+        test_overload_reject();
+        test_supply_release();
+        test_supply_parked();
+        test_codel_shed();
+        test_sockopts();
 
         test_slot_encode_decode();
 }
\ No newline at end of file